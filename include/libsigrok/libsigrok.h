@@ -176,6 +176,8 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
@@ -483,6 +485,16 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_session_file
+ * Opaque structure representing a session file opened for random access.
+ *
+ * None of the fields of this structure are meant to be accessed directly.
+ *
+ * @see sr_session_file_open(), sr_session_file_close().
+ */
+struct sr_session_file;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -514,6 +526,35 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Run n has the sample value at (values + n * unitsize), which repeats
+ * counts[n] times. Datafeed callbacks only receive this packet type
+ * when they were registered with sr_session_datafeed_rle_callback_add(),
+ * other receivers get the equivalent SR_DF_LOGIC packets.
+ */
+struct sr_datafeed_logic_rle {
+	/** Number of runs in the payload. */
+	uint64_t num_runs;
+	/** Number of bytes per sample value. */
+	uint16_t unitsize;
+	/** Sample values, one per run. */
+	void *values;
+	/** Number of samples per run, each at least 1. */
+	uint64_t *counts;
+};
+
+/** Statistics of the session feed thread's packet ring. */
+struct sr_session_feed_stats {
+	/** Number of packets which were passed to the feed thread. */
+	uint64_t packets;
+	/** Number of times a sender had to wait for free ring slots. */
+	uint64_t stalls;
+	/** Highest number of packets which were pending in the ring. */
+	uint64_t max_fill;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -618,12 +659,15 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/** If set, this output module accepts SR_DF_LOGIC_RLE packets. */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
 };
 
 struct sr_input;
 struct sr_input_module;
 struct sr_output;
 struct sr_output_module;
+struct sr_output_sink;
 struct sr_transform;
 struct sr_transform_module;
 
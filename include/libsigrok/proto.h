@@ -30,6 +30,10 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_float_strided(const struct sr_datafeed_analog *analog,
+		float *outbuf, size_t stride);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -57,6 +61,10 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API uint64_t sr_logic_rle_sample_count(const struct sr_datafeed_logic_rle *rle);
+SR_API uint64_t sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint64_t *run_idx, uint64_t *run_pos, void *dst,
+		uint64_t max_samples);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -68,6 +76,9 @@ SR_API int sr_log_loglevel_get(void);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
+SR_API int sr_log_deferred_enable(size_t num_records, gboolean background);
+SR_API int sr_log_deferred_disable(void);
+SR_API int sr_log_deferred_flush(void);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -141,10 +152,32 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 SR_API int sr_session_dev_list(struct sr_session *session, GSList **devlist);
 SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig);
 
+/* Random access to session files */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file);
+SR_API int sr_session_file_close(struct sr_session_file *file);
+SR_API int sr_session_file_logic_info(struct sr_session_file *file,
+		unsigned int *unitsize, uint64_t *num_samples);
+SR_API int sr_session_file_analog_info(struct sr_session_file *file,
+		unsigned int *num_channels, uint64_t *num_samples);
+SR_API int sr_session_file_logic_read(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *buf,
+		uint64_t *read_count);
+SR_API int sr_session_file_analog_read(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *read_count);
+SR_API int sr_session_file_logic_changes(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *changes);
+SR_API int sr_session_file_analog_range(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *min, float *max);
+
 /* Datafeed setup */
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_rle_callback_add(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
@@ -153,6 +186,10 @@ SR_API int sr_session_stop(struct sr_session *session);
 SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
+SR_API int sr_session_feed_thread_set(struct sr_session *session,
+		size_t ring_size);
+SR_API int sr_session_feed_stats_get(struct sr_session *session,
+		struct sr_session_feed_stats *stats);
 
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
@@ -176,6 +213,10 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_mapped(const struct sr_input *in,
+		void *data, size_t len);
+SR_API int sr_input_send_file(const struct sr_input *in, const char *filename,
+		uint64_t offset);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
@@ -198,8 +239,20 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink);
 SR_API int sr_output_free(const struct sr_output *o);
 
+/*--- output/sink.c ---------------------------------------------------------*/
+
+SR_API struct sr_output_sink *sr_output_sink_fd_new(int fd, size_t buffer_size);
+SR_API struct sr_output_sink *sr_output_sink_memory_new(void *mem, size_t size);
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink);
+SR_API uint64_t sr_output_sink_bytes(const struct sr_output_sink *sink);
+SR_API void sr_output_sink_reset(struct sr_output_sink *sink);
+SR_API int sr_output_sink_free(struct sr_output_sink *sink);
+
 /*--- transform/transform.c -------------------------------------------------*/
 
 SR_API const struct sr_transform_module **sr_transform_list(void);
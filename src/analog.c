@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include <float.h>
 #include <math.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -157,70 +158,428 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
-/**
- * Convert an analog datafeed payload to an array of floats.
- *
- * The caller must provide the #outbuf space for the conversion result,
- * and is expected to free allocated space after use.
- *
- * @param[in] analog The analog payload to convert. Must not be NULL.
- *                   analog->data, analog->meaning, and analog->encoding
- *                   must not be NULL.
- * @param[out] outbuf Memory where to store the result. Must not be NULL.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR Unsupported encoding.
- * @retval SR_ERR_ARG Invalid argument.
- *
- * @since 0.4.0
+/*
+ * Conversion of analog sample data to floating point values. Each
+ * supported input encoding has a scalar kernel per output type, which
+ * reads values by means of inlined endianess aware accessors. Integer
+ * input of up to 32 bits and single precision input in either byte order
+ * additionally have SIMD kernels which get selected at runtime. Double
+ * precision input only uses the scalar kernels, the conversion itself
+ * is not the bottleneck there. All kernels calculate scale and offset
+ * in double precision, results are identical for all of them.
  */
-SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
-		float *outbuf)
+
+/** @cond PRIVATE */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_ANALOG_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*analog_conv_flt)(const uint8_t *src, size_t count,
+	double scale, double offset, float *dst, size_t stride);
+typedef void (*analog_conv_dbl)(const uint8_t *src, size_t count,
+	double scale, double offset, double *dst, size_t stride);
+
+#define ANALOG_CONV_SCALAR(name, reader, width) \
+static void conv_ ## name ## _flt(const uint8_t *src, size_t count, \
+	double scale, double offset, float *dst, size_t stride) \
+{ \
+	double value; \
+	while (count--) { \
+		value = reader(src); \
+		src += width; \
+		value *= scale; \
+		value += offset; \
+		*dst = value; \
+		dst += stride; \
+	} \
+} \
+static void conv_ ## name ## _dbl(const uint8_t *src, size_t count, \
+	double scale, double offset, double *dst, size_t stride) \
+{ \
+	double value; \
+	while (count--) { \
+		value = reader(src); \
+		src += width; \
+		value *= scale; \
+		value += offset; \
+		*dst = value; \
+		dst += stride; \
+	} \
+}
+
+enum analog_simd_type {
+	ANALOG_SIMD_NONE,
+	ANALOG_SIMD_U8,
+	ANALOG_SIMD_I8,
+	ANALOG_SIMD_U16LE,
+	ANALOG_SIMD_U16BE,
+	ANALOG_SIMD_I16LE,
+	ANALOG_SIMD_I16BE,
+	ANALOG_SIMD_U32LE,
+	ANALOG_SIMD_U32BE,
+	ANALOG_SIMD_I32LE,
+	ANALOG_SIMD_I32BE,
+	ANALOG_SIMD_FLTLE,
+	ANALOG_SIMD_FLTBE,
+};
+
+enum analog_simd_level {
+	ANALOG_SIMD_SCALAR,
+	ANALOG_SIMD_SSE2,
+	ANALOG_SIMD_AVX2,
+};
+/** @endcond */
+
+ANALOG_CONV_SCALAR(u8, read_u8, 1)
+ANALOG_CONV_SCALAR(i8, read_i8, 1)
+ANALOG_CONV_SCALAR(u16le, read_u16le, 2)
+ANALOG_CONV_SCALAR(u16be, read_u16be, 2)
+ANALOG_CONV_SCALAR(i16le, read_i16le, 2)
+ANALOG_CONV_SCALAR(i16be, read_i16be, 2)
+ANALOG_CONV_SCALAR(u32le, read_u32le, 4)
+ANALOG_CONV_SCALAR(u32be, read_u32be, 4)
+ANALOG_CONV_SCALAR(i32le, read_i32le, 4)
+ANALOG_CONV_SCALAR(i32be, read_i32be, 4)
+ANALOG_CONV_SCALAR(fltle, read_fltle, 4)
+ANALOG_CONV_SCALAR(fltbe, read_fltbe, 4)
+ANALOG_CONV_SCALAR(dblle, read_dblle, 8)
+ANALOG_CONV_SCALAR(dblbe, read_dblbe, 8)
+
+static const struct analog_conv_desc {
+	gboolean is_float, is_signed, is_bigendian;
+	size_t unitsize;
+	analog_conv_flt conv_flt;
+	analog_conv_dbl conv_dbl;
+	enum analog_simd_type simd_type;
+} analog_convs[] = {
+	{ FALSE, FALSE, FALSE, 1, conv_u8_flt, conv_u8_dbl, ANALOG_SIMD_U8, },
+	{ FALSE, TRUE, FALSE, 1, conv_i8_flt, conv_i8_dbl, ANALOG_SIMD_I8, },
+	{ FALSE, FALSE, FALSE, 2, conv_u16le_flt, conv_u16le_dbl, ANALOG_SIMD_U16LE, },
+	{ FALSE, FALSE, TRUE, 2, conv_u16be_flt, conv_u16be_dbl, ANALOG_SIMD_U16BE, },
+	{ FALSE, TRUE, FALSE, 2, conv_i16le_flt, conv_i16le_dbl, ANALOG_SIMD_I16LE, },
+	{ FALSE, TRUE, TRUE, 2, conv_i16be_flt, conv_i16be_dbl, ANALOG_SIMD_I16BE, },
+	{ FALSE, FALSE, FALSE, 4, conv_u32le_flt, conv_u32le_dbl, ANALOG_SIMD_U32LE, },
+	{ FALSE, FALSE, TRUE, 4, conv_u32be_flt, conv_u32be_dbl, ANALOG_SIMD_U32BE, },
+	{ FALSE, TRUE, FALSE, 4, conv_i32le_flt, conv_i32le_dbl, ANALOG_SIMD_I32LE, },
+	{ FALSE, TRUE, TRUE, 4, conv_i32be_flt, conv_i32be_dbl, ANALOG_SIMD_I32BE, },
+	{ TRUE, FALSE, FALSE, 4, conv_fltle_flt, conv_fltle_dbl, ANALOG_SIMD_FLTLE, },
+	{ TRUE, FALSE, TRUE, 4, conv_fltbe_flt, conv_fltbe_dbl, ANALOG_SIMD_FLTBE, },
+	{ TRUE, FALSE, FALSE, 8, conv_dblle_flt, conv_dblle_dbl, ANALOG_SIMD_NONE, },
+	{ TRUE, FALSE, TRUE, 8, conv_dblbe_flt, conv_dblbe_dbl, ANALOG_SIMD_NONE, },
+};
+
+#ifdef HAVE_ANALOG_X86
+/*
+ * Convert four 32bit values to double precision, apply scale and
+ * offset, and store the result. Unsigned values get biased into the
+ * signed range and back, which is exact in double precision. Keep
+ * separate multiply and add steps to match the scalar implementation's
+ * rounding.
+ */
+__attribute__((target("sse2")))
+static inline void conv_store4_sse2(enum analog_simd_type type, __m128i v,
+	__m128d scale, __m128d offset, float *fdst, double *ddst)
+{
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	const __m128d dbias = _mm_set1_pd(2147483648.0);
+	__m128 f;
+	__m128d lo, hi;
+
+	switch (type) {
+	case ANALOG_SIMD_FLTLE:
+	case ANALOG_SIMD_FLTBE:
+		f = _mm_castsi128_ps(v);
+		lo = _mm_cvtps_pd(f);
+		hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+		break;
+	case ANALOG_SIMD_U32LE:
+	case ANALOG_SIMD_U32BE:
+		v = _mm_xor_si128(v, bias);
+		lo = _mm_add_pd(_mm_cvtepi32_pd(v), dbias);
+		hi = _mm_add_pd(_mm_cvtepi32_pd(
+			_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), dbias);
+		break;
+	default:
+		lo = _mm_cvtepi32_pd(v);
+		hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+		break;
+	}
+	lo = _mm_add_pd(_mm_mul_pd(lo, scale), offset);
+	hi = _mm_add_pd(_mm_mul_pd(hi, scale), offset);
+	if (fdst) {
+		_mm_storeu_ps(fdst, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+	} else {
+		_mm_storeu_pd(ddst, lo);
+		_mm_storeu_pd(ddst + 2, hi);
+	}
+}
+
+/* Swap the bytes of 16bit values. */
+__attribute__((target("sse2")))
+static inline __m128i bswap16_sse2(__m128i x)
 {
-	size_t count;
-	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+/* Swap the bytes of 32bit values. */
+__attribute__((target("sse2")))
+static inline __m128i bswap32_sse2(__m128i x)
+{
+	x = bswap16_sse2(x);
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+/* Convert 8 values per iteration, leave the remainder to the caller. */
+__attribute__((target("sse2")))
+static size_t conv_simd_sse2(enum analog_simd_type type, const uint8_t *src,
+	size_t count, double scale, double offset, float *fdst, double *ddst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128d vscale = _mm_set1_pd(scale);
+	const __m128d voffset = _mm_set1_pd(offset);
+	__m128i x, lo, hi;
+	size_t done;
+
+	for (done = 0; done + 8 <= count; done += 8) {
+		switch (type) {
+		case ANALOG_SIMD_U8:
+			x = _mm_loadl_epi64((const __m128i *)&src[done]);
+			lo = _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, zero), zero);
+			hi = _mm_unpackhi_epi16(_mm_unpacklo_epi8(x, zero), zero);
+			break;
+		case ANALOG_SIMD_I8:
+			x = _mm_loadl_epi64((const __m128i *)&src[done]);
+			x = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+			break;
+		case ANALOG_SIMD_U16LE:
+		case ANALOG_SIMD_U16BE:
+			x = _mm_loadu_si128((const __m128i *)&src[2 * done]);
+			if (type == ANALOG_SIMD_U16BE)
+				x = bswap16_sse2(x);
+			lo = _mm_unpacklo_epi16(x, zero);
+			hi = _mm_unpackhi_epi16(x, zero);
+			break;
+		case ANALOG_SIMD_I16LE:
+		case ANALOG_SIMD_I16BE:
+			x = _mm_loadu_si128((const __m128i *)&src[2 * done]);
+			if (type == ANALOG_SIMD_I16BE)
+				x = bswap16_sse2(x);
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+			break;
+		case ANALOG_SIMD_U32BE:
+		case ANALOG_SIMD_I32BE:
+		case ANALOG_SIMD_FLTBE:
+			lo = _mm_loadu_si128((const __m128i *)&src[4 * done]);
+			hi = _mm_loadu_si128((const __m128i *)&src[4 * done + 16]);
+			lo = bswap32_sse2(lo);
+			hi = bswap32_sse2(hi);
+			break;
+		default:
+			lo = _mm_loadu_si128((const __m128i *)&src[4 * done]);
+			hi = _mm_loadu_si128((const __m128i *)&src[4 * done + 16]);
+			break;
+		}
+		conv_store4_sse2(type, lo, vscale, voffset,
+			fdst ? &fdst[done] : NULL, ddst ? &ddst[done] : NULL);
+		conv_store4_sse2(type, hi, vscale, voffset,
+			fdst ? &fdst[done + 4] : NULL, ddst ? &ddst[done + 4] : NULL);
+	}
+
+	return done;
+}
+
+/* Convert four 32bit values to double precision, see the SSE2 variant. */
+__attribute__((target("avx2")))
+static inline __m256d conv_cvt4_avx2(enum analog_simd_type type, __m128i v)
+{
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	const __m256d dbias = _mm256_set1_pd(2147483648.0);
+
+	switch (type) {
+	case ANALOG_SIMD_FLTLE:
+	case ANALOG_SIMD_FLTBE:
+		return _mm256_cvtps_pd(_mm_castsi128_ps(v));
+	case ANALOG_SIMD_U32LE:
+	case ANALOG_SIMD_U32BE:
+		v = _mm_xor_si128(v, bias);
+		return _mm256_add_pd(_mm256_cvtepi32_pd(v), dbias);
+	default:
+		return _mm256_cvtepi32_pd(v);
+	}
+}
+
+__attribute__((target("avx2")))
+static size_t conv_simd_avx2(enum analog_simd_type type, const uint8_t *src,
+	size_t count, double scale, double offset, float *fdst, double *ddst)
+{
+	const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+		9, 8, 11, 10, 13, 12, 15, 14);
+	const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256d vscale = _mm256_set1_pd(scale);
+	const __m256d voffset = _mm256_set1_pd(offset);
+	__m256i v;
+	__m128i x;
+	__m256d lo, hi;
+	size_t done;
+
+	for (done = 0; done + 8 <= count; done += 8) {
+		switch (type) {
+		case ANALOG_SIMD_U8:
+			x = _mm_loadl_epi64((const __m128i *)&src[done]);
+			v = _mm256_cvtepu8_epi32(x);
+			break;
+		case ANALOG_SIMD_I8:
+			x = _mm_loadl_epi64((const __m128i *)&src[done]);
+			v = _mm256_cvtepi8_epi32(x);
+			break;
+		case ANALOG_SIMD_U16LE:
+		case ANALOG_SIMD_U16BE:
+			x = _mm_loadu_si128((const __m128i *)&src[2 * done]);
+			if (type == ANALOG_SIMD_U16BE)
+				x = _mm_shuffle_epi8(x, swap16);
+			v = _mm256_cvtepu16_epi32(x);
+			break;
+		case ANALOG_SIMD_I16LE:
+		case ANALOG_SIMD_I16BE:
+			x = _mm_loadu_si128((const __m128i *)&src[2 * done]);
+			if (type == ANALOG_SIMD_I16BE)
+				x = _mm_shuffle_epi8(x, swap16);
+			v = _mm256_cvtepi16_epi32(x);
+			break;
+		case ANALOG_SIMD_U32BE:
+		case ANALOG_SIMD_I32BE:
+		case ANALOG_SIMD_FLTBE:
+			v = _mm256_loadu_si256((const __m256i *)&src[4 * done]);
+			v = _mm256_shuffle_epi8(v, swap32);
+			break;
+		default:
+			v = _mm256_loadu_si256((const __m256i *)&src[4 * done]);
+			break;
+		}
+		/* Have 8 values of 32 bits in v. */
+		if (type == ANALOG_SIMD_U8 || type == ANALOG_SIMD_I8 ||
+				type == ANALOG_SIMD_U16LE || type == ANALOG_SIMD_U16BE ||
+				type == ANALOG_SIMD_I16LE || type == ANALOG_SIMD_I16BE) {
+			lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+			hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+		} else {
+			lo = conv_cvt4_avx2(type, _mm256_castsi256_si128(v));
+			hi = conv_cvt4_avx2(type, _mm256_extracti128_si256(v, 1));
+		}
+		lo = _mm256_add_pd(_mm256_mul_pd(lo, vscale), voffset);
+		hi = _mm256_add_pd(_mm256_mul_pd(hi, vscale), voffset);
+		if (fdst) {
+			_mm_storeu_ps(&fdst[done], _mm256_cvtpd_ps(lo));
+			_mm_storeu_ps(&fdst[done + 4], _mm256_cvtpd_ps(hi));
+		} else {
+			_mm256_storeu_pd(&ddst[done], lo);
+			_mm256_storeu_pd(&ddst[done + 4], hi);
+		}
+	}
+
+	return done;
+}
+#endif
+
+static enum analog_simd_level get_analog_simd_level(void)
+{
+	static gsize init_done;
+	static enum analog_simd_level level;
+
+	if (g_once_init_enter(&init_done)) {
+		level = ANALOG_SIMD_SCALAR;
+#ifdef HAVE_ANALOG_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			level = ANALOG_SIMD_AVX2;
+		else if (__builtin_cpu_supports("sse2"))
+			level = ANALOG_SIMD_SSE2;
+#endif
+		sr_dbg("Using %s analog conversion kernels.",
+			level == ANALOG_SIMD_AVX2 ? "AVX2" :
+			level == ANALOG_SIMD_SSE2 ? "SSE2" : "scalar");
+		g_once_init_leave(&init_done, 1);
+	}
+
+	return level;
+}
+
+/*
+ * Convert analog sample data to single or double precision values.
+ * Exactly one of fdst and ddst is used. The output values are stored
+ * stride elements apart.
+ */
+static int analog_convert(const struct sr_datafeed_analog *analog,
+	float *fdst, double *ddst, size_t stride)
+{
+	const struct analog_conv_desc *desc;
+	const struct sr_analog_encoding *enc;
+	size_t count, idx, done;
+	gboolean is_bigendian, host_bigendian, is_native;
+	double scale, offset;
+	const uint8_t *src;
 	char type_text[10];
 
 	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
 		return SR_ERR_ARG;
-	if (!outbuf)
+	if ((!fdst && !ddst) || !stride)
 		return SR_ERR_ARG;
 
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
-
-	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
-	 * Error messages for unsupported input property combinations
-	 * will only be seen by developers and maintainers of input
-	 * formats or acquisition device drivers. Terse output is
-	 * acceptable there, users shall never see them.
-	 */
+	enc = analog->encoding;
 #ifdef WORDS_BIGENDIAN
 	host_bigendian = TRUE;
 #else
 	host_bigendian = FALSE;
 #endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
 
 	/*
-	 * Prepare the iteration over the sample data: Get the common
-	 * scale/offset factors which apply to all individual values.
-	 * Position the read pointer on the first byte of input data.
+	 * Lookup the kernel for the input data's encoding. Error messages
+	 * for unsupported input property combinations will only be seen
+	 * by developers and maintainers of input formats or acquisition
+	 * device drivers. Terse output is acceptable there, users shall
+	 * never see them. Signedness does not apply to floating point,
+	 * endianess does not apply to single byte values.
+	 */
+	is_bigendian = enc->unitsize > 1 && enc->is_bigendian;
+	desc = NULL;
+	for (idx = 0; idx < ARRAY_SIZE(analog_convs); idx++) {
+		desc = &analog_convs[idx];
+		if (desc->unitsize != enc->unitsize)
+			continue;
+		if (desc->is_float != enc->is_float)
+			continue;
+		if (!desc->is_float && desc->is_signed != enc->is_signed)
+			continue;
+		if (desc->is_bigendian != is_bigendian)
+			continue;
+		break;
+	}
+	if (idx == ARRAY_SIZE(analog_convs)) {
+		snprintf(type_text, sizeof(type_text), "%c%zu%s",
+			enc->is_float ? 'f' : enc->is_signed ? 'i' : 'u',
+			(size_t)enc->unitsize * 8, enc->is_bigendian ? "be" : "le");
+		sr_err("Unsupported type for analog conversion: %s.",
+			type_text);
+		return SR_ERR;
+	}
+
+	/*
+	 * Get the common scale/offset factors which apply to all
+	 * individual values.
 	 */
-	offset = analog->encoding->offset.p;
-	offset /= analog->encoding->offset.q;
-	scale = analog->encoding->scale.p;
-	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
+	offset = enc->offset.p;
+	offset /= enc->offset.q;
+	scale = enc->scale.p;
+	scale /= enc->scale.q;
+	src = analog->data;
 
 	/*
 	 * Immediately handle the special case where input data needs
@@ -228,154 +587,121 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * native format. Do apply scale/offset though when applicable
 	 * on our way out.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
+	is_native = fdst && stride == 1 && desc->is_float &&
+		desc->unitsize == sizeof(fdst[0]) &&
+		desc->is_bigendian == host_bigendian;
+	if (is_native) {
+		memcpy(fdst, src, count * sizeof(fdst[0]));
 		if (scale != 1.0 || offset != 0.0) {
 			while (count--) {
-				*outbuf *= scale;
-				*outbuf += offset;
-				outbuf++;
+				*fdst *= scale;
+				*fdst += offset;
+				fdst++;
 			}
 		}
 		return SR_OK;
 	}
 
-	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
-	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
+	/* Have SIMD kernels convert most of the data where available. */
+	done = 0;
+#ifdef HAVE_ANALOG_X86
+	if (stride == 1 && desc->simd_type != ANALOG_SIMD_NONE) {
+		switch (get_analog_simd_level()) {
+		case ANALOG_SIMD_AVX2:
+			done = conv_simd_avx2(desc->simd_type, src, count,
+				scale, offset, fdst, ddst);
+			break;
+		case ANALOG_SIMD_SSE2:
+			done = conv_simd_sse2(desc->simd_type, src, count,
+				scale, offset, fdst, ddst);
+			break;
+		default:
+			break;
 		}
-		return SR_OK;
-	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
-		return SR_ERR;
 	}
+#endif
+	src += done * desc->unitsize;
+	count -= done;
 
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
+	if (fdst)
+		desc->conv_flt(src, count, scale, offset, &fdst[done * stride], stride);
+	else
+		desc->conv_dbl(src, count, scale, offset, &ddst[done * stride], stride);
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of floats.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
+		float *outbuf)
+{
+	return analog_convert(analog, outbuf, NULL, 1);
+}
+
+/**
+ * Convert an analog datafeed payload to an array of floats, and store
+ * the values with a fixed distance.
+ *
+ * Value n gets stored at outbuf[n * stride]. Use this to convert
+ * several single-channel payloads into an interleaved multi-channel
+ * buffer, or to fill one column of a caller's table.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ * @param[in] stride The distance of output values, in units of floats.
+ *                   Must not be 0.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_float_strided(const struct sr_datafeed_analog *analog,
+		float *outbuf, size_t stride)
+{
+	return analog_convert(analog, outbuf, NULL, stride);
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Other than sr_analog_to_float() this keeps the precision of wide
+ * integer or double precision input data.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	return analog_convert(analog, NULL, outbuf, 1);
 }
 
 /**
@@ -516,6 +842,82 @@ SR_API void sr_rational_set(struct sr_rational *r, int64_t p, uint64_t q)
 	r->q = q;
 }
 
+/*
+ * Upper bound for the numerator and denominator of approximations.
+ * Keeps both exactly representable as double, and leaves headroom
+ * for later multiplication of the rational numbers.
+ */
+#define RATIONAL_APPROX_LIMIT	1000000000000000ULL
+
+/**
+ * Approximate a floating point value by a rational number.
+ *
+ * Uses the continued fraction expansion of the value, and stops at the
+ * first convergent which matches the value to double precision, or
+ * before the numerator or denominator would exceed 10^15. Convergents
+ * are the best approximations for their denominator's size, so values
+ * like 0.1 or 1/3 result in 1/10 and 1/3. Use this to express a
+ * device's calibration, which is only available in floating point
+ * format, as an analog encoding's scale or offset.
+ *
+ * @param[out] r Rational number struct to set. Must not be NULL.
+ * @param[in] value The value to approximate.
+ *
+ * @private
+ */
+SR_PRIV void sr_rational_from_double(struct sr_rational *r, double value)
+{
+	uint64_t h, h1, h2, k, k1, k2, a;
+	double x, frac;
+	int i;
+
+	r->q = 1;
+	if (isnan(value)) {
+		r->p = 0;
+		return;
+	}
+	x = fabs(value);
+	if (x >= (double)RATIONAL_APPROX_LIMIT) {
+		/* Out of range, saturate. Not seen in device calibration. */
+		r->p = (int64_t)RATIONAL_APPROX_LIMIT;
+		if (value < 0)
+			r->p = -r->p;
+		return;
+	}
+
+	/* Convergents h/k, starting at h[-1]/k[-1] = 1/0, h[-2]/k[-2] = 0/1. */
+	h1 = 1;
+	h2 = 0;
+	k1 = 0;
+	k2 = 1;
+	h = 0;
+	k = 1;
+	for (i = 0; i < 64; i++) {
+		if (x >= (double)RATIONAL_APPROX_LIMIT)
+			break;
+		a = (uint64_t)floor(x);
+		if (a && h1 > (RATIONAL_APPROX_LIMIT - h2) / a)
+			break;
+		if (a && k1 > (RATIONAL_APPROX_LIMIT - k2) / a)
+			break;
+		h = a * h1 + h2;
+		k = a * k1 + k2;
+		h2 = h1;
+		h1 = h;
+		k2 = k1;
+		k1 = k;
+		if (fabs((double)h / k - fabs(value)) <= fabs(value) * DBL_EPSILON)
+			break;
+		frac = x - a;
+		if (frac <= 0.0)
+			break;
+		x = 1.0 / frac;
+	}
+
+	r->p = (value < 0) ? -(int64_t)h : (int64_t)h;
+	r->q = k;
+}
+
 #ifndef HAVE___INT128_T
 struct sr_int128_t {
 	int64_t high;
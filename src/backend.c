@@ -26,6 +26,9 @@
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include "minilzo/minilzo.h"
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "backend"
@@ -145,6 +148,13 @@ SR_API GSList *sr_buildinfo_libs_get(void)
 	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBZIP_VERSION));
 	l = g_slist_append(l, m);
 
+#ifdef HAVE_LIBZSTD
+	m = g_slist_append(NULL, g_strdup("libzstd"));
+	m = g_slist_append(m, g_strdup_printf("%s (rt: %s)",
+		ZSTD_VERSION_STRING, ZSTD_versionString()));
+	l = g_slist_append(l, m);
+#endif
+
 	m = g_slist_append(NULL, g_strdup("minilzo"));
 	m = g_slist_append(m, g_strdup_printf("%s", lzo_version_string()));
 	l = g_slist_append(l, m);
@@ -671,6 +681,7 @@ SR_API int sr_exit(struct sr_context *ctx)
 	hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
+	sr_usb_cache_free(ctx);
 	libusb_exit(ctx->libusb_ctx);
 #endif
 
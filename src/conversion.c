@@ -107,3 +107,812 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 
 	return SR_OK;
 }
+
+/*
+ * Bit matrix transpose of channel-planar logic data.
+ *
+ * Several USB logic analyzers deliver their sample data "channel major":
+ * one multi-bit word per enabled channel holds several consecutive
+ * samples of that channel. The session feed expects "sample major" data
+ * where one unit holds all channels' bits of one sample. Converting one
+ * layout to the other is a bit matrix transpose. The conversion below
+ * cuts the matrix into 8x8 bit blocks (8 channels by 8 samples), gathers
+ * these blocks into 64bit words, transposes many of them at once with a
+ * SIMD kernel that gets selected at runtime, and scatters the result to
+ * the caller's logic buffer.
+ */
+
+/** @cond PRIVATE */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_TRANSPOSE_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_TRANSPOSE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define TRANSPOSE_BLOCK_COUNT	512
+
+typedef void (*transpose_blocks_func)(uint64_t *blocks, size_t count);
+/** @endcond */
+
+/*
+ * Transpose an 8x8 bit matrix which is kept in a 64bit word. Byte n
+ * holds row n, bit m of a byte holds column m. See "Hacker's Delight",
+ * section 7-3 (delta swaps across the diagonal).
+ */
+static inline uint64_t transpose8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+static void transpose_blocks_scalar(uint64_t *blocks, size_t count)
+{
+	while (count--) {
+		*blocks = transpose8x8(*blocks);
+		blocks++;
+	}
+}
+
+#ifdef HAVE_TRANSPOSE_X86
+__attribute__((target("sse2")))
+static void transpose_blocks_sse2(uint64_t *blocks, size_t count)
+{
+	const __m128i m1 = _mm_set1_epi64x(0x00aa00aa00aa00aaLL);
+	const __m128i m2 = _mm_set1_epi64x(0x0000cccc0000ccccLL);
+	const __m128i m3 = _mm_set1_epi64x(0x00000000f0f0f0f0LL);
+	__m128i x, t;
+
+	while (count >= 2) {
+		x = _mm_loadu_si128((const __m128i *)blocks);
+		t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 7)), m1);
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 7)));
+		t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 14)), m2);
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 14)));
+		t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 28)), m3);
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 28)));
+		_mm_storeu_si128((__m128i *)blocks, x);
+		blocks += 2;
+		count -= 2;
+	}
+	transpose_blocks_scalar(blocks, count);
+}
+
+__attribute__((target("avx2")))
+static void transpose_blocks_avx2(uint64_t *blocks, size_t count)
+{
+	const __m256i m1 = _mm256_set1_epi64x(0x00aa00aa00aa00aaLL);
+	const __m256i m2 = _mm256_set1_epi64x(0x0000cccc0000ccccLL);
+	const __m256i m3 = _mm256_set1_epi64x(0x00000000f0f0f0f0LL);
+	__m256i x, t;
+
+	while (count >= 4) {
+		x = _mm256_loadu_si256((const __m256i *)blocks);
+		t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(x, 7)), m1);
+		x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi64(t, 7)));
+		t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(x, 14)), m2);
+		x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi64(t, 14)));
+		t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(x, 28)), m3);
+		x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi64(t, 28)));
+		_mm256_storeu_si256((__m256i *)blocks, x);
+		blocks += 4;
+		count -= 4;
+	}
+	transpose_blocks_sse2(blocks, count);
+}
+#endif
+
+#ifdef HAVE_TRANSPOSE_NEON
+static void transpose_blocks_neon(uint64_t *blocks, size_t count)
+{
+	const uint64x2_t m1 = vdupq_n_u64(UINT64_C(0x00aa00aa00aa00aa));
+	const uint64x2_t m2 = vdupq_n_u64(UINT64_C(0x0000cccc0000cccc));
+	const uint64x2_t m3 = vdupq_n_u64(UINT64_C(0x00000000f0f0f0f0));
+	uint64x2_t x, t;
+
+	while (count >= 2) {
+		x = vld1q_u64(blocks);
+		t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 7)), m1);
+		x = veorq_u64(x, veorq_u64(t, vshlq_n_u64(t, 7)));
+		t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 14)), m2);
+		x = veorq_u64(x, veorq_u64(t, vshlq_n_u64(t, 14)));
+		t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 28)), m3);
+		x = veorq_u64(x, veorq_u64(t, vshlq_n_u64(t, 28)));
+		vst1q_u64(blocks, x);
+		blocks += 2;
+		count -= 2;
+	}
+	transpose_blocks_scalar(blocks, count);
+}
+#endif
+
+static transpose_blocks_func get_transpose_blocks(void)
+{
+	static gsize init_done;
+	static transpose_blocks_func func;
+	const char *name;
+
+	if (g_once_init_enter(&init_done)) {
+		func = transpose_blocks_scalar;
+		name = "scalar";
+#ifdef HAVE_TRANSPOSE_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			func = transpose_blocks_avx2;
+			name = "AVX2";
+		} else if (__builtin_cpu_supports("sse2")) {
+			func = transpose_blocks_sse2;
+			name = "SSE2";
+		}
+#endif
+#ifdef HAVE_TRANSPOSE_NEON
+		func = transpose_blocks_neon;
+		name = "NEON";
+#endif
+		sr_dbg("Using %s bit transpose kernel.", name);
+		g_once_init_leave(&init_done, 1);
+	}
+
+	return func;
+}
+
+/**
+ * Convert channel-planar logic data to sample-major logic data.
+ *
+ * The input is a sequence of batches. Each batch holds one little endian
+ * word of @a word_bits width per enabled channel, in the order of the
+ * @a channel_map. Each word carries @a word_bits consecutive samples of
+ * one channel, starting at the least significant bit, or at the most
+ * significant bit when @a msb_first is set.
+ *
+ * The output holds @a word_bits samples per batch, each sample is
+ * @a unitsize bytes wide and is stored in little endian format (the
+ * session feed's logic data layout). Output bits which do not correspond
+ * to an input channel are cleared.
+ *
+ * @param[out] dst The output buffer, must provide space for
+ *   batch_count * word_bits * unitsize bytes.
+ * @param[in] unitsize The number of bytes per output sample (1 to 8).
+ * @param[in] src The channel-planar input data.
+ * @param[in] batch_count The number of complete batches to convert.
+ * @param[in] word_bits The number of samples per channel word
+ *   (8, 16, 32, or 64).
+ * @param[in] msb_first Whether the most significant bit of a channel
+ *   word holds the earliest sample.
+ * @param[in] channel_map The output bit position for each input word
+ *   of a batch. Can be NULL for an identity mapping.
+ * @param[in] channel_count The number of channel words per batch.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_planar_to_logic(uint8_t *dst, size_t unitsize,
+		const uint8_t *src, size_t batch_count, size_t word_bits,
+		gboolean msb_first, const uint8_t *channel_map,
+		size_t channel_count)
+{
+	transpose_blocks_func transpose_blocks;
+	uint64_t blocks[TRANSPOSE_BLOCK_COUNT];
+	static const uint8_t zeros[8];
+	const uint8_t *rows[64], *const *rdptr;
+	int src_offset[64];
+	size_t word_bytes, batch_bytes, blocks_per_batch, batches_per_run;
+	size_t run, batch, group, row, byte_idx, sample_idx, idx;
+	uint8_t *wrptr;
+	uint64_t block;
+	int offset;
+
+	if (!dst || !src)
+		return SR_ERR_ARG;
+	if (!unitsize || unitsize > 8)
+		return SR_ERR_ARG;
+	if (word_bits != 8 && word_bits != 16 && word_bits != 32 && word_bits != 64)
+		return SR_ERR_ARG;
+	if (!channel_count || channel_count > 8 * unitsize)
+		return SR_ERR_ARG;
+
+	/* Lookup the input word for each of the output bits. */
+	word_bytes = word_bits / 8;
+	for (idx = 0; idx < 8 * unitsize; idx++)
+		src_offset[idx] = -1;
+	for (idx = 0; idx < channel_count; idx++) {
+		row = channel_map ? channel_map[idx] : idx;
+		if (row >= 8 * unitsize)
+			return SR_ERR_ARG;
+		src_offset[row] = idx * word_bytes;
+	}
+	batch_bytes = channel_count * word_bytes;
+	blocks_per_batch = unitsize * word_bytes;
+	batches_per_run = TRANSPOSE_BLOCK_COUNT / blocks_per_batch;
+	transpose_blocks = get_transpose_blocks();
+
+	while (batch_count) {
+		run = MIN(batch_count, batches_per_run);
+
+		/*
+		 * Gather 8 channels by 8 samples into one block. Row n of
+		 * a block holds the samples of output bit n in a group.
+		 */
+		idx = 0;
+		for (batch = 0; batch < run; batch++) {
+			for (row = 0; row < 8 * unitsize; row++) {
+				offset = src_offset[row];
+				rows[row] = (offset < 0) ? zeros : &src[offset];
+			}
+			for (byte_idx = 0; byte_idx < word_bytes; byte_idx++) {
+				for (group = 0; group < unitsize; group++) {
+					rdptr = &rows[8 * group];
+					block = 0;
+					for (row = 0; row < 8; row++)
+						block |= (uint64_t)rdptr[row][byte_idx] << (8 * row);
+					blocks[idx++] = block;
+				}
+			}
+			src += batch_bytes;
+		}
+
+		transpose_blocks(blocks, idx);
+
+		/*
+		 * Scatter the transposed blocks. Row n of a block now holds
+		 * the bits of a group for sample n of the word's byte. The
+		 * earliest sample resides in the last byte and in the upper
+		 * bits of a byte for MSB first input.
+		 */
+		idx = 0;
+		wrptr = dst;
+		for (batch = 0; batch < run; batch++) {
+			for (byte_idx = 0; byte_idx < word_bytes; byte_idx++) {
+				sample_idx = msb_first ? word_bytes - 1 - byte_idx : byte_idx;
+				for (group = 0; group < unitsize; group++) {
+					block = blocks[idx++];
+					for (row = 0; row < 8; row++) {
+						offset = msb_first ? 7 - row : row;
+						wrptr[(8 * sample_idx + offset) * unitsize + group] = block & 0xff;
+						block >>= 8;
+					}
+				}
+			}
+			wrptr += word_bits * unitsize;
+		}
+
+		dst += run * word_bits * unitsize;
+		batch_count -= run;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Fill a buffer with repetitions of one logic sample value.
+ *
+ * @param[out] dst The output buffer, must provide space for
+ *   count * unitsize bytes.
+ * @param[in] value The sample value, unitsize bytes.
+ * @param[in] unitsize The number of bytes per sample.
+ * @param[in] count The number of samples to write.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_fill_repeat(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, size_t count)
+{
+	size_t total, filled, copy, step;
+
+	if (!count || !unitsize)
+		return;
+	if (unitsize == 1) {
+		memset(dst, value[0], count);
+		return;
+	}
+
+	/*
+	 * Double the already written region with every copy. Limit the
+	 * copy size to keep the source in the cache for long runs, but
+	 * copy at least one sample for units wider than that limit.
+	 */
+	total = count * unitsize;
+	step = MAX((4096 / unitsize) * unitsize, unitsize);
+	memcpy(dst, value, unitsize);
+	filled = unitsize;
+	while (filled < total) {
+		copy = MIN(filled, total - filled);
+		copy = MIN(copy, step);
+		memcpy(&dst[filled], dst, copy);
+		filled += copy;
+	}
+}
+
+/*
+ * Change detection in logic data.
+ *
+ * Long stretches of logic captures often hold the same value. Output
+ * modules which only care about value changes locate the end of such a
+ * run with one buffer comparison, instead of comparing sample by sample.
+ * The comparison kernel returns the offset of the first differing byte,
+ * and gets selected at runtime like the transpose kernel above.
+ */
+
+/** @cond PRIVATE */
+typedef size_t (*mismatch_func)(const uint8_t *a, const uint8_t *b,
+		size_t len);
+/** @endcond */
+
+static size_t mismatch_scalar(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	uint64_t wa, wb;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= sizeof(uint64_t)) {
+		memcpy(&wa, &a[pos], sizeof(wa));
+		memcpy(&wb, &b[pos], sizeof(wb));
+		if (wa != wb)
+			break;
+		pos += sizeof(uint64_t);
+	}
+	while (pos < len && a[pos] == b[pos])
+		pos++;
+
+	return pos;
+}
+
+#ifdef HAVE_TRANSPOSE_X86
+__attribute__((target("sse2")))
+static size_t mismatch_sse2(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	__m128i va, vb;
+	unsigned int mask;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= 16) {
+		va = _mm_loadu_si128((const __m128i *)&a[pos]);
+		vb = _mm_loadu_si128((const __m128i *)&b[pos]);
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffff;
+		if (mask)
+			return pos + __builtin_ctz(mask);
+		pos += 16;
+	}
+
+	return pos + mismatch_scalar(&a[pos], &b[pos], len - pos);
+}
+
+__attribute__((target("avx2")))
+static size_t mismatch_avx2(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	__m256i va, vb;
+	uint32_t mask;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= 32) {
+		va = _mm256_loadu_si256((const __m256i *)&a[pos]);
+		vb = _mm256_loadu_si256((const __m256i *)&b[pos]);
+		mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		if (mask)
+			return pos + __builtin_ctz(mask);
+		pos += 32;
+	}
+
+	return pos + mismatch_sse2(&a[pos], &b[pos], len - pos);
+}
+#endif
+
+static mismatch_func get_mismatch(void)
+{
+	static gsize init_done;
+	static mismatch_func func;
+	const char *name;
+
+	if (g_once_init_enter(&init_done)) {
+		func = mismatch_scalar;
+		name = "scalar";
+#ifdef HAVE_TRANSPOSE_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			func = mismatch_avx2;
+			name = "AVX2";
+		} else if (__builtin_cpu_supports("sse2")) {
+			func = mismatch_sse2;
+			name = "SSE2";
+		}
+#endif
+		sr_dbg("Using %s change detection kernel.", name);
+		g_once_init_leave(&init_done, 1);
+	}
+
+	return func;
+}
+
+/**
+ * Find the first logic sample which differs from a reference value.
+ *
+ * @param[in] data The logic samples.
+ * @param[in] count The number of samples in @a data.
+ * @param[in] unitsize The number of bytes per sample, any size.
+ * @param[in] ref The reference value, unitsize bytes.
+ *
+ * @return The index of the first sample which differs from @a ref,
+ *   or @a count when all samples match.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *ref)
+{
+	size_t len, pos;
+
+	if (!count || !unitsize)
+		return count;
+	if (memcmp(data, ref, unitsize) != 0)
+		return 0;
+
+	/*
+	 * The first sample matches. Each later sample matches as long as
+	 * all of its bytes equal those one sample earlier. Comparing the
+	 * buffer against itself, shifted by one unit, finds the end of
+	 * the run for any unit size with a single kernel call.
+	 */
+	len = (count - 1) * unitsize;
+	pos = get_mismatch()(&data[unitsize], data, len);
+	if (pos == len)
+		return count;
+
+	return pos / unitsize + 1;
+}
+
+/*
+ * Masking logic data in place.
+ *
+ * Transforms which invert, clear or set a subset of channels replace
+ * every sample by (sample & and_mask) ^ xor_mask. The per unit masks
+ * get repeated into patterns whose length is a multiple of both the
+ * unit size and the widest vector, so the kernels process whole words
+ * or vectors for any unit size. The kernel gets selected at runtime.
+ */
+
+/** @cond PRIVATE */
+#define LOGIC_MASK_VECTOR	32
+
+typedef void (*logic_mask_func)(uint8_t *data, size_t len,
+		const uint8_t *and_pat, const uint8_t *xor_pat,
+		size_t period, size_t off);
+/** @endcond */
+
+static void logic_mask_scalar(uint8_t *data, size_t len,
+		const uint8_t *and_pat, const uint8_t *xor_pat,
+		size_t period, size_t off)
+{
+	uint64_t w, a, x;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= sizeof(uint64_t)) {
+		memcpy(&w, &data[pos], sizeof(w));
+		memcpy(&a, &and_pat[off], sizeof(a));
+		memcpy(&x, &xor_pat[off], sizeof(x));
+		w = (w & a) ^ x;
+		memcpy(&data[pos], &w, sizeof(w));
+		pos += sizeof(uint64_t);
+		off += sizeof(uint64_t);
+		if (off == period)
+			off = 0;
+	}
+	while (pos < len) {
+		data[pos] = (data[pos] & and_pat[off]) ^ xor_pat[off];
+		pos++;
+		if (++off == period)
+			off = 0;
+	}
+}
+
+#ifdef HAVE_TRANSPOSE_X86
+__attribute__((target("sse2")))
+static void logic_mask_sse2(uint8_t *data, size_t len,
+		const uint8_t *and_pat, const uint8_t *xor_pat,
+		size_t period, size_t off)
+{
+	__m128i w, a, x;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= 16) {
+		w = _mm_loadu_si128((const __m128i *)&data[pos]);
+		a = _mm_loadu_si128((const __m128i *)&and_pat[off]);
+		x = _mm_loadu_si128((const __m128i *)&xor_pat[off]);
+		w = _mm_xor_si128(_mm_and_si128(w, a), x);
+		_mm_storeu_si128((__m128i *)&data[pos], w);
+		pos += 16;
+		off += 16;
+		if (off == period)
+			off = 0;
+	}
+	logic_mask_scalar(&data[pos], len - pos, and_pat, xor_pat, period, off);
+}
+
+__attribute__((target("avx2")))
+static void logic_mask_avx2(uint8_t *data, size_t len,
+		const uint8_t *and_pat, const uint8_t *xor_pat,
+		size_t period, size_t off)
+{
+	__m256i w, a, x;
+	size_t pos;
+
+	pos = 0;
+	while (len - pos >= 32) {
+		w = _mm256_loadu_si256((const __m256i *)&data[pos]);
+		a = _mm256_loadu_si256((const __m256i *)&and_pat[off]);
+		x = _mm256_loadu_si256((const __m256i *)&xor_pat[off]);
+		w = _mm256_xor_si256(_mm256_and_si256(w, a), x);
+		_mm256_storeu_si256((__m256i *)&data[pos], w);
+		pos += 32;
+		off += 32;
+		if (off == period)
+			off = 0;
+	}
+	logic_mask_sse2(&data[pos], len - pos, and_pat, xor_pat, period, off);
+}
+#endif
+
+static logic_mask_func get_logic_mask(void)
+{
+	static gsize init_done;
+	static logic_mask_func func;
+	const char *name;
+
+	if (g_once_init_enter(&init_done)) {
+		func = logic_mask_scalar;
+		name = "scalar";
+#ifdef HAVE_TRANSPOSE_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			func = logic_mask_avx2;
+			name = "AVX2";
+		} else if (__builtin_cpu_supports("sse2")) {
+			func = logic_mask_sse2;
+			name = "SSE2";
+		}
+#endif
+		sr_dbg("Using %s logic mask kernel.", name);
+		g_once_init_leave(&init_done, 1);
+	}
+
+	return func;
+}
+
+/**
+ * Create a mask which modifies logic samples in place.
+ *
+ * Applying the mask replaces every sample by
+ * (sample & and_mask) ^ xor_mask. This inverts (xor), clears (and),
+ * or sets (and plus xor) selected channels.
+ *
+ * @param[in] unitsize The number of bytes per sample, any size.
+ * @param[in] and_mask Bits to keep, unitsize bytes. NULL keeps all bits.
+ * @param[in] xor_mask Bits to invert, unitsize bytes. NULL inverts none.
+ *
+ * @return The new mask, or NULL on invalid arguments. Free it with
+ *   sr_logic_mask_free().
+ *
+ * @private
+ */
+SR_PRIV struct sr_logic_mask *sr_logic_mask_new(size_t unitsize,
+		const uint8_t *and_mask, const uint8_t *xor_mask)
+{
+	struct sr_logic_mask *mask;
+	uint8_t *unit;
+	size_t period;
+
+	if (!unitsize)
+		return NULL;
+
+	period = unitsize;
+	while (period % LOGIC_MASK_VECTOR)
+		period += unitsize;
+
+	mask = g_malloc0(sizeof(*mask));
+	mask->unitsize = unitsize;
+	mask->period = period;
+	mask->and_pat = g_malloc(period);
+	mask->xor_pat = g_malloc(period);
+	unit = g_malloc(unitsize);
+
+	if (and_mask)
+		memcpy(unit, and_mask, unitsize);
+	else
+		memset(unit, 0xff, unitsize);
+	sr_logic_fill_repeat(mask->and_pat, unit, unitsize, period / unitsize);
+	if (xor_mask)
+		memcpy(unit, xor_mask, unitsize);
+	else
+		memset(unit, 0, unitsize);
+	sr_logic_fill_repeat(mask->xor_pat, unit, unitsize, period / unitsize);
+	g_free(unit);
+
+	return mask;
+}
+
+/**
+ * Apply a logic mask to samples in place.
+ *
+ * @param[in] mask The mask, see sr_logic_mask_new().
+ * @param[in,out] data The samples, starting at a sample boundary.
+ * @param[in] length The number of bytes in @a data.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_mask_apply(const struct sr_logic_mask *mask,
+		uint8_t *data, size_t length)
+{
+	if (!mask || !length)
+		return;
+
+	get_logic_mask()(data, length, mask->and_pat, mask->xor_pat,
+		mask->period, 0);
+}
+
+/**
+ * Free a logic mask.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_mask_free(struct sr_logic_mask *mask)
+{
+	if (!mask)
+		return;
+
+	g_free(mask->and_pat);
+	g_free(mask->xor_pat);
+	g_free(mask);
+}
+
+/**
+ * Get the number of samples which are encoded in a run-length payload.
+ *
+ * @param[in] rle The run-length encoded logic payload.
+ *
+ * @return The total number of samples, 0 for an invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_sample_count(const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t run, count;
+
+	if (!rle || !rle->counts)
+		return 0;
+
+	count = 0;
+	for (run = 0; run < rle->num_runs; run++)
+		count += rle->counts[run];
+
+	return count;
+}
+
+/**
+ * Expand run-length encoded logic data to plain samples.
+ *
+ * The caller keeps the position within the payload in run_idx and
+ * run_pos, which both must be 0 on the first call. Subsequent calls
+ * continue where the previous call stopped. This allows the expansion
+ * of long runs in chunks of limited size.
+ *
+ * @param[in] rle The run-length encoded logic payload.
+ * @param[in,out] run_idx The index of the current run.
+ * @param[in,out] run_pos The number of samples of the current run
+ *   which were written before.
+ * @param[out] dst The output buffer, must provide space for
+ *   max_samples * rle->unitsize bytes.
+ * @param[in] max_samples The maximum number of samples to write.
+ *
+ * @return The number of samples written to dst, 0 when all runs were
+ *   expanded or for an invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint64_t *run_idx, uint64_t *run_pos, void *dst,
+		uint64_t max_samples)
+{
+	const uint8_t *values;
+	uint8_t *wrptr;
+	uint64_t written, count;
+
+	if (!rle || !run_idx || !run_pos || !dst || !rle->unitsize)
+		return 0;
+
+	values = rle->values;
+	wrptr = dst;
+	written = 0;
+	while (written < max_samples && *run_idx < rle->num_runs) {
+		count = rle->counts[*run_idx] - *run_pos;
+		count = MIN(count, max_samples - written);
+		sr_logic_fill_repeat(wrptr,
+			&values[*run_idx * rle->unitsize], rle->unitsize, count);
+		wrptr += count * rle->unitsize;
+		written += count;
+		*run_pos += count;
+		if (*run_pos >= rle->counts[*run_idx]) {
+			(*run_idx)++;
+			*run_pos = 0;
+		}
+	}
+
+	return written;
+}
+
+/** @cond PRIVATE */
+#define RLE_EXPAND_CHUNK_SIZE (1024 * 1024)
+/** @endcond */
+
+/**
+ * Expand a run-length encoded logic payload to SR_DF_LOGIC packets.
+ *
+ * The payload gets expanded in chunks of limited size. Each chunk is
+ * passed to the callback in a SR_DF_LOGIC packet which only is valid
+ * during the callback's execution.
+ *
+ * @param[in] rle The run-length encoded logic payload.
+ * @param[in] cb The routine which receives the SR_DF_LOGIC packets.
+ * @param[in] cb_data Caller specific data, passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Memory allocation failed.
+ * @retval other The callback's error code.
+ *
+ * @private
+ */
+SR_PRIV int sr_logic_rle_expand_packets(const struct sr_datafeed_logic_rle *rle,
+		int (*cb)(const struct sr_datafeed_packet *packet, void *cb_data),
+		void *cb_data)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t run_idx, run_pos, total, chunk, count;
+	uint8_t *buf;
+	int ret;
+
+	if (!rle || !cb || !rle->unitsize)
+		return SR_ERR_ARG;
+
+	total = sr_logic_rle_sample_count(rle);
+	if (!total)
+		return SR_OK;
+	chunk = MAX(RLE_EXPAND_CHUNK_SIZE / rle->unitsize, 1);
+	chunk = MIN(chunk, total);
+	buf = g_try_malloc(chunk * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+	run_idx = 0;
+	run_pos = 0;
+	ret = SR_OK;
+	while (ret == SR_OK) {
+		count = sr_logic_rle_expand(rle, &run_idx, &run_pos, buf, chunk);
+		if (!count)
+			break;
+		logic.length = count * rle->unitsize;
+		ret = cb(&packet, cb_data);
+	}
+	g_free(buf);
+
+	return ret;
+}
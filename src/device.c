@@ -902,7 +902,7 @@ SR_API const char *sr_dev_inst_connid_get(const struct sr_dev_inst *sdi)
 		drvc = sdi->driver->context;
 		usb = sdi->conn;
 
-		if ((cnt = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist)) < 0) {
+		if ((cnt = sr_usb_get_device_list(drvc->sr_ctx, &devlist)) < 0) {
 			sr_err("Failed to retrieve device list: %s.",
 			       libusb_error_name(cnt));
 			return NULL;
@@ -140,5 +140,8 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 
 	libusb_close(hdl);
 
+	/* The device renumerates with the new firmware. */
+	sr_usb_cache_invalidate(ctx);
+
 	return SR_OK;
 }
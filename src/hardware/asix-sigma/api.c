@@ -108,7 +108,7 @@ static gboolean known_vid_pid(const struct libusb_device_descriptor *des)
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
 	struct drv_context *drvc;
-	libusb_context *usbctx;
+	struct sr_context *sr_ctx;
 	const char *conn;
 	const char *probe_names;
 	GSList *l, *conn_devices;
@@ -131,7 +131,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	size_t count;
 
 	drvc = di->context;
-	usbctx = drvc->sr_ctx->libusb_ctx;
+	sr_ctx = drvc->sr_ctx;
 
 	/* Find all devices which match an (optional) conn= spec. */
 	conn = NULL;
@@ -149,13 +149,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 	conn_devices = NULL;
 	if (conn)
-		conn_devices = sr_usb_find(usbctx, conn);
+		conn_devices = sr_usb_find(sr_ctx, conn);
 	if (conn && !conn_devices)
 		return NULL;
 
 	/* Find all ASIX logic analyzers (which match the connection spec). */
 	devices = NULL;
-	libusb_get_device_list(usbctx, &devlist);
+	sr_usb_get_device_list(sr_ctx, &devlist);
 	for (devidx = 0; devlist[devidx]; devidx++) {
 		devitem = devlist[devidx];
 
@@ -177,23 +177,18 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			sr_warn("Cannot get serial number (index 0).");
 			continue;
 		}
-		ret = libusb_open(devitem, &hdl);
-		if (ret < 0) {
-			sr_warn("Cannot open USB device %04x.%04x: %s.",
-				des.idVendor, des.idProduct,
-				libusb_error_name(ret));
-			continue;
-		}
-		ret = libusb_get_string_descriptor_ascii(hdl,
-			des.iSerialNumber,
-			(unsigned char *)serno_txt, sizeof(serno_txt));
+		hdl = NULL;
+		ret = sr_usb_get_string(sr_ctx, devitem, &hdl,
+			des.iSerialNumber, serno_txt, sizeof(serno_txt));
+		/* Only opened on a string cache miss. */
+		if (hdl)
+			libusb_close(hdl);
 		if (ret < 0) {
-			sr_warn("Cannot get serial number (%s).",
+			sr_warn("Cannot get serial number of USB device "
+				"%04x.%04x (%s).", des.idVendor, des.idProduct,
 				libusb_error_name(ret));
-			libusb_close(hdl);
 			continue;
 		}
-		libusb_close(hdl);
 
 		/*
 		 * All ASIX logic analyzers have a serial number, which
@@ -146,12 +146,12 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
@@ -169,30 +169,26 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0)
-			continue;
-
-		if (des.iProduct == 0) {
-			product[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, (unsigned char *)product,
-				sizeof(product))) < 0) {
+		hdl = NULL;
+		product[0] = '\0';
+		serial_num[0] = '\0';
+		ret = 0;
+		if (des.iProduct && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iProduct, product,
+				sizeof(product))) < 0)
 			sr_warn("Failed to get product string descriptor: %s.",
 				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iSerialNumber == 0) {
-			serial_num[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iSerialNumber, (unsigned char *)serial_num,
-				sizeof(serial_num))) < 0) {
+		else if (des.iSerialNumber && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iSerialNumber, serial_num,
+				sizeof(serial_num))) < 0)
 			sr_warn("Failed to get serial number string descriptor: %s.",
 				libusb_error_name(ret));
-			continue;
-		}
 
-		libusb_close(hdl);
+		/* Only opened on a string cache miss. */
+		if (hdl)
+			libusb_close(hdl);
+		if (ret < 0)
+			continue;
 
 		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
@@ -47,6 +47,12 @@ static const char *logic_pattern_str[] = {
 	"graycode",
 };
 
+/* Pace data generation to the samplerate, or send as fast as possible. */
+static const char *test_mode_str[] = {
+	"realtime",
+	"benchmark",
+};
+
 static const uint32_t scanopts[] = {
 	SR_CONF_NUM_LOGIC_CHANNELS,
 	SR_CONF_NUM_ANALOG_CHANNELS,
@@ -69,6 +75,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TEST_MODE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -148,6 +156,8 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devc->limit_frames = limit_frames;
 	devc->capture_ratio = 20;
 	devc->stl = NULL;
+	devc->packet_samples = DEFAULT_PACKET_SAMPLES;
+	devc->random_state = UINT64_C(0x9e3779b97f4a7c15);
 
 	if (num_logic_channels > 0) {
 		/* Logic channels, all in one channel group. */
@@ -220,6 +230,7 @@ static void clear_helper(struct dev_context *devc)
 	void *value;
 
 	demo_free_analog_pattern(devc);
+	demo_free_packet(devc);
 
 	/* Analog generators. */
 	g_hash_table_iter_init(&iter, devc->ch_ag);
@@ -315,6 +326,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_TEST_MODE:
+		*data = g_variant_new_string(test_mode_str[devc->benchmark ? 1 : 0]);
+		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->packet_samples);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -330,7 +347,8 @@ static int config_set(uint32_t key, GVariant *data,
 	struct sr_channel *ch;
 	GVariant *mq_tuple_child;
 	GSList *l;
-	int logic_pattern, analog_pattern;
+	int logic_pattern, analog_pattern, idx;
+	uint64_t packet_samples;
 
 	devc = sdi->priv;
 
@@ -428,6 +446,19 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_TEST_MODE:
+		idx = std_str_idx(data, ARRAY_AND_SIZE(test_mode_str));
+		if (idx < 0)
+			return SR_ERR_ARG;
+		devc->benchmark = idx == 1;
+		sr_dbg("Setting test mode to %s", test_mode_str[idx]);
+		break;
+	case SR_CONF_BUFFERSIZE:
+		packet_samples = g_variant_get_uint64(data);
+		if (!packet_samples || packet_samples > MAX_PACKET_SAMPLES)
+			return SR_ERR_ARG;
+		devc->packet_samples = packet_samples;
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -451,6 +482,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_TRIGGER_MATCH:
 			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 			break;
+		case SR_CONF_TEST_MODE:
+			*data = g_variant_new_strv(ARRAY_AND_SIZE(test_mode_str));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -497,6 +531,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	int bitpos;
 	uint8_t mask;
 	struct sr_trigger *trigger;
+	int ret;
 
 	devc = sdi->priv;
 	devc->sent_samples = 0;
@@ -561,7 +596,21 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	devc->send_us = 0;
+	devc->sent_bytes = 0;
+	if (devc->benchmark) {
+		ret = demo_render_packet((struct sr_dev_inst *)sdi);
+		if (ret != SR_OK) {
+			if (devc->stl) {
+				soft_trigger_logic_free(devc->stl);
+				devc->stl = NULL;
+			}
+			return ret;
+		}
+	}
+
+	/* Benchmark mode runs the data callback without delay. */
+	sr_session_source_add(sdi->session, -1, 0, devc->benchmark ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
@@ -587,7 +636,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	if (devc->limit_frames > 0)
 		std_session_send_df_frame_end(sdi);
 
+	demo_report_benchmark(sdi);
 	std_session_send_df_end(sdi);
+	demo_free_packet(devc);
 
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
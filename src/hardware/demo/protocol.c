@@ -266,6 +266,20 @@ static uint64_t encode_number_to_gray(uint64_t nr)
 	return nr ^ (nr >> 1);
 }
 
+/* Xorshift generator, yields 8 bytes of pseudo-random data per call. */
+static uint64_t random_next(uint64_t *state)
+{
+	uint64_t x;
+
+	x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+
+	return x * UINT64_C(0x2545f4914f6cdd1d);
+}
+
 static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 {
 	while (len--) {
@@ -282,7 +296,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	uint8_t *sample;
 	const uint8_t *image_col;
 	size_t col_count, col_height;
-	uint64_t gray;
+	uint64_t gray, rnd;
 
 	devc = sdi->priv;
 
@@ -298,8 +312,10 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+		for (i = 0; i < size; i += sizeof(rnd)) {
+			rnd = random_next(&devc->random_state);
+			memcpy(&devc->logic_data[i], &rnd, MIN(sizeof(rnd), size - i));
+		}
 		break;
 	case PATTERN_INC:
 		for (i = 0; i < size; i++) {
@@ -399,6 +415,119 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+/*
+ * Pre-render the logic data which benchmark mode sends. Run the pattern
+ * generator for one packet's worth of samples, and mask out disabled
+ * channels once. The block then gets sent over and over again, through
+ * a second buffer which gets restored before each send.
+ */
+SR_PRIV int demo_render_packet(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_logic logic;
+	size_t size, chunk, pos, len;
+	int64_t start_us;
+
+	devc = sdi->priv;
+
+	demo_free_packet(devc);
+	devc->render_us = 0;
+	if (!devc->logic_unitsize)
+		return SR_OK;
+
+	start_us = g_get_monotonic_time();
+	size = devc->packet_samples * devc->logic_unitsize;
+	devc->packet_render = g_try_malloc(size);
+	devc->packet_data = g_try_malloc(size);
+	if (!devc->packet_render || !devc->packet_data) {
+		sr_err("Cannot allocate %zu bytes for logic packets.", 2 * size);
+		demo_free_packet(devc);
+		return SR_ERR_MALLOC;
+	}
+	chunk = LOGIC_BUFSIZE / devc->logic_unitsize * devc->logic_unitsize;
+	for (pos = 0; pos < size; pos += len) {
+		len = MIN(size - pos, chunk);
+		logic_generator(sdi, len);
+		memcpy(devc->packet_render + pos, devc->logic_data, len);
+	}
+	logic.length = size;
+	logic.unitsize = devc->logic_unitsize;
+	logic.data = devc->packet_render;
+	logic_fixup_feed(devc, &logic);
+	devc->packet_pos = 0;
+	devc->render_us = g_get_monotonic_time() - start_us;
+
+	return SR_OK;
+}
+
+SR_PRIV void demo_free_packet(struct dev_context *devc)
+{
+	g_free(devc->packet_render);
+	devc->packet_render = NULL;
+	g_free(devc->packet_data);
+	devc->packet_data = NULL;
+}
+
+/*
+ * Log the throughput which a benchmark mode acquisition achieved, and
+ * where the time was spent: Rendering the logic data (once, before the
+ * acquisition started), in the session (transforms, outputs, datafeed
+ * callbacks), and in the driver and the main loop.
+ */
+SR_PRIV void demo_report_benchmark(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int64_t total_us, driver_us;
+	double secs, msps, mbps;
+
+	devc = sdi->priv;
+	if (!devc->benchmark)
+		return;
+
+	total_us = g_get_monotonic_time() - devc->start_us;
+	driver_us = MAX(0, total_us - devc->send_us);
+	secs = (double)total_us / G_USEC_PER_SEC;
+	msps = secs > 0 ? devc->sent_samples / secs / 1e6 : 0.0;
+	mbps = secs > 0 ? devc->sent_bytes / secs / 1e6 : 0.0;
+	sr_info("Benchmark: %" PRIu64 " samples (%" PRIu64 " bytes) in %.3f s, "
+		"%.2f MS/s, %.1f MB/s.", devc->sent_samples, devc->sent_bytes,
+		secs, msps, mbps);
+	sr_info("Benchmark: render %.3f ms, session %.3f ms, driver %.3f ms.",
+		devc->render_us / 1e3, devc->send_us / 1e3, driver_us / 1e3);
+}
+
+/*
+ * Send a packet to the session. Benchmark mode accounts the time which
+ * the session spends on the packet, and the amount of sample data.
+ */
+static void demo_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct dev_context *devc;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	int64_t start_us;
+
+	devc = sdi->priv;
+	if (!devc->benchmark) {
+		sr_session_send(sdi, packet);
+		return;
+	}
+
+	start_us = g_get_monotonic_time();
+	sr_session_send(sdi, packet);
+	devc->send_us += g_get_monotonic_time() - start_us;
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		devc->sent_bytes += logic->length;
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		devc->sent_bytes += analog->num_samples *
+			analog->encoding->unitsize;
+	}
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -524,7 +653,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			ag->packet.data = pattern->data + ag_pattern_pos;
 		}
 		ag->packet.num_samples = sending_now;
-		sr_session_send(sdi, &packet);
+		demo_send(sdi, &packet);
 
 		/* Whichever channel group gets there first. */
 		*analog_sent = MAX(*analog_sent, sending_now);
@@ -564,7 +693,7 @@ do_send:
 		ag->packet.data = &ag->avg_val;
 		ag->packet.num_samples = 1;
 
-		sr_session_send(sdi, &packet);
+		demo_send(sdi, &packet);
 		*analog_sent = ag->num_avgs;
 
 		ag->num_avgs = 0;
@@ -582,6 +711,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	struct analog_gen *ag;
 	GHashTableIter iter;
 	void *value;
+	uint8_t *logic_data;
 	uint64_t samples_todo, logic_done, analog_done, analog_sent, sending_now;
 	int64_t elapsed_us, limit_us, todo_us;
 	int64_t trigger_offset;
@@ -601,17 +731,23 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		return G_SOURCE_CONTINUE;
 	}
 
-	/* What time span should we send samples for? */
-	elapsed_us = g_get_monotonic_time() - devc->start_us;
 	limit_us = 1000 * devc->limit_msec;
-	if (limit_us > 0 && limit_us < elapsed_us)
-		todo_us = MAX(0, limit_us - devc->spent_us);
-	else
-		todo_us = MAX(0, elapsed_us - devc->spent_us);
-
-	/* How many samples are outstanding since the last round? */
-	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
-			/ G_USEC_PER_SEC;
+	if (devc->benchmark) {
+		/* Don't pace, send as much as the session accepts. */
+		samples_todo = BENCHMARK_PACKETS * devc->packet_samples;
+		todo_us = 0;
+	} else {
+		/* What time span should we send samples for? */
+		elapsed_us = g_get_monotonic_time() - devc->start_us;
+		if (limit_us > 0 && limit_us < elapsed_us)
+			todo_us = MAX(0, limit_us - devc->spent_us);
+		else
+			todo_us = MAX(0, elapsed_us - devc->spent_us);
+
+		/* How many samples are outstanding since the last round? */
+		samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+				/ G_USEC_PER_SEC;
+	}
 
 	if (devc->limit_samples > 0) {
 		if (devc->limit_samples < devc->sent_samples)
@@ -635,7 +771,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	 * count, rounded towards zero. This avoids getting stuck on a too-low
 	 * time delta with no samples being sent due to round-off.
 	 */
-	todo_us = samples_todo * G_USEC_PER_SEC / devc->cur_samplerate;
+	if (!devc->benchmark)
+		todo_us = samples_todo * G_USEC_PER_SEC / devc->cur_samplerate;
 
 	logic_done = devc->num_logic_channels > 0 ? 0 : samples_todo;
 	if (!devc->enabled_logic_channels)
@@ -648,13 +785,32 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	while (logic_done < samples_todo || analog_done < samples_todo) {
 		/* Logic */
 		if (logic_done < samples_todo) {
-			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+			if (devc->benchmark) {
+				/*
+				 * Continue where the previous packet ended.
+				 * Restore the data which transforms may have
+				 * modified, this counts as driver time.
+				 */
+				sending_now = MIN(samples_todo - logic_done,
+						devc->packet_samples - devc->packet_pos);
+				logic_data = devc->packet_data +
+					devc->packet_pos * devc->logic_unitsize;
+				memcpy(logic_data, devc->packet_render +
+					devc->packet_pos * devc->logic_unitsize,
+					sending_now * devc->logic_unitsize);
+				devc->packet_pos += sending_now;
+				if (devc->packet_pos == devc->packet_samples)
+					devc->packet_pos = 0;
+			} else {
+				sending_now = MIN(samples_todo - logic_done,
+						LOGIC_BUFSIZE / devc->logic_unitsize);
+				logic_generator(sdi, sending_now * devc->logic_unitsize);
+				logic_data = devc->logic_data;
+			}
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+						logic_data, sending_now * devc->logic_unitsize,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -672,9 +828,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
 					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
-					sr_session_send(sdi, &packet);
+					logic.data = logic_data + trigger_offset * devc->logic_unitsize;
+					if (!devc->benchmark)
+						logic_fixup_feed(devc, &logic);
+					demo_send(sdi, &packet);
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
 					sr_dbg("Triggered, stopping acquisition.");
@@ -687,9 +844,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
-				sr_session_send(sdi, &packet);
+				logic.data = logic_data;
+				if (!devc->benchmark)
+					logic_fixup_feed(devc, &logic);
+				demo_send(sdi, &packet);
 				logic_done += sending_now;
 			}
 		}
@@ -711,7 +869,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	uint64_t min = MIN(logic_done, analog_done);
 	devc->sent_samples += min;
 	devc->sent_frame_samples += min;
-	devc->spent_us += todo_us;
+	if (devc->benchmark)
+		devc->spent_us = g_get_monotonic_time() - devc->start_us;
+	else
+		devc->spent_us += todo_us;
 
 	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
 		std_session_send_df_frame_end(sdi);
@@ -735,7 +896,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				packet.payload = &ag->packet;
 				ag->packet.data = &ag->avg_val;
 				ag->packet.num_samples = 1;
-				sr_session_send(sdi, &packet);
+				demo_send(sdi, &packet);
 			}
 		}
 		sr_dbg("Requested number of samples reached.");
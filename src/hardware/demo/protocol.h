@@ -37,6 +37,11 @@
 /* This is a development feature: it starts a new frame every n samples. */
 #define SAMPLES_PER_FRAME		1000UL
 #define DEFAULT_LIMIT_FRAMES		0
+/* Samples per logic packet in benchmark mode (SR_CONF_BUFFERSIZE). */
+#define DEFAULT_PACKET_SAMPLES		(64 * 1024)
+#define MAX_PACKET_SAMPLES		(16 * 1024 * 1024)
+/* Number of logic packets per main loop iteration in benchmark mode. */
+#define BENCHMARK_PACKETS		16
 
 #define DEFAULT_ANALOG_ENCODING_DIGITS	4
 #define DEFAULT_ANALOG_SPEC_DIGITS		4
@@ -128,6 +133,7 @@ struct dev_context {
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
 	uint8_t logic_data[LOGIC_BUFSIZE];
+	uint64_t random_state;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -142,6 +148,21 @@ struct dev_context {
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
 	struct soft_trigger_logic *stl;
+	/*
+	 * Benchmark mode: Send a pre-rendered block of logic data as fast
+	 * as the session accepts it, instead of pacing to the samplerate.
+	 * Transforms may modify sent data in place, so packets are sent
+	 * from a copy of the rendered block. The position in the block
+	 * carries over when frames end within a packet.
+	 */
+	gboolean benchmark;
+	uint64_t packet_samples;
+	uint64_t packet_pos;
+	uint8_t *packet_render;
+	uint8_t *packet_data;
+	int64_t render_us;
+	int64_t send_us;
+	uint64_t sent_bytes;
 };
 
 struct analog_gen {
@@ -162,6 +183,9 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV int demo_render_packet(struct sr_dev_inst *sdi);
+SR_PRIV void demo_free_packet(struct dev_context *devc);
+SR_PRIV void demo_report_benchmark(const struct sr_dev_inst *sdi);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
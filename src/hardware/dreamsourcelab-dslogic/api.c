@@ -150,13 +150,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all DSLogic compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -177,44 +177,32 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (!is_plausible(&des))
 			continue;
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0) {
-			sr_warn("Failed to open potential device with "
-				"VID:PID %04x:%04x: %s.", des.idVendor,
-				des.idProduct, libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iManufacturer == 0) {
-			manufacturer[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iManufacturer, (unsigned char *) manufacturer,
-				sizeof(manufacturer))) < 0) {
+		hdl = NULL;
+		manufacturer[0] = '\0';
+		product[0] = '\0';
+		serial_num[0] = '\0';
+		ret = 0;
+		if (des.iManufacturer && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iManufacturer, manufacturer,
+				sizeof(manufacturer))) < 0)
 			sr_warn("Failed to get manufacturer string descriptor: %s.",
 				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iProduct == 0) {
-			product[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, (unsigned char *) product,
-				sizeof(product))) < 0) {
+		else if (des.iProduct && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iProduct, product,
+				sizeof(product))) < 0)
 			sr_warn("Failed to get product string descriptor: %s.",
 				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iSerialNumber == 0) {
-			serial_num[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iSerialNumber, (unsigned char *) serial_num,
-				sizeof(serial_num))) < 0) {
+		else if (des.iSerialNumber && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iSerialNumber, serial_num,
+				sizeof(serial_num))) < 0)
 			sr_warn("Failed to get serial number string descriptor: %s.",
 				libusb_error_name(ret));
-			continue;
-		}
 
-		libusb_close(hdl);
+		/* Only opened on a string cache miss. */
+		if (hdl)
+			libusb_close(hdl);
+		if (ret < 0)
+			continue;
 
 		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
@@ -255,7 +243,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		devc->samplerates = samplerates;
 		devc->num_samplerates = ARRAY_SIZE(samplerates);
-		has_firmware = usb_match_manuf_prod(devlist[i], "DreamSourceLab", "USB-based Instrument");
+		has_firmware = usb_match_manuf_prod(drvc->sr_ctx, devlist[i], "DreamSourceLab", "USB-based Instrument");
 
 		if (has_firmware) {
 			/* Already has the firmware, so fix the new address. */
@@ -724,28 +724,30 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
-static void deinterleave_buffer(const uint8_t *src, size_t length,
+static int deinterleave_buffer(const uint8_t *src, size_t length,
 	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
-		}
+	uint8_t channel_map[16];
+	size_t map_count;
+	unsigned int channel;
+
+	/* The device sends one 64bit word per enabled channel. */
+	map_count = 0;
+	for (channel = 0; channel < 16; channel++) {
+		if (channel_mask & (1 << channel))
+			channel_map[map_count++] = channel;
 	}
+	if (!map_count || map_count != channel_count) {
+		sr_err("Channel mask 0x%04x does not match %zu channels.",
+			channel_mask, channel_count);
+		return SR_ERR_BUG;
+	}
+
+	sr_planar_to_logic((uint8_t *)dst_ptr, sizeof(uint16_t), src,
+		length / (channel_count * sizeof(uint64_t)), 64, FALSE,
+		channel_map, channel_count);
+
+	return SR_OK;
 }
 
 static void send_data(struct sr_dev_inst *sdi,
@@ -842,8 +844,13 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
+		if (deinterleave_buffer(transfer->buffer, transfer->actual_length,
+				devc->deinterleave_buffer, channel_count,
+				channel_mask) != SR_OK) {
+			abort_acquisition(devc);
+			free_transfer(transfer);
+			return;
+		}
 
 		/* Send the incoming transfer to the session bus. */
 		if (devc->trigger_pos > devc->sent_samples
@@ -275,9 +275,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	if (conn) {
 		devices = NULL;
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 		for (i = 0; devlist[i]; i++) {
-			conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+			conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 			for (l = conn_devices; l; l = l->next) {
 				usb = l->data;
 				if (usb->bus == libusb_get_bus_number(devlist[i])
@@ -411,11 +411,40 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
+/*
+ * Pass the transfer's complete buffer to the session feed thread
+ * without copying the data, and continue with a new transfer buffer.
+ */
+static gboolean la_send_transfer_buffer(struct sr_dev_inst *sdi,
+	struct libusb_transfer *transfer, size_t length, size_t sample_width)
+{
+	struct sr_datafeed_packet *packet;
+	struct sr_datafeed_logic *logic;
+	unsigned char *buffer;
+
+	buffer = g_try_malloc(transfer->length);
+	if (!buffer)
+		return FALSE;
+
+	logic = g_malloc(sizeof(*logic));
+	logic->length = length;
+	logic->unitsize = sample_width;
+	logic->data = transfer->buffer;
+	packet = g_malloc(sizeof(*packet));
+	packet->type = SR_DF_LOGIC;
+	packet->payload = logic;
+	transfer->buffer = buffer;
+	sr_session_send_owned(sdi, packet);
+
+	return TRUE;
+}
+
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	gboolean packet_has_error = FALSE;
+	gboolean handed_over;
 	unsigned int num_samples;
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
@@ -478,8 +507,16 @@ check_trigger:
 			if (devc->limit_samples && devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer + processed_samples * unitsize,
-				num_samples * unitsize, unitsize);
+			handed_over = FALSE;
+			if (devc->send_data_proc == la_send_data_proc &&
+					sr_session_feed_is_threaded(sdi->session) &&
+					!processed_samples &&
+					num_samples == (unsigned int)cur_sample_count)
+				handed_over = la_send_transfer_buffer(sdi, transfer,
+					num_samples * unitsize, unitsize);
+			if (!handed_over)
+				devc->send_data_proc(sdi, (uint8_t *)transfer->buffer + processed_samples * unitsize,
+					num_samples * unitsize, unitsize);
 			devc->sent_samples += num_samples;
 			processed_samples += num_samples;
 		}
@@ -1366,19 +1366,88 @@ SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc)
 	 */
 }
 
-SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
-{
+/* A waveform transfer which gets forwarded while it is received. */
+struct hmo_block_stream {
+	const struct sr_dev_inst *sdi;
 	struct sr_channel *ch;
-	struct sr_dev_inst *sdi;
+	size_t unitsize;
+	uint64_t num_samples;
+	/* Received bytes, can be less than announced after a timeout. */
+	size_t received;
+};
+
+static int hmo_forward_slice(const uint8_t *data, size_t len, size_t total,
+	void *cb_data)
+{
+	struct hmo_block_stream *stream;
 	struct dev_context *devc;
 	struct scope_state *state;
+	struct sr_channel *ch;
 	struct sr_datafeed_packet packet;
-	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
+	uint64_t count;
+
+	stream = cb_data;
+	devc = stream->sdi->priv;
+	state = devc->model_state;
+	ch = stream->ch;
+
+	(void)total;
+
+	stream->received += len;
+	count = len / stream->unitsize;
+	/* Truncate acquisition if a smaller number of samples has been requested. */
+	if (devc->samples_limit > 0) {
+		if (stream->num_samples >= devc->samples_limit)
+			return SR_OK;
+		count = MIN(count, devc->samples_limit - stream->num_samples);
+	}
+	if (!count)
+		return SR_OK;
+
+	if (ch->type == SR_CHANNEL_ANALOG) {
+		packet.type = SR_DF_ANALOG;
+		analog.data = (void *)data;
+		analog.num_samples = count;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		encoding.is_signed = TRUE;
+		if (state->analog_channels[ch->index].probe_unit == 'V') {
+			meaning.mq = SR_MQ_VOLTAGE;
+			meaning.unit = SR_UNIT_VOLT;
+		} else {
+			meaning.mq = SR_MQ_CURRENT;
+			meaning.unit = SR_UNIT_AMPERE;
+		}
+		meaning.channels = g_slist_append(NULL, ch);
+		packet.payload = &analog;
+		sr_session_send(stream->sdi, &packet);
+		g_slist_free(meaning.channels);
+	} else {
+		packet.type = SR_DF_LOGIC;
+		logic.data = (void *)data;
+		logic.length = count;
+		logic.unitsize = 1;
+		packet.payload = &logic;
+		sr_session_send(stream->sdi, &packet);
+	}
+
+	stream->num_samples += count;
+
+	return SR_OK;
+}
+
+SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_channel *ch;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct hmo_block_stream stream;
+	GByteArray *data;
 	size_t group;
 
 	(void)fd;
@@ -1398,7 +1467,6 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	*/
 
 	ch = devc->current_channel->data;
-	state = devc->model_state;
 
 	/*
 	 * Send "frame begin" packet upon reception of data for the
@@ -1412,51 +1480,24 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
+		/* Forward the samples while the waveform is received. */
+		stream.sdi = sdi;
+		stream.ch = ch;
+		stream.unitsize = sizeof(float);
+		stream.num_samples = 0;
+		stream.received = 0;
+		if (sr_scpi_get_block_cb(sdi->conn, NULL, sizeof(float),
+				hmo_forward_slice, &stream) != SR_OK)
 			return TRUE;
-		}
-
-		packet.type = SR_DF_ANALOG;
-
-		analog.data = data->data;
-		analog.num_samples = data->len / sizeof(float);
-		/* Truncate acquisition if a smaller number of samples has been requested. */
-		if (devc->samples_limit > 0 && analog.num_samples > devc->samples_limit)
-			analog.num_samples = devc->samples_limit;
-		/* TODO: Use proper 'digits' value for this device (and its modes). */
-		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-		encoding.is_signed = TRUE;
-		if (state->analog_channels[ch->index].probe_unit == 'V') {
-			meaning.mq = SR_MQ_VOLTAGE;
-			meaning.unit = SR_UNIT_VOLT;
-		} else {
-			meaning.mq = SR_MQ_CURRENT;
-			meaning.unit = SR_UNIT_AMPERE;
-		}
-		meaning.channels = g_slist_append(NULL, ch);
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		devc->num_samples = data->len / sizeof(float);
-		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
+		devc->num_samples = stream.received / sizeof(float);
 		break;
 	case SR_CHANNEL_LOGIC:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
 		/*
 		 * If only data from the first pod is involved in the
 		 * acquisition, then the raw input bytes can get passed
-		 * forward for performance reasons. When the second pod
-		 * is involved (either alone, or in combination with the
+		 * forward for performance reasons, while they are being
+		 * received. When the second pod is involved (either
+		 * alone, or in combination with the
 		 * first pod), then the received bytes need to be put
 		 * into memory in such a layout that all channel groups
 		 * get combined, and a unitsize larger than a single byte
@@ -1466,20 +1507,28 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		 * above for analog data.
 		 */
 		if (devc->pod_count == 1) {
-			packet.type = SR_DF_LOGIC;
-			logic.data = data->data;
-			logic.length = data->len;
-			/* Truncate acquisition if a smaller number of samples has been requested. */
-			if (devc->samples_limit > 0 && logic.length > devc->samples_limit)
-				logic.length = devc->samples_limit;
-			logic.unitsize = 1;
-			packet.payload = &logic;
-			sr_session_send(sdi, &packet);
-		} else {
-			group = ch->index / DIGITAL_CHANNELS_PER_POD;
-			hmo_queue_logic_data(devc, group, data);
+			stream.sdi = sdi;
+			stream.ch = ch;
+			stream.unitsize = 1;
+			stream.num_samples = 0;
+			stream.received = 0;
+			if (sr_scpi_get_block_cb(sdi->conn, NULL, 1,
+					hmo_forward_slice, &stream) != SR_OK)
+				return TRUE;
+			devc->num_samples = stream.received;
+			break;
+		}
+
+		data = NULL;
+		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
+			if (data)
+				g_byte_array_free(data, TRUE);
+			return TRUE;
 		}
 
+		group = ch->index / DIGITAL_CHANNELS_PER_POD;
+		hmo_queue_logic_data(devc, group, data);
+
 		devc->num_samples = data->len / devc->pod_count;
 		g_byte_array_free(data, TRUE);
 		data = NULL;
@@ -227,12 +227,12 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -290,12 +290,12 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all Hantek DSO devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -650,6 +650,7 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
+	uint8_t *codes;
 
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
@@ -659,18 +660,26 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(num_samples * sizeof(float));
+	/* Send the unsigned 8bit ADC codes, see below for scale/offset. */
+	analog.encoding->unitsize = sizeof(codes[0]);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_signed = FALSE;
+	codes = g_malloc(num_samples);
+	analog.data = codes;
 
 	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
+		const uint64_t *vdiv = vdivs[devc->voltage[ch]];
+		float range = ((float)vdiv[0] / vdiv[1]) * 8;
 		float vdivlog = log10f(range / 255);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		analog.encoding->digits = digits;
 		analog.spec->spec_digits = digits;
+		/* value = code * range / 255 - range / 2, range = 8 * vdiv */
+		sr_rational_set(&analog.encoding->scale, 8 * vdiv[0], 255 * vdiv[1]);
+		sr_rational_set(&analog.encoding->offset, -4 * (int64_t)vdiv[0], vdiv[1]);
 		analog.meaning->channels = g_slist_append(NULL, channels->data);
 
 		for (int i = 0; i < num_samples; i++) {
@@ -687,14 +696,14 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 			 * and 255 = +2V.
 			 */
 			/* TODO: Support for DSO-5xxx series 9-bit samples. */
-			((float *)analog.data)[i] = range / 255 * *(buf + i * 2 + 1 - ch) - range / 2;
+			codes[i] = *(buf + i * 2 + 1 - ch);
 		}
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
 
 		channels = channels->next;
 	}
-	g_free(analog.data);
+	g_free(codes);
 }
 
 /*
@@ -71,7 +71,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	drvc = di->context;
 
-	usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, USB_VID_PID);
+	usb_devices = sr_usb_find(drvc->sr_ctx, USB_VID_PID);
 
 	if (!usb_devices)
 		return NULL;
@@ -178,7 +178,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	usb = sdi->conn;
 	devc = sdi->priv;
 
-	if (sr_usb_open(drvc->sr_ctx->libusb_ctx, usb) != SR_OK)
+	if (sr_usb_open(drvc->sr_ctx, usb) != SR_OK)
 		return SR_ERR;
 
 	if (libusb_kernel_driver_active(usb->devhdl, USB_INTERFACE) == 1) {
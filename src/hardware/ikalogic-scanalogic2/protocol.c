@@ -615,7 +615,7 @@ SR_PRIV int sl2_get_device_info(struct sr_dev_driver *di,
 	if (!dev_info)
 		return SR_ERR_ARG;
 
-	if (sr_usb_open(drvc->sr_ctx->libusb_ctx, &usb) != SR_OK)
+	if (sr_usb_open(drvc->sr_ctx, &usb) != SR_OK)
 		return SR_ERR;
 
 	if (libusb_kernel_driver_active(usb.devhdl, USB_INTERFACE) == 1) {
@@ -456,7 +456,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(ctx, conn);
 	if (conn && !conn_devices) {
 		sr_err("Cannot find the specified connection '%s'.", conn);
 		return NULL;
@@ -473,7 +473,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	found_devices = NULL;
 	renum_devices = NULL;
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Cannot get device list: %s.", libusb_error_name(ret));
 		return devices;
@@ -1063,8 +1063,17 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		} else {
 			return SR_ERR_ARG;
 		}
-		devc->feed_queue = feed_queue_logic_alloc(sdi,
-			LA2016_CONVBUFFER_SIZE, unitsize);
+		/*
+		 * Normal mode receives (value, repetitions) pairs, which
+		 * get forwarded as runs without expanding them. Stream
+		 * mode receives uncompressed samples.
+		 */
+		if (devc->continuous)
+			devc->feed_queue = feed_queue_logic_alloc(sdi,
+				LA2016_CONVBUFFER_SIZE, unitsize);
+		else
+			devc->feed_queue = feed_queue_logic_alloc_rle(sdi,
+				LA2016_RLEBUFFER_SIZE, unitsize);
 		if (!devc->feed_queue) {
 			sr_err("Cannot allocate buffer for session feed.");
 			return SR_ERR_MALLOC;
@@ -581,9 +581,9 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
-		stream->channel_masks[stream->enabled_count++] = channel_mask;
+		stream->channel_map[stream->enabled_count++] = ch->index;
 	}
-	stream->channel_index = 0;
+	stream->batch_fill = 0;
 }
 
 /*
@@ -1452,23 +1452,20 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * Implementor's note: This routine is inspired by convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
- * channels before returning to the first of the channels.
+ * The bit matrix transpose is done by the common sr_planar_to_logic()
+ * helper. Operation was verified with an LA2016 device. The LA5032
+ * reportedly shares the 16 samples per channel layout, just round-robins
+ * through a potentially larger set of enabled channels before returning
+ * to the first of the channels.
  */
 static void stream_data(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
 	struct stream_state_t *stream;
-	size_t bit_count;
-	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
-	size_t bit_idx;
-	uint32_t ch_mask;
+	size_t bit_count, unitsize, batch_size, batch_count, count;
+	const uint8_t *rp, *batch_src;
+	uint8_t sample_buff[64 * 16 * sizeof(uint32_t)];
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1481,39 +1478,47 @@ static void stream_data(struct sr_dev_inst *sdi,
 
 	/* TODO Add soft trigger support when in stream mode? */
 
-	/* All channels' chunks carry 16 samples for one channel. */
+	/*
+	 * All channels' chunks carry 16 samples for one channel. One
+	 * batch of all enabled channels' chunks translates to 16 sample
+	 * units. Batches can span USB transfers.
+	 */
 	bit_count = 16;
-	data_length /= sizeof(uint16_t);
+	unitsize = devc->model->channel_count / 8;
+	batch_size = stream->enabled_count * sizeof(uint16_t);
+	if (!batch_size)
+		return;
 
 	rp = data_buffer;
-	sample_value = 0;
-	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
-
-		/*
-		 * Advance to the next channel. Submit a block of
-		 * samples when all channels' data was seen.
-		 */
-		stream->channel_index++;
-		if (stream->channel_index != stream->enabled_count)
-			continue;
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit(devc->feed_queue, sample_buff, 1);
+	while (data_length) {
+		if (stream->batch_fill || data_length < batch_size) {
+			count = batch_size - stream->batch_fill;
+			count = MIN(count, data_length);
+			memcpy(&stream->batch_data[stream->batch_fill], rp, count);
+			stream->batch_fill += count;
+			rp += count;
+			data_length -= count;
+			if (stream->batch_fill < batch_size)
+				break;
+			batch_src = stream->batch_data;
+			batch_count = 1;
+			stream->batch_fill = 0;
+		} else {
+			batch_src = rp;
+			batch_count = data_length / batch_size;
+			count = sizeof(sample_buff) / (bit_count * unitsize);
+			batch_count = MIN(batch_count, count);
+			rp += batch_count * batch_size;
+			data_length -= batch_count * batch_size;
 		}
-		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
-		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
-		stream->channel_index = 0;
+		sr_planar_to_logic(sample_buff, unitsize, batch_src,
+			batch_count, bit_count, FALSE,
+			stream->channel_map, stream->enabled_count);
+		feed_queue_logic_submit_many(devc->feed_queue, sample_buff,
+			batch_count * bit_count);
+		sr_sw_limits_update_samples_read(&devc->sw_limits,
+			batch_count * bit_count);
+		devc->total_samples += batch_count * bit_count;
 	}
 
 	/*
@@ -103,6 +103,7 @@
 #define WITH_DEINIT_IN_CLOSE	0
 
 #define LA2016_CONVBUFFER_SIZE	(4 * 1024 * 1024)
+#define LA2016_RLEBUFFER_SIZE	(64 * 1024)
 
 struct kingst_model {
 	uint8_t magic, magic2;	/* EEPROM magic byte values. */
@@ -162,9 +163,9 @@ struct dev_context {
 	struct stream_state_t {
 		size_t enabled_count;
 		uint32_t enabled_mask;
-		uint32_t channel_masks[32];
-		size_t channel_index;
-		uint32_t sample_data[32];
+		uint8_t channel_map[32];
+		size_t batch_fill;
+		uint8_t batch_data[32 * sizeof(uint16_t)];
 		uint64_t flush_period_ms;
 		uint64_t last_flushed;
 	} stream;
@@ -63,7 +63,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		return NULL;
 
 	devices = NULL;
-	if ((usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn))) {
+	if ((usb_devices = sr_usb_find(drvc->sr_ctx, conn))) {
 		/* We have a list of sr_usb_dev_inst matching the connection
 		 * string. Wrap them in sr_dev_inst and we're done. */
 		for (l = usb_devices; l; l = l->next) {
@@ -93,7 +93,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 	usb = sdi->conn;
 
-	if (sr_usb_open(drvc->sr_ctx->libusb_ctx, usb) != SR_OK)
+	if (sr_usb_open(drvc->sr_ctx, usb) != SR_OK)
 		return SR_ERR;
 
 	if ((ret = libusb_claim_interface(usb->devhdl, LASCAR_INTERFACE))) {
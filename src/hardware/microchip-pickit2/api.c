@@ -141,7 +141,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	devices = NULL;
-	usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+	usb_devices = sr_usb_find(drvc->sr_ctx, conn);
 	if (!usb_devices)
 		return NULL;
 
@@ -198,7 +198,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	di = sdi->driver;
 	drvc = di->context;
 
-	ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	ret = sr_usb_open(drvc->sr_ctx, usb);
 	if (ret < 0)
 		return SR_ERR;
 
@@ -300,7 +300,6 @@ static void clear_helper(struct dev_context *devc)
 {
 	unsigned int i;
 
-	g_free(devc->data);
 	g_free(devc->buffer);
 	for (i = 0; i < ARRAY_SIZE(devc->coupling); i++)
 		g_free(devc->coupling[i]);
@@ -427,7 +426,6 @@ static struct sr_dev_inst *probe_device(struct sr_scpi_dev_inst *scpi)
 	}
 
 	devc->buffer = g_malloc(ACQ_BUFFER_SIZE);
-	devc->data = g_malloc(ACQ_BUFFER_SIZE * sizeof(float));
 
 	devc->data_source = DATA_SOURCE_LIVE;
 
@@ -1036,8 +1034,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->sample_rate = 1. / xinc;
 	}
 
-	if (rigol_ds_capture_start(sdi) != SR_OK)
+	devc->batch = sr_scpi_batch_new(scpi);
+	devc->source_queued = FALSE;
+	devc->block_queued = FALSE;
+
+	if (rigol_ds_capture_start(sdi) != SR_OK) {
+		sr_scpi_batch_free(devc->batch);
+		devc->batch = NULL;
 		return SR_ERR;
+	}
 
 	/* Start of first frame. */
 	std_session_send_df_frame_begin(sdi);
@@ -1058,6 +1063,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_batch_free(devc->batch);
+	devc->batch = NULL;
 
 	return SR_OK;
 }
@@ -453,11 +453,133 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Drop queued and outstanding waveform commands after an error. */
+static void rigol_ds_batch_reset(struct dev_context *devc)
+{
+	sr_scpi_batch_reset(devc->batch);
+	devc->source_queued = FALSE;
+	devc->block_queued = FALSE;
+}
+
+/* Whether the waveform preamble of a channel gets read. */
+static gboolean rigol_ds_want_preamble(const struct dev_context *devc,
+		const struct sr_channel *ch)
+{
+	return devc->num_frames == 0 && ch->type == SR_CHANNEL_ANALOG;
+}
+
+/*
+ * Queue the selection of a channel's waveform, followed by the preamble
+ * queries, or by an *OPC? query which synchronizes with the scope.
+ * Protocol V3 and later.
+ */
+static void rigol_ds_queue_source(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch)
+{
+	struct dev_context *devc;
+	gboolean first_frame;
+
+	devc = sdi->priv;
+	first_frame = devc->num_frames == 0;
+
+	if (devc->model->series->protocol == PROTOCOL_V3) {
+		if (ch->type == SR_CHANNEL_LOGIC)
+			sr_scpi_batch_add(devc->batch, ":WAV:SOUR LA");
+		else
+			sr_scpi_batch_add(devc->batch, ":WAV:SOUR CHAN%d",
+				ch->index + 1);
+		if (devc->data_source != DATA_SOURCE_LIVE) {
+			sr_scpi_batch_add(devc->batch, ":WAV:RES");
+			sr_scpi_batch_add(devc->batch, ":WAV:BEG");
+		}
+	} else {
+		if (ch->type == SR_CHANNEL_ANALOG)
+			sr_scpi_batch_add(devc->batch, ":WAV:SOUR CHAN%d",
+				ch->index + 1);
+		else
+			sr_scpi_batch_add(devc->batch, ":WAV:SOUR D%d",
+				ch->index);
+		if (first_frame)
+			sr_scpi_batch_add(devc->batch,
+				devc->data_source == DATA_SOURCE_LIVE ?
+					":WAV:MODE NORM" : ":WAV:MODE RAW");
+		if (devc->data_source != DATA_SOURCE_LIVE)
+			sr_scpi_batch_add(devc->batch, ":WAV:RES");
+	}
+
+	if (rigol_ds_want_preamble(devc, ch)) {
+		/* Vertical increment, origin and reference. */
+		sr_scpi_batch_add_query(devc->batch, ":WAV:YINC?");
+		sr_scpi_batch_add_query(devc->batch, ":WAV:YOR?");
+		sr_scpi_batch_add_query(devc->batch, ":WAV:YREF?");
+	} else {
+		sr_scpi_batch_add_query(devc->batch, SCPI_CMD_OPC);
+	}
+}
+
+/*
+ * Queue the request of the current channel's data block which starts
+ * at an offset into the channel's data. Protocol V3 and later.
+ */
+static void rigol_ds_queue_block(const struct sr_dev_inst *sdi,
+		uint64_t channel_bytes)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	if (devc->model->series->protocol >= PROTOCOL_V4 &&
+			devc->num_frames == 0) {
+		sr_scpi_batch_add(devc->batch, ":WAV:START %" PRIu64,
+			channel_bytes + 1);
+		sr_scpi_batch_add(devc->batch, ":WAV:STOP %" PRIu64,
+			MIN(channel_bytes + ACQ_BLOCK_SIZE,
+				devc->analog_frame_size));
+	}
+	sr_scpi_batch_add(devc->batch, ":WAV:BEG");
+	sr_scpi_batch_add_query(devc->batch, ":WAV:DATA?");
+}
+
+/*
+ * Request the block which follows the current one before the current
+ * one gets read: the channel's next block, or the first block of the
+ * frame's next channel. The scope prepares it while the current block
+ * is transferred, which hides the round trips between blocks and
+ * channels. Protocol V3 needs other commands between the channels, and
+ * status polling between the blocks, so it is not pipelined.
+ */
+static int rigol_ds_queue_next(const struct sr_dev_inst *sdi,
+		uint64_t block_len, uint64_t expected_data_bytes)
+{
+	struct dev_context *devc;
+	struct sr_channel *next;
+
+	devc = sdi->priv;
+
+	if (devc->model->series->protocol < PROTOCOL_V4)
+		return SR_OK;
+
+	if (devc->num_channel_bytes + block_len < expected_data_bytes) {
+		rigol_ds_queue_block(sdi, devc->num_channel_bytes + block_len);
+	} else if (devc->channel_entry->next) {
+		next = devc->channel_entry->next->data;
+		rigol_ds_queue_source(sdi, next);
+		rigol_ds_queue_block(sdi, 0);
+		devc->source_queued = TRUE;
+	} else {
+		return SR_OK;
+	}
+	devc->block_queued = TRUE;
+
+	return sr_scpi_batch_flush(devc->batch);
+}
+
 /* Start reading data from the current channel */
 SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
+	char *buf;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
@@ -466,8 +588,6 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Starting reading data from channel %d", ch->index + 1);
 
-	const gboolean first_frame = (devc->num_frames == 0);
-
 	switch (devc->model->series->protocol) {
 	case PROTOCOL_V1:
 	case PROTOCOL_V2:
@@ -480,65 +600,41 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 				return SR_ERR;
 		}
 		rigol_ds_set_wait_event(devc, WAIT_NONE);
+		if (ch->type == SR_CHANNEL_ANALOG)
+			devc->vert_inc[ch->index] = devc->vdiv[ch->index] / 25.6;
 		break;
-	case PROTOCOL_V3:
-		if (ch->type == SR_CHANNEL_LOGIC) {
-			if (rigol_ds_config_set(sdi, ":WAV:SOUR LA") != SR_OK)
-				return SR_ERR;
-		} else {
-			if (rigol_ds_config_set(sdi, ":WAV:SOUR CHAN%d",
-					ch->index + 1) != SR_OK)
-				return SR_ERR;
-		}
-		if (devc->data_source != DATA_SOURCE_LIVE) {
-			if (rigol_ds_config_set(sdi, ":WAV:RES") != SR_OK)
-				return SR_ERR;
-			if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
-				return SR_ERR;
-		}
-		break;
-	case PROTOCOL_V4:
-	case PROTOCOL_V5:
-		if (ch->type == SR_CHANNEL_ANALOG) {
-			if (rigol_ds_config_set(sdi, ":WAV:SOUR CHAN%d",
-					ch->index + 1) != SR_OK)
-				return SR_ERR;
+	default:
+		/*
+		 * The source selection and the preamble queries take a
+		 * single round trip on connections which support pipelining.
+		 * They were queued ahead along with the previous channel's
+		 * last block request, or get queued now.
+		 */
+		if (!devc->source_queued)
+			rigol_ds_queue_source(sdi, ch);
+		devc->source_queued = FALSE;
+		if (sr_scpi_batch_flush(devc->batch) != SR_OK)
+			goto err_batch;
+		if (rigol_ds_want_preamble(devc, ch)) {
+			if (sr_scpi_batch_get_float(devc->batch,
+					&devc->vert_inc[ch->index]) != SR_OK)
+				goto err_batch;
+			if (sr_scpi_batch_get_float(devc->batch,
+					&devc->vert_origin[ch->index]) != SR_OK)
+				goto err_batch;
+			if (sr_scpi_batch_get_int(devc->batch,
+					&devc->vert_reference[ch->index]) != SR_OK)
+				goto err_batch;
 		} else {
-			if (rigol_ds_config_set(sdi, ":WAV:SOUR D%d",
-					ch->index) != SR_OK)
-				return SR_ERR;
-		}
-
-		if (first_frame && rigol_ds_config_set(sdi,
-					devc->data_source == DATA_SOURCE_LIVE ?
-						":WAV:MODE NORM" :":WAV:MODE RAW") != SR_OK)
-			return SR_ERR;
-
-		if (devc->data_source != DATA_SOURCE_LIVE) {
-			if (rigol_ds_config_set(sdi, ":WAV:RES") != SR_OK)
-				return SR_ERR;
+			if (sr_scpi_batch_get_string(devc->batch, &buf) != SR_OK) {
+				g_free(buf);
+				goto err_batch;
+			}
+			g_free(buf);
 		}
 		break;
 	}
 
-	if (devc->model->series->protocol >= PROTOCOL_V3 &&
-			ch->type == SR_CHANNEL_ANALOG) {
-		/* Vertical increment. */
-		if (first_frame && sr_scpi_get_float(sdi->conn, ":WAV:YINC?",
-				&devc->vert_inc[ch->index]) != SR_OK)
-			return SR_ERR;
-		/* Vertical origin. */
-		if (first_frame && sr_scpi_get_float(sdi->conn, ":WAV:YOR?",
-			&devc->vert_origin[ch->index]) != SR_OK)
-			return SR_ERR;
-		/* Vertical reference. */
-		if (first_frame && sr_scpi_get_int(sdi->conn, ":WAV:YREF?",
-				&devc->vert_reference[ch->index]) != SR_OK)
-			return SR_ERR;
-	} else if (ch->type == SR_CHANNEL_ANALOG) {
-		devc->vert_inc[ch->index] = devc->vdiv[ch->index] / 25.6;
-	}
-
 	rigol_ds_set_wait_event(devc, WAIT_BLOCK);
 
 	devc->num_channel_bytes = 0;
@@ -546,6 +642,10 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 	devc->num_block_bytes = 0;
 
 	return SR_OK;
+
+err_batch:
+	rigol_ds_batch_reset(devc);
+	return SR_ERR;
 }
 
 /* Read the header of a data block */
@@ -617,9 +717,10 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	int len, vref;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
+	size_t block_len;
 
 	(void)fd;
 
@@ -634,8 +735,6 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
-	const gboolean first_frame = (devc->num_frames == 0);
-
 	switch (devc->wait_event) {
 	case WAIT_NONE:
 		break;
@@ -667,24 +766,58 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	expected_data_bytes = ch->type == SR_CHANNEL_ANALOG ?
 			devc->analog_frame_size : devc->digital_frame_size;
 
-	if (devc->num_block_bytes == 0) {
-		if (devc->model->series->protocol >= PROTOCOL_V4) {
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
-					devc->num_channel_bytes + 1) != SR_OK)
-				return TRUE;
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
-					MIN(devc->num_channel_bytes + ACQ_BLOCK_SIZE,
-						devc->analog_frame_size)) != SR_OK)
-				return TRUE;
+	if (devc->num_block_bytes == 0 &&
+			devc->model->series->protocol >= PROTOCOL_V3) {
+		/* Request the block in a single write, unless that happened. */
+		if (!devc->block_queued)
+			rigol_ds_queue_block(sdi, devc->num_channel_bytes);
+		devc->block_queued = FALSE;
+		if (sr_scpi_batch_flush(devc->batch) != SR_OK) {
+			rigol_ds_batch_reset(devc);
+			return TRUE;
 		}
 
-		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			if (rigol_ds_config_set(sdi, ":WAV:BEG") != SR_OK)
-				return TRUE;
-			if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
-				return TRUE;
+		if (sr_scpi_batch_block_begin(devc->batch, &block_len) != SR_OK) {
+			rigol_ds_batch_reset(devc);
+			sr_err("Error while reading block header, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		/*
+		 * At slow timebases in live capture the DS2072 and
+		 * DS1054Z sometimes return "short" data blocks, with
+		 * apparently no way to get the rest of the data.
+		 * Discard these, the complete data block will appear
+		 * eventually.
+		 */
+		if (devc->data_source == DATA_SOURCE_LIVE
+				&& block_len < expected_data_bytes) {
+			sr_dbg("Discarding short data block: got %zu/%d bytes",
+				block_len, (int)expected_data_bytes);
+			while (block_len > 0) {
+				len = sr_scpi_batch_read_block(devc->batch,
+					devc->buffer, MIN(block_len, ACQ_BUFFER_SIZE));
+				if (len < 0) {
+					rigol_ds_batch_reset(devc);
+					break;
+				}
+				block_len -= len;
+			}
+			return TRUE;
 		}
+		devc->num_block_bytes = block_len;
+		devc->num_block_read = 0;
 
+		if (rigol_ds_queue_next(sdi, block_len,
+				expected_data_bytes) != SR_OK) {
+			rigol_ds_batch_reset(devc);
+			sr_err("Error while requesting data, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+	} else if (devc->num_block_bytes == 0) {
 		if (sr_scpi_read_begin(scpi) != SR_OK)
 			return TRUE;
 
@@ -700,12 +833,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 				sr_dev_acquisition_stop(sdi);
 				return TRUE;
 			}
-			/* At slow timebases in live capture the DS2072 and
-			 * DS1054Z sometimes return "short" data blocks, with
-			 * apparently no way to get the rest of the data.
-			 * Discard these, the complete data block will appear
-			 * eventually.
-			 */
+			/* See above, discard short data blocks. */
 			if (devc->data_source == DATA_SOURCE_LIVE
 					&& (unsigned)len < expected_data_bytes) {
 				sr_dbg("Discarding short data block: got %d/%d bytes\n", len, (int)expected_data_bytes);
@@ -725,9 +853,13 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		len = ACQ_BUFFER_SIZE;
 	sr_dbg("Requesting read of %d bytes", len);
 
-	len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
+	if (devc->model->series->protocol >= PROTOCOL_V3)
+		len = sr_scpi_batch_read_block(devc->batch, devc->buffer, len);
+	else
+		len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
 
-	if (len == -1) {
+	if (len < 0) {
+		rigol_ds_batch_reset(devc);
 		sr_err("Error while reading block data, aborting capture.");
 		std_session_send_df_frame_end(sdi);
 		sr_dev_acquisition_stop(sdi);
@@ -743,18 +875,30 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		vdiv = devc->vert_inc[ch->index];
 		origin = devc->vert_origin[ch->index];
 		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
 		float vdivlog = log10f(vdiv);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+		/*
+		 * Send the raw ADC codes, and express the vertical
+		 * calibration as the encoding's scale and offset.
+		 */
+		encoding.unitsize = sizeof(devc->buffer[0]);
+		encoding.is_float = FALSE;
+		encoding.is_signed = FALSE;
+		if (devc->model->series->protocol >= PROTOCOL_V3) {
+			/* value = (code - vref - origin) * vdiv */
+			sr_rational_from_double(&encoding.scale, vdiv);
+			sr_rational_from_double(&encoding.offset,
+				-(vref + origin) * vdiv);
+		} else {
+			/* value = (128 - code) * vdiv - offset */
+			sr_rational_from_double(&encoding.scale, -vdiv);
+			sr_rational_from_double(&encoding.offset,
+				128 * vdiv - offset);
+		}
 		analog.meaning->channels = g_slist_append(NULL, ch);
 		analog.num_samples = len;
-		analog.data = devc->data;
+		analog.data = devc->buffer;
 		analog.meaning->mq = SR_MQ_VOLTAGE;
 		analog.meaning->unit = SR_UNIT_VOLT;
 		analog.meaning->mqflags = 0;
@@ -776,10 +920,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 	if (devc->num_block_read == devc->num_block_bytes) {
 		sr_dbg("Block has been completed");
-		if (devc->model->series->protocol >= PROTOCOL_V3) {
-			/* Discard the terminating linefeed */
-			sr_scpi_read_data(scpi, (char *)devc->buffer, 1);
-		}
+		/* The batch has already consumed the terminating linefeed. */
 		if (devc->format == FORMAT_IEEE488_2) {
 			/* Prepare for possible next block */
 			devc->num_header_bytes = 0;
@@ -787,7 +928,9 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			if (devc->data_source != DATA_SOURCE_LIVE)
 				rigol_ds_set_wait_event(devc, WAIT_BLOCK);
 		}
-		if (!sr_scpi_read_complete(scpi) && !devc->channel_entry->next) {
+		if (devc->model->series->protocol < PROTOCOL_V3 &&
+				!sr_scpi_read_complete(scpi) &&
+				!devc->channel_entry->next) {
 			sr_err("Read should have been completed");
 		}
 		devc->num_block_read = 0;
@@ -162,7 +162,12 @@ struct dev_context {
 	int wait_status;
 	/* Acq buffers used for reading from the scope and sending data to app */
 	unsigned char *buffer;
-	float *data;
+	/* Queued waveform commands, pipelined on raw TCP connections */
+	struct sr_scpi_batch *batch;
+	/* The current channel's source selection was requested ahead */
+	gboolean source_queued;
+	/* The next data block was requested ahead */
+	gboolean block_queued;
 };
 
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
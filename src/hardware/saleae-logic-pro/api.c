@@ -117,6 +117,9 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 
 	sr_info("Firmware upload done.");
 
+	/* The device renumerates with the new firmware. */
+	sr_usb_cache_invalidate(ctx);
+
  out:
 	if (hdl)
 		libusb_close(hdl);
@@ -126,36 +129,34 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 	return ret;
 }
 
-static gboolean scan_firmware(libusb_device *dev)
+static gboolean scan_firmware(struct sr_context *ctx, libusb_device *dev)
 {
 	struct libusb_device_descriptor des;
 	struct libusb_device_handle *hdl;
 	gboolean ret;
-	unsigned char strdesc[64];
+	char strdesc[64];
 
 	hdl = NULL;
 	ret = FALSE;
 
 	libusb_get_device_descriptor(dev, &des);
 
-	if (libusb_open(dev, &hdl) != 0)
-		goto out;
-
-	if (libusb_get_string_descriptor_ascii(hdl,
+	if (sr_usb_get_string(ctx, dev, &hdl,
 		des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
 		goto out;
-	if (strcmp((const char *)strdesc, "Saleae"))
+	if (strcmp(strdesc, "Saleae"))
 		goto out;
 
-	if (libusb_get_string_descriptor_ascii(hdl,
+	if (sr_usb_get_string(ctx, dev, &hdl,
 		des.iProduct, strdesc, sizeof(strdesc)) < 0)
 		goto out;
-	if (strcmp((const char *)strdesc, "Logic Pro"))
+	if (strcmp(strdesc, "Logic Pro"))
 		goto out;
 
 	ret = TRUE;
 
 out:
+	/* Only opened on a string cache miss. */
 	if (hdl)
 		libusb_close(hdl);
 
@@ -190,14 +191,14 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
 		if (des.idVendor != 0x21a9 || des.idProduct != 0x1006)
 			continue;
 
-		if (!scan_firmware(devlist[i])) {
+		if (!scan_firmware(drvc->sr_ctx, devlist[i])) {
 			const char *fwname;
 			sr_info("Found a Logic Pro 16 device (no firmware loaded).");
 			fwname = "saleae-logicpro16-fx3.fw";
@@ -214,10 +215,10 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		/* Give the device some time to come back and scan again */
 		libusb_free_device_list(devlist, 1);
 		g_usleep(500 * 1000);
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		if (conn_devices) {
 			struct sr_usb_dev_inst *usb = NULL;
@@ -278,7 +279,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	struct sr_usb_dev_inst *usb = sdi->conn;
 	int ret;
 
-	if (sr_usb_open(drvc->sr_ctx->libusb_ctx, usb) != SR_OK)
+	if (sr_usb_open(drvc->sr_ctx, usb) != SR_OK)
 		return SR_ERR;
 
 	if ((ret = libusb_claim_interface(usb->devhdl, 0))) {
@@ -578,9 +578,8 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			continue;
 
 		mask = 1 << c->index;
-		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
+		devc->dig_channel_map[devc->dig_channel_cnt++] = c->index;
 		devc->dig_channel_mask |= mask;
-
 	}
 	sr_dbg("%d channels enabled (0x%04x)",
 	       devc->dig_channel_cnt, devc->dig_channel_mask);
@@ -796,7 +795,7 @@ SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 
 	devc->conv_size = 0;
-	devc->batch_index = 0;
+	devc->batch_fill = 0;
 
 	write_reg(sdi, 0x00, 0x01);
 
@@ -846,43 +845,46 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
  * This stream of batches is packed into USB packets with 16384 bytes each.
  */
 static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
-					 const uint32_t *src, size_t srccnt)
+					 const uint8_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
 	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
-
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
-	/* Reset converted size. */
+	size_t batch_size, batch_count, count;
+
+	batch_size = devc->dig_channel_cnt * sizeof(uint32_t);
 	devc->conv_size = 0;
 
-	batch_index = devc->batch_index;
-	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
-
-		/* Last index of the batch. */
-		if (++batch_index == devc->dig_channel_cnt) {
-			devc->conv_size += CONV_BATCH_SIZE;
-			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
-		}
+	/* No digital channels (analog only capture), no logic data. */
+	if (!batch_size)
+		return;
+
+	/* Complete the partial batch from the previous packet. */
+	if (devc->batch_fill) {
+		count = MIN(batch_size - devc->batch_fill, srccnt);
+		memcpy(&devc->batch_data[devc->batch_fill], src, count);
+		devc->batch_fill += count;
+		src += count;
+		srccnt -= count;
+		if (devc->batch_fill < batch_size)
+			return;
+		sr_planar_to_logic(dst, 2, devc->batch_data, 1, 32, TRUE,
+			devc->dig_channel_map, devc->dig_channel_cnt);
+		devc->batch_fill = 0;
+		devc->conv_size += CONV_BATCH_SIZE;
+		dst += CONV_BATCH_SIZE;
 	}
-	devc->batch_index = batch_index;
+
+	/* Convert all complete batches. */
+	batch_count = srccnt / batch_size;
+	sr_planar_to_logic(dst, 2, src, batch_count, 32, TRUE,
+		devc->dig_channel_map, devc->dig_channel_cnt);
+	devc->conv_size += batch_count * CONV_BATCH_SIZE;
+	src += batch_count * batch_size;
+	srccnt -= batch_count * batch_size;
+
+	/* Keep the partial batch for the next packet. */
+	memcpy(devc->batch_data, src, srccnt);
+	devc->batch_fill = srccnt;
 }
 
 SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *transfer)
@@ -903,7 +905,7 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 		return;
 	}
 
-	saleae_logic_pro_convert_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
+	saleae_logic_pro_convert_data(sdi, transfer->buffer, 16 * 1024);
 	saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
 
 	if ((ret = libusb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
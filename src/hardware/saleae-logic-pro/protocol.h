@@ -39,7 +39,7 @@
 struct dev_context {
 	unsigned int dig_channel_cnt;
 	uint16_t dig_channel_mask;
-	uint16_t dig_channel_masks[16];
+	uint8_t dig_channel_map[16];
 	uint64_t dig_samplerate;
 
 	uint32_t lfsr;
@@ -50,7 +50,8 @@ struct dev_context {
 
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
-	unsigned int batch_index;
+	uint8_t batch_data[16 * sizeof(uint32_t)];
+	size_t batch_fill;
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
@@ -101,12 +101,12 @@ static const uint64_t samplerates[] = {
 	SR_MHZ(100),
 };
 
-static gboolean check_conf_profile(libusb_device *dev)
+static gboolean check_conf_profile(struct sr_context *ctx, libusb_device *dev)
 {
 	struct libusb_device_descriptor des;
 	struct libusb_device_handle *hdl;
 	gboolean ret;
-	unsigned char strdesc[64];
+	char strdesc[64];
 
 	hdl = NULL;
 	ret = FALSE;
@@ -114,24 +114,22 @@ static gboolean check_conf_profile(libusb_device *dev)
 		/* Assume the FW has not been loaded, unless proven wrong. */
 		libusb_get_device_descriptor(dev, &des);
 
-		if (libusb_open(dev, &hdl) != 0)
-			break;
-
-		if (libusb_get_string_descriptor_ascii(hdl,
+		if (sr_usb_get_string(ctx, dev, &hdl,
 		    des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
 			break;
-		if (strcmp((const char *)strdesc, "Saleae LLC"))
+		if (strcmp(strdesc, "Saleae LLC"))
 			break;
 
-		if (libusb_get_string_descriptor_ascii(hdl,
+		if (sr_usb_get_string(ctx, dev, &hdl,
 		    des.iProduct, strdesc, sizeof(strdesc)) < 0)
 			break;
-		if (strcmp((const char *)strdesc, "Logic S/16"))
+		if (strcmp(strdesc, "Logic S/16"))
 			break;
 
 		/* If we made it here, it must be a configured Logic16. */
 		ret = TRUE;
 	}
+	/* Only opened on a string cache miss. */
 	if (hdl)
 		libusb_close(hdl);
 
@@ -164,13 +162,13 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 	if (conn)
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	else
 		conn_devices = NULL;
 
 	/* Find all Logic16 devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -209,7 +207,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		sdi->priv = devc;
 		devices = g_slist_append(devices, sdi);
 
-		if (check_conf_profile(devlist[i])) {
+		if (check_conf_profile(drvc->sr_ctx, devlist[i])) {
 			/* Already has the firmware, so fix the new address. */
 			sr_dbg("Found a Logic16 device.");
 			sdi->status = SR_ST_INACTIVE;
@@ -578,17 +576,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		channel_bit = 1 << (ch->index);
 
 		devc->cur_channels |= channel_bit;
-
-#ifdef WORDS_BIGENDIAN
-		/*
-		 * Output logic data should be stored in little endian format.
-		 * To speed things up during conversion, do the switcharoo
-		 * here instead.
-		 */
-		channel_bit = 1 << (ch->index ^ 8);
-#endif
-
-		devc->channel_masks[devc->num_channels++] = channel_bit;
+		devc->channel_map[devc->num_channels++] = ch->index;
 	}
 
 	return SR_OK;
@@ -646,8 +634,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	devc->sent_samples = 0;
 	devc->empty_transfer_count = 0;
-	devc->cur_channel = 0;
-	memset(devc->channel_data, 0, sizeof(devc->channel_data));
+	devc->batch_fill = 0;
 
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
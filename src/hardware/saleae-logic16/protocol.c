@@ -806,41 +806,50 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
-	uint16_t *channel_data;
-	int i, cur_channel;
-	size_t ret = 0;
-	uint16_t sample, channel_mask;
+	size_t batch_size, batch_count, count, ret;
 
-	srccnt /= 2;
-
-	channel_data = devc->channel_data;
-	cur_channel = devc->cur_channel;
-
-	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
-		src += 2;
-
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
-
-		if (++cur_channel == devc->num_channels) {
-			cur_channel = 0;
-			if (destcnt < 16 * 2) {
-				sr_err("Conversion buffer too small!");
-				break;
-			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
-			dest += 16 * 2;
-			ret += 16;
-			destcnt -= 16 * 2;
+	/*
+	 * One batch holds a 16bit word for each enabled channel, each
+	 * word carries 16 samples of one channel (MSB first). Batches
+	 * can span USB transfers, keep the incomplete remainder around.
+	 */
+	batch_size = devc->num_channels * sizeof(uint16_t);
+	ret = 0;
+
+	if (devc->batch_fill) {
+		count = MIN(batch_size - devc->batch_fill, srccnt);
+		memcpy(&devc->batch_data[devc->batch_fill], src, count);
+		devc->batch_fill += count;
+		src += count;
+		srccnt -= count;
+		if (devc->batch_fill < batch_size)
+			return 0;
+		devc->batch_fill = 0;
+		if (destcnt < 16 * 2) {
+			sr_err("Conversion buffer too small!");
+			return 0;
 		}
-	}
-
-	devc->cur_channel = cur_channel;
+		sr_planar_to_logic(dest, 2, devc->batch_data, 1, 16, TRUE,
+			devc->channel_map, devc->num_channels);
+		dest += 16 * 2;
+		destcnt -= 16 * 2;
+		ret += 16;
+	}
+
+	batch_count = srccnt / batch_size;
+	if (batch_count > destcnt / (16 * 2)) {
+		sr_err("Conversion buffer too small!");
+		batch_count = destcnt / (16 * 2);
+		srccnt = batch_count * batch_size;
+	}
+	sr_planar_to_logic(dest, 2, src, batch_count, 16, TRUE,
+		devc->channel_map, devc->num_channels);
+	ret += 16 * batch_count;
+	src += batch_count * batch_size;
+	srccnt -= batch_count * batch_size;
+
+	memcpy(devc->batch_data, src, srccnt);
+	devc->batch_fill = srccnt;
 
 	return ret;
 }
@@ -78,9 +78,9 @@ struct dev_context {
 	int submitted_transfers;
 	int empty_transfer_count;
 	int num_channels;
-	int cur_channel;
-	uint16_t channel_masks[16];
-	uint16_t channel_data[16];
+	uint8_t channel_map[16];
+	uint8_t batch_data[16 * 2];
+	size_t batch_fill;
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
 	struct soft_trigger_logic *stl;
@@ -887,9 +887,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	std_session_send_df_header(sdi);
 
 	devc->channel_entry = devc->enabled_channels;
+	devc->batch = sr_scpi_batch_new(scpi);
+	devc->analog_requested = FALSE;
 
-	if (siglent_sds_capture_start(sdi) != SR_OK)
+	if (siglent_sds_capture_start(sdi) != SR_OK) {
+		sr_scpi_batch_free(devc->batch);
+		devc->batch = NULL;
 		return SR_ERR;
+	}
 
 	/* Start of first frame. */
 	std_session_send_df_frame_begin(sdi);
@@ -910,6 +915,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_batch_free(devc->batch);
+	devc->batch = NULL;
 
 	return SR_OK;
 }
@@ -157,6 +157,8 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 	if (!(devc = sdi->priv))
 		return SR_ERR;
 
+	devc->analog_requested = FALSE;
+
 	switch (devc->model->series->protocol) {
 	case SPO_MODEL:
 		if (devc->data_source == DATA_SOURCE_SCREEN) {
@@ -266,12 +268,49 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Drop queued and outstanding waveform requests after an error. */
+static void siglent_sds_batch_reset(struct dev_context *devc)
+{
+	sr_scpi_batch_reset(devc->batch);
+	devc->analog_requested = FALSE;
+}
+
+/*
+ * Request the waveforms of the current and all following analog
+ * channels of the frame in a single write, unless that happened
+ * already. The responses get read back-to-back, without a round trip
+ * per channel.
+ */
+static int siglent_sds_request_analog(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_channel *ch;
+	GSList *l;
+
+	devc = sdi->priv;
+	if (devc->analog_requested)
+		return SR_OK;
+
+	for (l = devc->channel_entry; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_ANALOG)
+			sr_scpi_batch_add_query(devc->batch, "C%d:WF? ALL",
+				ch->index + 1);
+	}
+	if (sr_scpi_batch_flush(devc->batch) != SR_OK) {
+		siglent_sds_batch_reset(devc);
+		return SR_ERR;
+	}
+	devc->analog_requested = TRUE;
+
+	return SR_OK;
+}
+
 /* Start reading data from the current channel. */
 SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
-	const char *s;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
@@ -283,20 +322,20 @@ SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 	switch (devc->model->series->protocol) {
 	case NON_SPO_MODEL:
 	case SPO_MODEL:
-		s = (ch->type == SR_CHANNEL_LOGIC) ? "D%d:WF?" : "C%d:WF? ALL";
-		if (sr_scpi_send(sdi->conn, s, ch->index + 1) != SR_OK)
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			if (sr_scpi_send(sdi->conn, "D%d:WF?",
+					ch->index + 1) != SR_OK)
+				return SR_ERR;
+		} else if (siglent_sds_request_analog(sdi) != SR_OK) {
 			return SR_ERR;
+		}
 		siglent_sds_set_wait_event(devc, WAIT_NONE);
 		break;
 	case ESERIES:
 		if (ch->type == SR_CHANNEL_ANALOG) {
-			if (sr_scpi_send(sdi->conn, "C%d:WF? ALL",
-				ch->index + 1) != SR_OK)
+			if (siglent_sds_request_analog(sdi) != SR_OK)
 				return SR_ERR;
 		}
-		siglent_sds_set_wait_event(devc, WAIT_NONE);
-		if (sr_scpi_read_begin(sdi->conn) != SR_OK)
-			return TRUE;
 		siglent_sds_set_wait_event(devc, WAIT_BLOCK);
 		break;
 	}
@@ -308,56 +347,107 @@ SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-/* Read the header of a data block. */
-static int siglent_sds_read_header(struct sr_dev_inst *sdi)
+/*
+ * Read an analog channel's waveform, which starts with the waveform
+ * descriptor, and send the samples.
+ */
+static int siglent_sds_get_analog(const struct sr_dev_inst *sdi,
+		struct sr_channel *ch)
 {
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
-	struct dev_context *devc = sdi->priv;
-	char *buf = (char *)devc->buffer;
-	int ret, desc_length;
-	int block_offset = 15; /* Offset for descriptor block. */
-	long data_length = 0;
-
-	/* Read header from device. */
-	ret = sr_scpi_read_data(scpi, buf, SIGLENT_HEADER_SIZE);
-	if (ret < SIGLENT_HEADER_SIZE) {
-		sr_err("Read error while reading data header.");
-		return SR_ERR;
-	}
-	sr_dbg("Device returned %i bytes.", ret);
-	devc->num_header_bytes += ret;
-	buf += block_offset; /* Skip to start descriptor block. */
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GByteArray *block;
+	uint32_t desc_length, data_length;
+	float vdiv, offset, vdivlog;
+	int digits;
 
-	/* Parse WaveDescriptor header. */
-	memcpy(&desc_length, buf + 36, 4); /* Descriptor block length */
-	memcpy(&data_length, buf + 60, 4); /* Data block length */
+	devc = sdi->priv;
 
-	devc->block_header_size = desc_length + 15;
-	devc->num_samples = data_length;
+	if (sr_scpi_batch_get_block(devc->batch, &block) != SR_OK)
+		return SR_ERR;
 
-	sr_dbg("Received data block header: '%s' -> block length %d.", buf, ret);
+	/* Descriptor block length, and data block length. */
+	if (block->len < 64) {
+		sr_err("Received short waveform descriptor.");
+		g_byte_array_free(block, TRUE);
+		return SR_ERR_DATA;
+	}
+	desc_length = RL32(&block->data[36]);
+	data_length = RL32(&block->data[60]);
+	if ((uint64_t)desc_length + data_length > block->len) {
+		sr_err("Received incomplete waveform.");
+		g_byte_array_free(block, TRUE);
+		return SR_ERR_DATA;
+	}
+	devc->block_header_size = desc_length;
+	devc->num_samples = data_length;
+	sr_dbg("Received waveform: %" PRIu32 " bytes descriptor, %"
+		PRIu32 " samples.", desc_length, data_length);
+
+	vdiv = devc->vdiv[ch->index];
+	offset = devc->vert_offset[ch->index];
+	vdivlog = log10f(vdiv);
+	digits = -(int) vdivlog + (vdivlog < 0.0);
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	/*
+	 * Send the signed 8bit ADC codes, with
+	 * value = code / 25 * vdiv - offset.
+	 */
+	encoding.unitsize = sizeof(int8_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	sr_rational_from_double(&encoding.scale, vdiv / 25.0);
+	sr_rational_from_double(&encoding.offset, -offset);
+	analog.meaning->channels = g_slist_append(NULL, ch);
+	analog.num_samples = data_length;
+	analog.data = &block->data[desc_length];
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+
+	g_byte_array_free(block, TRUE);
 
-	return ret;
+	return SR_OK;
 }
 
 static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_channel *ch)
 {
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
 	struct dev_context *devc = sdi->priv;
 	GArray *tmp_samplebuf; /* Temp buffer while iterating over the scope samples */
-	char *buf = (char *)devc->buffer; /* Buffer from scope */
 	uint8_t tmp_value; /* Holding temp value from data */
-	GArray *data_low_channels, *data_high_channels, *buffdata;
+	GArray *data_low_channels, *data_high_channels;
+	GByteArray *buffdata;
 	GSList *l;
 	gboolean low_channels; /* Lower channels enabled */
 	gboolean high_channels; /* Higher channels enabled */
 	int len, channel_index;
-	uint64_t samples_index;
+	uint64_t samples_index, num_bytes;
 
 	len = 0;
 	channel_index = 0;
 	low_channels = FALSE;
 	high_channels = FALSE;
+
+	/* Request all enabled channels at once, then read the blocks back-to-back. */
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && ch->enabled)
+			sr_scpi_batch_add_query(devc->batch, "D%d:WF? DAT2",
+				ch->index);
+	}
+	if (sr_scpi_batch_flush(devc->batch) != SR_OK) {
+		siglent_sds_batch_reset(devc);
+		return 0;
+	}
+
 	data_low_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
 	data_high_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
 
@@ -366,20 +456,17 @@ static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_chan
 		samples_index = 0;
 		if (ch->type == SR_CHANNEL_LOGIC) {
 			if (ch->enabled) {
-				if (sr_scpi_send(sdi->conn, "D%d:WF? DAT2", ch->index) != SR_OK)
-					return SR_ERR;
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				len = sr_scpi_read_data(scpi, buf, -1);
-				if (len < 0)
-					return TRUE;
-				len -= 15;
-				buffdata = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-				buf += 15; /* Skipping the data header. */
-				g_array_append_vals(buffdata, buf, len);
+				if (sr_scpi_batch_get_block(devc->batch, &buffdata) != SR_OK) {
+					siglent_sds_batch_reset(devc);
+					g_array_free(data_low_channels, TRUE);
+					g_array_free(data_high_channels, TRUE);
+					return 0;
+				}
+				len = buffdata->len;
+				num_bytes = MIN(devc->memory_depth_digital, buffdata->len);
 				tmp_samplebuf = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len); /* New temp buffer. */
-				for (uint64_t cur_sample_index = 0; cur_sample_index < devc->memory_depth_digital; cur_sample_index++) {
-					char sample = (char)g_array_index(buffdata, uint8_t, cur_sample_index);
+				for (uint64_t cur_sample_index = 0; cur_sample_index < num_bytes; cur_sample_index++) {
+					char sample = (char)buffdata->data[cur_sample_index];
 					for (int ii = 0; ii < 8; ii++, sample >>= 1) {
 						if (ch->index < 8) {
 							channel_index = ch->index;
@@ -426,7 +513,7 @@ static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_chan
 						g_array_append_val(data_high_channels, value);
 				}
 				g_array_free(tmp_samplebuf, TRUE);
-				g_array_free(buffdata, TRUE);
+				g_byte_array_free(buffdata, TRUE);
 			}
 		}
 	}
@@ -460,18 +547,11 @@ static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_chan
 SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
-	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	struct sr_channel *ch;
-	int len, i;
 	float wait;
-	gboolean read_complete = FALSE;
 
 	(void)fd;
 
@@ -481,8 +561,6 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	if (!(devc = sdi->priv))
 		return TRUE;
 
-	scpi = sdi->conn;
-
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
@@ -511,140 +589,49 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	}
 
 	ch = devc->channel_entry->data;
-	len = 0;
 
 	if (ch->type == SR_CHANNEL_ANALOG) {
-		if (devc->num_block_bytes == 0) {
-			/* Wait for the device to fill its output buffers. */
-			switch (devc->model->series->protocol) {
-			case NON_SPO_MODEL:
-			case SPO_MODEL:
-				/* The older models need more time to prepare the the output buffers due to CPU speed. */
-				wait = (devc->memory_depth_analog * 2.5);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				break;
-			case ESERIES:
-				/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				break;
-			}
+		/* Wait for the device to fill its output buffers. */
+		switch (devc->model->series->protocol) {
+		case NON_SPO_MODEL:
+		case SPO_MODEL:
+			/* The older models need more time to prepare the the output buffers due to CPU speed. */
+			wait = (devc->memory_depth_analog * 2.5);
+			break;
+		case ESERIES:
+		default:
+			/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
+			wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
+			break;
+		}
+		sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
+		g_usleep(wait);
 
-			sr_dbg("New block with header expected.");
-			len = siglent_sds_read_header(sdi);
-			if (len == 0)
-				/* Still reading the header. */
-				return TRUE;
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
-				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-			devc->num_block_bytes = len;
-			devc->num_block_read = 0;
+		if (siglent_sds_get_analog(sdi, ch) != SR_OK) {
+			siglent_sds_batch_reset(devc);
+			sr_err("Read error, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sdi->driver->dev_acquisition_stop(sdi);
+			return TRUE;
+		}
 
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+		if (devc->channel_entry->next) {
+			/* We got the frame for this channel, now get the next channel. */
+			devc->channel_entry = devc->channel_entry->next;
+			siglent_sds_channel_start(sdi);
+		} else {
+			/* Done with this frame. */
+			std_session_send_df_frame_end(sdi);
+			if (++devc->num_frames == devc->limit_frames) {
+				/* Last frame, stop capture. */
 				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-
-			do {
-				read_complete = FALSE;
-				if (devc->num_block_bytes > devc->num_samples) {
-					/* We received all data as one block. */
-					/* Offset the data block buffer past the IEEE header and description header. */
-					devc->buffer += devc->block_header_size;
-					len = devc->num_samples;
-				} else {
-					sr_dbg("Requesting: %" PRIu64 " bytes.", devc->num_samples - devc->num_block_bytes);
-					len = sr_scpi_read_data(scpi, (char *)devc->buffer, devc->num_samples-devc->num_block_bytes);
-					if (len == -1) {
-						sr_err("Read error, aborting capture.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read++;
-					devc->num_block_bytes += len;
-				}
-				sr_dbg("Received block: %i, %d bytes.", devc->num_block_read, len);
-				if (ch->type == SR_CHANNEL_ANALOG) {
-					float vdiv = devc->vdiv[ch->index];
-					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
-					int digits;
-
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
-					vdivlog = log10f(vdiv);
-					digits = -(int) vdivlog + (vdivlog < 0.0);
-					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
-					analog.meaning->mq = SR_MQ_VOLTAGE;
-					analog.meaning->unit = SR_UNIT_VOLT;
-					analog.meaning->mqflags = 0;
-					packet.type = SR_DF_ANALOG;
-					packet.payload = &analog;
-					sr_session_send(sdi, &packet);
-					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
-				}
-				len = 0;
-				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
-					sr_dbg("Transfer has been completed.");
-					devc->num_header_bytes = 0;
-					devc->num_block_bytes = 0;
-					read_complete = TRUE;
-					if (!sr_scpi_read_complete(scpi)) {
-						sr_err("Read should have been completed.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read = 0;
-				} else {
-					sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read.",
-						devc->num_block_bytes, devc->num_samples);
-				}
-			} while (!read_complete);
-
-			if (devc->channel_entry->next) {
-				/* We got the frame for this channel, now get the next channel. */
-				devc->channel_entry = devc->channel_entry->next;
-				siglent_sds_channel_start(sdi);
 			} else {
-				/* Done with this frame. */
-				std_session_send_df_frame_end(sdi);
-				if (++devc->num_frames == devc->limit_frames) {
-					/* Last frame, stop capture. */
-					sdi->driver->dev_acquisition_stop(sdi);
-				} else {
-					/* Get the next frame, starting with the first channel. */
-					devc->channel_entry = devc->enabled_channels;
-					siglent_sds_capture_start(sdi);
+				/* Get the next frame, starting with the first channel. */
+				devc->channel_entry = devc->enabled_channels;
+				siglent_sds_capture_start(sdi);
 
-					/* Start of next frame. */
-					std_session_send_df_frame_begin(sdi);
-				}
+				/* Start of next frame. */
+				std_session_send_df_frame_begin(sdi);
 			}
 		}
 	} else {
@@ -31,7 +31,6 @@
 //#define ACQ_BUFFER_SIZE (6000000)
 #define ACQ_BUFFER_SIZE (18000000)
 
-#define SIGLENT_HEADER_SIZE 363
 #define SIGLENT_DIG_HEADER_SIZE 346
 
 /* Maximum number of samples to retrieve at once. */
@@ -153,6 +152,10 @@ struct dev_context {
 	unsigned char *buffer;
 	float *data;
 	GArray *dig_buffer;
+	/* Queued waveform queries, pipelined on raw TCP connections. */
+	struct sr_scpi_batch *batch;
+	/* The waveforms of the frame's remaining analog channels were requested. */
+	gboolean analog_requested;
 };
 
 SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
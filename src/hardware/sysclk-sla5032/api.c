@@ -165,11 +165,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 	if (conn) {
 		/* Find devices matching the connection specification. */
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
+		conn_devices = sr_usb_find(drvc->sr_ctx, conn);
 	}
 
 	/* List all libusb devices. */
-	num_devs = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	num_devs = sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (num_devs < 0) {
 		sr_err("Failed to list USB devices: %s.",
 			libusb_error_name(num_devs));
@@ -205,7 +205,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	ret = sr_usb_open(drvc->sr_ctx, usb);
 	if (ret != SR_OK)
 		return ret;
 
@@ -67,10 +67,10 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (src->key != SR_CONF_CONN)
 			continue;
 		str = g_variant_get_string(src->data, NULL);
-		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, str);
+		conn_devices = sr_usb_find(drvc->sr_ctx, str);
 	}
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn_devices) {
 			usb = NULL;
@@ -88,23 +88,23 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0)
-			continue;
-
+		hdl = NULL;
 		manufacturer[0] = product[0] = '\0';
-		if (des.iManufacturer && (ret = libusb_get_string_descriptor_ascii(
-				hdl, des.iManufacturer, (unsigned char *) manufacturer,
+		if (des.iManufacturer && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iManufacturer, manufacturer,
 				sizeof(manufacturer))) < 0) {
 			sr_warn("Failed to get manufacturer string descriptor: %s.",
 				libusb_error_name(ret));
 		}
-		if (des.iProduct && (ret = libusb_get_string_descriptor_ascii(
-				hdl, des.iProduct, (unsigned char *) product,
+		if (des.iProduct && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iProduct, product,
 				sizeof(product))) < 0) {
 			sr_warn("Failed to get product string descriptor: %s.",
 				libusb_error_name(ret));
 		}
-		libusb_close(hdl);
+		/* Only opened on a string cache miss. */
+		if (hdl)
+			libusb_close(hdl);
 
 		if (strncmp(manufacturer, "testo", 5))
 			continue;
@@ -147,7 +147,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 	usb = sdi->conn;
 
-	ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	ret = sr_usb_open(drvc->sr_ctx, usb);
 	if (ret != SR_OK)
 		return ret;
 
@@ -73,7 +73,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		return NULL;
 
 	devices = NULL;
-	if (!(usb_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn))) {
+	if (!(usb_devices = sr_usb_find(drvc->sr_ctx, conn))) {
 		g_slist_free_full(usb_devices, g_free);
 		return NULL;
 	}
@@ -106,7 +106,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	drvc = di->context;
 	usb = sdi->conn;
 
-	return sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	return sr_usb_open(drvc->sr_ctx, usb);
 }
 
 static int config_set(uint32_t key, GVariant *data,
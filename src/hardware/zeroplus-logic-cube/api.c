@@ -179,29 +179,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 
 	/* Find all ZEROPLUS analyzers and add them to device list. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist); /* TODO: Errors. */
+	sr_usb_get_device_list(drvc->sr_ctx, &devlist); /* TODO: Errors. */
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0)
-			continue;
-
-		if (des.iSerialNumber == 0) {
-			serial_num[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iSerialNumber, (unsigned char *) serial_num,
-				sizeof(serial_num))) < 0) {
-			sr_warn("Failed to get serial number string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		libusb_close(hdl);
-
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
-			continue;
-
 		prof = NULL;
 		for (j = 0; j < zeroplus_models[j].vid; j++) {
 			if (des.idVendor == zeroplus_models[j].vid &&
@@ -212,6 +194,25 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		if (!prof)
 			continue;
+
+		hdl = NULL;
+		serial_num[0] = '\0';
+		ret = 0;
+		if (des.iSerialNumber && (ret = sr_usb_get_string(drvc->sr_ctx,
+				devlist[i], &hdl, des.iSerialNumber, serial_num,
+				sizeof(serial_num))) < 0)
+			sr_warn("Failed to get serial number string descriptor: %s.",
+				libusb_error_name(ret));
+
+		/* Only opened on a string cache miss. */
+		if (hdl)
+			libusb_close(hdl);
+		if (ret < 0)
+			continue;
+
+		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			continue;
+
 		sr_info("Found ZEROPLUS %s.", prof->model_name);
 
 		sdi = g_malloc0(sizeof(struct sr_dev_inst));
@@ -263,7 +264,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	usb = sdi->conn;
 	devc = sdi->priv;
 
-	ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	ret = sr_usb_open(drvc->sr_ctx, usb);
 	if (ret != SR_OK)
 		return ret;
 
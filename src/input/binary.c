@@ -91,17 +91,17 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = sr_input_buf_len(in) / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = sr_input_buf_data(in) + i;
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+	sr_input_buf_consume(in, chunk_size);
 
 	return SR_OK;
 }
@@ -110,7 +110,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -145,7 +145,7 @@ static int reset(struct sr_input *in)
 	struct context *inc = in->priv;
 
 	inc->started = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -174,6 +174,7 @@ SR_PRIV struct sr_input_module input_binary = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.reset = reset,
 };
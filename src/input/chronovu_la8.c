@@ -158,11 +158,11 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = unitsize;
 
 	/* Cut off at multiple of unitsize. Avoid sending the "header". */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = sr_input_buf_len(in) / logic.unitsize * logic.unitsize;
 	chunk_size = MIN(chunk_size, inc->samples_remain * unitsize);
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = sr_input_buf_data(in) + i;
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		if (chunk) {
 			logic.length = chunk;
@@ -170,7 +170,7 @@ static int process_buffer(struct sr_input *in)
 			inc->samples_remain -= chunk / unitsize;
 		}
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+	sr_input_buf_consume(in, chunk_size);
 
 	return SR_OK;
 }
@@ -179,7 +179,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -214,7 +214,7 @@ static int reset(struct sr_input *in)
 	struct context *inc = in->priv;
 
 	inc->started = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -245,6 +245,7 @@ SR_PRIV struct sr_input_module input_chronovu_la8 = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.reset = reset,
 };
@@ -34,6 +34,9 @@
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
 
+/* Minimum amount of text per parse thread. */
+#define PARALLEL_MIN_SIZE	(128 * 1024)
+
 /*
  * The CSV input module has the following options:
  *
@@ -91,6 +94,13 @@
  *     up to the end of the current text line. Can be empty to disable
  *     comment support. Defaults to semicolon.
  *
+ * threads: Specifies the number of threads which parse text lines.
+ *     Large amounts of input data get cut into runs of text lines which
+ *     get parsed in parallel, results are sent in input order. Applies
+ *     after the start line and the header line, and after the samplerate
+ *     was determined from timestamps. 0 uses the number of processors.
+ *     Defaults to 1, which parses all input in the calling thread.
+ *
  * Typical examples of using these options:
  * - ... -I csv:column_formats=*l ...
  *   All columns are single-bit logic data. Identical to the previous
@@ -202,6 +212,32 @@ struct column_details {
 	GString **channel_names;
 };
 
+/*
+ * Parse state of the current text line. The context has the instance
+ * for processing in the calling thread, parse threads have their own.
+ */
+struct line_state {
+	size_t line_number;		/**!< For diagnostics. */
+	uint8_t *sample_buffer;		/**!< Buffer for a single sample. */
+	csv_analog_t *analog_sample_buffer;	/**!< Buffer for one set of analog values. */
+	size_t analog_stride;		/**!< Distance of channels' analog values. */
+	char **columns;			/**!< The line's columns' text. */
+};
+
+/* A run of text lines which gets parsed in a separate thread. */
+struct parse_worker {
+	struct context *inc;
+	char *text;			/* NUL terminated text lines. */
+	size_t first_line;		/* Line number of the first line. */
+	size_t line_count;
+	struct line_state line;
+	size_t capacity;		/* Sample sets which fit the buffers. */
+	size_t rows;			/* Sample sets which were parsed. */
+	uint8_t *logic;			/* Logic sample sets, back to back. */
+	csv_analog_t *analog;		/* Analog values, 'capacity' per channel. */
+	int ret;
+};
+
 struct context {
 	gboolean started;
 
@@ -237,8 +273,6 @@ struct context {
 	gboolean header_seen;
 
 	size_t sample_unit_size;	/**!< Byte count for a single sample. */
-	uint8_t *sample_buffer;		/**!< Buffer for a single sample. */
-	csv_analog_t *analog_sample_buffer;	/**!< Buffer for one set of analog values. */
 
 	uint8_t *datafeed_buffer;	/**!< Queue for datafeed submission. */
 	size_t datafeed_buf_size;
@@ -250,8 +284,18 @@ struct context {
 	int *analog_datafeed_digits;
 	GSList **analog_datafeed_channels;
 
-	/* Current line number. */
+	/* Current line number, and parse state of the line. */
 	size_t line_number;
+	struct line_state line;
+
+	/* Parallel parsing of text lines. */
+	size_t threads;
+	struct parse_worker *workers;
+	size_t worker_count;
+	GThreadPool *pool;
+	GMutex pool_mutex;
+	GCond pool_cond;
+	size_t pool_pending;		/* Runs which pool threads still parse. */
 
 	/* List of previously created sigrok channels. */
 	GSList *prev_sr_channels;
@@ -287,15 +331,31 @@ static int flush_samplerate(const struct sr_input *in)
 	return SR_OK;
 }
 
-static void clear_logic_samples(struct context *inc)
+static void set_analog_value(const struct context *inc,
+	struct line_state *line, size_t ch_idx, csv_analog_t value);
+
+/* Have the line's sample set point to the datafeed submission queue. */
+static void select_queued_samples(struct context *inc)
 {
-	if (!inc->logic_channels)
-		return;
-	inc->sample_buffer = &inc->datafeed_buffer[inc->datafeed_buf_fill];
-	memset(inc->sample_buffer, 0, inc->sample_unit_size);
+	inc->line.analog_stride = inc->analog_datafeed_buf_size;
+	if (inc->logic_channels)
+		inc->line.sample_buffer = &inc->datafeed_buffer[inc->datafeed_buf_fill];
+	if (inc->analog_channels)
+		inc->line.analog_sample_buffer = &inc->analog_datafeed_buffer[inc->analog_datafeed_buf_fill];
+}
+
+static void clear_samples(const struct context *inc, struct line_state *line)
+{
+	size_t idx;
+
+	if (inc->logic_channels)
+		memset(line->sample_buffer, 0, inc->sample_unit_size);
+	for (idx = 0; idx < inc->analog_channels; idx++)
+		set_analog_value(inc, line, idx, 0.0);
 }
 
-static void set_logic_level(struct context *inc, size_t ch_idx, int on)
+static void set_logic_level(const struct context *inc,
+	struct line_state *line, size_t ch_idx, int on)
 {
 	size_t byte_idx, bit_idx;
 	uint8_t bit_mask;
@@ -308,10 +368,11 @@ static void set_logic_level(struct context *inc, size_t ch_idx, int on)
 	byte_idx = ch_idx / 8;
 	bit_idx = ch_idx % 8;
 	bit_mask = 1 << bit_idx;
-	inc->sample_buffer[byte_idx] |= bit_mask;
+	line->sample_buffer[byte_idx] |= bit_mask;
 }
 
-static int flush_logic_samples(const struct sr_input *in)
+static int send_logic_samples(const struct sr_input *in,
+	uint8_t *data, size_t length)
 {
 	struct context *inc;
 	struct sr_datafeed_packet packet;
@@ -319,7 +380,7 @@ static int flush_logic_samples(const struct sr_input *in)
 	int rc;
 
 	inc = in->priv;
-	if (!inc->datafeed_buf_fill)
+	if (!length)
 		return SR_OK;
 
 	rc = flush_samplerate(in);
@@ -331,10 +392,19 @@ static int flush_logic_samples(const struct sr_input *in)
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = inc->sample_unit_size;
-	logic.length = inc->datafeed_buf_fill;
-	logic.data = inc->datafeed_buffer;
+	logic.length = length;
+	logic.data = data;
+
+	return sr_session_send(in->sdi, &packet);
+}
+
+static int flush_logic_samples(const struct sr_input *in)
+{
+	struct context *inc;
+	int rc;
 
-	rc = sr_session_send(in->sdi, &packet);
+	inc = in->priv;
+	rc = send_logic_samples(in, inc->datafeed_buffer, inc->datafeed_buf_fill);
 	if (rc != SR_OK)
 		return rc;
 
@@ -362,27 +432,17 @@ static int queue_logic_samples(const struct sr_input *in)
 	return SR_OK;
 }
 
-static void set_analog_value(struct context *inc, size_t ch_idx, csv_analog_t value);
-
-static void clear_analog_samples(struct context *inc)
-{
-	size_t idx;
-
-	if (!inc->analog_channels)
-		return;
-	inc->analog_sample_buffer = &inc->analog_datafeed_buffer[inc->analog_datafeed_buf_fill];
-	for (idx = 0; idx < inc->analog_channels; idx++)
-		set_analog_value(inc, idx, 0.0);
-}
-
-static void set_analog_value(struct context *inc, size_t ch_idx, csv_analog_t value)
+static void set_analog_value(const struct context *inc,
+	struct line_state *line, size_t ch_idx, csv_analog_t value)
 {
 	if (ch_idx >= inc->analog_channels)
 		return;
-	inc->analog_sample_buffer[ch_idx * inc->analog_datafeed_buf_size] = value;
+	line->analog_sample_buffer[ch_idx * line->analog_stride] = value;
 }
 
-static int flush_analog_samples(const struct sr_input *in)
+/* Send 'count' sets of analog values, channels are 'stride' apart. */
+static int send_analog_samples(const struct sr_input *in,
+	csv_analog_t *samples, size_t count, size_t stride)
 {
 	struct context *inc;
 	struct sr_datafeed_packet packet;
@@ -390,27 +450,25 @@ static int flush_analog_samples(const struct sr_input *in)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	csv_analog_t *samples;
 	size_t ch_idx;
 	int digits;
 	int rc;
 
 	inc = in->priv;
-	if (!inc->analog_datafeed_buf_fill)
+	if (!count)
 		return SR_OK;
 
 	rc = flush_samplerate(in);
 	if (rc != SR_OK)
 		return rc;
 
-	samples = inc->analog_datafeed_buffer;
 	for (ch_idx = 0; ch_idx < inc->analog_channels; ch_idx++) {
 		digits = inc->analog_datafeed_digits[ch_idx];
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
 		memset(&packet, 0, sizeof(packet));
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
-		analog.num_samples = inc->analog_datafeed_buf_fill;
+		analog.num_samples = count;
 		analog.data = samples;
 		analog.meaning->channels = inc->analog_datafeed_channels[ch_idx];
 		analog.meaning->mq = 0;
@@ -428,9 +486,23 @@ static int flush_analog_samples(const struct sr_input *in)
 		rc = sr_session_send(in->sdi, &packet);
 		if (rc != SR_OK)
 			return rc;
-		samples += inc->analog_datafeed_buf_size;
+		samples += stride;
 	}
 
+	return SR_OK;
+}
+
+static int flush_analog_samples(const struct sr_input *in)
+{
+	struct context *inc;
+	int rc;
+
+	inc = in->priv;
+	rc = send_analog_samples(in, inc->analog_datafeed_buffer,
+		inc->analog_datafeed_buf_fill, inc->analog_datafeed_buf_size);
+	if (rc != SR_OK)
+		return rc;
+
 	inc->analog_datafeed_buf_fill = 0;
 
 	return SR_OK;
@@ -772,11 +844,78 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/**
+ * Splits a text line into columns, in place.
+ *
+ * @param[in] buf	The input text line to split. Gets modified.
+ * @param[in] inc	The input module's context.
+ * @param[out] columns	Receives the columns' text.
+ *
+ * @returns The number of columns, at most the number of columns which
+ *   get processed.
+ *
+ * Unlike split_line() this does not allocate memory, and stops after
+ * the columns which get processed. Trailing whitespace gets removed
+ * from the columns' text.
+ */
+static size_t split_columns(char *buf, const struct context *inc,
+	char **columns)
+{
+	const char *delim;
+	size_t delim_len, count;
+	char *next;
+
+	delim = inc->delimiter->str;
+	delim_len = inc->delimiter->len;
+	count = 0;
+	while (count < inc->column_want_count) {
+		if (delim_len == 1)
+			next = strchr(buf, delim[0]);
+		else
+			next = strstr(buf, delim);
+		if (next)
+			*next = '\0';
+		columns[count++] = g_strchomp(buf);
+		if (!next)
+			break;
+		buf = next + delim_len;
+	}
+
+	return count;
+}
+
+/*
+ * Get the next line from a run of text lines, and terminate it in place.
+ * Returns NULL after the last line. Like g_strsplit() a trailing line
+ * termination results in an empty last line.
+ */
+static char *next_line(char **pos, const char *termination)
+{
+	char *line, *end;
+
+	line = *pos;
+	if (!line)
+		return NULL;
+	if (!termination[1])
+		end = strchr(line, termination[0]);
+	else
+		end = strstr(line, termination);
+	if (end) {
+		*end = '\0';
+		*pos = end + strlen(termination);
+	} else {
+		*pos = NULL;
+	}
+
+	return line;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
  * @param[in] column	The input text, a run of bin/hex/oct digits.
  * @param[in] inc	The input module's context.
+ * @param[in] line	The text line's parse state.
  * @param[in] details	The column processing details.
  *
  * @retval SR_OK	Success.
@@ -786,7 +925,7 @@ static char **split_line(char *buf, struct context *inc)
  * based on the text input and a user provided format spec.
  */
 static int parse_logic(const char *column, struct context *inc,
-	const struct column_details *details)
+	struct line_state *line, const struct column_details *details)
 {
 	size_t length, ch_rem, ch_idx, ch_inc;
 	const char *rdptr;
@@ -804,7 +943,7 @@ static int parse_logic(const char *column, struct context *inc,
 	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
-			inc->line_number);
+			line->line_number);
 		return SR_ERR;
 	}
 	rdptr = &column[length];
@@ -839,7 +978,7 @@ static int parse_logic(const char *column, struct context *inc,
 		if (!valid) {
 			type_text = col_format_text[details->text_format];
 			sr_err("Invalid text '%s' in %s type column %zu in line %zu.",
-				column, type_text, details->col_nr, inc->line_number);
+				column, type_text, details->col_nr, line->line_number);
 			return SR_ERR;
 		}
 		/* Use the digit's bits for logic channels' data. */
@@ -848,22 +987,22 @@ static int parse_logic(const char *column, struct context *inc,
 		case FORMAT_HEX:
 			if (ch_rem >= 4) {
 				ch_rem--;
-				set_logic_level(inc, ch_idx + 3, bits & (1 << 3));
+				set_logic_level(inc, line, ch_idx + 3, bits & (1 << 3));
 			}
 			/* FALLTHROUGH */
 		case FORMAT_OCT:
 			if (ch_rem >= 3) {
 				ch_rem--;
-				set_logic_level(inc, ch_idx + 2, bits & (1 << 2));
+				set_logic_level(inc, line, ch_idx + 2, bits & (1 << 2));
 			}
 			if (ch_rem >= 2) {
 				ch_rem--;
-				set_logic_level(inc, ch_idx + 1, bits & (1 << 1));
+				set_logic_level(inc, line, ch_idx + 1, bits & (1 << 1));
 			}
 			/* FALLTHROUGH */
 		case FORMAT_BIN:
 			ch_rem--;
-			set_logic_level(inc, ch_idx + 0, bits & (1 << 0));
+			set_logic_level(inc, line, ch_idx + 0, bits & (1 << 0));
 			break;
 		default:
 			/* ShouldNotHappen(TM), but silences compiler warning. */
@@ -887,6 +1026,7 @@ static int parse_logic(const char *column, struct context *inc,
  *
  * @param[in] column	The input text, a floating point number.
  * @param[in] inc	The input module's context.
+ * @param[in] line	The text line's parse state.
  * @param[in] details	The column processing details.
  *
  * @retval SR_OK	Success.
@@ -896,7 +1036,7 @@ static int parse_logic(const char *column, struct context *inc,
  * based on the text input and a user provided format spec.
  */
 static int parse_analog(const char *column, struct context *inc,
-	const struct column_details *details)
+	struct line_state *line, const struct column_details *details)
 {
 	size_t length;
 	double dvalue; float fvalue;
@@ -909,7 +1049,7 @@ static int parse_analog(const char *column, struct context *inc,
 	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
-			inc->line_number);
+			line->line_number);
 		return SR_ERR;
 	}
 	if (sizeof(value) == sizeof(double)) {
@@ -923,10 +1063,10 @@ static int parse_analog(const char *column, struct context *inc,
 	}
 	if (ret != SR_OK) {
 		sr_err("Cannot parse analog text %s in column %zu in line %zu.",
-			column, details->col_nr, inc->line_number);
+			column, details->col_nr, line->line_number);
 		return SR_ERR_DATA;
 	}
-	set_analog_value(inc, details->channel_offset, value);
+	set_analog_value(inc, line, details->channel_offset, value);
 
 	return SR_OK;
 }
@@ -936,6 +1076,7 @@ static int parse_analog(const char *column, struct context *inc,
  *
  * @param[in] column	The input text, a floating point number.
  * @param[in] inc	The input module's context.
+ * @param[in] line	The text line's parse state.
  * @param[in] details	The column processing details.
  *
  * @retval SR_OK	Success.
@@ -944,9 +1085,12 @@ static int parse_analog(const char *column, struct context *inc,
  * This routine attempts to automatically determine the input data's
  * samplerate from text rows' timestamp values. Only simple formats are
  * supported, user provided values always take precedence.
+ *
+ * Modifies the context until the samplerate is known. Parse threads
+ * only get used after that.
  */
 static int parse_timestamp(const char *column, struct context *inc,
-	const struct column_details *details)
+	struct line_state *line, const struct column_details *details)
 {
 	double ts, rate;
 	int ret;
@@ -990,30 +1134,30 @@ static int parse_timestamp(const char *column, struct context *inc,
 		ts = 0.0;
 	if (!ts) {
 		sr_info("Cannot convert timestamp text %s in line %zu (or zero value).",
-			column, inc->line_number);
+			column, line->line_number);
 		inc->prev_timestamp = 0.0;
 		return SR_OK;
 	}
 	if (!inc->prev_timestamp) {
 		sr_dbg("First timestamp value %g in line %zu.",
-			ts, inc->line_number);
+			ts, line->line_number);
 		inc->prev_timestamp = ts;
 		return SR_OK;
 	}
-	sr_dbg("Second timestamp value %g in line %zu.", ts, inc->line_number);
+	sr_dbg("Second timestamp value %g in line %zu.", ts, line->line_number);
 	ts -= inc->prev_timestamp;
 	sr_dbg("Timestamp difference %g in line %zu.",
-		ts, inc->line_number);
+		ts, line->line_number);
 	if (!ts) {
 		sr_warn("Zero timestamp difference in line %zu.",
-			inc->line_number);
+			line->line_number);
 		inc->prev_timestamp = ts;
 		return SR_OK;
 	}
 	rate = 1.0 / ts;
 	rate += 0.5;
 	rate = (uint64_t)rate;
-	sr_dbg("Rate from timestamp %g in line %zu.", rate, inc->line_number);
+	sr_dbg("Rate from timestamp %g in line %zu.", rate, line->line_number);
 	inc->calc_samplerate = rate;
 	inc->prev_timestamp = 0.0;
 
@@ -1027,17 +1171,18 @@ static int parse_timestamp(const char *column, struct context *inc,
  * columns' data types to their respective parse routines.
  */
 static int parse_ignore(const char *column, struct context *inc,
-	const struct column_details *details)
+	struct line_state *line, const struct column_details *details)
 {
 	(void)column;
 	(void)inc;
+	(void)line;
 	(void)details;
 
 	return SR_OK;
 }
 
 typedef int (*col_parse_cb)(const char *column, struct context *inc,
-	const struct column_details *details);
+	struct line_state *line, const struct column_details *details);
 
 static const col_parse_cb col_parse_funcs[] = {
 	[FORMAT_NONE] = parse_ignore,
@@ -1048,6 +1193,306 @@ static const col_parse_cb col_parse_funcs[] = {
 	[FORMAT_TIME] = parse_timestamp,
 };
 
+/* Strip comments off a text line. Returns FALSE for lines without data. */
+static gboolean line_has_data(const struct context *inc,
+	const struct line_state *line, char *text)
+{
+	if (text[0] == '\0') {
+		sr_spew("Blank line %zu skipped.", line->line_number);
+		return FALSE;
+	}
+
+	/* Remove trailing comment. */
+	strip_comment(text, inc->comment);
+	if (text[0] == '\0') {
+		sr_spew("Comment-only line %zu skipped.", line->line_number);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Split a text line into columns, get the sample set from their text. */
+static int parse_line(struct context *inc, struct line_state *line,
+	char *text)
+{
+	size_t num_columns, col_idx, col_nr;
+	const struct column_details *details;
+	col_parse_cb parse_func;
+	int ret;
+
+	/* Split the line into columns, check for minimum length. */
+	num_columns = split_columns(text, inc, line->columns);
+	if (num_columns < inc->column_want_count) {
+		sr_err("Insufficient column count %zu in line %zu.",
+			num_columns, line->line_number);
+		return SR_ERR;
+	}
+
+	/* Have the columns of the current text line processed. */
+	clear_samples(inc, line);
+	for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+		col_nr = col_idx + 1;
+		details = lookup_column_details(inc, col_nr);
+		if (!details || !details->text_format)
+			continue;
+		parse_func = col_parse_funcs[details->text_format];
+		if (!parse_func)
+			continue;
+		ret = parse_func(line->columns[col_idx], inc, line, details);
+		if (ret != SR_OK)
+			return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Parallel parsing of text lines. Requires that processing of the
+ * lines does not depend on previous lines any longer: Lines before the
+ * start line and the header line were seen, and the samplerate is known
+ * in the presence of timestamps. Text gets cut into runs of lines, which
+ * threads parse into their own sample buffers. Results are sent in input
+ * order by the calling thread. Each thread parses at least a minimum
+ * amount of text, small input is not worth the overhead.
+ */
+
+static size_t parallel_worker_count(const struct context *inc, size_t len)
+{
+	size_t count, col_idx;
+
+	count = MIN(inc->threads, len / PARALLEL_MIN_SIZE);
+	if (count < 2)
+		return 0;
+	if (inc->line_number + 1 < inc->start_line)
+		return 0;
+	if (inc->use_header && !inc->header_seen)
+		return 0;
+	if (!inc->calc_samplerate) {
+		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+			if (format_is_timestamp(inc->column_details[col_idx].text_format))
+				return 0;
+		}
+	}
+
+	return count;
+}
+
+static size_t count_lines(const char *text, const char *end,
+	const char *termination)
+{
+	size_t count, term_len;
+
+	count = 1;
+	term_len = strlen(termination);
+	while ((text = memchr(text, termination[0], end - text))) {
+		if ((size_t)(end - text) >= term_len &&
+				memcmp(text, termination, term_len) == 0) {
+			count++;
+			text += term_len;
+		} else {
+			text++;
+		}
+	}
+
+	return count;
+}
+
+static gpointer parse_worker_thread(gpointer data)
+{
+	struct parse_worker *worker;
+	struct context *inc;
+	struct line_state *line;
+	char *pos, *text;
+
+	worker = data;
+	inc = worker->inc;
+	line = &worker->line;
+
+	if (worker->capacity < worker->line_count) {
+		worker->capacity = worker->line_count;
+		worker->logic = g_realloc(worker->logic,
+			worker->capacity * inc->sample_unit_size);
+		worker->analog = g_realloc(worker->analog,
+			worker->capacity * inc->analog_channels * sizeof(worker->analog[0]));
+	}
+	line->analog_stride = worker->capacity;
+	line->line_number = worker->first_line - 1;
+
+	worker->rows = 0;
+	worker->ret = SR_OK;
+	pos = worker->text;
+	while ((text = next_line(&pos, inc->termination))) {
+		line->line_number++;
+		if (!line_has_data(inc, line, text))
+			continue;
+		if (inc->logic_channels)
+			line->sample_buffer = &worker->logic[worker->rows * inc->sample_unit_size];
+		if (inc->analog_channels)
+			line->analog_sample_buffer = &worker->analog[worker->rows];
+		worker->ret = parse_line(inc, line, text);
+		if (worker->ret != SR_OK)
+			break;
+		worker->rows++;
+	}
+
+	return NULL;
+}
+
+static void parse_worker_job(gpointer data, gpointer user_data)
+{
+	struct context *inc;
+
+	inc = user_data;
+	parse_worker_thread(data);
+
+	g_mutex_lock(&inc->pool_mutex);
+	if (!--inc->pool_pending)
+		g_cond_signal(&inc->pool_cond);
+	g_mutex_unlock(&inc->pool_mutex);
+}
+
+/*
+ * Threads get created once, and are kept for the remainder of the
+ * import. The calling thread parses a run of lines itself.
+ */
+static void start_parse_pool(struct context *inc)
+{
+	if (inc->pool)
+		return;
+
+	g_mutex_init(&inc->pool_mutex);
+	g_cond_init(&inc->pool_cond);
+	inc->pool = g_thread_pool_new(parse_worker_job, inc,
+		inc->threads - 1, FALSE, NULL);
+	if (!inc->pool) {
+		sr_warn("Cannot create parse threads, parsing inline.");
+		g_mutex_clear(&inc->pool_mutex);
+		g_cond_clear(&inc->pool_cond);
+		inc->threads = 1;
+		return;
+	}
+	sr_dbg("Parsing text lines on %zu threads.", inc->threads);
+}
+
+static int parse_parallel(const struct sr_input *in, char *text, size_t len,
+	size_t count)
+{
+	struct context *inc;
+	struct parse_worker *worker;
+	char *end, *cut;
+	size_t idx, line_number, term_len;
+	int ret;
+
+	inc = in->priv;
+	term_len = strlen(inc->termination);
+
+	if (inc->worker_count < count) {
+		inc->workers = g_renew(struct parse_worker, inc->workers, count);
+		memset(&inc->workers[inc->worker_count], 0,
+			(count - inc->worker_count) * sizeof(inc->workers[0]));
+		for (idx = inc->worker_count; idx < count; idx++) {
+			inc->workers[idx].inc = inc;
+			inc->workers[idx].line.columns = g_malloc0_n(
+				inc->column_want_count + 1, sizeof(char *));
+		}
+		inc->worker_count = count;
+	}
+
+	/* Cut the text at line boundaries, determine line numbers. */
+	end = text + len;
+	line_number = inc->line_number;
+	for (idx = 0; idx < count; idx++) {
+		worker = &inc->workers[idx];
+		worker->text = text;
+		cut = NULL;
+		if (idx + 1 < count)
+			cut = strstr(text + (end - text) / (count - idx), inc->termination);
+		if (!cut)
+			cut = end;
+		worker->first_line = line_number + 1;
+		worker->line_count = count_lines(text, cut, inc->termination);
+		line_number += worker->line_count;
+		if (cut == end) {
+			count = idx + 1;
+			break;
+		}
+		*cut = '\0';
+		text = cut + term_len;
+	}
+
+	/* Parse in pool threads, the calling thread takes the first run. */
+	if (count > 1)
+		start_parse_pool(inc);
+	if (inc->pool) {
+		g_mutex_lock(&inc->pool_mutex);
+		inc->pool_pending = count - 1;
+		g_mutex_unlock(&inc->pool_mutex);
+	}
+	for (idx = 1; idx < count; idx++) {
+		worker = &inc->workers[idx];
+		if (inc->pool)
+			g_thread_pool_push(inc->pool, worker, NULL);
+		else
+			parse_worker_thread(worker);
+	}
+	parse_worker_thread(&inc->workers[0]);
+	if (inc->pool) {
+		g_mutex_lock(&inc->pool_mutex);
+		while (inc->pool_pending)
+			g_cond_wait(&inc->pool_cond, &inc->pool_mutex);
+		g_mutex_unlock(&inc->pool_mutex);
+	}
+
+	/* Send previously queued samples, then the results in order. */
+	ret = flush_logic_samples(in);
+	ret += flush_analog_samples(in);
+	if (ret != SR_OK) {
+		sr_err("Sending samples failed.");
+		return SR_ERR;
+	}
+	for (idx = 0; idx < count; idx++) {
+		worker = &inc->workers[idx];
+		if (worker->ret != SR_OK)
+			return SR_ERR;
+		inc->line_number += worker->line_count;
+		ret = SR_OK;
+		if (inc->logic_channels)
+			ret = send_logic_samples(in, worker->logic,
+				worker->rows * inc->sample_unit_size);
+		if (ret == SR_OK && inc->analog_channels)
+			ret = send_analog_samples(in, worker->analog,
+				worker->rows, worker->capacity);
+		if (ret != SR_OK) {
+			sr_err("Sending samples failed.");
+			return SR_ERR;
+		}
+	}
+
+	return SR_OK;
+}
+
+static void release_parse_workers(struct context *inc)
+{
+	size_t idx;
+
+	if (inc->pool) {
+		g_thread_pool_free(inc->pool, FALSE, TRUE);
+		inc->pool = NULL;
+		g_mutex_clear(&inc->pool_mutex);
+		g_cond_clear(&inc->pool_cond);
+	}
+
+	for (idx = 0; idx < inc->worker_count; idx++) {
+		g_free(inc->workers[idx].line.columns);
+		g_free(inc->workers[idx].logic);
+		g_free(inc->workers[idx].analog);
+	}
+	g_free(inc->workers);
+	inc->workers = NULL;
+	inc->worker_count = 0;
+}
+
 /*
  * BEWARE! Implementor's notes. Sync with feature set and default option
  * values required during maintenance of the input module implementation.
@@ -1218,6 +1663,14 @@ static int init(struct sr_input *in, GHashTable *options)
 		sr_err("Invalid start line %zu.", inc->start_line);
 		return SR_ERR_ARG;
 	}
+	inc->threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!inc->threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		inc->threads = g_get_num_processors();
+#else
+		inc->threads = 1;
+#endif
+	}
 
 	/*
 	 * Scan flexible, to get prefered format specs which describe
@@ -1461,6 +1914,10 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 		inc->analog_datafeed_buf_fill = 0;
 	}
 
+	/* Column text references of a line, re-used for all lines. */
+	inc->line.columns = g_malloc0_n(inc->column_want_count + 1,
+		sizeof(inc->line.columns[0]));
+
 out:
 	if (columns)
 		g_strfreev(columns);
@@ -1479,21 +1936,21 @@ out:
  * against multiple execution or dropping the BOM multiple times --
  * there should be at most one in the input stream.
  */
-static void initial_bom_check(const struct sr_input *in)
+static void initial_bom_check(struct sr_input *in)
 {
 	static const char *utf8_bom = "\xef\xbb\xbf";
 
-	if (in->buf->len < strlen(utf8_bom))
+	if (sr_input_buf_len(in) < strlen(utf8_bom))
 		return;
-	if (strncmp(in->buf->str, utf8_bom, strlen(utf8_bom)) != 0)
+	if (strncmp(sr_input_buf_data(in), utf8_bom, strlen(utf8_bom)) != 0)
 		return;
-	g_string_erase(in->buf, 0, strlen(utf8_bom));
+	sr_input_buf_consume(in, strlen(utf8_bom));
 }
 
-static int initial_receive(const struct sr_input *in)
+static int initial_receive(struct sr_input *in)
 {
 	struct context *inc;
-	GString *new_buf;
+	GString *buf, *new_buf;
 	int len, ret;
 	char *p;
 	const char *termination;
@@ -1501,23 +1958,24 @@ static int initial_receive(const struct sr_input *in)
 	initial_bom_check(in);
 
 	inc = in->priv;
+	buf = sr_input_buf_compact(in);
 
-	termination = get_line_termination(in->buf);
+	termination = get_line_termination(buf);
 	if (!termination)
 		/* Don't have a full line yet. */
 		return SR_ERR_NA;
 
-	p = g_strrstr_len(in->buf->str, in->buf->len, termination);
+	p = g_strrstr_len(buf->str, buf->len, termination);
 	if (!p)
 		/* Don't have a full line yet. */
 		return SR_ERR_NA;
-	len = p - in->buf->str - 1;
-	new_buf = g_string_new_len(in->buf->str, len);
+	len = p - buf->str - 1;
+	new_buf = g_string_new_len(buf->str, len);
 	g_string_append_c(new_buf, '\0');
 
 	inc->termination = g_strdup(termination);
 
-	if (in->buf->str[0] != '\0')
+	if (buf->str[0] != '\0')
 		ret = initial_parse(in, new_buf);
 	else
 		ret = SR_OK;
@@ -1530,13 +1988,10 @@ static int initial_receive(const struct sr_input *in)
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
-	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
-	const struct column_details *details;
-	col_parse_cb parse_func;
+	size_t workers;
 	int ret;
-	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+	char *data, *processed_up_to, *pos, *line;
+	size_t len, text_len;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1557,39 +2012,44 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 * on Windows). A present termination sequence will just result
 	 * in the "execution of an empty line", and does not harm.
 	 */
-	if (!in->buf->len)
+	data = sr_input_buf_data(in);
+	len = sr_input_buf_len(in);
+	if (!len)
 		return SR_OK;
 	if (is_eof) {
-		processed_up_to = in->buf->str + in->buf->len;
+		processed_up_to = data + len;
+		text_len = len;
 	} else {
-		processed_up_to = g_strrstr_len(in->buf->str, in->buf->len,
-			inc->termination);
+		processed_up_to = g_strrstr_len(data, len, inc->termination);
 		if (!processed_up_to)
 			return SR_OK;
 		*processed_up_to = '\0';
+		text_len = processed_up_to - data;
 		processed_up_to += strlen(inc->termination);
 	}
 
+	/* Have large amounts of text lines parsed in parallel. */
+	workers = parallel_worker_count(inc, text_len);
+	if (workers) {
+		ret = parse_parallel(in, data, text_len, workers);
+		if (ret != SR_OK)
+			return ret;
+		sr_input_buf_consume(in, processed_up_to - data);
+		return SR_OK;
+	}
+
 	/* Split input text lines and process their columns. */
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
+	pos = data;
+	while ((line = next_line(&pos, inc->termination))) {
 		inc->line_number++;
+		inc->line.line_number = inc->line_number;
 		if (inc->line_number < inc->start_line) {
 			sr_spew("Line %zu skipped (before start).", inc->line_number);
 			continue;
 		}
-		if (line[0] == '\0') {
-			sr_spew("Blank line %zu skipped.", inc->line_number);
-			continue;
-		}
-
-		/* Remove trailing comment. */
-		strip_comment(line, inc->comment);
-		if (line[0] == '\0') {
-			sr_spew("Comment-only line %zu skipped.", inc->line_number);
+		if (!line_has_data(inc, &inc->line, line))
 			continue;
-		}
 
 		/* Skip the header line, its content was used as the channel names. */
 		if (inc->use_header && !inc->header_seen) {
@@ -1598,56 +2058,37 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 			continue;
 		}
 
-		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
-		if (num_columns < inc->column_want_count) {
-			sr_err("Insufficient column count %zu in line %zu.",
-				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
+		/* Parse the line's columns into the datafeed queue. */
+		select_queued_samples(inc);
+		ret = parse_line(inc, &inc->line, line);
+		if (ret != SR_OK)
 			return SR_ERR;
-		}
-
-		/* Have the columns of the current text line processed. */
-		clear_logic_samples(inc);
-		clear_analog_samples(inc);
-		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
-			col_nr = col_idx + 1;
-			details = lookup_column_details(inc, col_nr);
-			if (!details || !details->text_format)
-				continue;
-			parse_func = col_parse_funcs[details->text_format];
-			if (!parse_func)
-				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
-				return SR_ERR;
-			}
-		}
 
 		/* Send sample data to the session bus (buffered). */
 		ret = queue_logic_samples(in);
 		ret += queue_analog_samples(in);
 		if (ret != SR_OK) {
 			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
 
-		g_strfreev(columns);
+		/*
+		 * The header and the samplerate detection need the first
+		 * lines in order. Have the remaining lines parsed in
+		 * parallel as soon as they are done.
+		 */
+		if (inc->threads > 1 && pos) {
+			workers = parallel_worker_count(inc, data + text_len - pos);
+			if (workers) {
+				ret = parse_parallel(in, pos,
+					data + text_len - pos, workers);
+				if (ret != SR_OK)
+					return ret;
+				break;
+			}
+		}
 	}
-	g_strfreev(lines);
-	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
+	sr_input_buf_consume(in, processed_up_to - data);
 
 	return ret;
 }
@@ -1657,7 +2098,7 @@ static int receive(struct sr_input *in, GString *buf)
 	struct context *inc;
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	inc = in->priv;
 	if (!inc->column_seen_count) {
@@ -1720,6 +2161,9 @@ static void cleanup(struct sr_input *in)
 	inc->analog_datafeed_buffer = NULL;
 	g_free(inc->analog_datafeed_digits);
 	inc->analog_datafeed_digits = NULL;
+	g_free(inc->line.columns);
+	inc->line.columns = NULL;
+	release_parse_workers(inc);
 	/* analog_datafeed_channels was released in keep_header_for_reread() */
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
@@ -1734,6 +2178,7 @@ static void cleanup(struct sr_input *in)
 	inc->column_formats = save_ctx.column_formats;
 	inc->start_line = save_ctx.start_line;
 	inc->use_header = save_ctx.use_header;
+	inc->threads = save_ctx.threads;
 	inc->prev_sr_channels = save_ctx.prev_sr_channels;
 	inc->prev_df_channels = save_ctx.prev_df_channels;
 }
@@ -1745,7 +2190,7 @@ static int reset(struct sr_input *in)
 	inc = in->priv;
 	cleanup(in);
 	inc->started = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -1761,6 +2206,7 @@ enum option_index {
 	OPT_SAMPLERATE,
 	OPT_COL_SEP,
 	OPT_COMMENT,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1815,6 +2261,11 @@ static struct sr_option options[] = {
 		"The text which starts comments at the end of text lines, semicolon by default.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parse threads",
+		"Number of threads which parse large amounts of input text in parallel. 0 uses all processors, 1 (the default) parses in the calling thread.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -1838,6 +2289,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(g_variant_new_uint64(0));
 		options[OPT_COL_SEP].def = g_variant_ref_sink(g_variant_new_string(","));
 		options[OPT_COMMENT].def = g_variant_ref_sink(g_variant_new_string(";"));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(1));
 	}
 
 	return options;
@@ -27,8 +27,10 @@ struct feed_queue_logic {
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	uint64_t *run_counts;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
 };
 
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
@@ -57,28 +59,181 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	return q;
 }
 
-SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
+/*
+ * Run-length encoding queue. Consecutive submissions of identical
+ * sample values are merged into one run. The session feed receives
+ * SR_DF_LOGIC_RLE packets, and expands them for those receivers which
+ * don't handle runs. The sample_count is the number of runs which
+ * get queued before they are sent.
+ */
+SR_API struct feed_queue_logic *feed_queue_logic_alloc_rle(
+	const struct sr_dev_inst *sdi,
+	size_t sample_count, size_t unit_size)
+{
+	struct feed_queue_logic *q;
+
+	q = feed_queue_logic_alloc(sdi, sample_count, unit_size);
+	if (!q)
+		return NULL;
+	q->run_counts = g_try_malloc(q->alloc_count * sizeof(q->run_counts[0]));
+	if (!q->run_counts) {
+		feed_queue_logic_free(q);
+		return NULL;
+	}
+
+	q->packet.type = SR_DF_LOGIC_RLE;
+	q->packet.payload = &q->logic_rle;
+	q->logic_rle.unitsize = q->unit_size;
+	q->logic_rle.values = q->data_bytes;
+	q->logic_rle.counts = q->run_counts;
+
+	return q;
+}
+
+static int feed_queue_logic_submit_rle(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count)
 {
 	uint8_t *wrptr;
 	int ret;
 
+	if (!count)
+		return SR_OK;
+
+	/* Extend the most recent run when the value did not change. */
+	if (q->fill_count) {
+		wrptr = &q->data_bytes[(q->fill_count - 1) * q->unit_size];
+		if (memcmp(wrptr, data, q->unit_size) == 0) {
+			q->run_counts[q->fill_count - 1] += count;
+			return SR_OK;
+		}
+	}
+
+	/* Start another run. Keep the last run open for extension. */
+	if (q->fill_count == q->alloc_count) {
+		ret = feed_queue_logic_flush(q);
+		if (ret != SR_OK)
+			return ret;
+	}
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	memcpy(wrptr, data, q->unit_size);
+	q->run_counts[q->fill_count] = count;
+	q->fill_count++;
+
+	return SR_OK;
+}
+
+SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count)
+{
+	uint8_t *wrptr;
+	size_t copy_count;
+	int ret;
+
+	if (q->run_counts)
+		return feed_queue_logic_submit_rle(q, data, count);
+
+	/* Repeat the sample value, with wide stores for long runs. */
+	while (count) {
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		copy_count = MIN(count, q->alloc_count - q->fill_count);
+		sr_logic_fill_repeat(wrptr, data, q->unit_size, copy_count);
+		q->fill_count += copy_count;
+		count -= copy_count;
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_logic_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Submit a block of contiguous sample data (samples_count different
+ * values, as opposed to one value which repeats count times). Large
+ * blocks pass through to the session feed without a copy when there
+ * is no previously queued data, and no transform module would modify
+ * the caller's data in place.
+ */
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t samples_count)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *wrptr;
+	size_t copy_count;
+	gboolean passthrough;
+	int ret;
+
+	if (q->run_counts) {
+		while (samples_count--) {
+			ret = feed_queue_logic_submit_rle(q, data, 1);
+			if (ret != SR_OK)
+				return ret;
+			data += q->unit_size;
+		}
+		return SR_OK;
+	}
+
+	passthrough = !q->sdi->session || !q->sdi->session->transforms;
+	while (samples_count) {
+		if (passthrough && !q->fill_count &&
+				samples_count >= q->alloc_count) {
+			memset(&packet, 0, sizeof(packet));
+			memset(&logic, 0, sizeof(logic));
+			packet.type = SR_DF_LOGIC;
+			packet.payload = &logic;
+			logic.unitsize = q->unit_size;
+			logic.length = samples_count * q->unit_size;
+			logic.data = (void *)data;
+			return sr_session_send(q->sdi, &packet);
+		}
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		copy_count = MIN(samples_count, q->alloc_count - q->fill_count);
+		memcpy(wrptr, data, copy_count * q->unit_size);
+		data += copy_count * q->unit_size;
+		q->fill_count += copy_count;
+		samples_count -= copy_count;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
 	return SR_OK;
 }
 
+/*
+ * Pass the queue's buffer to the session feed thread without a copy,
+ * and continue with a new buffer. Returns FALSE when no buffer could
+ * be allocated, the caller then sends a copy.
+ */
+static gboolean feed_queue_logic_handover(struct feed_queue_logic *q)
+{
+	struct sr_datafeed_packet *packet;
+	struct sr_datafeed_logic *logic;
+	uint8_t *buffer;
+
+	buffer = g_try_malloc(q->alloc_count * q->unit_size);
+	if (!buffer)
+		return FALSE;
+
+	logic = g_malloc(sizeof(*logic));
+	logic->length = q->fill_count * q->unit_size;
+	logic->unitsize = q->unit_size;
+	logic->data = q->data_bytes;
+	packet = g_malloc(sizeof(*packet));
+	packet->type = SR_DF_LOGIC;
+	packet->payload = logic;
+	q->data_bytes = buffer;
+	q->logic.data = buffer;
+	sr_session_send_owned(q->sdi, packet);
+
+	return TRUE;
+}
+
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 {
 	int ret;
@@ -86,7 +241,14 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 	if (!q->fill_count)
 		return SR_OK;
 
+	if (!q->run_counts && sr_session_feed_is_threaded(q->sdi->session) &&
+			feed_queue_logic_handover(q)) {
+		q->fill_count = 0;
+		return SR_OK;
+	}
+
 	q->logic.length = q->fill_count * q->unit_size;
+	q->logic_rle.num_runs = q->fill_count;
 	ret = sr_session_send(q->sdi, &q->packet);
 	if (ret != SR_OK)
 		return ret;
@@ -117,6 +279,7 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 		return;
 
 	g_free(q->data_bytes);
+	g_free(q->run_counts);
 	g_free(q);
 }
 
@@ -22,6 +22,12 @@
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -31,6 +37,11 @@
 
 /** @cond PRIVATE */
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+
+/* Amount of a mapped file which gets passed to a module per call. */
+#define MAPPED_WINDOW_SIZE	(64 * 1024 * 1024)
+/* Copied data which completes a module's leftover from a previous call. */
+#define MAPPED_STITCH_SIZE	(64 * 1024)
 /** @endcond */
 
 /**
@@ -574,6 +585,86 @@ SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in)
 		return NULL;
 }
 
+/**
+ * Append received data to an input module's buffer.
+ *
+ * Consumed data gets dropped from the buffer here, when it's at least
+ * as large as the unprocessed remainder. This bounds the memory moves
+ * to the amount of consumed data.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_append(struct sr_input *in, const GString *buf)
+{
+	if (!buf || !buf->len)
+		return;
+	if (in->map)
+		sr_input_buf_compact(in);
+	if (in->buf_pos && in->buf_pos >= in->buf->len - in->buf_pos) {
+		g_string_erase(in->buf, 0, in->buf_pos);
+		in->buf_pos = 0;
+	}
+	g_string_append_len(in->buf, buf->str, buf->len);
+}
+
+/**
+ * Mark data at the start of an input module's buffer as processed.
+ *
+ * Only the read cursor advances, data does not move.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t len)
+{
+	len = MIN(len, sr_input_buf_len(in));
+	if (in->map) {
+		in->map_pos += len;
+		return;
+	}
+	in->buf_pos += len;
+	if (in->buf_pos == in->buf->len) {
+		g_string_truncate(in->buf, 0);
+		in->buf_pos = 0;
+	}
+}
+
+/**
+ * Drop all data of an input module's buffer.
+ *
+ * @private
+ */
+SR_PRIV void sr_input_buf_clear(struct sr_input *in)
+{
+	g_string_truncate(in->buf, 0);
+	in->buf_pos = 0;
+	in->map = NULL;
+}
+
+/**
+ * Get an input module's unprocessed data as a GString.
+ *
+ * Moves the unprocessed data to the start of the buffer when needed.
+ * For code paths which work on the GString, like header parsers.
+ * Mapped data which sr_input_send_mapped() presents gets copied to
+ * the buffer.
+ *
+ * @private
+ */
+SR_PRIV GString *sr_input_buf_compact(struct sr_input *in)
+{
+	if (in->map) {
+		g_string_append_len(in->buf, sr_input_buf_data(in),
+			sr_input_buf_len(in));
+		in->map = NULL;
+	}
+	if (in->buf_pos) {
+		g_string_erase(in->buf, 0, in->buf_pos);
+		in->buf_pos = 0;
+	}
+
+	return in->buf;
+}
+
 /**
  * Send data to the specified input instance.
  *
@@ -597,6 +688,330 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+static int send_copied(struct sr_input *in, const char *data, size_t len,
+	size_t chunk_size)
+{
+	GString *buf;
+	size_t n;
+	int ret;
+
+	buf = g_string_sized_new(MIN(len, chunk_size) + 1);
+	ret = SR_OK;
+	while (len && ret == SR_OK) {
+		n = MIN(len, chunk_size);
+		g_string_truncate(buf, 0);
+		g_string_append_len(buf, data, n);
+		ret = in->module->receive(in, buf);
+		data += n;
+		len -= n;
+	}
+	g_string_free(buf, TRUE);
+
+	return ret;
+}
+
+/**
+ * Send data in caller provided memory to the specified input instance.
+ *
+ * This has the same effect as sr_input_send() with a copy of the data,
+ * but modules which support it parse the data in place, and the sample
+ * data packets they send point into the caller's memory. Data which
+ * the module cannot process yet, like an incomplete sample at the end,
+ * gets copied and is kept for the next call.
+ *
+ * Until the input instance's device instance is ready, and for modules
+ * without support for in place parsing, the data gets copied. Frontends
+ * typically send the start of a file with sr_input_send() until
+ * sr_input_dev_inst_get() returns the device instance, and pass the
+ * remainder with this function.
+ *
+ * Session transforms may modify sample data in place, so the memory
+ * must be writable. A private mapping of a file is fine.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param data Start of the data. Needs to stay valid during the call only.
+ * @param len Length of the data in bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code returned by the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_mapped(const struct sr_input *in_ro,
+	void *data, size_t len)
+{
+	struct sr_input *in;
+	GString *piece;
+	char *ptr;
+	size_t pos, n, rest;
+	int ret;
+
+	in = (struct sr_input *)in_ro;	/* "un-const" */
+	if (!in || (!data && len))
+		return SR_ERR_ARG;
+
+	sr_spew("Sending %zu mapped bytes to %s module.", len, in->module->id);
+	ptr = data;
+	if (!in->module->receive_mapped || !in->sdi_ready)
+		return send_copied(in, ptr, len, CHUNK_SIZE);
+
+	/*
+	 * Leftover data from previous calls sits in the module's buffer.
+	 * Feed copies of the new data until the module consumed all of
+	 * the leftover. What remains then came from the last copy, and
+	 * is still available from the caller's memory. Drop the copy and
+	 * continue in place from there.
+	 */
+	ret = SR_OK;
+	pos = 0;
+	piece = g_string_sized_new(MAPPED_STITCH_SIZE + 1);
+	while (sr_input_buf_len(in) && pos < len) {
+		n = MIN(len - pos, MAPPED_STITCH_SIZE);
+		g_string_truncate(piece, 0);
+		g_string_append_len(piece, ptr + pos, n);
+		ret = in->module->receive(in, piece);
+		if (ret != SR_OK)
+			break;
+		pos += n;
+		rest = sr_input_buf_len(in);
+		if (rest <= n) {
+			sr_input_buf_clear(in);
+			pos -= rest;
+			break;
+		}
+	}
+	g_string_free(piece, TRUE);
+	if (ret != SR_OK || pos == len)
+		return ret;
+
+	/*
+	 * Present the remainder to the module in place. Keep a copy of
+	 * what it did not consume, unless the module took a copy itself.
+	 */
+	in->map = ptr + pos;
+	in->map_len = len - pos;
+	in->map_pos = 0;
+	piece = g_string_new(NULL);
+	ret = in->module->receive(in, piece);
+	g_string_free(piece, TRUE);
+	if (in->map) {
+		g_string_append_len(in->buf, sr_input_buf_data(in),
+			sr_input_buf_len(in));
+		in->map = NULL;
+	}
+
+	return ret;
+}
+
+/*
+ * Read a file in chunks, and send copies of them. Closes the stream.
+ * Files which cannot seek (pipes) skip the data up to the offset by
+ * reading it.
+ */
+static int send_stream_copied(struct sr_input *in, const char *filename,
+	FILE *stream, uint64_t offset)
+{
+	char *buf;
+	size_t count;
+	int ret;
+
+	buf = g_malloc(CHUNK_SIZE);
+	if (offset && (offset > G_MAXLONG ||
+			fseek(stream, (long)offset, SEEK_SET) < 0)) {
+		while (offset) {
+			count = fread(buf, 1, MIN(offset, CHUNK_SIZE), stream);
+			if (!count)
+				break;
+			offset -= count;
+		}
+		if (offset) {
+			sr_err("Failed to seek %s: %s", filename,
+				g_strerror(errno));
+			g_free(buf);
+			fclose(stream);
+			return SR_ERR;
+		}
+	}
+	ret = SR_OK;
+	while (ret == SR_OK) {
+		count = fread(buf, 1, CHUNK_SIZE, stream);
+		if (!count)
+			break;
+		ret = send_copied(in, buf, count, CHUNK_SIZE);
+	}
+	if (ret == SR_OK && ferror(stream)) {
+		sr_err("Failed to read %s: %s", filename, g_strerror(errno));
+		ret = SR_ERR;
+	}
+	g_free(buf);
+	fclose(stream);
+
+	return ret;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+/* Read a file which is open already, see send_stream_copied(). */
+static int send_fd_copied(struct sr_input *in, const char *filename,
+	int fd, uint64_t offset)
+{
+	FILE *stream;
+
+	stream = fdopen(fd, "rb");
+	if (!stream) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		close(fd);
+		return SR_ERR;
+	}
+
+	return send_stream_copied(in, filename, stream, offset);
+}
+
+#ifdef MADV_SEQUENTIAL
+static void advise_mapping(char *base, size_t start, size_t end, int advice)
+{
+	size_t page;
+
+	/* Only drop pages which are completely done with. */
+	page = sysconf(_SC_PAGESIZE);
+	start -= start % page;
+	if (advice == MADV_DONTNEED)
+		end -= end % page;
+	if (end > start)
+		(void)madvise(base + start, end - start, advice);
+}
+#endif
+
+/*
+ * Map regular files and send them in place. Other files (pipes, devices),
+ * files which exceed the address space, and files on filesystems without
+ * mmap support get read instead.
+ */
+static int send_file_mapped(struct sr_input *in, const char *filename,
+	uint64_t offset)
+{
+	struct stat st;
+	char *base;
+	size_t size, pos, n;
+	int fd, ret;
+
+	fd = g_open(filename, O_RDONLY, 0);
+	if (fd < 0) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		return SR_ERR;
+	}
+	if (fstat(fd, &st) < 0) {
+		sr_err("Failed to get size of %s: %s",
+			filename, g_strerror(errno));
+		close(fd);
+		return SR_ERR;
+	}
+	if (!S_ISREG(st.st_mode))
+		return send_fd_copied(in, filename, fd, offset);
+	if ((uint64_t)st.st_size < offset) {
+		sr_err("Cannot send %s from offset %" PRIu64 ".",
+			filename, offset);
+		close(fd);
+		return SR_ERR_ARG;
+	}
+	if ((uint64_t)st.st_size > SIZE_MAX)
+		return send_fd_copied(in, filename, fd, offset);
+	size = st.st_size;
+	if (size == offset) {
+		close(fd);
+		return SR_OK;
+	}
+
+	/*
+	 * A private writable mapping, so that session transforms can
+	 * modify sample data in place without touching the file.
+	 */
+	base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED) {
+		sr_dbg("Cannot map %s, reading it instead: %s",
+			filename, g_strerror(errno));
+		return send_fd_copied(in, filename, fd, offset);
+	}
+	close(fd);
+#ifdef MADV_SEQUENTIAL
+	advise_mapping(base, offset, size, MADV_SEQUENTIAL);
+#endif
+
+	ret = SR_OK;
+	for (pos = offset; pos < size && ret == SR_OK; pos += n) {
+		n = MIN(size - pos, MAPPED_WINDOW_SIZE);
+#ifdef MADV_SEQUENTIAL
+		/* Read ahead the next window, drop pages of this one. */
+		advise_mapping(base, pos + n,
+			pos + n + MIN(size - pos - n, MAPPED_WINDOW_SIZE),
+			MADV_WILLNEED);
+#endif
+		ret = sr_input_send_mapped(in, base + pos, n);
+#ifdef MADV_SEQUENTIAL
+		advise_mapping(base, pos, pos + n, MADV_DONTNEED);
+#endif
+	}
+	munmap(base, size);
+
+	return ret;
+}
+#else
+static int send_file_copied(struct sr_input *in, const char *filename,
+	uint64_t offset)
+{
+	FILE *stream;
+
+	stream = g_fopen(filename, "rb");
+	if (!stream) {
+		sr_err("Failed to open %s: %s", filename, g_strerror(errno));
+		return SR_ERR;
+	}
+
+	return send_stream_copied(in, filename, stream, offset);
+}
+#endif
+
+/**
+ * Send the content of a file to the specified input instance.
+ *
+ * Where memory mapped files are supported, regular files get mapped and
+ * passed to sr_input_send_mapped() in large windows, with sequential
+ * read ahead. Other files (pipes), and files which cannot be mapped,
+ * are read in chunks and sent like with sr_input_send().
+ *
+ * Frontends which need the device instance before sample data gets
+ * sent (to add it to a session) send the start of the file with
+ * sr_input_send() first, and pass the number of bytes sent as
+ * @p offset.
+ *
+ * This does not call sr_input_end().
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param filename The file to send.
+ * @param offset Position in the file to start at.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR File access failed.
+ * @retval other Error code returned by the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_file(const struct sr_input *in, const char *filename,
+	uint64_t offset)
+{
+	if (!in || !filename || !filename[0])
+		return SR_ERR_ARG;
+
+	sr_dbg("Sending %s from offset %" PRIu64 " to %s module.",
+		filename, offset, in->module->id);
+#ifdef HAVE_SYS_MMAN_H
+	return send_file_mapped((struct sr_input *)in, filename, offset);
+#else
+	return send_file_copied((struct sr_input *)in, filename, offset);
+#endif
+}
+
 /**
  * Signal the input module no more data will come.
  *
@@ -659,7 +1074,7 @@ SR_API int sr_input_reset(const struct sr_input *in_ro)
 	 * rely on common code and keep working across resets.
 	 */
 	if (in->buf)
-		g_string_truncate(in->buf, 0);
+		sr_input_buf_clear(in);
 	in->sdi_ready = FALSE;
 
 	return rc;
@@ -689,10 +1104,10 @@ SR_API void sr_input_free(const struct sr_input *in)
 	 * .cleanup() released potentially nested resources under 'inc').
 	 */
 	sr_dev_inst_free(in->sdi);
-	if (in->buf->len > 64) {
+	if (sr_input_buf_len(in) > 64) {
 		/* That seems more than just some sub-unitsize leftover... */
 		sr_warn("Found %" G_GSIZE_FORMAT
-			" unprocessed bytes at free time.", in->buf->len);
+			" unprocessed bytes at free time.", sr_input_buf_len(in));
 	}
 	g_string_free(in->buf, TRUE);
 	g_free(in->priv);
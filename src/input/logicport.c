@@ -641,7 +641,7 @@ static int have_text_line(struct sr_input *in, char **line, char **next)
 
 	if (!in || !in->buf || !in->buf->str)
 		return 0;
-	sol_ptr = in->buf->str;
+	sol_ptr = sr_input_buf_data(in);
 	eol_ptr = strstr(sol_ptr, CRLF);
 	if (!eol_ptr)
 		return 0;
@@ -715,11 +715,11 @@ static int process_text_line(struct context *inc, char *line)
 }
 
 /* Tell whether received data is sufficient for session feed preparation. */
-static int have_header(GString *buf)
+static int have_header(const char *text)
 {
 	const char *assumed_last_key = CRLF LAST_KEYWORD CONT_OPEN;
 
-	if (strstr(buf->str, assumed_last_key))
+	if (strstr(text, assumed_last_key))
 		return TRUE;
 
 	return FALSE;
@@ -735,7 +735,7 @@ static int parse_header(struct sr_input *in)
 	inc = in->priv;
 	while (have_text_line(in, &line, &next)) {
 		rc = process_text_line(inc, line);
-		g_string_erase(in->buf, 0, next - line);
+		sr_input_buf_consume(in, next - line);
 		if (rc)
 			return rc;
 	}
@@ -1041,7 +1041,7 @@ static int receive(struct sr_input *in, GString *buf)
 	int rc;
 
 	/* Accumulate another chunk of input data. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	/*
 	 * Wait for the full header's availability, then process it in a
@@ -1051,7 +1051,7 @@ static int receive(struct sr_input *in, GString *buf)
 	 */
 	inc = in->priv;
 	if (!inc->got_header) {
-		if (!have_header(in->buf))
+		if (!have_header(sr_input_buf_data(in)))
 			return SR_OK;
 		rc = parse_header(in);
 		if (rc)
@@ -174,29 +174,25 @@ static int process_buffer(struct sr_input *in)
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	offset = 0;
 
-	while ((offset + chunk_size) < in->buf->len) {
-		inc->analog.data = in->buf->str + offset;
+	while ((offset + chunk_size) < sr_input_buf_len(in)) {
+		inc->analog.data = sr_input_buf_data(in) + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	inc->analog.num_samples = (in->buf->len - offset) / inc->samplesize;
+	inc->analog.num_samples = (sr_input_buf_len(in) - offset) / inc->samplesize;
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	if (chunk_size > 0) {
-		inc->analog.data = in->buf->str + offset;
+		inc->analog.data = sr_input_buf_data(in) + offset;
 		sr_session_send(in->sdi, &inc->packet);
 		offset += chunk_size;
 	}
 
-	if ((unsigned int)offset < in->buf->len) {
-		/*
-		 * The incoming buffer wasn't processed completely. Stash
-		 * the leftover data for next time.
-		 */
-		g_string_erase(in->buf, 0, offset);
-	} else {
-		g_string_truncate(in->buf, 0);
-	}
+	/*
+	 * The incoming buffer may not have been processed completely.
+	 * Leftover data is kept for next time.
+	 */
+	sr_input_buf_consume(in, offset);
 
 	return SR_OK;
 }
@@ -205,7 +201,7 @@ static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -274,7 +270,7 @@ static int reset(struct sr_input *in)
 
 	inc->started = FALSE;
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -287,6 +283,7 @@ SR_PRIV struct sr_input_module input_raw_analog = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
@@ -378,24 +378,34 @@ static int addto_feed_buffer_logic(struct sr_input *in,
 	uint64_t data, size_t count)
 {
 	struct context *inc;
+	uint8_t unit_buffer[sizeof(uint64_t)];
+	size_t copy_count;
 
 	inc = in->priv;
 
 	if (inc->feed.is_analog)
 		return SR_ERR_ARG;
 
-	while (count--) {
-		if (inc->feed.unit_size == sizeof(uint64_t))
-			write_u64le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint32_t))
-			write_u32le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint16_t))
-			write_u16le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint8_t))
-			write_u8_inc(&inc->feed.write_pos, data);
-		else
-			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
+	if (inc->feed.unit_size == sizeof(uint64_t))
+		write_u64le(unit_buffer, data);
+	else if (inc->feed.unit_size == sizeof(uint32_t))
+		write_u32le(unit_buffer, data);
+	else if (inc->feed.unit_size == sizeof(uint16_t))
+		write_u16le(unit_buffer, data);
+	else if (inc->feed.unit_size == sizeof(uint8_t))
+		write_u8(unit_buffer, data);
+	else
+		return SR_ERR_BUG;
+
+	while (count) {
+		copy_count = inc->feed.samples_per_chunk;
+		copy_count -= inc->feed.samples_in_buffer;
+		copy_count = MIN(copy_count, count);
+		sr_logic_fill_repeat(inc->feed.write_pos, unit_buffer,
+			inc->feed.unit_size, copy_count);
+		inc->feed.write_pos += copy_count * inc->feed.unit_size;
+		inc->feed.samples_in_buffer += copy_count;
+		count -= copy_count;
 		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
 			flush_feed_buffer(in);
 	}
@@ -504,8 +514,8 @@ static int parse_header(struct sr_input *in)
 	uint64_t sample_rate;
 
 	inc = in->priv;
-	read_pos = (const uint8_t *)in->buf->str;
-	read_len = in->buf->len;
+	read_pos = (const uint8_t *)sr_input_buf_data(in);
+	read_len = sr_input_buf_len(in);
 
 	/*
 	 * Clear internal state. Normalize user specified option values
@@ -666,7 +676,7 @@ static int parse_header(struct sr_input *in)
 
 	/* Remove the consumed header fields from the receive buffer. */
 	read_len = read_pos - start_pos;
-	g_string_erase(in->buf, 0, read_len);
+	sr_input_buf_consume(in, read_len);
 
 	return SR_OK;
 }
@@ -854,9 +864,9 @@ static int parse_samples(struct sr_input *in)
 	size_t len;
 	int rc;
 
-	start = (const uint8_t *)in->buf->str;
+	start = (const uint8_t *)sr_input_buf_data(in);
 	buff = start;
-	blen = in->buf->len;
+	blen = sr_input_buf_len(in);
 	while (have_next_item(in, buff, blen, &curr, &next)) {
 		len = next - curr;
 		rc = parse_next_item(in, curr, len);
@@ -866,7 +876,7 @@ static int parse_samples(struct sr_input *in)
 		blen -= len;
 	}
 	len = buff - start;
-	g_string_erase(in->buf, 0, len);
+	sr_input_buf_consume(in, len);
 
 	return SR_OK;
 }
@@ -998,7 +1008,7 @@ static int receive(struct sr_input *in, GString *buf)
 	inc = in->priv;
 
 	/* Accumulate another chunk of input data. */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	/*
 	 * Wait for the full header's availability, then process it in
@@ -1007,7 +1017,7 @@ static int receive(struct sr_input *in, GString *buf)
 	 * backend requires those separate phases.
 	 */
 	if (!inc->module_state.got_header) {
-		if (!have_header(inc, in->buf))
+		if (!have_header(inc, sr_input_buf_compact(in)))
 			return SR_OK;
 		rc = parse_header(in);
 		if (rc)
@@ -1059,8 +1069,8 @@ static int end(struct sr_input *in)
 	}
 
 	/* Input data shall be exhausted by now. Non-fatal condition. */
-	if (in->buf->len)
-		sr_warn("Unprocessed remaining input: %zu bytes.", in->buf->len);
+	if (sr_input_buf_len(in))
+		sr_warn("Unprocessed remaining input: %zu bytes.", sr_input_buf_len(in));
 
 	return SR_OK;
 }
@@ -1114,7 +1124,7 @@ static int reset(struct sr_input *in)
 	inc->module_state.got_header = FALSE;
 	inc->module_state.header_sent = FALSE;
 	inc->module_state.rate_sent = FALSE;
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -1209,6 +1219,7 @@ SR_PRIV struct sr_input_module input_saleae = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
@@ -666,18 +666,18 @@ static int parse_magic(struct sr_input *in)
 	 * unknown or yet unsupported formats).
 	 */
 	inc = in->priv;
-	if (in->buf->len < STF_MAGIC_LENGTH)
+	if (sr_input_buf_len(in) < STF_MAGIC_LENGTH)
 		return SR_OK;
-	if (strncmp(in->buf->str, STF_MAGIC_SIGMA, STF_MAGIC_LENGTH) == 0) {
+	if (strncmp(sr_input_buf_data(in), STF_MAGIC_SIGMA, STF_MAGIC_LENGTH) == 0) {
 		inc->file_format = STF_FORMAT_SIGMA;
-		g_string_erase(in->buf, 0, STF_MAGIC_LENGTH);
+		sr_input_buf_consume(in, STF_MAGIC_LENGTH);
 		sr_dbg("Magic check: Detected SIGMA file format.");
 		inc->file_stage = STF_STAGE_HEADER;
 		return SR_OK;
 	}
-	if (strncmp(in->buf->str, STF_MAGIC_OMEGA, STF_MAGIC_LENGTH) == 0) {
+	if (strncmp(sr_input_buf_data(in), STF_MAGIC_OMEGA, STF_MAGIC_LENGTH) == 0) {
 		inc->file_format = STF_FORMAT_OMEGA;
-		g_string_erase(in->buf, 0, STF_MAGIC_LENGTH);
+		sr_input_buf_consume(in, STF_MAGIC_LENGTH);
 		sr_dbg("Magic check: Detected OMEGA file format.");
 		sr_err("OMEGA format not supported by STF input module.");
 		inc->file_stage = STF_STAGE_DONE;
@@ -748,9 +748,9 @@ static int parse_header(struct sr_input *in)
 	 * the Omega case, too.
 	 */
 	inc = in->priv;
-	while (in->buf->len) {
-		if (in->buf->str[0] == '\0') {
-			g_string_erase(in->buf, 0, 1);
+	while (sr_input_buf_len(in)) {
+		if (sr_input_buf_data(in)[0] == '\0') {
+			sr_input_buf_consume(in, 1);
 			sr_dbg("Header: End of section seen.");
 			rc = eval_header(in);
 			if (rc != SR_OK)
@@ -759,8 +759,8 @@ static int parse_header(struct sr_input *in)
 			return SR_OK;
 		}
 
-		line = in->buf->str;
-		len = in->buf->len;
+		line = sr_input_buf_data(in);
+		len = sr_input_buf_len(in);
 		eol = g_strstr_len(line, len, STF_HEADER_EOL);
 		if (!eol) {
 			sr_dbg("Header: Need more receive data.");
@@ -771,7 +771,7 @@ static int parse_header(struct sr_input *in)
 		sr_spew("Header: Got a line, len %zd, text: %s.", len, line);
 
 		parse_header_line(inc, line, len);
-		g_string_erase(in->buf, 0, len + strlen(STF_HEADER_EOL));
+		sr_input_buf_consume(in, len + strlen(STF_HEADER_EOL));
 	}
 	return SR_OK;
 }
@@ -1057,24 +1057,24 @@ static int parse_file_data(struct sr_input *in)
 	 * current read position when input data is incomplete.
 	 */
 	final_len = (uint32_t)~0ul;
-	while (in->buf->len) {
+	while (sr_input_buf_len(in)) {
 		/*
 		 * Wait for record data to become available. Check for
 		 * the availability of a header, get the payload size
 		 * from the header, check for the data's availability.
 		 * Check the CRC of the (compressed) payload data.
 		 */
-		have_len = in->buf->len;
+		have_len = sr_input_buf_len(in);
 		if (have_len < STF_DATA_REC_HDRLEN) {
 			sr_dbg("Data: Need more receive data (header).");
 			return SR_OK;
 		}
-		read_ptr = (const uint8_t *)in->buf->str;
+		read_ptr = (const uint8_t *)sr_input_buf_data(in);
 		len = read_u32le_inc(&read_ptr);
 		crc = read_u32le_inc(&read_ptr);
 		if (len == final_len && !crc) {
 			sr_dbg("Data: Last record seen.");
-			g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN);
+			sr_input_buf_consume(in, STF_DATA_REC_HDRLEN);
 			inc->file_stage = STF_STAGE_DONE;
 			return SR_OK;
 		}
@@ -1108,7 +1108,7 @@ static int parse_file_data(struct sr_input *in)
 		memset(&inc->record_data.raw, 0, sizeof(inc->record_data.raw));
 		rc = lzo1x_decompress_safe(compressed, want_len,
 			inc->record_data.raw, &raw_len, NULL);
-		g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
+		sr_input_buf_consume(in, STF_DATA_REC_HDRLEN + want_len);
 		if (rc) {
 			sr_err("Data: Decompression error %d.", rc);
 			return SR_ERR_DATA;
@@ -1274,7 +1274,7 @@ static int receive(struct sr_input *in, GString *buf)
 	 * with end(), to make sure pending data gets processed, even
 	 * when receive() is only invoked exactly once for short input.
 	 */
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 	return process_data(in);
 }
 
@@ -1329,7 +1329,7 @@ static int reset(struct sr_input *in)
 	cleanup(in);
 	keep = inc->keep;
 	memset(inc, 0, sizeof(*inc));
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 	inc->keep = keep;
 
 	return SR_OK;
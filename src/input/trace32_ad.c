@@ -441,12 +441,12 @@ static void process_record_pi(struct sr_input *in, gsize start)
 	uint64_t timestamp, next_timestamp;
 	uint32_t pod_data;
 	char single_payload[12 * 3];
-	GString *buf;
+	const char *buf;
 	int i, pod_count, clk_offset, packet_count, pod;
 	int payload_bit, payload_len, value;
 
 	inc = in->priv;
-	buf = in->buf;
+	buf = sr_input_buf_data(in);
 
 	/*
 	 * 0x00 u8  timestamp
@@ -471,7 +471,7 @@ static void process_record_pi(struct sr_input *in, gsize start)
 	 * 0x2C/1B u8 ??
 	 */
 
-	timestamp = RL64(buf->str + start);
+	timestamp = RL64(buf + start);
 
 	if (inc->record_mode == AD_MODE_500MHZ) {
 		pod_count = 6;
@@ -491,52 +491,52 @@ static void process_record_pi(struct sr_input *in, gsize start)
 
 		switch (pod) {
 		case 0: /* A */
-			pod_data = RL16(buf->str + start + 0x08);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 1) << 16;
+			pod_data = RL16(buf + start + 0x08);
+			pod_data |= (RL16(buf + start + clk_offset) & 1) << 16;
 			break;
 		case 1: /* B */
-			pod_data = RL16(buf->str + start + 0x0A);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 2) << 15;
+			pod_data = RL16(buf + start + 0x0A);
+			pod_data |= (RL16(buf + start + clk_offset) & 2) << 15;
 			break;
 		case 2: /* C */
-			pod_data = RL16(buf->str + start + 0x0C);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 4) << 14;
+			pod_data = RL16(buf + start + 0x0C);
+			pod_data |= (RL16(buf + start + clk_offset) & 4) << 14;
 			break;
 		case 3: /* D */
-			pod_data = RL16(buf->str + start + 0x0E);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 8) << 13;
+			pod_data = RL16(buf + start + 0x0E);
+			pod_data |= (RL16(buf + start + clk_offset) & 8) << 13;
 			break;
 		case 4: /* E */
-			pod_data = RL16(buf->str + start + 0x10);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 16) << 12;
+			pod_data = RL16(buf + start + 0x10);
+			pod_data |= (RL16(buf + start + clk_offset) & 16) << 12;
 			break;
 		case 5: /* F */
-			pod_data = RL16(buf->str + start + 0x12);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 32) << 11;
+			pod_data = RL16(buf + start + 0x12);
+			pod_data |= (RL16(buf + start + clk_offset) & 32) << 11;
 			break;
 		case 6: /* J */
-			pod_data = RL16(buf->str + start + 0x18);
-			pod_data |= (RL16(buf->str + start + 0x29) & 1) << 16;
+			pod_data = RL16(buf + start + 0x18);
+			pod_data |= (RL16(buf + start + 0x29) & 1) << 16;
 			break;
 		case 7: /* K */
-			pod_data = RL16(buf->str + start + 0x1A);
-			pod_data |= (RL16(buf->str + start + 0x29) & 2) << 15;
+			pod_data = RL16(buf + start + 0x1A);
+			pod_data |= (RL16(buf + start + 0x29) & 2) << 15;
 			break;
 		case 8: /* L */
-			pod_data = RL16(buf->str + start + 0x1C);
-			pod_data |= (RL16(buf->str + start + 0x29) & 4) << 14;
+			pod_data = RL16(buf + start + 0x1C);
+			pod_data |= (RL16(buf + start + 0x29) & 4) << 14;
 			break;
 		case 9: /* M */
-			pod_data = RL16(buf->str + start + 0x1E);
-			pod_data |= (RL16(buf->str + start + 0x29) & 8) << 13;
+			pod_data = RL16(buf + start + 0x1E);
+			pod_data |= (RL16(buf + start + 0x29) & 8) << 13;
 			break;
 		case 10: /* N */
-			pod_data = RL16(buf->str + start + 0x20);
-			pod_data |= (RL16(buf->str + start + 0x29) & 16) << 12;
+			pod_data = RL16(buf + start + 0x20);
+			pod_data |= (RL16(buf + start + 0x29) & 16) << 12;
 			break;
 		case 11: /* O */
-			pod_data = RL16(buf->str + start + 0x22);
-			pod_data |= (RL16(buf->str + start + 0x29) & 32) << 11;
+			pod_data = RL16(buf + start + 0x22);
+			pod_data |= (RL16(buf + start + 0x29) & 32) << 11;
 			break;
 		default:
 			pod_data = 0;
@@ -579,7 +579,7 @@ static void process_record_pi(struct sr_input *in, gsize start)
 		g_string_append_len(inc->out_buf, single_payload, payload_len);
 	} else {
 		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(buf->str + start + inc->record_size);
+		next_timestamp = RL64(buf + start + inc->record_size);
 		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
 
 		/* Make sure we send at least one data set. */
@@ -599,6 +599,7 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 	struct context *inc;
 	uint64_t timestamp, next_timestamp;
 	char single_payload[3];
+	const char *data;
 	int i, payload_len, packet_count;
 
 	inc = in->priv;
@@ -609,10 +610,11 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 	 * 0x0A u8  CLK
 	 */
 
-	timestamp = RL64(in->buf->str + start);
-	single_payload[0] = R8(in->buf->str + start + 0x08);
-	single_payload[1] = R8(in->buf->str + start + 0x09);
-	single_payload[2] = R8(in->buf->str + start + 0x0A) & 1;
+	data = sr_input_buf_data(in);
+	timestamp = RL64(data + start);
+	single_payload[0] = R8(data + start + 0x08);
+	single_payload[1] = R8(data + start + 0x09);
+	single_payload[2] = R8(data + start + 0x0A) & 1;
 	payload_len = 3;
 
 	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
@@ -628,7 +630,7 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 		g_string_append_len(inc->out_buf, single_payload, payload_len);
 	} else {
 		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(in->buf->str + start + inc->record_size);
+		next_timestamp = RL64(data + start + inc->record_size);
 		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
 
 		/* Make sure we send at least one data set. */
@@ -724,18 +726,23 @@ static void process_practice_token(struct sr_input *in, char *cmd_token)
 static void process_practice(struct sr_input *in)
 {
 	char delimiter[3];
-	char **tokens, *token;
+	char **tokens, *token, *data;
+	size_t len;
 	int i;
 
 	/* Gather all input data until we see the end marker. */
-	if (in->buf->str[in->buf->len - 1] != 0x29)
+	data = sr_input_buf_data(in);
+	len = sr_input_buf_len(in);
+	if (!len || data[len - 1] != 0x29)
 		return;
+	/* Splitting needs the NUL terminated buffer, not mapped input. */
+	data = sr_input_buf_compact(in)->str;
 
 	delimiter[0] = 0x0A;
 	delimiter[1] = ' ';
 	delimiter[2] = 0;
 
-	tokens = g_strsplit(in->buf->str, delimiter, 0);
+	tokens = g_strsplit(data, delimiter, 0);
 
 	/* Special case: first token contains the start marker, too. Skip it. */
 	token = tokens[0];
@@ -749,7 +756,7 @@ static void process_practice(struct sr_input *in)
 
 	g_strfreev(tokens);
 
-	g_string_erase(in->buf, 0, in->buf->len);
+	sr_input_buf_clear(in);
 }
 
 static int process_buffer(struct sr_input *in)
@@ -760,8 +767,8 @@ static int process_buffer(struct sr_input *in)
 	inc = in->priv;
 
 	if (!inc->header_read) {
-		res = process_header(in->buf, inc);
-		g_string_erase(in->buf, 0, inc->header_size);
+		res = process_header(sr_input_buf_compact(in), inc);
+		sr_input_buf_consume(in, inc->header_size);
 		if (res != SR_OK)
 			return res;
 	}
@@ -773,7 +780,7 @@ static int process_buffer(struct sr_input *in)
 
 	if (!inc->records_read) {
 		/* Cut off at a multiple of the record size. */
-		chunk_size = ((in->buf->len) / inc->record_size) * inc->record_size;
+		chunk_size = (sr_input_buf_len(in) / inc->record_size) * inc->record_size;
 
 		/* There needs to be at least one more record process_record() can peek into. */
 		chunk_size -= inc->record_size;
@@ -796,7 +803,7 @@ static int process_buffer(struct sr_input *in)
 				inc->records_read = TRUE;
 		}
 
-		g_string_erase(in->buf, 0, i);
+		sr_input_buf_consume(in, i);
 	}
 
 	if (inc->records_read) {
@@ -809,7 +816,7 @@ static int process_buffer(struct sr_input *in)
 
 static int receive(struct sr_input *in, GString *buf)
 {
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
 	if (!in->sdi_ready) {
 		/* sdi is ready, notify frontend. */
@@ -850,7 +857,7 @@ static int reset(struct sr_input *in)
 	inc->trigger_sent = FALSE;
 	inc->cur_record = 0;
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -907,6 +914,7 @@ SR_PRIV struct sr_input_module input_trace32_ad = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.reset = reset,
 };
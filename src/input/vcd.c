@@ -134,11 +134,13 @@ struct context {
 	uint64_t prev_timestamp;
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
-	GSList *ignored_signals;
+	GHashTable *signals;
+	struct vcd_signal **signal_index;
 	gboolean data_after_timestamp;
 	gboolean ignore_end_keyword;
 	gboolean skip_until_end;
 	GSList *channels;
+	struct vcd_channel **analog_channels;
 	size_t unit_size;
 	size_t logic_count;
 	size_t analog_count;
@@ -205,6 +207,107 @@ static void free_channel(void *data)
 	g_free(vcd_ch);
 }
 
+/*
+ * VCD signal identifiers and the channels which they map to. Several
+ * declarations can share an identifier. Identifiers of declarations
+ * which don't result in channels are kept as well, their value changes
+ * are silently ignored.
+ */
+struct vcd_signal {
+	char *identifier;
+	GSList *channels;
+	gboolean ignored;
+};
+
+static void free_signal(void *data)
+{
+	struct vcd_signal *signal;
+
+	signal = data;
+	if (!signal)
+		return;
+
+	g_free(signal->identifier);
+	g_slist_free(signal->channels);
+
+	g_free(signal);
+}
+
+/*
+ * Identifiers consist of printable ASCII characters, and tools which
+ * generate VCD files typically use the shortest ones available. Map
+ * one and two character identifiers to a slot in a lookup table, only
+ * look up longer identifiers in the hash table. Returns the size of
+ * the table (an invalid slot) for identifiers which don't fit.
+ */
+#define ID_CHAR_FIRST '!'
+#define ID_CHAR_COUNT ('~' - '!' + 1)
+#define SIGNAL_INDEX_SIZE (ID_CHAR_COUNT + ID_CHAR_COUNT * ID_CHAR_COUNT)
+
+static size_t signal_index_slot(const char *id)
+{
+	size_t c0, c1;
+
+	c0 = (size_t)(uint8_t)id[0] - ID_CHAR_FIRST;
+	if (c0 >= ID_CHAR_COUNT)
+		return SIGNAL_INDEX_SIZE;
+	if (!id[1])
+		return c0;
+	c1 = (size_t)(uint8_t)id[1] - ID_CHAR_FIRST;
+	if (c1 >= ID_CHAR_COUNT || id[2])
+		return SIGNAL_INDEX_SIZE;
+
+	return ID_CHAR_COUNT + c0 * ID_CHAR_COUNT + c1;
+}
+
+static struct vcd_signal *lookup_signal(struct context *inc, const char *id)
+{
+	size_t slot;
+
+	slot = signal_index_slot(id);
+	if (slot < SIGNAL_INDEX_SIZE)
+		return inc->signal_index ? inc->signal_index[slot] : NULL;
+	if (!inc->signals)
+		return NULL;
+
+	return g_hash_table_lookup(inc->signals, id);
+}
+
+/*
+ * Register a VCD signal identifier, and a channel for it (or NULL when
+ * the signal's value changes are to get ignored).
+ */
+static void add_signal(struct context *inc, const char *id,
+	struct vcd_channel *vcd_ch)
+{
+	struct vcd_signal *signal;
+	size_t slot;
+
+	if (!inc->signals) {
+		inc->signals = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, free_signal);
+	}
+
+	signal = g_hash_table_lookup(inc->signals, id);
+	if (!signal) {
+		signal = g_malloc0(sizeof(*signal));
+		signal->identifier = g_strdup(id);
+		g_hash_table_insert(inc->signals, signal->identifier, signal);
+		slot = signal_index_slot(id);
+		if (slot < SIGNAL_INDEX_SIZE) {
+			if (!inc->signal_index) {
+				inc->signal_index = g_malloc0(SIGNAL_INDEX_SIZE *
+					sizeof(inc->signal_index[0]));
+			}
+			inc->signal_index[slot] = signal;
+		}
+	}
+	if (vcd_ch)
+		signal->channels = g_slist_append(signal->channels, vcd_ch);
+	else
+		signal->ignored = TRUE;
+}
+
 /*
  * Another timestamp delta was observed, update statistics: Update the
  * sorted list of minimum values, and increment the occurance counter.
@@ -850,8 +953,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	} else if (is_str) {
 		sr_warn("Skipping id %s, name '%s%s', unsupported type '%s'.",
 			id, ref, idx ? idx : "", type);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		add_signal(inc, id, NULL);
 		g_strfreev(parts);
 		return SR_OK;
 	} else {
@@ -891,8 +993,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	if (inc->options.maxchannels && next_size > inc->options.maxchannels) {
 		sr_warn("Skipping '%s%s', exceeds requested channel count %zu.",
 			ref, idx ? idx : "", inc->options.maxchannels);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		add_signal(inc, id, NULL);
 		g_strfreev(parts);
 		return SR_OK;
 	}
@@ -922,6 +1023,7 @@ static int parse_header_var(struct context *inc, char *contents)
 		vcd_ch->type == SR_CHANNEL_ANALOG ? "A" : "L",
 		vcd_ch->array_index);
 	inc->channels = g_slist_append(inc->channels, vcd_ch);
+	add_signal(inc, id, vcd_ch);
 	g_strfreev(parts);
 
 	return SR_OK;
@@ -1099,10 +1201,15 @@ static void create_feeds(const struct sr_input *in)
 	}
 
 	/* Create one feed per analog channel. */
+	if (inc->analog_count) {
+		inc->analog_channels = g_malloc0(inc->analog_count *
+			sizeof(inc->analog_channels[0]));
+	}
 	for (l = inc->channels; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
+		inc->analog_channels[vcd_ch->array_index] = vcd_ch;
 		ch_idx = vcd_ch->array_index;
 		ch_idx += inc->logic_count;
 		ch = g_slist_nth_data(in->sdi->channels, ch_idx);
@@ -1284,7 +1391,7 @@ done_section:
 static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 {
 	struct context *inc;
-	GSList *ch_list;
+	size_t idx;
 	struct vcd_channel *vcd_ch;
 	struct feed_queue_analog *q;
 	float value;
@@ -1297,31 +1404,24 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 		if (flush)
 			feed_queue_logic_flush(inc->feed_logic);
 	}
-	for (ch_list = inc->channels; ch_list; ch_list = ch_list->next) {
-		vcd_ch = ch_list->data;
-		if (vcd_ch->type != SR_CHANNEL_ANALOG)
-			continue;
+	for (idx = 0; idx < inc->analog_count; idx++) {
+		vcd_ch = inc->analog_channels[idx];
 		q = vcd_ch->feed_analog;
 		if (!q)
 			continue;
-		value = inc->current_floats[vcd_ch->array_index];
+		value = inc->current_floats[idx];
 		feed_queue_analog_submit(q, value, count);
 		if (flush)
 			feed_queue_analog_flush(q);
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
-{
-	return strcmp((const char *)a, (const char *)b);
-}
-
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
+	struct vcd_signal *signal;
 
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	signal = lookup_signal(inc, id);
+	return signal && signal->ignored;
 }
 
 /*
@@ -1360,6 +1460,7 @@ static void process_bits(struct context *inc, char *identifier,
 {
 	size_t size;
 	gboolean have_int;
+	struct vcd_signal *signal;
 	GSList *l;
 	struct vcd_channel *vcd_ch;
 	float int_val;
@@ -1371,10 +1472,9 @@ static void process_bits(struct context *inc, char *identifier,
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
+	signal = lookup_signal(inc, identifier);
+	for (l = signal ? signal->channels : NULL; l; l = l->next) {
 		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1430,7 +1530,7 @@ static void process_bits(struct context *inc, char *identifier,
 			}
 		}
 	}
-	if (!size && !is_ignored(inc, identifier))
+	if (!size && !(signal && signal->ignored))
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1441,16 +1541,16 @@ static void process_bits(struct context *inc, char *identifier,
 static void process_real(struct context *inc, char *identifier, float real_val)
 {
 	gboolean found;
+	struct vcd_signal *signal;
 	GSList *l;
 	struct vcd_channel *vcd_ch;
 
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
+	signal = lookup_signal(inc, identifier);
+	for (l = signal ? signal->channels : NULL; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
@@ -1458,7 +1558,7 @@ static void process_real(struct context *inc, char *identifier, float real_val)
 			identifier, vcd_ch->array_index, real_val);
 		inc->current_floats[vcd_ch->array_index] = real_val;
 	}
-	if (!found && !is_ignored(inc, identifier))
+	if (!found && !(signal && signal->ignored))
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -2035,7 +2135,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 
 	/* Find and process complete text lines in the input data. */
 	ret = SR_OK;
-	rdptr = in->buf->str;
+	rdptr = sr_input_buf_data(in);
 	while (TRUE) {
 		rdlen = &in->buf->str[in->buf->len] - rdptr;
 		endptr = g_strstr_len(rdptr, rdlen, "\n");
@@ -2056,8 +2156,8 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		if (ret != SR_OK)
 			break;
 	}
-	rdlen = rdptr - in->buf->str;
-	g_string_erase(in->buf, 0, rdlen);
+	rdlen = rdptr - sr_input_buf_data(in);
+	sr_input_buf_consume(in, rdlen);
 
 	return ret;
 }
@@ -2135,13 +2235,13 @@ static int receive(struct sr_input *in, GString *buf)
 	inc = in->priv;
 
 	/* Collect all input chunks, potential deferred processing. */
-	g_string_append_len(in->buf, buf->str, buf->len);
-	if (!inc->got_header && in->buf->len == buf->len)
-		check_remove_bom(in->buf);
+	sr_input_buf_append(in, buf);
+	if (!inc->got_header && sr_input_buf_len(in) == buf->len)
+		check_remove_bom(sr_input_buf_compact(in));
 
 	/* Must complete reception of the VCD header first. */
 	if (!inc->got_header) {
-		if (!have_header(in->buf))
+		if (!have_header(sr_input_buf_compact(in)))
 			return SR_OK;
 		ret = parse_header(in, in->buf);
 		if (ret != SR_OK)
@@ -2196,6 +2296,13 @@ static void cleanup(struct sr_input *in)
 
 	keep_header_for_reread(in);
 
+	if (inc->signals)
+		g_hash_table_destroy(inc->signals);
+	inc->signals = NULL;
+	g_free(inc->signal_index);
+	inc->signal_index = NULL;
+	g_free(inc->analog_channels);
+	inc->analog_channels = NULL;
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 	feed_queue_logic_free(inc->feed_logic);
@@ -2208,8 +2315,6 @@ static void cleanup(struct sr_input *in)
 	inc->current_floats = NULL;
 	g_string_free(inc->scope_prefix, TRUE);
 	inc->scope_prefix = NULL;
-	g_slist_free_full(inc->ignored_signals, g_free);
-	inc->ignored_signals = NULL;
 	free_text_split(inc, NULL);
 }
 
@@ -2223,7 +2328,7 @@ static int reset(struct sr_input *in)
 
 	/* Relase previously allocated resources. */
 	cleanup(in);
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	/* Restore part of the context, init() won't run again. */
 	save = inc->options;
@@ -200,7 +200,7 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 
 	total_samples = num_samples * inc->num_channels;
 	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
+	s = sr_input_buf_data(in) + offset;
 	d = (char *)fdata;
 
 	for (samplenum = 0; samplenum < total_samples; samplenum++) {
@@ -248,6 +248,7 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 static int process_buffer(struct sr_input *in)
 {
 	struct context *inc;
+	GString *buf;
 	int offset, chunk_samples, total_samples, processed, max_chunk_samples;
 	int num_samples, i;
 
@@ -261,10 +262,11 @@ static int process_buffer(struct sr_input *in)
 
 	if (!inc->found_data) {
 		/* Skip past size of 'fmt ' chunk. */
-		i = 20 + RL32(in->buf->str + 16);
-		offset = find_data_chunk(in->buf, i);
+		buf = sr_input_buf_compact(in);
+		i = 20 + RL32(buf->str + 16);
+		offset = find_data_chunk(buf, i);
 		if (offset < 0) {
-			if (in->buf->len > MAX_DATA_CHUNK_OFFSET) {
+			if (buf->len > MAX_DATA_CHUNK_OFFSET) {
 				sr_err("Couldn't find data chunk.");
 				return SR_ERR;
 			}
@@ -274,7 +276,7 @@ static int process_buffer(struct sr_input *in)
 		offset = 0;
 
 	/* Round off up to the last channels * unitsize boundary. */
-	chunk_samples = (in->buf->len - offset) / inc->samplesize;
+	chunk_samples = (sr_input_buf_len(in) - offset) / inc->samplesize;
 	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
 	processed = 0;
 	total_samples = chunk_samples;
@@ -289,14 +291,11 @@ static int process_buffer(struct sr_input *in)
 		processed += num_samples;
 	}
 
-	if ((unsigned int)offset < in->buf->len) {
-		/*
-		 * The incoming buffer wasn't processed completely. Stash
-		 * the leftover data for next time.
-		 */
-		g_string_erase(in->buf, 0, offset);
-	} else
-		g_string_truncate(in->buf, 0);
+	/*
+	 * The incoming buffer may not have been processed completely.
+	 * Leftover data is kept for next time.
+	 */
+	sr_input_buf_consume(in, offset);
 
 	return SR_OK;
 }
@@ -345,9 +344,9 @@ static int receive(struct sr_input *in, GString *buf)
 	int ret;
 	char channelname[16];
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sr_input_buf_append(in, buf);
 
-	if (in->buf->len < MIN_DATA_CHUNK_OFFSET) {
+	if (sr_input_buf_len(in) < MIN_DATA_CHUNK_OFFSET) {
 		/*
 		 * Don't even try until there's enough room
 		 * for the data segment to start.
@@ -357,7 +356,7 @@ static int receive(struct sr_input *in, GString *buf)
 
 	inc = in->priv;
 	if (!in->sdi_ready) {
-		if ((ret = parse_wav_header(in->buf, inc)) == SR_ERR_NA)
+		if ((ret = parse_wav_header(sr_input_buf_compact(in), inc)) == SR_ERR_NA)
 			/* Not enough data yet. */
 			return SR_OK;
 		else if (ret != SR_OK)
@@ -412,7 +411,7 @@ static int reset(struct sr_input *in)
 	 */
 	keep_header_for_reread(in);
 
-	g_string_truncate(in->buf, 0);
+	sr_input_buf_clear(in);
 
 	return SR_OK;
 }
@@ -426,6 +425,7 @@ SR_PRIV struct sr_input_module input_wav = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = TRUE,
 	.end = end,
 	.reset = reset,
 };
@@ -1143,6 +1143,7 @@ struct sr_context {
 	struct sr_dev_driver **driver_list;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
+	struct sr_usb_cache *usb_cache;
 #endif
 	sr_resource_open_callback resource_open_cb;
 	sr_resource_close_callback resource_close_cb;
@@ -1169,7 +1170,23 @@ struct sr_input {
 	 * A pointer to this input module's 'struct sr_input_module'.
 	 */
 	const struct sr_input_module *module;
+	/**
+	 * Received data which the module has not processed yet. Use the
+	 * sr_input_buf_*() helpers, the unprocessed part starts at
+	 * 'buf_pos'.
+	 */
 	GString *buf;
+	/** Read cursor into 'buf', bytes before it were consumed. */
+	size_t buf_pos;
+	/**
+	 * Caller's memory which sr_input_send_mapped() presents in place
+	 * of 'buf' during a receive() call, NULL otherwise.
+	 */
+	char *map;
+	/** Length of 'map'. */
+	size_t map_len;
+	/** Read cursor into 'map'. */
+	size_t map_pos;
 	struct sr_dev_inst *sdi;
 	gboolean sdi_ready;
 	void *priv;
@@ -1305,6 +1322,46 @@ struct sr_input_module {
 	 * @retval other Negative error code.
 	 */
 	void (*cleanup) (struct sr_input *in);
+
+	/**
+	 * The module reads sample data through sr_input_buf_data() only,
+	 * and keeps no pointers into it across receive() calls. Lets
+	 * sr_input_send_mapped() pass the caller's memory to the module
+	 * without copying it into 'buf' first.
+	 */
+	gboolean receive_mapped;
+};
+
+/** Kinds of output sink destinations. */
+enum sr_output_sink_type {
+	/** Buffered writes to a file descriptor. */
+	SR_OUTPUT_SINK_FD,
+	/** Caller provided memory region of fixed size. */
+	SR_OUTPUT_SINK_MEMORY,
+	/** Appends to a GString, serves sr_output_send(). */
+	SR_OUTPUT_SINK_GSTRING,
+};
+
+/** One element of a gather list, see sr_output_sink_writev(). */
+struct sr_output_iovec {
+	const void *base;
+	size_t len;
+};
+
+/** Caller supplied destination of output module data. */
+struct sr_output_sink {
+	enum sr_output_sink_type type;
+	/** File descriptor of SR_OUTPUT_SINK_FD sinks. */
+	int fd;
+	/** Write buffer, or the memory region of SR_OUTPUT_SINK_MEMORY. */
+	uint8_t *buf;
+	size_t size;
+	size_t used;
+	gboolean own_buf;
+	/** Destination of SR_OUTPUT_SINK_GSTRING sinks. */
+	GString *str;
+	/** Number of bytes accepted since creation or the last reset. */
+	uint64_t bytes;
 };
 
 /** Output module instance. */
@@ -1413,6 +1470,27 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Alternative to receive(), which writes output to a caller
+	 * supplied sink instead of returning a newly allocated GString.
+	 * Modules can pass references to packet data to the sink, which
+	 * avoids copies for large chunks of binary output.
+	 *
+	 * This function is optional. Modules which implement it can
+	 * leave receive() NULL, sr_output_send() then collects the
+	 * sink's output in a GString.
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param sink The destination of the output. Must not be NULL.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_sink) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet,
+			struct sr_output_sink *sink);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1613,7 +1691,12 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
 #endif
 
 /* Message logging helpers with subsystem-specific prefix string. */
+#ifdef SR_LOG_STRIP_SPEW
+/* Keep the arguments type checked, but let the compiler drop the call. */
+#define sr_spew(...)	(0 ? sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__) : SR_OK)
+#else
 #define sr_spew(...)	sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
+#endif
 #define sr_dbg(...)	sr_log(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
 #define sr_info(...)	sr_log(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
 #define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
@@ -1768,6 +1851,19 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Number of packet ring slots of the feed thread, 0 if disabled. */
+	size_t feed_ring_size;
+	/**
+	 * Session feed thread state, NULL when packets get sent directly.
+	 * Accessed atomically, senders look it up while the session stops.
+	 */
+	struct feed_worker *feed_worker;
+	/** Number of senders which currently access feed_worker. */
+	gint feed_senders;
+	/** Statistics of the session feed thread, accessed atomically. */
+	gsize feed_packets;
+	gsize feed_stalls;
+	gsize feed_max_fill;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1798,6 +1894,9 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_owned(const struct sr_dev_inst *sdi,
+		struct sr_datafeed_packet *packet);
+SR_PRIV gboolean sr_session_feed_is_threaded(const struct sr_session *session);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
@@ -1813,6 +1912,35 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/*--- conversion.c ----------------------------------------------------------*/
+
+SR_PRIV int sr_planar_to_logic(uint8_t *dst, size_t unitsize,
+		const uint8_t *src, size_t batch_count, size_t word_bits,
+		gboolean msb_first, const uint8_t *channel_map,
+		size_t channel_count);
+SR_PRIV void sr_logic_fill_repeat(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, size_t count);
+SR_PRIV size_t sr_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *ref);
+
+/** In place logic sample mask, see sr_logic_mask_new(). */
+struct sr_logic_mask {
+	size_t unitsize;
+	/** Pattern length, a multiple of the unit size and vector width. */
+	size_t period;
+	uint8_t *and_pat;
+	uint8_t *xor_pat;
+};
+
+SR_PRIV struct sr_logic_mask *sr_logic_mask_new(size_t unitsize,
+		const uint8_t *and_mask, const uint8_t *xor_mask);
+SR_PRIV void sr_logic_mask_apply(const struct sr_logic_mask *mask,
+		uint8_t *data, size_t length);
+SR_PRIV void sr_logic_mask_free(struct sr_logic_mask *mask);
+SR_PRIV int sr_logic_rle_expand_packets(const struct sr_datafeed_logic_rle *rle,
+		int (*cb)(const struct sr_datafeed_packet *packet, void *cb_data),
+		void *cb_data);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -1820,6 +1948,7 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV void sr_rational_from_double(struct sr_rational *r, double value);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -1927,15 +2056,62 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret);
 SR_PRIV GString *sr_hexdump_new(const uint8_t *data, const size_t len);
 SR_PRIV void sr_hexdump_free(GString *s);
 
+SR_PRIV void sr_gstring_append_u64(GString *s, uint64_t value);
+SR_PRIV void sr_gstring_append_i64(GString *s, int64_t value);
+SR_PRIV void sr_gstring_append_fixed(GString *s, double value, int decimals);
+SR_PRIV void sr_gstring_append_g(GString *s, double value, int precision);
+SR_PRIV void sr_gstring_append_float(GString *s, float value);
+
+/*--- input/input.c --------------------------------------------------------*/
+
+SR_PRIV void sr_input_buf_append(struct sr_input *in, const GString *buf);
+SR_PRIV void sr_input_buf_consume(struct sr_input *in, size_t len);
+SR_PRIV void sr_input_buf_clear(struct sr_input *in);
+SR_PRIV GString *sr_input_buf_compact(struct sr_input *in);
+
+/** Start of the input module's unprocessed data. */
+static inline char *sr_input_buf_data(const struct sr_input *in)
+{
+	if (in->map)
+		return in->map + in->map_pos;
+	return in->buf->str + in->buf_pos;
+}
+
+/** Length of the input module's unprocessed data. */
+static inline size_t sr_input_buf_len(const struct sr_input *in)
+{
+	if (in->map)
+		return in->map_len - in->map_pos;
+	return in->buf->len - in->buf_pos;
+}
+
+/*--- output/sink.c ---------------------------------------------------------*/
+
+SR_PRIV int sr_output_sink_writev(struct sr_output_sink *sink,
+	const struct sr_output_iovec *iov, size_t count);
+SR_PRIV int sr_output_sink_write(struct sr_output_sink *sink,
+	const void *data, size_t len);
+SR_PRIV int sr_output_sink_write_gstring(struct sr_output_sink *sink,
+	const GString *s);
+SR_PRIV void sr_output_sink_init_gstring(struct sr_output_sink *sink,
+	GString *s);
+
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+struct soft_trigger_stage;
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
 	int unitsize;
 	int cur_stage;
-	uint8_t *prev_sample;
+	int num_stages;
+	struct soft_trigger_stage *stages;
+	int words;
+	uint64_t *masks;
+	uint64_t *cur_word;
+	uint64_t *prev_word;
+	gboolean have_prev;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
 	int pre_trigger_size;
@@ -2129,15 +2305,23 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 SR_PRIV int sr_usb_split_conn(const char *conn,
 	uint16_t *vid, uint16_t *pid, uint8_t *bus, uint8_t *addr);
 #ifdef HAVE_LIBUSB_1_0
-SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
-SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list);
+SR_PRIV int sr_usb_get_string(struct sr_context *ctx, libusb_device *dev,
+		libusb_device_handle **hdl, uint8_t index,
+		char *data, int length);
+SR_PRIV void sr_usb_cache_invalidate(struct sr_context *ctx);
+SR_PRIV uint64_t sr_usb_cache_enumerations(struct sr_context *ctx);
+SR_PRIV void sr_usb_cache_free(struct sr_context *ctx);
+SR_PRIV GSList *sr_usb_find(struct sr_context *ctx, const char *conn);
+SR_PRIV int sr_usb_open(struct sr_context *ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product);
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product);
 #endif
 
 /*--- binary_helpers.c ------------------------------------------------------*/
@@ -2771,8 +2955,13 @@ struct feed_queue_analog;
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size);
+SR_API struct feed_queue_logic *feed_queue_logic_alloc_rle(
+	const struct sr_dev_inst *sdi,
+	size_t sample_count, size_t unit_size);
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count);
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t samples_count);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
 SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q);
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
@@ -19,7 +19,10 @@
 
 #include <config.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -182,51 +185,624 @@ SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data)
 	return SR_OK;
 }
 
-static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
+/*
+ * Deferred logging.
+ *
+ * Formatting a message with g_vasprintf() and writing it to stderr takes
+ * far longer than most hot paths that emit debug or spew messages. When
+ * deferred logging is enabled, sr_log() only stores the format string
+ * pointer, the arguments and a timestamp in a fixed size record of a
+ * lock-free ring. Formatting and output happen when the ring is drained,
+ * either by a background thread or by sr_log_deferred_flush().
+ *
+ * Format strings must outlive the record. This holds for the sr_spew()
+ * and friends macros, which always pass string literals. String arguments
+ * are copied into the record. Messages which do not fit into a record, or
+ * which use conversions the argument capture doesn't handle (like '*'
+ * field widths), are formatted right away into a heap copy instead.
+ */
+
+/** @cond PRIVATE */
+#define LOG_RING_DEFAULT_SIZE	4096
+#define LOG_RING_MAX_ARGS	8
+#define LOG_RING_STR_SPACE	152
+#define LOG_RING_SPEC_LEN	32
+#define LOG_RING_DRAIN_US	(10 * 1000)
+/** @endcond */
+
+enum log_arg_type {
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LLONG,
+	LOG_ARG_INTMAX,
+	LOG_ARG_SIZE,
+	LOG_ARG_PTRDIFF,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STR,
+};
+
+union log_arg {
+	int i;
+	long l;
+	long long ll;
+	intmax_t im;
+	size_t sz;
+	ptrdiff_t pd;
+	double d;
+	const void *p;
+};
+
+struct log_record {
+	/* Ring sequence number, see log_ring_push(). */
+	gint seq;
+	int loglevel;
+	int64_t time_us;
+	/* Static format string, or NULL if text holds the message. */
+	const char *format;
+	char *text;
+	uint8_t num_args;
+	uint8_t types[LOG_RING_MAX_ARGS];
+	union log_arg args[LOG_RING_MAX_ARGS];
+	/* Copies of string arguments, referenced by offset. */
+	char strings[LOG_RING_STR_SPACE];
+};
+
+/*
+ * Bounded multi-producer queue, after Dmitry Vyukov's design. Producers
+ * claim a slot with a compare-and-swap on head, and publish it by
+ * advancing the slot's sequence number. The consumer side is serialized
+ * by drain_mutex. When the ring is full, messages are counted as
+ * dropped rather than blocking the caller.
+ */
+static struct log_record *log_ring;
+static guint log_ring_mask;
+static gint log_ring_head;
+static guint log_ring_tail;
+static gint log_ring_dropped;
+static gint log_deferred;
+/* Number of sr_log() calls which may push to the ring. */
+static gint log_producers;
+/* A warning or error was pushed since the last drain started. */
+static gint log_urgent;
+
+static GMutex drain_mutex;
+static GMutex thread_mutex;
+static GCond thread_cond;
+static GThread *drain_thread;
+static gboolean drain_thread_stop;
+
+/*
+ * Parse a printf() conversion specification, starting right after the
+ * '%' character. Returns a pointer past the conversion character, the
+ * type of the argument it consumes and the precision (-1 if none), or
+ * NULL for specifications the argument capture doesn't support.
+ */
+static const char *log_parse_spec(const char *p, enum log_arg_type *type,
+		int *precision)
+{
+	enum log_arg_type int_type;
+
+	p += strspn(p, "-+ #0'");
+	p += strspn(p, "0123456789");
+	*precision = -1;
+	if (*p == '.') {
+		p++;
+		*precision = 0;
+		while (g_ascii_isdigit(*p)) {
+			if (*precision > G_MAXINT / 10 - 1)
+				return NULL;
+			*precision = *precision * 10 + (*p++ - '0');
+		}
+	}
+
+	int_type = LOG_ARG_INT;
+	switch (*p) {
+	case 'h':
+		p += (p[1] == 'h') ? 2 : 1;
+		break;
+	case 'l':
+		if (p[1] == 'l') {
+			int_type = LOG_ARG_LLONG;
+			p += 2;
+		} else {
+			int_type = LOG_ARG_LONG;
+			p++;
+		}
+		break;
+	case 'q':
+		int_type = LOG_ARG_LLONG;
+		p++;
+		break;
+	case 'j':
+		int_type = LOG_ARG_INTMAX;
+		p++;
+		break;
+	case 'z':
+		int_type = LOG_ARG_SIZE;
+		p++;
+		break;
+	case 't':
+		int_type = LOG_ARG_PTRDIFF;
+		p++;
+		break;
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		*type = int_type;
+		break;
+	case 'c':
+		if (int_type != LOG_ARG_INT)
+			return NULL;
+		*type = LOG_ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		*type = LOG_ARG_DOUBLE;
+		break;
+	case 'p':
+		*type = LOG_ARG_PTR;
+		break;
+	case 's':
+		if (int_type != LOG_ARG_INT)
+			return NULL;
+		*type = LOG_ARG_STR;
+		break;
+	default:
+		/* '*' widths, %n, %m, long double and wide characters. */
+		return NULL;
+	}
+
+	return p + 1;
+}
+
+/* Store the arguments of a message. Returns FALSE if they don't fit. */
+static gboolean log_capture(struct log_record *rec, const char *format,
+		va_list args)
+{
+	enum log_arg_type type;
+	const char *p, *end, *s;
+	size_t str_used, len;
+	union log_arg *arg;
+	int precision;
+
+	rec->num_args = 0;
+	str_used = 0;
+	p = format;
+	while ((p = strchr(p, '%'))) {
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		end = log_parse_spec(p + 1, &type, &precision);
+		if (!end || end - p >= LOG_RING_SPEC_LEN)
+			return FALSE;
+		if (rec->num_args == LOG_RING_MAX_ARGS)
+			return FALSE;
+		arg = &rec->args[rec->num_args];
+		switch (type) {
+		case LOG_ARG_INT:
+			arg->i = va_arg(args, int);
+			break;
+		case LOG_ARG_LONG:
+			arg->l = va_arg(args, long);
+			break;
+		case LOG_ARG_LLONG:
+			arg->ll = va_arg(args, long long);
+			break;
+		case LOG_ARG_INTMAX:
+			arg->im = va_arg(args, intmax_t);
+			break;
+		case LOG_ARG_SIZE:
+			arg->sz = va_arg(args, size_t);
+			break;
+		case LOG_ARG_PTRDIFF:
+			arg->pd = va_arg(args, ptrdiff_t);
+			break;
+		case LOG_ARG_DOUBLE:
+			arg->d = va_arg(args, double);
+			break;
+		case LOG_ARG_PTR:
+			arg->p = va_arg(args, void *);
+			break;
+		case LOG_ARG_STR:
+			s = va_arg(args, const char *);
+			if (!s)
+				s = "(null)";
+			/* A precision allows for text without termination. */
+			if (precision >= 0)
+				len = strnlen(s, precision);
+			else
+				len = strlen(s);
+			if (str_used + len + 1 > sizeof(rec->strings))
+				return FALSE;
+			memcpy(rec->strings + str_used, s, len);
+			rec->strings[str_used + len] = '\0';
+			arg->sz = str_used;
+			str_used += len + 1;
+			break;
+		}
+		rec->types[rec->num_args++] = type;
+		p = end;
+	}
+	rec->format = format;
+
+	return TRUE;
+}
+
+/* Format a captured record, the counterpart of log_capture(). */
+static void log_render(GString *out, const struct log_record *rec)
+{
+	enum log_arg_type type;
+	const union log_arg *arg;
+	const char *p, *q, *end;
+	char spec[LOG_RING_SPEC_LEN];
+	unsigned int n;
+	int precision;
+
+	if (!rec->format) {
+		g_string_append(out, rec->text);
+		return;
+	}
+
+	n = 0;
+	p = rec->format;
+	while ((q = strchr(p, '%'))) {
+		g_string_append_len(out, p, q - p);
+		if (q[1] == '%') {
+			g_string_append_c(out, '%');
+			p = q + 2;
+			continue;
+		}
+		end = log_parse_spec(q + 1, &type, &precision);
+		memcpy(spec, q, end - q);
+		spec[end - q] = '\0';
+		arg = &rec->args[n];
+		switch (rec->types[n]) {
+		case LOG_ARG_INT:
+			g_string_append_printf(out, spec, arg->i);
+			break;
+		case LOG_ARG_LONG:
+			g_string_append_printf(out, spec, arg->l);
+			break;
+		case LOG_ARG_LLONG:
+			g_string_append_printf(out, spec, arg->ll);
+			break;
+		case LOG_ARG_INTMAX:
+			g_string_append_printf(out, spec, arg->im);
+			break;
+		case LOG_ARG_SIZE:
+			g_string_append_printf(out, spec, arg->sz);
+			break;
+		case LOG_ARG_PTRDIFF:
+			g_string_append_printf(out, spec, arg->pd);
+			break;
+		case LOG_ARG_DOUBLE:
+			g_string_append_printf(out, spec, arg->d);
+			break;
+		case LOG_ARG_PTR:
+			g_string_append_printf(out, spec, arg->p);
+			break;
+		case LOG_ARG_STR:
+			g_string_append_printf(out, spec,
+				rec->strings + arg->sz);
+			break;
+		}
+		n++;
+		p = end;
+	}
+	g_string_append(out, p);
+}
+
+static int log_ring_push(int loglevel, const char *format, va_list args)
+{
+	struct log_record *rec;
+	guint pos;
+	gint diff;
+	va_list args_copy;
+
+	pos = g_atomic_int_get(&log_ring_head);
+	for (;;) {
+		rec = &log_ring[pos & log_ring_mask];
+		diff = (gint)((guint)g_atomic_int_get(&rec->seq) - pos);
+		if (diff == 0) {
+			if (g_atomic_int_compare_and_exchange(&log_ring_head,
+					(gint)pos, (gint)(pos + 1)))
+				break;
+		} else if (diff < 0) {
+			g_atomic_int_inc(&log_ring_dropped);
+			return SR_OK;
+		}
+		pos = g_atomic_int_get(&log_ring_head);
+	}
+
+	rec->loglevel = loglevel;
+	rec->time_us = g_get_monotonic_time();
+	rec->text = NULL;
+	va_copy(args_copy, args);
+	if (!log_capture(rec, format, args_copy)) {
+		rec->format = NULL;
+		rec->text = g_strdup_vprintf(format, args);
+	}
+	va_end(args_copy);
+
+	/* Publish the record to the consumer. */
+	g_atomic_int_set(&rec->seq, (gint)(pos + 1));
+
+	return SR_OK;
+}
+
+/* Write one message to stderr, dropping embedded newlines in place. */
+static int log_write(int64_t time_us, char *text)
 {
 	uint64_t elapsed_us, minutes;
 	unsigned int rest_us, seconds, microseconds;
-	char *raw_output, *output;
-	int raw_len, raw_idx, idx, ret;
-
-	/* This specific log callback doesn't need the void pointer data. */
-	(void)cb_data;
+	char *src, *dst;
+	int ret;
 
-	(void)loglevel;
+	for (src = dst = text; *src; src++) {
+		if (*src != '\n')
+			*dst++ = *src;
+	}
+	*dst = '\0';
 
 	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
-		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
+		elapsed_us = time_us - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
 		rest_us = elapsed_us % G_TIME_SPAN_MINUTE;
 		seconds = rest_us / G_TIME_SPAN_SECOND;
 		microseconds = rest_us % G_TIME_SPAN_SECOND;
 
-		ret = g_fprintf(stderr, "sr: [%.2" PRIu64 ":%.2u.%.6u] ",
-				minutes, seconds, microseconds);
+		ret = g_fprintf(stderr, "sr: [%.2" PRIu64 ":%.2u.%.6u] %s\n",
+				minutes, seconds, microseconds, text);
 	} else {
-		ret = fputs("sr: ", stderr);
+		ret = g_fprintf(stderr, "sr: %s\n", text);
 	}
+	fflush(stderr);
+
+	return (ret < 0) ? SR_ERR : SR_OK;
+}
+
+static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
+{
+	char *output;
+	int ret;
+
+	/* This specific log callback doesn't need the void pointer data. */
+	(void)cb_data;
+
+	(void)loglevel;
 
-	if (ret < 0 || (raw_len = g_vasprintf(&raw_output, format, args)) < 0)
+	if (g_vasprintf(&output, format, args) < 0)
 		return SR_ERR;
 
-	output = g_malloc0(raw_len + 1);
+	ret = log_write(g_get_monotonic_time(), output);
+	g_free(output);
+
+	return ret;
+}
+
+static int log_cb_text(int loglevel, const char *format, ...)
+{
+	int ret;
+	va_list args;
+
+	va_start(args, format);
+	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	va_end(args);
 
-	/* Copy the string without any unwanted newlines. */
-	raw_idx = idx = 0;
-	while (raw_idx < raw_len) {
-		if (raw_output[raw_idx] != '\n') {
-			output[idx] = raw_output[raw_idx];
-			idx++;
+	return ret;
+}
+
+/*
+ * Hand a formatted message to the log callback. The built-in callback
+ * gets the time the message was logged, custom callbacks only see the
+ * text.
+ */
+static void log_emit(int loglevel, int64_t time_us, GString *text)
+{
+	if (sr_log_cb == sr_logv)
+		log_write(time_us, text->str);
+	else
+		log_cb_text(loglevel, "%s", text->str);
+}
+
+/* Must be called with drain_mutex held. */
+static void log_ring_drain(void)
+{
+	struct log_record *rec;
+	GString *text;
+	gint dropped;
+
+	g_atomic_int_set(&log_urgent, 0);
+	text = g_string_sized_new(256);
+	for (;;) {
+		rec = &log_ring[log_ring_tail & log_ring_mask];
+		if ((gint)((guint)g_atomic_int_get(&rec->seq)
+				- (log_ring_tail + 1)) < 0)
+			break;
+
+		g_string_truncate(text, 0);
+		log_render(text, rec);
+		g_free(rec->text);
+		rec->text = NULL;
+		log_emit(rec->loglevel, rec->time_us, text);
+
+		/* Hand the slot back to the producers. */
+		g_atomic_int_set(&rec->seq,
+			(gint)(log_ring_tail + log_ring_mask + 1));
+		log_ring_tail++;
+	}
+
+	do {
+		dropped = g_atomic_int_get(&log_ring_dropped);
+	} while (dropped && !g_atomic_int_compare_and_exchange(
+			&log_ring_dropped, dropped, 0));
+	if (dropped) {
+		g_string_printf(text, "%s: Deferred log ring full, "
+			"dropped %d messages.", LOG_PREFIX, dropped);
+		log_emit(SR_LOG_WARN, g_get_monotonic_time(), text);
+	}
+
+	g_string_free(text, TRUE);
+}
+
+/*
+ * Drain warnings and errors unless another thread is draining. Their
+ * callers don't wait for drain_mutex, so every thread which releases
+ * it checks again for urgent messages which were pushed meanwhile.
+ */
+static void log_ring_drain_urgent(void)
+{
+	while (g_atomic_int_get(&log_urgent)
+			&& g_mutex_trylock(&drain_mutex)) {
+		log_ring_drain();
+		g_mutex_unlock(&drain_mutex);
+	}
+}
+
+static gpointer log_drain_thread_func(gpointer data)
+{
+	int64_t end_time;
+
+	(void)data;
+
+	g_mutex_lock(&thread_mutex);
+	while (!drain_thread_stop) {
+		end_time = g_get_monotonic_time() + LOG_RING_DRAIN_US;
+		g_cond_wait_until(&thread_cond, &thread_mutex, end_time);
+		g_mutex_unlock(&thread_mutex);
+		sr_log_deferred_flush();
+		g_mutex_lock(&thread_mutex);
+	}
+	g_mutex_unlock(&thread_mutex);
+
+	return NULL;
+}
+
+static void log_drain_thread_stop(void)
+{
+	if (!drain_thread)
+		return;
+
+	g_mutex_lock(&thread_mutex);
+	drain_thread_stop = TRUE;
+	g_cond_signal(&thread_cond);
+	g_mutex_unlock(&thread_mutex);
+
+	g_thread_join(drain_thread);
+	drain_thread = NULL;
+}
+
+/**
+ * Enable deferred logging.
+ *
+ * Messages which pass the loglevel check are stored in an in-memory ring
+ * together with their arguments and a timestamp, and only get formatted
+ * and passed to the log callback when the ring is drained. This keeps
+ * debug and spew logging cheap enough for acquisition hot paths.
+ *
+ * Warnings and errors still get drained right away. Everything else is
+ * drained by sr_log_deferred_flush(), sr_log_deferred_disable(), or the
+ * background thread if requested. In that case the log callback is
+ * invoked from that thread. Messages are dropped and counted if the
+ * ring overflows.
+ *
+ * @param num_records Number of messages the ring can hold, rounded up to
+ *                    a power of two. 0 selects the default of 4096. Only
+ *                    used when the ring is allocated, on the first call.
+ * @param background Drain the ring from a background thread every 10ms.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid ring size.
+ * @retval SR_ERR_MALLOC Out of memory.
+ * @retval SR_ERR Failed to start the background thread.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_deferred_enable(size_t num_records, gboolean background)
+{
+	size_t size;
+	guint i;
+
+	if (!log_ring) {
+		if (num_records == 0)
+			num_records = LOG_RING_DEFAULT_SIZE;
+		if (num_records > G_MAXINT / 2) {
+			sr_err("Invalid deferred log ring size %zu.", num_records);
+			return SR_ERR_ARG;
 		}
-		raw_idx++;
+		size = 1;
+		while (size < num_records)
+			size <<= 1;
+		log_ring = g_try_malloc0(size * sizeof(*log_ring));
+		if (!log_ring)
+			return SR_ERR_MALLOC;
+		for (i = 0; i < size; i++)
+			log_ring[i].seq = i;
+		log_ring_mask = size - 1;
 	}
 
-	g_fprintf(stderr, "%s\n", output);
-	fflush(stderr);
-	g_free(raw_output);
-	g_free(output);
+	if (background && !drain_thread) {
+		drain_thread_stop = FALSE;
+		drain_thread = g_thread_try_new("sr-log",
+			log_drain_thread_func, NULL, NULL);
+		if (!drain_thread) {
+			sr_err("Cannot create log drain thread.");
+			return SR_ERR;
+		}
+	} else if (!background) {
+		log_drain_thread_stop();
+	}
+
+	g_atomic_int_set(&log_deferred, 1);
+
+	return SR_OK;
+}
+
+/**
+ * Disable deferred logging.
+ *
+ * Stops the background thread, if any, and drains the messages which are
+ * still pending. Subsequent messages are formatted right away again.
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_deferred_disable(void)
+{
+	g_atomic_int_set(&log_deferred, 0);
+	log_drain_thread_stop();
+
+	/* Wait for callers which saw deferred logging still enabled. */
+	while (g_atomic_int_get(&log_producers))
+		g_thread_yield();
+
+	return sr_log_deferred_flush();
+}
+
+/**
+ * Format and output all messages pending in the deferred log ring.
+ *
+ * Can be called from any thread, and at any time, also when deferred
+ * logging is not enabled.
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_deferred_flush(void)
+{
+	if (!log_ring)
+		return SR_OK;
+
+	g_mutex_lock(&drain_mutex);
+	log_ring_drain();
+	g_mutex_unlock(&drain_mutex);
+	log_ring_drain_urgent();
 
 	return SR_OK;
 }
@@ -241,9 +817,30 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 	if (loglevel > cur_loglevel)
 		return SR_OK;
 
+	/*
+	 * Announce the message before checking the mode, so that
+	 * sr_log_deferred_disable() can wait for it to be pushed, and
+	 * drain it.
+	 */
+	g_atomic_int_inc(&log_producers);
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	if (g_atomic_int_get(&log_deferred))
+		ret = log_ring_push(loglevel, format, args);
+	else
+		ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
 	va_end(args);
+	g_atomic_int_add(&log_producers, -1);
+
+	/*
+	 * Don't hold back warnings and errors. Skip if a drain is already
+	 * in progress, which will pick the message up, or drain again
+	 * after it released the mutex (this also covers a log callback
+	 * which logs by itself).
+	 */
+	if (loglevel <= SR_LOG_WARN && g_atomic_int_get(&log_deferred)) {
+		g_atomic_int_set(&log_urgent, 1);
+		log_ring_drain_urgent();
+	}
 
 	return ret;
 }
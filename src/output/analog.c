@@ -34,6 +34,8 @@ struct context {
 	GPtrArray *channellist;
 	int digits;
 	float *fdata;
+	/* Text of the current packet, reused across packets. */
+	GString *text;
 };
 
 enum {
@@ -68,13 +70,16 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->num_enabled_channels++;
 	}
 	ctx->fdata = NULL;
+	ctx->text = g_string_sized_new(512);
 
 	return SR_OK;
 }
 
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		struct sr_output_sink *sink)
 {
+	static const char frame_begin[] = "FRAME-BEGIN\n";
+	static const char frame_end[] = "FRAME-END\n";
 	struct context *ctx;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_datafeed_meta *meta;
@@ -82,47 +87,46 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_key_info *srci;
 	struct sr_channel *ch;
 	GSList *l;
+	GString *out;
 	float *fdata;
 	unsigned int i;
 	int num_channels, c, ret, digits, actual_digits;
-	char *number, *suffix;
+	char *suffix;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	ctx = o->priv;
+	out = ctx->text;
+	g_string_truncate(out, 0);
 
 	switch (packet->type) {
 	case SR_DF_FRAME_BEGIN:
-		*out = g_string_new("FRAME-BEGIN\n");
-		break;
+		return sr_output_sink_write(sink, frame_begin, strlen(frame_begin));
 	case SR_DF_FRAME_END:
-		*out = g_string_new("FRAME-END\n");
-		break;
+		return sr_output_sink_write(sink, frame_end, strlen(frame_end));
 	case SR_DF_META:
 		meta = packet->payload;
 		for (l = meta->config; l; l = l->next) {
 			src = l->data;
 			if (!(srci = sr_key_info_get(SR_KEY_CONFIG, src->key)))
 				return SR_ERR;
-			*out = g_string_sized_new(512);
-			g_string_append(*out, "META ");
-			g_string_append_printf(*out, "%s: ", srci->id);
+			g_string_append(out, "META ");
+			g_string_append_printf(out, "%s: ", srci->id);
 			if (srci->datatype == SR_T_BOOL) {
-				g_string_append_printf(*out, "%u",
+				g_string_append_printf(out, "%u",
 					g_variant_get_boolean(src->data));
 			} else if (srci->datatype == SR_T_FLOAT) {
-				g_string_append_printf(*out, "%f",
+				g_string_append_printf(out, "%f",
 					g_variant_get_double(src->data));
 			} else if (srci->datatype == SR_T_UINT64) {
-				g_string_append_printf(*out, "%"
+				g_string_append_printf(out, "%"
 					G_GUINT64_FORMAT,
 					g_variant_get_uint64(src->data));
 			} else if (srci->datatype == SR_T_STRING) {
-				g_string_append_printf(*out, "%s",
+				g_string_append_printf(out, "%s",
 					g_variant_get_string(src->data, NULL));
 			}
-			g_string_append(*out, "\n");
+			g_string_append(out, "\n");
 		}
 		break;
 	case SR_DF_ANALOG:
@@ -134,7 +138,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		ctx->fdata = fdata;
 		if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 			return ret;
-		*out = g_string_sized_new(512);
 		if (ctx->digits == DIGITS_ALL)
 			digits = analog->encoding->digits;
 		else
@@ -151,21 +154,21 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 				if (si_friendly)
 					prefix = sr_analog_si_prefix(&value, &actual_digits);
 				ch = l->data;
-				g_string_append_printf(*out, "%s: ", ch->name);
-				number = g_strdup_printf("%.*f", MAX(actual_digits, 0), value);
-				g_string_append(*out, number);
-				g_free(number);
-				g_string_append(*out, " ");
-				g_string_append(*out, prefix);
-				g_string_append(*out, suffix);
-				g_string_append(*out, "\n");
+				g_string_append(out, ch->name);
+				g_string_append(out, ": ");
+				sr_gstring_append_fixed(out, value,
+					MAX(actual_digits, 0));
+				g_string_append(out, " ");
+				g_string_append(out, prefix);
+				g_string_append(out, suffix);
+				g_string_append(out, "\n");
 			}
 		}
 		g_free(suffix);
 		break;
 	}
 
-	return SR_OK;
+	return sr_output_sink_write_gstring(sink, out);
 }
 
 static struct sr_option options[] = {
@@ -204,6 +207,7 @@ static int cleanup(struct sr_output *o)
 		options[0].values = NULL;
 	}
 	g_free(ctx->fdata);
+	g_string_free(ctx->text, TRUE);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -218,6 +222,6 @@ SR_PRIV struct sr_output_module output_analog = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup
 };
@@ -49,6 +49,8 @@ struct context {
 	uint8_t *prev_sample;
 	gboolean header_done;
 	GString **lines;
+	/* Text of the current packet, reused across packets. */
+	GString *text;
 	const char *charset;
 	gboolean edges;
 };
@@ -117,6 +119,7 @@ static int init(struct sr_output *o, GHashTable *options)
 
 		j++;
 	}
+	ctx->text = g_string_sized_new(512);
 
 	return SR_OK;
 }
@@ -173,7 +176,7 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 }
 
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		struct sr_output_sink *sink)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
@@ -187,12 +190,15 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	uint8_t bitmask, curbit, prevbit;
 	char c;
 	size_t charidx;
+	GString *out, *header;
+	int ret;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
 		return SR_ERR_ARG;
+	out = ctx->text;
+	g_string_truncate(out, 0);
 
 	switch (packet->type) {
 	case SR_DF_META:
@@ -209,10 +215,12 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			header = gen_header(o);
+			ret = sr_output_sink_write_gstring(sink, header);
+			g_string_free(header, TRUE);
+			if (ret != SR_OK)
+				return ret;
 			ctx->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		logic = packet->payload;
@@ -237,11 +245,12 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 				if (ctx->spl_cnt == ctx->spl) {
 					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
+					g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+					g_string_append_c(out, '\n');
 					if (j + 1 == ctx->num_enabled_channels)
-						maybe_add_trigger(ctx, *out);
-					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+						maybe_add_trigger(ctx, out);
+					/* Keep the aligned name prefix. */
+					g_string_truncate(ctx->lines[j], ctx->max_namelen + 1);
 				}
 			}
 			if (ctx->spl_cnt == ctx->spl)
@@ -254,17 +263,16 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
-			maybe_add_trigger(ctx, *out);
+			maybe_add_trigger(ctx, out);
 		}
 		break;
 	}
 
-	return SR_OK;
+	return sr_output_sink_write_gstring(sink, out);
 }
 
 static int cleanup(struct sr_output *o)
@@ -286,6 +294,7 @@ static int cleanup(struct sr_output *o)
 	}
 	g_free(ctx->aligned_names);
 	g_free(ctx->lines);
+	g_string_free(ctx->text, TRUE);
 	g_free((gpointer)ctx->charset);
 	g_free(ctx);
 	o->priv = NULL;
@@ -319,6 +328,6 @@ SR_PRIV struct sr_output_module output_ascii = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
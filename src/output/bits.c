@@ -38,6 +38,7 @@ struct context {
 	char **channel_names;
 	gboolean header_done;
 	GString **lines;
+	struct sr_output_iovec *iov;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -66,6 +67,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
+	ctx->iov = g_malloc(sizeof(ctx->iov[0]) * (2 * ctx->num_enabled_channels + 1));
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
@@ -116,24 +118,60 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
+/*
+ * Write all line buffers in one go, followed by the trigger marker if
+ * a marker offset is given. Line buffers are written from where they
+ * are, they must not be modified before this returns.
+ */
+static int flush_lines(struct context *ctx, struct sr_output_sink *sink,
+		int marker_offset)
+{
+	struct sr_output_iovec *iov;
+	char *marker;
+	unsigned int i;
+	size_t n;
+	int ret;
+
+	iov = ctx->iov;
+	n = 0;
+	for (i = 0; i < ctx->num_enabled_channels; i++) {
+		iov[n].base = ctx->lines[i]->str;
+		iov[n++].len = ctx->lines[i]->len;
+		iov[n].base = "\n";
+		iov[n++].len = 1;
+	}
+	marker = NULL;
+	if (marker_offset >= 0) {
+		marker = g_strdup_printf("T:%*s^ %d\n",
+			marker_offset, "", ctx->trigger);
+		iov[n].base = marker;
+		iov[n++].len = strlen(marker);
+	}
+	ret = sr_output_sink_writev(sink, iov, n);
+	g_free(marker);
+
+	return ret;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		struct sr_output_sink *sink)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	struct context *ctx;
+	GString *header;
 	GSList *l;
-	int idx, offset;
+	int idx, offset, ret;
 	uint64_t i, j;
 	gchar *p, c;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
 		return SR_ERR_ARG;
 
+	ret = SR_OK;
 	switch (packet->type) {
 	case SR_DF_META:
 		meta = packet->payload;
@@ -149,10 +187,13 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			header = gen_header(o);
+			ret = sr_output_sink_write_gstring(sink, header);
+			g_string_free(header, TRUE);
+			if (ret != SR_OK)
+				return ret;
 			ctx->header_done = TRUE;
-		} else
-			*out = g_string_sized_new(512);
+		}
 
 		logic = packet->payload;
 		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
@@ -163,44 +204,43 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 				c = (*p & (1 << (idx % 8))) ? '1' : '0';
 				g_string_append_c(ctx->lines[j], c);
 
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per bit,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				} else if ((ctx->spl_cnt & 7) == 0) {
+				if (ctx->spl_cnt != ctx->spl && (ctx->spl_cnt & 7) == 0) {
 					/* Add a space every 8th bit. */
 					g_string_append_c(ctx->lines[j], ' ');
 				}
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+			if (ctx->spl_cnt != ctx->spl)
+				continue;
+
+			/* Flush line buffers. */
+			offset = -1;
+			if (ctx->num_enabled_channels && ctx->trigger > -1) {
+				/*
+				 * Sample data lines have one character per bit,
+				 * plus one separator per byte. Align trigger marker
+				 * to this layout.
+				 */
+				offset = ctx->trigger + ctx->trigger / 8;
+			}
+			ret = flush_lines(ctx, sink, offset);
+			if (offset >= 0)
+				ctx->trigger = -1;
+			for (j = 0; j < ctx->num_enabled_channels; j++)
+				g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+			ctx->spl_cnt = 0;
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
-			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
-			}
+			ret = flush_lines(ctx, sink, -1);
 		}
 		break;
 	}
 
-	return SR_OK;
+	return ret;
 }
 
 static int cleanup(struct sr_output *o)
@@ -219,6 +259,7 @@ static int cleanup(struct sr_output *o)
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
+	g_free(ctx->iov);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -248,6 +289,6 @@ SR_PRIV struct sr_output_module output_bits = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
@@ -51,6 +51,11 @@
  *
  * dedup:   Don't output duplicate rows. Defaults to FALSE. If time is off, then
  *          this is forced to be off.
+ *
+ * Numbers are written in the C locale's format, with '.' as the decimal
+ * separator, regardless of the LC_NUMERIC setting of the application.
+ * Earlier versions used the application's locale, which collided with
+ * the default value separator in locales that use ',' for decimals.
  */
 
 #include <config.h>
@@ -106,6 +111,9 @@ struct context {
 	gboolean have_checked;
 	gboolean have_frames;
 	uint64_t pkt_snums;
+
+	/* Text of the current packet, reused across packets. */
+	GString *text;
 };
 
 /*
@@ -206,6 +214,7 @@ static int init(struct sr_output *o, GHashTable *options)
 			ctx->channels[i++].ch = ch;
 		}
 	}
+	ctx->text = g_string_sized_new(512);
 
 	return SR_OK;
 }
@@ -405,7 +414,7 @@ static void process_logic(struct context *ctx,
 	}
 }
 
-static void dump_saved_values(struct context *ctx, GString **out)
+static void dump_saved_values(struct context *ctx, GString *out)
 {
 	unsigned int i, j, analog_size, num_channels;
 	double sample_time_dbl;
@@ -420,29 +429,27 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
 
-		if (!*out)
-			*out = g_string_sized_new(512);
 		num_channels =
 		    ctx->num_logic_channels + ctx->num_analog_channels;
 
 		if (ctx->label_do) {
 			if (ctx->time)
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->label_names ? "Time" : ctx->xlabel,
 					ctx->value);
 			for (i = 0; i < num_channels; i++) {
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->channels[i].label, ctx->value);
 				if (ctx->channels[i].ch->type == SR_CHANNEL_ANALOG
 						&& ctx->label_names)
 					g_free(ctx->channels[i].label);
 			}
 			if (ctx->do_trigger)
-				g_string_append_printf(*out, "Trigger%s",
+				g_string_append_printf(out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 
 			ctx->label_do = FALSE;
 		}
@@ -474,14 +481,15 @@ static void dump_saved_values(struct context *ctx, GString **out)
 			}
 
 			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
+				g_string_append_c(out, '0');
+				g_string_append(out, ctx->value);
 			} else if (ctx->time) {
 				sample_time_dbl = ctx->out_sample_count++;
 				sample_time_dbl /= ctx->sample_rate;
 				sample_time_dbl *= ctx->sample_scale;
 				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
+				sr_gstring_append_u64(out, sample_time_u64);
+				g_string_append(out, ctx->value);
 			}
 
 			for (j = 0; j < num_channels; j++) {
@@ -491,11 +499,12 @@ static void dump_saved_values(struct context *ctx, GString **out)
 					    fmax(value, ctx->channels[j].max);
 					ctx->channels[j].min =
 					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
+					sr_gstring_append_g(out, value, 6);
+					g_string_append(out, ctx->value);
 				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
+					g_string_append_c(out,
+						ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0');
+					g_string_append(out, ctx->value);
 				} else {
 					sr_warn("Unexpected channel type: %d",
 						ctx->channels[i].ch->type);
@@ -503,12 +512,12 @@ static void dump_saved_values(struct context *ctx, GString **out)
 			}
 
 			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
+				sr_gstring_append_i64(out, ctx->trigger);
+				g_string_append(out, ctx->value);
 				ctx->trigger = FALSE;
 			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 		}
 	}
 
@@ -655,17 +664,21 @@ static void check_input_constraints(struct context *ctx)
 }
 
 static int receive(const struct sr_output *o,
-		   const struct sr_datafeed_packet *packet, GString **out)
+		   const struct sr_datafeed_packet *packet,
+		   struct sr_output_sink *sink)
 {
 	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	GString *out, *header;
+	int ret;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
 		return SR_ERR_ARG;
+	out = ctx->text;
+	g_string_truncate(out, 0);
 
 	sr_dbg("Got packet of type %d", packet->type);
 	switch (packet->type) {
@@ -673,13 +686,16 @@ static int receive(const struct sr_output *o,
 		ctx->have_checked = FALSE;
 		ctx->have_frames = FALSE;
 		ctx->pkt_snums = FALSE;
-		*out = gen_header(o, packet->payload);
+		header = gen_header(o, packet->payload);
+		ret = sr_output_sink_write_gstring(sink, header);
+		g_string_free(header, TRUE);
+		if (ret != SR_OK)
+			return ret;
 		break;
 	case SR_DF_TRIGGER:
 		ctx->trigger = TRUE;
 		break;
 	case SR_DF_LOGIC:
-		*out = g_string_sized_new(512);
 		logic = packet->payload;
 		ctx->pkt_snums = logic->length;
 		ctx->pkt_snums /= logic->length;
@@ -687,7 +703,6 @@ static int receive(const struct sr_output *o,
 		process_logic(ctx, logic);
 		break;
 	case SR_DF_ANALOG:
-		*out = g_string_sized_new(512);
 		analog = packet->payload;
 		ctx->pkt_snums = analog->num_samples;
 		ctx->pkt_snums /= g_slist_length(analog->meaning->channels);
@@ -696,7 +711,7 @@ static int receive(const struct sr_output *o,
 		break;
 	case SR_DF_FRAME_BEGIN:
 		ctx->have_frames = TRUE;
-		*out = g_string_new(ctx->frame);
+		g_string_append(out, ctx->frame);
 		/* Fallthrough */
 	case SR_DF_END:
 		/* Got to end of frame/session with part of the data. */
@@ -711,7 +726,7 @@ static int receive(const struct sr_output *o,
 	if (ctx->channels_seen >= ctx->channel_count)
 		dump_saved_values(ctx, out);
 
-	return SR_OK;
+	return sr_output_sink_write_gstring(sink, out);
 }
 
 static int cleanup(struct sr_output *o)
@@ -730,6 +745,7 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->value);
 		g_free(ctx->previous_sample);
 		g_free(ctx->channels);
+		g_string_free(ctx->text, TRUE);
 		g_free(o->priv);
 		o->priv = NULL;
 	}
@@ -785,6 +801,6 @@ SR_PRIV struct sr_output_module output_csv = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
@@ -49,6 +49,10 @@
  * Output modules generate a newly allocated GString. The caller is then
  * expected to free this with g_string_free() when finished with it.
  *
+ * Alternatively, frontends can have output written to a reusable sink,
+ * see sr_output_send_sink(). Sinks write to a file descriptor or a
+ * memory region, and save the allocation and copy of the GString.
+ *
  * @{
  */
 
@@ -325,18 +329,159 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/* Get a module's output as a GString, via its sink interface if need be. */
+static int module_receive(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct sr_output_sink sink;
+	GString *s;
+	int ret;
+
+	if (o->module->receive)
+		return o->module->receive(o, packet, out);
+
+	s = g_string_new(NULL);
+	sr_output_sink_init_gstring(&sink, s);
+	ret = o->module->receive_sink(o, packet, &sink);
+	/* Like GString modules, return an empty string for no output. */
+	if (ret != SR_OK) {
+		g_string_free(s, TRUE);
+		s = NULL;
+	}
+	*out = s;
+
+	return ret;
+}
+
+/* Have a module write to a sink, via its GString interface if need be. */
+static int module_receive_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	GString *out;
+	int ret;
+
+	if (o->module->receive_sink)
+		return o->module->receive_sink(o, packet, sink);
+
+	out = NULL;
+	ret = o->module->receive(o, packet, &out);
+	if (out) {
+		if (ret == SR_OK)
+			ret = sr_output_sink_write_gstring(sink, out);
+		g_string_free(out, TRUE);
+	}
+
+	return ret;
+}
+
+struct expand_rle_context {
+	const struct sr_output *o;
+	GString *out;
+	struct sr_output_sink *sink;
+};
+
+/* Pass an expanded SR_DF_LOGIC_RLE chunk to the output module. */
+static int send_expanded_rle(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	struct expand_rle_context *ctx;
+	GString *chunk_out;
+	int ret;
+
+	ctx = cb_data;
+	if (ctx->sink)
+		return module_receive_sink(ctx->o, packet, ctx->sink);
+
+	chunk_out = NULL;
+	ret = module_receive(ctx->o, packet, &chunk_out);
+	if (chunk_out) {
+		if (!ctx->out)
+			ctx->out = chunk_out;
+		else {
+			g_string_append_len(ctx->out,
+				chunk_out->str, chunk_out->len);
+			g_string_free(chunk_out, TRUE);
+		}
+	}
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
- * which must be freed by the caller.
+ * which must be freed by the caller. The GString may be empty, or
+ * @a out may be set to NULL, when the packet caused no output.
+ *
+ * Run-length encoded logic data gets expanded for output modules
+ * which don't handle SR_DF_LOGIC_RLE packets themselves.
  *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	struct expand_rle_context ctx;
+	int ret;
+
+	if (packet->type == SR_DF_LOGIC_RLE &&
+			!(o->module->flags & SR_OUTPUT_LOGIC_RLE)) {
+		ctx.o = o;
+		ctx.out = NULL;
+		ctx.sink = NULL;
+		ret = sr_logic_rle_expand_packets(packet->payload,
+			send_expanded_rle, &ctx);
+		*out = ctx.out;
+		return ret;
+	}
+
+	return module_receive(o, packet, out);
+}
+
+/**
+ * Send a packet to the specified output instance, and have its output
+ * written to a sink.
+ *
+ * This is the allocation free alternative to sr_output_send(). Output
+ * modules which support sinks write their output directly, binary
+ * data is passed on from the packet's buffer where possible. Other
+ * modules' output gets copied to the sink.
+ *
+ * Buffered sinks may hold on to part of the output, use
+ * sr_output_sink_flush() to write it out.
+ *
+ * @param o The output instance.
+ * @param packet The packet to process.
+ * @param sink The sink to write to, see sr_output_sink_fd_new() and
+ *             sr_output_sink_memory_new().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error from the output module or the sink.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	struct expand_rle_context ctx;
+
+	if (!o || !packet || !sink)
+		return SR_ERR_ARG;
+
+	if (packet->type == SR_DF_LOGIC_RLE &&
+			!(o->module->flags & SR_OUTPUT_LOGIC_RLE)) {
+		ctx.o = o;
+		ctx.out = NULL;
+		ctx.sink = sink;
+		return sr_logic_rle_expand_packets(packet->payload,
+			send_expanded_rle, &ctx);
+	}
+
+	return module_receive_sink(o, packet, sink);
 }
 
 /**
@@ -0,0 +1,408 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "output"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Output sinks, caller supplied destinations for output module data.
+ */
+
+/**
+ * @addtogroup grp_output
+ *
+ * @{
+ */
+
+/* Number of gather elements passed to one writev() call. */
+#define SINK_IOV_BATCH	16
+
+#ifdef HAVE_SYS_UIO_H
+static int fd_write_vec(int fd, const struct sr_output_iovec *iov, size_t count)
+{
+	struct iovec vec[SINK_IOV_BATCH];
+	size_t i, n, skip;
+	ssize_t ret;
+
+	skip = 0;
+	while (count) {
+		n = MIN(count, SINK_IOV_BATCH);
+		for (i = 0; i < n; i++) {
+			vec[i].iov_base = (void *)iov[i].base;
+			vec[i].iov_len = iov[i].len;
+		}
+		vec[0].iov_base = (uint8_t *)vec[0].iov_base + skip;
+		vec[0].iov_len -= skip;
+		ret = writev(fd, vec, n);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			sr_err("Cannot write output: %s.", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		/* Skip completed elements, keep the offset into a partial one. */
+		ret += skip;
+		while (count && (size_t)ret >= iov->len) {
+			ret -= iov->len;
+			iov++;
+			count--;
+		}
+		skip = ret;
+	}
+
+	return SR_OK;
+}
+#else
+static int fd_write_vec(int fd, const struct sr_output_iovec *iov, size_t count)
+{
+	const uint8_t *p;
+	size_t left;
+	ssize_t ret;
+
+	for (; count; iov++, count--) {
+		p = iov->base;
+		left = iov->len;
+		while (left) {
+			ret = write(fd, p, left);
+			if (ret < 0) {
+				if (errno == EINTR)
+					continue;
+				sr_err("Cannot write output: %s.", g_strerror(errno));
+				return SR_ERR_IO;
+			}
+			p += ret;
+			left -= ret;
+		}
+	}
+
+	return SR_OK;
+}
+#endif
+
+static int fd_flush(struct sr_output_sink *sink)
+{
+	struct sr_output_iovec iov;
+	int ret;
+
+	if (!sink->used)
+		return SR_OK;
+	iov.base = sink->buf;
+	iov.len = sink->used;
+	ret = fd_write_vec(sink->fd, &iov, 1);
+	sink->used = 0;
+
+	return ret;
+}
+
+/*
+ * Small writes get collected in the sink's buffer. Writes which would
+ * not fit go to the file descriptor directly from the caller's memory.
+ */
+static int fd_write(struct sr_output_sink *sink,
+	const struct sr_output_iovec *iov, size_t count, size_t total)
+{
+	size_t i;
+	int ret;
+
+	if (sink->used + total > sink->size) {
+		ret = fd_flush(sink);
+		if (ret != SR_OK)
+			return ret;
+		if (total >= sink->size)
+			return fd_write_vec(sink->fd, iov, count);
+	}
+	for (i = 0; i < count; i++) {
+		memcpy(sink->buf + sink->used, iov[i].base, iov[i].len);
+		sink->used += iov[i].len;
+	}
+
+	return SR_OK;
+}
+
+static int memory_write(struct sr_output_sink *sink,
+	const struct sr_output_iovec *iov, size_t count, size_t total)
+{
+	size_t i;
+
+	if (total > sink->size - sink->used) {
+		sr_err("Output sink memory exhausted (%zu of %zu bytes used).",
+			sink->used, sink->size);
+		return SR_ERR_IO;
+	}
+	for (i = 0; i < count; i++) {
+		memcpy(sink->buf + sink->used, iov[i].base, iov[i].len);
+		sink->used += iov[i].len;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Write a gather list of memory regions to an output sink.
+ *
+ * Data is consumed before the call returns, the regions may be reused
+ * by the caller afterwards.
+ *
+ * @param sink The sink to write to. Must not be NULL.
+ * @param iov Array of regions, written in order.
+ * @param count Number of elements in @p iov.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Write error, or memory sink exhausted.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_writev(struct sr_output_sink *sink,
+	const struct sr_output_iovec *iov, size_t count)
+{
+	size_t i, total;
+	int ret;
+
+	total = 0;
+	for (i = 0; i < count; i++)
+		total += iov[i].len;
+	if (!total)
+		return SR_OK;
+
+	switch (sink->type) {
+	case SR_OUTPUT_SINK_FD:
+		ret = fd_write(sink, iov, count, total);
+		break;
+	case SR_OUTPUT_SINK_MEMORY:
+		ret = memory_write(sink, iov, count, total);
+		break;
+	case SR_OUTPUT_SINK_GSTRING:
+		for (i = 0; i < count; i++)
+			g_string_append_len(sink->str, iov[i].base, iov[i].len);
+		ret = SR_OK;
+		break;
+	default:
+		return SR_ERR_BUG;
+	}
+	if (ret == SR_OK)
+		sink->bytes += total;
+
+	return ret;
+}
+
+/**
+ * Write one memory region to an output sink.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_write(struct sr_output_sink *sink,
+	const void *data, size_t len)
+{
+	struct sr_output_iovec iov;
+
+	iov.base = data;
+	iov.len = len;
+
+	return sr_output_sink_writev(sink, &iov, 1);
+}
+
+/**
+ * Write the content of a GString to an output sink.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_write_gstring(struct sr_output_sink *sink,
+	const GString *s)
+{
+	return sr_output_sink_write(sink, s->str, s->len);
+}
+
+/**
+ * Set up a caller allocated sink which appends to a GString.
+ *
+ * This is how output modules which only implement the sink interface
+ * serve sr_output_send(). The sink holds no resources of its own and
+ * needs not be freed.
+ *
+ * @private
+ */
+SR_PRIV void sr_output_sink_init_gstring(struct sr_output_sink *sink,
+	GString *s)
+{
+	memset(sink, 0, sizeof(*sink));
+	sink->type = SR_OUTPUT_SINK_GSTRING;
+	sink->fd = -1;
+	sink->str = s;
+}
+
+/**
+ * Create an output sink which writes to a file descriptor.
+ *
+ * The sink does not take ownership of the file descriptor, it is not
+ * closed when the sink gets freed.
+ *
+ * @param fd The file descriptor to write to.
+ * @param buffer_size Size of the write buffer which collects small
+ *                    chunks of output. 0 writes every chunk directly.
+ *
+ * @return A new sink, or NULL on error. Free with sr_output_sink_free().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_fd_new(int fd, size_t buffer_size)
+{
+	struct sr_output_sink *sink;
+
+	if (fd < 0)
+		return NULL;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->type = SR_OUTPUT_SINK_FD;
+	sink->fd = fd;
+	if (buffer_size) {
+		sink->buf = g_try_malloc(buffer_size);
+		if (!sink->buf) {
+			sr_err("Cannot allocate output sink buffer.");
+			g_free(sink);
+			return NULL;
+		}
+		sink->own_buf = TRUE;
+	}
+	sink->size = buffer_size;
+
+	return sink;
+}
+
+/**
+ * Create an output sink which writes to a caller provided memory region.
+ *
+ * Output is stored back to back from the start of the region. Writes
+ * which exceed the region fail with SR_ERR_IO. Use
+ * sr_output_sink_bytes() to get the amount of data, and
+ * sr_output_sink_reset() to rewind the sink for reuse.
+ *
+ * @param mem Start of the region. The caller keeps ownership.
+ * @param size Size of the region in bytes.
+ *
+ * @return A new sink, or NULL on error. Free with sr_output_sink_free().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_memory_new(void *mem, size_t size)
+{
+	struct sr_output_sink *sink;
+
+	if (!mem && size)
+		return NULL;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->type = SR_OUTPUT_SINK_MEMORY;
+	sink->fd = -1;
+	sink->buf = mem;
+	sink->size = size;
+
+	return sink;
+}
+
+/**
+ * Write out buffered data of an output sink.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Write error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink)
+{
+	if (!sink)
+		return SR_ERR_ARG;
+
+	if (sink->type == SR_OUTPUT_SINK_FD)
+		return fd_flush(sink);
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of bytes written to an output sink.
+ *
+ * This includes data which still sits in the sink's write buffer. For
+ * memory sinks, this is the amount of data in the region.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_output_sink_bytes(const struct sr_output_sink *sink)
+{
+	if (!sink)
+		return 0;
+
+	return sink->bytes;
+}
+
+/**
+ * Rewind an output sink.
+ *
+ * Memory sinks restart at the beginning of their region. Other sinks
+ * just reset their byte counter.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_output_sink_reset(struct sr_output_sink *sink)
+{
+	if (!sink)
+		return;
+
+	if (sink->type == SR_OUTPUT_SINK_MEMORY)
+		sink->used = 0;
+	sink->bytes = 0;
+}
+
+/**
+ * Flush and free an output sink.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Buffered data could not be written. The sink is
+ *                   freed nevertheless.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_free(struct sr_output_sink *sink)
+{
+	int ret;
+
+	if (!sink)
+		return SR_ERR_ARG;
+
+	ret = sr_output_sink_flush(sink);
+	if (sink->own_buf)
+		g_free(sink->buf);
+	g_free(sink);
+
+	return ret;
+}
+
+/** @} */
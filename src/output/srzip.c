@@ -18,22 +18,124 @@
  */
 
 #include <config.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
-#include <zip.h>
+#include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+/* ZIP archive format constants. */
+#define ZIP_SIG_LOCAL		0x04034b50
+#define ZIP_SIG_CENTRAL		0x02014b50
+#define ZIP_SIG_END		0x06054b50
+#define ZIP_SIG_END64		0x06064b50
+#define ZIP_SIG_LOCATOR64	0x07064b50
+#define ZIP_LOCAL_SIZE		30
+#define ZIP_CENTRAL_SIZE	46
+#define ZIP_END_SIZE		22
+#define ZIP_END64_SIZE		56
+#define ZIP_LOCATOR64_SIZE	20
+#define ZIP_EXTRA_ZIP64		0x0001
+#define ZIP_VERSION		20
+#define ZIP_VERSION_ZIP64	45
+#define ZIP_VERSION_ZSTD	63
+#define ZIP_MADE_BY_UNIX	(3 << 8)
+#define ZIP_METHOD_STORE	0
+#define ZIP_METHOD_DEFLATE	8
+#define ZIP_METHOD_ZSTD		93
+#define ZIP_MAX16		0xffff
+#define ZIP_MAX32		0xffffffffU
+
+/*
+ * The ZIP archive gets written while the acquisition runs. Sample data
+ * chunks get compressed in memory when they are complete, and are
+ * appended to the output file as archive members right away. The end
+ * of the session feed only writes the last partial chunks, the index,
+ * the metadata, and the archive's central directory. Neither a copy of
+ * the uncompressed data nor a stall at the end of long captures remain.
+ *
+ * libzip cannot write archives this way: it compresses all entries when
+ * the archive gets closed, and cannot add data which was compressed by
+ * the caller. The module has a minimal ZIP writer of its own instead.
+ * Member sizes and checksums are known before a member gets written,
+ * so local headers need no data descriptors. Members which exceed the
+ * 4 GiB offset range, and archives with more than 65535 members, use
+ * the ZIP64 extensions in the central directory. Until the central
+ * directory is written, the file holds a sequence of complete members,
+ * which archive repair tools can recover after a crash.
+ *
+ * Sample data chunks get compressed by a pool of worker threads. The
+ * chunk buffer gets handed over to a job, and the acquisition continues
+ * with another buffer from a free list. Completed jobs are written in
+ * the order they were queued, so that the member order does not depend
+ * on scheduling. The number of jobs in flight is limited, which bounds
+ * memory use when compression cannot keep up with the acquisition.
+ *
+ * An "index" entry lists the number of samples in each chunk, which
+ * allows readers to locate a sample range without decompressing the
+ * preceding chunks. It also holds per chunk summaries: the channels
+ * which change within a logic chunk, its first and last sample, and
+ * the minimum and maximum of analog chunks.
+ */
+
+/* A member which was written, kept for the central directory. */
+struct zip_entry {
+	char *name;
+	uint16_t method;
+	uint32_t crc;
+	uint32_t comp_size;
+	uint32_t size;
+	uint64_t offset;
+};
+
+/* A member's data, and its compressed form. */
+struct zip_member {
+	const char *name;
+	const uint8_t *data;
+	size_t size;
+	uint8_t *comp;
+	size_t comp_size;
+	uint16_t method;
+	uint32_t crc;
+};
+
+/* A sample data chunk which gets compressed by the worker pool. */
+struct zip_job {
+	struct zip_member m;
+	char *name;
+	uint8_t *buf;
+	int ret;
+	gboolean done;
+};
+
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	int comp_method;
+	uint32_t comp_level;
+	guint threads;
+	GThreadPool *pool;
+	GMutex job_mutex;
+	GCond job_cond;
+	GQueue *jobs;
+	GSList *free_bufs;
+	FILE *file;
+	uint64_t file_pos;
+	GArray *entries;
+	uint16_t dos_time;
+	uint16_t dos_date;
+	GKeyFile *meta;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -42,37 +144,497 @@ struct out_context {
 		size_t alloc_size;
 		uint8_t *samples;
 		size_t fill_size;
+		unsigned int chunk_num;
+		GArray *chunk_samples;
+		GByteArray *chunk_summary;
 	} logic_buff;
 	struct analog_buff {
 		size_t alloc_size;
 		float *samples;
 		size_t fill_size;
+		unsigned int chunk_num;
+		GArray *chunk_samples;
+		GArray *chunk_min;
+		GArray *chunk_max;
 	} *analog_buff;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
-
-	(void)options;
+	const char *s;
+	int method;
+	uint32_t level, threads;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	s = g_variant_get_string(g_hash_table_lookup(options, "compression"), NULL);
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "level"));
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+	if (!strcmp(s, "deflate")) {
+		method = ZIP_METHOD_DEFLATE;
+		if (level > Z_BEST_COMPRESSION) {
+			sr_err("Compression level %" PRIu32 " out of range.", level);
+			return SR_ERR_ARG;
+		}
+	} else if (!strcmp(s, "store")) {
+		method = ZIP_METHOD_STORE;
+		level = 0;
+#ifdef HAVE_LIBZSTD
+	} else if (!strcmp(s, "zstd")) {
+		method = ZIP_METHOD_ZSTD;
+		if (level > (uint32_t)ZSTD_maxCLevel()) {
+			sr_err("Compression level %" PRIu32 " out of range.", level);
+			return SR_ERR_ARG;
+		}
+#endif
+	} else {
+		sr_err("Unknown compression method '%s'.", s);
+		return SR_ERR_ARG;
+	}
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->comp_method = method;
+	outc->comp_level = level;
+	outc->threads = threads ? threads : (guint)g_get_num_processors();
+	g_mutex_init(&outc->job_mutex);
+	g_cond_init(&outc->job_cond);
+	outc->jobs = g_queue_new();
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+/* Give up an incomplete archive, remove the output file. */
+static void zip_discard_file(struct out_context *outc)
+{
+	if (!outc->file)
+		return;
+	fclose(outc->file);
+	outc->file = NULL;
+	g_unlink(outc->filename);
+}
+
+static int zip_write(struct out_context *outc, const void *buf, size_t length)
+{
+	if (fwrite(buf, 1, length, outc->file) != length) {
+		sr_err("Cannot write '%s': %s", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->file_pos += length;
+
+	return SR_OK;
+}
+
+/*
+ * Compress a member's data, and determine its checksum. Data which
+ * does not shrink gets stored.
+ */
+static int zip_compress(struct zip_member *m, int method, uint32_t level)
+{
+	z_stream zs;
+	int zret;
+#ifdef HAVE_LIBZSTD
+	size_t ret;
+#endif
+
+	m->crc = crc32(0L, m->data, m->size);
+	m->method = ZIP_METHOD_STORE;
+	m->comp = NULL;
+	m->comp_size = m->size;
+	if (method == ZIP_METHOD_STORE || !m->size)
+		return SR_OK;
+
+	m->comp = g_try_malloc(m->size);
+	if (!m->comp)
+		return SR_ERR_MALLOC;
+#ifdef HAVE_LIBZSTD
+	if (method == ZIP_METHOD_ZSTD) {
+		ret = ZSTD_compress(m->comp, m->size, m->data, m->size,
+			level ? (int)level : ZSTD_CLEVEL_DEFAULT);
+		if (!ZSTD_isError(ret)) {
+			m->method = ZIP_METHOD_ZSTD;
+			m->comp_size = ret;
+		} else {
+			/* Data does not shrink, or compression failed. */
+			g_free(m->comp);
+			m->comp = NULL;
+		}
+		return SR_OK;
+	}
+#endif
+	memset(&zs, 0, sizeof(zs));
+	zret = deflateInit2(&zs, level ? (int)level : Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	if (zret != Z_OK) {
+		g_free(m->comp);
+		m->comp = NULL;
+		return SR_ERR_MALLOC;
+	}
+	zs.next_in = (Bytef *)m->data;
+	zs.avail_in = m->size;
+	zs.next_out = m->comp;
+	zs.avail_out = m->size;
+	zret = deflate(&zs, Z_FINISH);
+	if (zret == Z_STREAM_END) {
+		m->method = ZIP_METHOD_DEFLATE;
+		m->comp_size = zs.total_out;
+	} else {
+		/* No space left in the output buffer, data does not shrink. */
+		g_free(m->comp);
+		m->comp = NULL;
+	}
+	deflateEnd(&zs);
+
+	return SR_OK;
+}
+
+/* The version needed to extract a member. */
+static uint16_t zip_version(uint16_t method, gboolean zip64)
+{
+	if (method == ZIP_METHOD_ZSTD)
+		return ZIP_VERSION_ZSTD;
+
+	return zip64 ? ZIP_VERSION_ZIP64 : ZIP_VERSION;
+}
+
+/* Write a member's local header and data, keep its directory entry. */
+static int zip_write_member(struct out_context *outc,
+	const struct zip_member *m)
+{
+	struct zip_entry entry;
+	uint8_t hdr[ZIP_LOCAL_SIZE], *p;
+	size_t namelen;
+	int ret;
+
+	namelen = strlen(m->name);
+	entry.name = g_strdup(m->name);
+	entry.method = m->method;
+	entry.crc = m->crc;
+	entry.comp_size = m->comp_size;
+	entry.size = m->size;
+	entry.offset = outc->file_pos;
+
+	p = hdr;
+	write_u32le_inc(&p, ZIP_SIG_LOCAL);
+	write_u16le_inc(&p, zip_version(entry.method, FALSE));
+	write_u16le_inc(&p, 0);
+	write_u16le_inc(&p, entry.method);
+	write_u16le_inc(&p, outc->dos_time);
+	write_u16le_inc(&p, outc->dos_date);
+	write_u32le_inc(&p, entry.crc);
+	write_u32le_inc(&p, entry.comp_size);
+	write_u32le_inc(&p, entry.size);
+	write_u16le_inc(&p, namelen);
+	write_u16le_inc(&p, 0);
+
+	ret = zip_write(outc, hdr, sizeof(hdr));
+	if (ret == SR_OK)
+		ret = zip_write(outc, m->name, namelen);
+	if (ret == SR_OK)
+		ret = zip_write(outc, m->comp ? m->comp : m->data, m->comp_size);
+	if (ret != SR_OK) {
+		g_free(entry.name);
+		return ret;
+	}
+	g_array_append_val(outc->entries, entry);
+
+	return SR_OK;
+}
+
+/* Return a job's chunk buffer to the free list, release the job. */
+static void zip_job_free(struct out_context *outc, struct zip_job *job)
+{
+	outc->free_bufs = g_slist_prepend(outc->free_bufs, job->buf);
+	g_free(job->m.comp);
+	g_free(job->name);
+	g_free(job);
+}
+
+/* Worker pool routine, compresses a chunk. */
+static void zip_compress_job(gpointer data, gpointer user_data)
+{
+	struct zip_job *job;
+	struct out_context *outc;
+	int ret;
+
+	job = data;
+	outc = user_data;
+	ret = zip_compress(&job->m, outc->comp_method, outc->comp_level);
+
+	g_mutex_lock(&outc->job_mutex);
+	job->ret = ret;
+	job->done = TRUE;
+	g_cond_broadcast(&outc->job_cond);
+	g_mutex_unlock(&outc->job_mutex);
+}
+
+/*
+ * Write completed jobs to the archive, in the order they were queued.
+ * Waits for the oldest job while more than max_jobs are pending. A
+ * failed job discards the archive, later jobs just get released.
+ */
+static int zip_write_jobs(struct out_context *outc, guint max_jobs)
+{
+	struct zip_job *job;
+	int ret;
+
+	ret = SR_OK;
+	for (;;) {
+		g_mutex_lock(&outc->job_mutex);
+		job = g_queue_peek_head(outc->jobs);
+		while (job && !job->done && outc->jobs->length > max_jobs)
+			g_cond_wait(&outc->job_cond, &outc->job_mutex);
+		if (!job || !job->done) {
+			g_mutex_unlock(&outc->job_mutex);
+			break;
+		}
+		g_queue_pop_head(outc->jobs);
+		g_mutex_unlock(&outc->job_mutex);
+
+		if (ret == SR_OK && outc->file) {
+			ret = job->ret;
+			if (ret == SR_OK)
+				ret = zip_write_member(outc, &job->m);
+			if (ret != SR_OK) {
+				sr_err("Failed to add '%s' to the archive.",
+					job->name);
+				zip_discard_file(outc);
+			}
+		}
+		zip_job_free(outc, job);
+	}
+
+	return ret;
+}
+
+/* Take a chunk buffer from the free list, or allocate another one. */
+static void *zip_chunk_buf_get(struct out_context *outc)
+{
+	void *buf;
+
+	if (!outc->free_bufs)
+		return g_try_malloc(CHUNK_SIZE);
+	buf = outc->free_bufs->data;
+	outc->free_bufs = g_slist_delete_link(outc->free_bufs, outc->free_bufs);
+
+	return buf;
+}
+
+/**
+ * Add a sample data chunk to the srzip archive.
+ *
+ * The chunk gets compressed by the worker pool, and is written after
+ * all earlier chunks were written. Takes ownership of the chunk buffer,
+ * which must have a size of CHUNK_SIZE bytes.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name The archive entry name.
+ * @param[in] buf The chunk's data.
+ * @param[in] length The chunk's length in bytes.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_chunk(const struct sr_output *o,
+	const char *name, void *buf, size_t length)
+{
+	struct out_context *outc;
+	struct zip_job *job;
+
+	outc = o->priv;
+	job = g_malloc0(sizeof(*job));
+	job->name = g_strdup(name);
+	job->buf = buf;
+	job->m.name = job->name;
+	job->m.data = job->buf;
+	job->m.size = length;
+	if (!outc->file) {
+		zip_job_free(outc, job);
+		return SR_ERR_BUG;
+	}
+
+	g_mutex_lock(&outc->job_mutex);
+	g_queue_push_tail(outc->jobs, job);
+	g_mutex_unlock(&outc->job_mutex);
+	if (outc->pool)
+		g_thread_pool_push(outc->pool, job, NULL);
+	else
+		zip_compress_job(job, outc);
+
+	return zip_write_jobs(outc, 2 * outc->threads);
+}
+
+/**
+ * Add a member to the srzip archive.
+ *
+ * The data gets compressed, and is written to the output file.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name The archive entry name.
+ * @param[in] buf The member's data.
+ * @param[in] length The member's length in bytes.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add(const struct sr_output *o,
+	const char *name, const void *buf, size_t length)
+{
+	struct out_context *outc;
+	struct zip_member m;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->file)
+		return SR_ERR_BUG;
+
+	/* Keep the member order, write pending chunks first. */
+	ret = zip_write_jobs(outc, 0);
+	if (ret != SR_OK)
+		return ret;
+
+	memset(&m, 0, sizeof(m));
+	m.name = name;
+	m.data = buf;
+	m.size = length;
+	ret = zip_compress(&m, outc->comp_method, outc->comp_level);
+	if (ret == SR_OK)
+		ret = zip_write_member(outc, &m);
+	g_free(m.comp);
+	if (ret != SR_OK)
+		sr_err("Failed to add '%s' to the archive.", name);
+
+	return ret;
+}
+
+/*
+ * Write the central directory, and the end of central directory record.
+ * The ZIP64 records get added when the member count or an offset do not
+ * fit the original fields.
+ */
+static int zip_write_directory(struct out_context *outc)
+{
+	const struct zip_entry *entry;
+	GByteArray *dir;
+	uint8_t hdr[ZIP_CENTRAL_SIZE + 12], *p;
+	uint64_t dir_offset, dir_size, count;
+	size_t namelen, extralen;
+	gboolean zip64;
+	guint i;
+	int ret;
+
+	dir_offset = outc->file_pos;
+	count = outc->entries->len;
+	dir = g_byte_array_new();
+	for (i = 0; i < outc->entries->len; i++) {
+		entry = &g_array_index(outc->entries, struct zip_entry, i);
+		namelen = strlen(entry->name);
+		zip64 = entry->offset >= ZIP_MAX32;
+		extralen = zip64 ? 12 : 0;
+		p = hdr;
+		write_u32le_inc(&p, ZIP_SIG_CENTRAL);
+		write_u16le_inc(&p, ZIP_MADE_BY_UNIX |
+			zip_version(entry->method, zip64));
+		write_u16le_inc(&p, zip_version(entry->method, zip64));
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, entry->method);
+		write_u16le_inc(&p, outc->dos_time);
+		write_u16le_inc(&p, outc->dos_date);
+		write_u32le_inc(&p, entry->crc);
+		write_u32le_inc(&p, entry->comp_size);
+		write_u32le_inc(&p, entry->size);
+		write_u16le_inc(&p, namelen);
+		write_u16le_inc(&p, extralen);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, 0);
+		write_u16le_inc(&p, 0);
+		/* Regular file, rw-r--r-- permissions. */
+		write_u32le_inc(&p, 0100644U << 16);
+		write_u32le_inc(&p, zip64 ? ZIP_MAX32 : entry->offset);
+		g_byte_array_append(dir, hdr, ZIP_CENTRAL_SIZE);
+		g_byte_array_append(dir, (const guint8 *)entry->name, namelen);
+		if (zip64) {
+			p = hdr;
+			write_u16le_inc(&p, ZIP_EXTRA_ZIP64);
+			write_u16le_inc(&p, 8);
+			write_u64le_inc(&p, entry->offset);
+			g_byte_array_append(dir, hdr, extralen);
+		}
+	}
+	dir_size = dir->len;
+	zip64 = count >= ZIP_MAX16 || dir_offset >= ZIP_MAX32 ||
+		dir_size >= ZIP_MAX32;
+	if (zip64) {
+		p = hdr;
+		write_u32le_inc(&p, ZIP_SIG_END64);
+		write_u64le_inc(&p, ZIP_END64_SIZE - 12);
+		write_u16le_inc(&p, ZIP_MADE_BY_UNIX | ZIP_VERSION_ZIP64);
+		write_u16le_inc(&p, ZIP_VERSION_ZIP64);
+		write_u32le_inc(&p, 0);
+		write_u32le_inc(&p, 0);
+		write_u64le_inc(&p, count);
+		write_u64le_inc(&p, count);
+		write_u64le_inc(&p, dir_size);
+		write_u64le_inc(&p, dir_offset);
+		g_byte_array_append(dir, hdr, ZIP_END64_SIZE);
+		p = hdr;
+		write_u32le_inc(&p, ZIP_SIG_LOCATOR64);
+		write_u32le_inc(&p, 0);
+		write_u64le_inc(&p, dir_offset + dir_size);
+		write_u32le_inc(&p, 1);
+		g_byte_array_append(dir, hdr, ZIP_LOCATOR64_SIZE);
+	}
+	p = hdr;
+	write_u32le_inc(&p, ZIP_SIG_END);
+	write_u16le_inc(&p, 0);
+	write_u16le_inc(&p, 0);
+	write_u16le_inc(&p, MIN(count, ZIP_MAX16));
+	write_u16le_inc(&p, MIN(count, ZIP_MAX16));
+	write_u32le_inc(&p, MIN(dir_size, ZIP_MAX32));
+	write_u32le_inc(&p, MIN(dir_offset, ZIP_MAX32));
+	write_u16le_inc(&p, 0);
+	g_byte_array_append(dir, hdr, ZIP_END_SIZE);
+
+	ret = zip_write(outc, dir->data, dir->len);
+	g_byte_array_free(dir, TRUE);
+
+	return ret;
+}
+
+static void zip_entries_free(struct out_context *outc)
+{
+	guint i;
+
+	if (!outc->entries)
+		return;
+	for (i = 0; i < outc->entries->len; i++)
+		g_free(g_array_index(outc->entries, struct zip_entry, i).name);
+	g_array_free(outc->entries, TRUE);
+	outc->entries = NULL;
+}
+
+/* Members carry the archive's creation time, in MS-DOS format. */
+static void zip_set_time(struct out_context *outc)
+{
+	GDateTime *now;
+
+	now = g_date_time_new_now_local();
+	outc->dos_time = g_date_time_get_hour(now) << 11 |
+		g_date_time_get_minute(now) << 5 |
+		g_date_time_get_second(now) / 2;
+	outc->dos_date = MAX(g_date_time_get_year(now) - 1980, 0) << 9 |
+		g_date_time_get_month(now) << 5 |
+		g_date_time_get_day_of_month(now);
+	g_date_time_unref(now);
+}
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
-	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
@@ -80,8 +642,8 @@ static int zip_create(const struct sr_output *o)
 	GKeyFile *meta;
 	GSList *l;
 	const char *devgroup;
-	char *s, *metabuf;
-	gsize metalen;
+	char *s;
+	int ret;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
@@ -94,20 +656,27 @@ static int zip_create(const struct sr_output *o)
 		g_variant_unref(gvar);
 	}
 
-	/* Quietly delete it first, libzip wants replace ops otherwise. */
-	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
-		return SR_ERR;
+	outc->file = g_fopen(outc->filename, "wb");
+	if (!outc->file) {
+		sr_err("Cannot create '%s': %s", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->file_pos = 0;
+	outc->entries = g_array_new(FALSE, FALSE, sizeof(struct zip_entry));
+	zip_set_time(outc);
+	outc->pool = g_thread_pool_new(zip_compress_job, outc,
+		outc->threads, FALSE, NULL);
+	if (!outc->pool)
+		sr_warn("Cannot create compression threads, compressing inline.");
+	else
+		sr_dbg("Compressing chunks on %u threads.", outc->threads);
 
 	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_add(zipfile, "version", versrc) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
-		return SR_ERR;
+	ret = zip_add(o, "version", "2", 1);
+	if (ret != SR_OK) {
+		zip_discard_file(outc);
+		return ret;
 	}
 
 	/* init "metadata" */
@@ -209,11 +778,13 @@ static int zip_create(const struct sr_output *o)
 	outc->logic_buff.unit_size /= 8;
 	outc->logic_buff.samples = g_try_malloc0(alloc_size);
 	if (!outc->logic_buff.samples)
-		return SR_ERR_MALLOC;
+		goto err_malloc;
 	if (outc->logic_buff.unit_size)
 		alloc_size /= outc->logic_buff.unit_size;
 	outc->logic_buff.alloc_size = alloc_size;
 	outc->logic_buff.fill_size = 0;
+	outc->logic_buff.chunk_samples = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+	outc->logic_buff.chunk_summary = g_byte_array_new();
 
 	alloc_size = sizeof(outc->analog_buff[0]) * outc->analog_ch_count + 1;
 	outc->analog_buff = g_malloc0(alloc_size);
@@ -221,167 +792,291 @@ static int zip_create(const struct sr_output *o)
 		alloc_size = CHUNK_SIZE;
 		outc->analog_buff[index].samples = g_try_malloc0(alloc_size);
 		if (!outc->analog_buff[index].samples)
-			return SR_ERR_MALLOC;
+			goto err_malloc;
 		alloc_size /= sizeof(outc->analog_buff[0].samples[0]);
 		outc->analog_buff[index].alloc_size = alloc_size;
 		outc->analog_buff[index].fill_size = 0;
+		outc->analog_buff[index].chunk_samples = g_array_new(FALSE,
+			FALSE, sizeof(uint64_t));
+		outc->analog_buff[index].chunk_min = g_array_new(FALSE,
+			FALSE, sizeof(double));
+		outc->analog_buff[index].chunk_max = g_array_new(FALSE,
+			FALSE, sizeof(double));
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
+	/* The metadata gets written when the archive is closed. */
+	outc->meta = meta;
+
+	return SR_OK;
+
+err_malloc:
+	/* Buffers get released by cleanup(). */
 	g_key_file_free(meta);
+	zip_discard_file(outc);
+	return SR_ERR_MALLOC;
+}
 
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
-		sr_err("Error saving metadata into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(metasrc);
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+static void index_set_u64_list(GKeyFile *index, const char *group,
+	const char *key, const GArray *values)
+{
+	GString *s;
+	guint i;
+
+	s = g_string_sized_new(values->len * 8);
+	for (i = 0; i < values->len; i++) {
+		g_string_append_printf(s, "%" PRIu64 ";",
+			g_array_index(values, uint64_t, i));
 	}
+	g_key_file_set_value(index, group, key, s->str);
+	g_string_free(s, TRUE);
+}
 
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+static void index_set_hex_list(GKeyFile *index, const char *group,
+	const char *key, const GByteArray *summary, size_t unitsize,
+	size_t offset)
+{
+	GString *s;
+	size_t pos, i;
+
+	s = g_string_sized_new(summary->len);
+	for (pos = offset; pos < summary->len; pos += 3 * unitsize) {
+		for (i = 0; i < unitsize; i++)
+			g_string_append_printf(s, "%02x", summary->data[pos + i]);
+		g_string_append_c(s, ';');
 	}
-	g_free(metabuf);
+	g_key_file_set_value(index, group, key, s->str);
+	g_string_free(s, TRUE);
+}
 
-	return SR_OK;
+/**
+ * Create the content of the srzip archive's "index" entry.
+ *
+ * @param[in] o Output module instance.
+ * @param[out] length The index text's length.
+ *
+ * @returns The index text, or NULL when no chunks were written.
+ */
+static char *zip_create_index(const struct sr_output *o, gsize *length)
+{
+	struct out_context *outc;
+	struct logic_buff *lbuff;
+	struct analog_buff *abuff;
+	GKeyFile *index;
+	char *group, *text;
+	size_t idx, unitsize;
+	gboolean have_chunks;
+
+	outc = o->priv;
+	index = g_key_file_new();
+	have_chunks = FALSE;
+
+	lbuff = &outc->logic_buff;
+	if (lbuff->chunk_samples && lbuff->chunk_samples->len) {
+		unitsize = lbuff->unit_size;
+		group = "logic-1";
+		g_key_file_set_integer(index, group, "unitsize", unitsize);
+		index_set_u64_list(index, group, "samples", lbuff->chunk_samples);
+		index_set_hex_list(index, group, "changes",
+			lbuff->chunk_summary, unitsize, 0);
+		index_set_hex_list(index, group, "first",
+			lbuff->chunk_summary, unitsize, unitsize);
+		index_set_hex_list(index, group, "last",
+			lbuff->chunk_summary, unitsize, 2 * unitsize);
+		have_chunks = TRUE;
+	}
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
+		abuff = &outc->analog_buff[idx];
+		if (!abuff->chunk_samples || !abuff->chunk_samples->len)
+			continue;
+		group = g_strdup_printf("analog-1-%zu",
+			outc->first_analog_index + idx);
+		index_set_u64_list(index, group, "samples", abuff->chunk_samples);
+		g_key_file_set_double_list(index, group, "min",
+			(double *)abuff->chunk_min->data, abuff->chunk_min->len);
+		g_key_file_set_double_list(index, group, "max",
+			(double *)abuff->chunk_max->data, abuff->chunk_max->len);
+		g_free(group);
+		have_chunks = TRUE;
+	}
+
+	text = NULL;
+	if (have_chunks)
+		text = g_key_file_to_data(index, length, NULL);
+	g_key_file_free(index);
+
+	return text;
 }
 
 /**
- * Append a block of logic data to an srzip archive.
+ * Complete the srzip archive, and release the resources of the writer.
+ *
+ * Adds the index and the metadata, and writes the central directory.
  *
  * @param[in] o Output module instance.
- * @param[in] buf Logic data samples as byte sequence.
- * @param[in] unitsize Logic data unit size (bytes per sample).
- * @param[in] length Byte sequence length (in bytes, not samples).
  *
  * @returns SR_OK et al error codes.
  */
-static int zip_append(const struct sr_output *o,
-	uint8_t *buf, size_t unitsize, size_t length)
+static int zip_finish(const struct sr_output *o)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
-	char *chunkname;
-	unsigned int next_chunk_num;
-
-	if (!length)
-		return SR_OK;
+	char *indexbuf, *metabuf;
+	gsize metalen, indexlen;
+	int ret;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
+	if (!outc->file)
+		return SR_OK;
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
+	ret = SR_OK;
+	indexbuf = zip_create_index(o, &indexlen);
+	if (indexbuf)
+		ret = zip_add(o, "index", indexbuf, indexlen);
+	g_free(indexbuf);
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	if (ret == SR_OK)
+		ret = zip_add(o, "metadata", metabuf, metalen);
+	g_free(metabuf);
+	if (ret == SR_OK)
+		ret = zip_write_directory(outc);
+
+	if (ret == SR_OK && fclose(outc->file) != 0) {
+		sr_err("Cannot write '%s': %s", outc->filename,
+			g_strerror(errno));
+		g_unlink(outc->filename);
+		ret = SR_ERR_IO;
+	} else if (ret != SR_OK) {
+		zip_discard_file(outc);
 	}
+	outc->file = NULL;
+
+	zip_entries_free(outc);
+	g_key_file_free(outc->meta);
+	outc->meta = NULL;
+
+	return ret;
+}
+
+/**
+ * Determine the index summary of a logic data chunk.
+ *
+ * The summary consists of the bit mask of channels which change within
+ * the chunk, the chunk's first sample, and its last sample.
+ *
+ * @param[in] buf Logic data samples as byte sequence.
+ * @param[in] unitsize Logic data unit size (bytes per sample).
+ * @param[in] count Number of samples.
+ * @param[out] summary Space for three samples' worth of bytes.
+ */
+static void logic_chunk_summary(const uint8_t *buf, size_t unitsize,
+	size_t count, uint8_t *summary)
+{
+	uint64_t *acc_or, *acc_and, word;
+	uint8_t *all_or, *all_and;
+	size_t blocks, i, j, b, pos;
+
+	memset(summary, 0, 3 * unitsize);
+	if (!count)
+		return;
+	memcpy(&summary[unitsize], buf, unitsize);
+	memcpy(&summary[2 * unitsize], &buf[(count - 1) * unitsize], unitsize);
+
 	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
+	 * A channel changes within the chunk when its bit takes both
+	 * values, that is when the OR and the AND of all samples differ.
+	 * Eight samples span unitsize 64bit words, so the same word of
+	 * each such block holds the same bytes of the samples.
 	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
+	all_or = &summary[0];
+	all_and = g_malloc(unitsize);
+	memset(all_and, 0xff, unitsize);
+	blocks = count / 8;
+	if (blocks) {
+		acc_or = g_malloc0(unitsize * sizeof(uint64_t));
+		acc_and = g_malloc(unitsize * sizeof(uint64_t));
+		memset(acc_and, 0xff, unitsize * sizeof(uint64_t));
+		for (i = 0; i < blocks; i++) {
+			for (j = 0; j < unitsize; j++) {
+				memcpy(&word, &buf[(i * unitsize + j) * 8], 8);
+				acc_or[j] |= word;
+				acc_and[j] &= word;
+			}
 		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
+		for (j = 0; j < unitsize; j++) {
+			for (b = 0; b < 8; b++) {
+				pos = (j * 8 + b) % unitsize;
+				all_or[pos] |= ((uint8_t *)&acc_or[j])[b];
+				all_and[pos] &= ((uint8_t *)&acc_and[j])[b];
+			}
 		}
+		g_free(acc_or);
+		g_free(acc_and);
 	}
-	g_key_file_free(kf);
-
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+	for (i = blocks * 8; i < count; i++) {
+		for (b = 0; b < unitsize; b++) {
+			all_or[b] |= buf[i * unitsize + b];
+			all_and[b] &= buf[i * unitsize + b];
 		}
 	}
+	for (b = 0; b < unitsize; b++)
+		all_or[b] ^= all_and[b];
+	g_free(all_and);
+}
+
+/**
+ * Append the logic data buffer's content to an srzip archive.
+ *
+ * The buffer gets handed over, and is replaced by another one.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] unitsize Logic data unit size (bytes per sample).
+ * @param[in] length Byte sequence length (in bytes, not samples).
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append(const struct sr_output *o,
+	size_t unitsize, size_t length)
+{
+	struct out_context *outc;
+	GByteArray *summary;
+	char *chunkname;
+	uint64_t count;
+	uint8_t *buf, *next;
+	size_t pos;
+	int ret;
+
+	if (!length)
+		return SR_OK;
+
+	outc = o->priv;
+	buf = outc->logic_buff.samples;
+	next = zip_chunk_buf_get(outc);
+	if (!next)
+		return SR_ERR_MALLOC;
+
+	/* Add the unitsize field with the first chunk of logic data. */
+	if (!outc->logic_buff.chunk_num)
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize", unitsize);
 
 	if (length % unitsize != 0) {
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
+
+	/* Keep the chunk's index entry. */
+	count = length / unitsize;
+	g_array_append_val(outc->logic_buff.chunk_samples, count);
+	summary = outc->logic_buff.chunk_summary;
+	pos = summary->len;
+	g_byte_array_set_size(summary, pos + 3 * unitsize);
+	logic_chunk_summary(buf, unitsize, count, &summary->data[pos]);
+
+	outc->logic_buff.chunk_num++;
+	outc->logic_buff.samples = next;
+	chunkname = g_strdup_printf("logic-1-%u", outc->logic_buff.chunk_num);
+	ret = zip_add_chunk(o, chunkname, buf, length);
 	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	g_free(metabuf);
 
-	return SR_OK;
+	return ret;
 }
 
 /**
@@ -429,7 +1124,7 @@ static int zip_append_queue(const struct sr_output *o,
 			remain -= copy_size;
 		}
 		if (send_size && !remain) {
-			ret = zip_append(o, buff->samples, buff->unit_size,
+			ret = zip_append(o, buff->unit_size,
 				buff->fill_size * buff->unit_size);
 			if (ret != SR_OK)
 				return ret;
@@ -440,7 +1135,7 @@ static int zip_append_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append(o, buff->samples, buff->unit_size,
+		ret = zip_append(o, buff->unit_size,
 			buff->fill_size * buff->unit_size);
 		if (ret != SR_OK)
 			return ret;
@@ -451,80 +1146,108 @@ static int zip_append_queue(const struct sr_output *o,
 }
 
 /**
- * Append analog data of a channel to an srzip archive.
+ * Queue run-length encoded logic data for srzip archive writes.
+ *
+ * Expands the runs into the local buffer, without an intermediate copy
+ * of the complete sample data.
  *
  * @param[in] o Output module instance.
- * @param[in] values Sample data as array of floating point values.
- * @param[in] count Number of samples (float items, not bytes).
- * @param[in] ch_nr 1-based channel number.
+ * @param[in] rle Run-length encoded logic data.
  *
  * @returns SR_OK et al error codes.
  */
-static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+static int zip_append_queue_rle(const struct sr_output *o,
+	const struct sr_datafeed_logic_rle *rle)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
-	char *chunkname;
-	unsigned int next_chunk_num;
+	struct logic_buff *buff;
+	uint64_t run, send_size;
+	size_t remain, copy_size;
+	const uint8_t *value;
+	uint8_t *wrptr;
+	int ret;
 
 	outc = o->priv;
-
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
+	buff = &outc->logic_buff;
+	if (rle->num_runs && rle->unitsize != buff->unit_size) {
+		sr_warn("Unexpected unit size, discarding logic data.");
+		return SR_ERR_ARG;
 	}
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+	value = rle->values;
+	for (run = 0; run < rle->num_runs; run++) {
+		send_size = rle->counts[run];
+		while (send_size) {
+			remain = buff->alloc_size - buff->fill_size;
+			if (!remain) {
+				ret = zip_append(o, buff->unit_size,
+					buff->fill_size * buff->unit_size);
+				if (ret != SR_OK)
+					return ret;
+				buff->fill_size = 0;
+				remain = buff->alloc_size;
+			}
+			wrptr = &buff->samples[buff->fill_size * buff->unit_size];
+			copy_size = MIN(send_size, remain);
+			sr_logic_fill_repeat(wrptr, value,
+				buff->unit_size, copy_size);
+			buff->fill_size += copy_size;
+			send_size -= copy_size;
 		}
+		value += rle->unitsize;
 	}
 
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
+	return SR_OK;
+}
+
+/**
+ * Append the analog data buffer's content of a channel to an srzip archive.
+ *
+ * The buffer gets handed over, and is replaced by another one.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] buff The channel's buffer, provides the chunk counter.
+ * @param[in] count Number of samples (float items, not bytes).
+ * @param[in] ch_nr 1-based channel number.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_analog(const struct sr_output *o,
+	struct analog_buff *buff, size_t count, size_t ch_nr)
+{
+	char *chunkname;
+	uint64_t samples;
+	double min, max;
+	float *values, *next;
+	size_t i;
+	int ret;
+
+	values = buff->samples;
+	next = zip_chunk_buf_get(o->priv);
+	if (!next)
+		return SR_ERR_MALLOC;
+
+	/* Keep the chunk's index entry. */
+	min = count ? values[0] : 0.0;
+	max = min;
+	for (i = 1; i < count; i++) {
+		if (values[i] < min)
+			min = values[i];
+		if (values[i] > max)
+			max = values[i];
 	}
+	samples = count;
+	g_array_append_val(buff->chunk_samples, samples);
+	g_array_append_val(buff->chunk_min, min);
+	g_array_append_val(buff->chunk_max, max);
+
+	buff->chunk_num++;
+	buff->samples = next;
+	chunkname = g_strdup_printf("analog-1-%zu-%u", ch_nr, buff->chunk_num);
+	ret = zip_add_chunk(o, chunkname, values, sizeof(values[0]) * count);
 	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
-	}
-
-	g_free(basename);
 
-	return SR_OK;
+	return ret;
 }
 
 /**
@@ -556,8 +1279,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 			buff = &outc->analog_buff[idx];
 			if (!buff->fill_size)
 				continue;
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+			ret = zip_append_analog(o, buff, buff->fill_size, nr);
 			if (ret != SR_OK)
 				return ret;
 			buff->fill_size = 0;
@@ -609,8 +1331,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 			remain -= copy_size;
 		}
 		if (send_size && !remain) {
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+			ret = zip_append_analog(o, buff, buff->fill_size, nr);
 			if (ret != SR_OK) {
 				g_free(values);
 				return ret;
@@ -623,7 +1344,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
+		ret = zip_append_analog(o, buff, buff->fill_size, nr);
 		if (ret != SR_OK)
 			return ret;
 		buff->fill_size = 0;
@@ -669,6 +1390,16 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_LOGIC_RLE:
+		if (!outc->zip_created) {
+			if ((ret = zip_create(o)) != SR_OK)
+				return ret;
+			outc->zip_created = TRUE;
+		}
+		ret = zip_append_queue_rle(o, packet->payload);
+		if (ret != SR_OK)
+			return ret;
+		break;
 	case SR_DF_ANALOG:
 		if (!outc->zip_created) {
 			if ((ret = zip_create(o)) != SR_OK)
@@ -688,6 +1419,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			ret = zip_finish(o);
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -696,26 +1430,74 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"compression", "Compression", "Compression method of sample data", NULL, NULL},
+	{"level", "Compression level", "Compression level, 0 selects the method's default", NULL, NULL},
+	{"threads", "Threads", "Number of compression threads, 0 selects the number of processors", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("deflate")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("store")));
+#ifdef HAVE_LIBZSTD
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("zstd")));
+#endif
+		options[0].values = l;
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	}
+
 	return options;
 }
 
 static int cleanup(struct sr_output *o)
 {
 	struct out_context *outc;
+	struct zip_job *job;
 	size_t idx;
 
 	outc = o->priv;
 
+	/* Complete the archive when the session feed did not end. */
+	if (outc->file) {
+		zip_append_queue(o, NULL, 0, 0, TRUE);
+		zip_append_analog_queue(o, NULL, TRUE);
+		zip_finish(o);
+	}
+	zip_entries_free(outc);
+
+	/* Jobs remain after errors, wait for the workers to finish them. */
+	if (outc->pool)
+		g_thread_pool_free(outc->pool, FALSE, TRUE);
+	while ((job = g_queue_pop_head(outc->jobs)))
+		zip_job_free(outc, job);
+	g_queue_free(outc->jobs);
+	g_slist_free_full(outc->free_bufs, g_free);
+	g_mutex_clear(&outc->job_mutex);
+	g_cond_clear(&outc->job_cond);
+
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
-	for (idx = 0; idx < outc->analog_ch_count; idx++)
+	if (outc->logic_buff.chunk_samples)
+		g_array_free(outc->logic_buff.chunk_samples, TRUE);
+	if (outc->logic_buff.chunk_summary)
+		g_byte_array_free(outc->logic_buff.chunk_summary, TRUE);
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
 		g_free(outc->analog_buff[idx].samples);
+		if (outc->analog_buff[idx].chunk_samples)
+			g_array_free(outc->analog_buff[idx].chunk_samples, TRUE);
+		if (outc->analog_buff[idx].chunk_min)
+			g_array_free(outc->analog_buff[idx].chunk_min, TRUE);
+		if (outc->analog_buff[idx].chunk_max)
+			g_array_free(outc->analog_buff[idx].chunk_max, TRUE);
+	}
 	g_free(outc->analog_buff);
 
 	g_free(outc);
@@ -729,7 +1511,7 @@ SR_PRIV struct sr_output_module output_srzip = {
 	.name = "srzip",
 	.desc = "srzip session file format data",
 	.exts = (const char*[]){"sr", NULL},
-	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_RLE,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
@@ -47,7 +47,6 @@ struct vcd_channel_desc {
 	GString *name;
 	enum sr_channeltype type;
 	struct {
-		uint8_t logic;
 		double real;
 	} last;
 	uint64_t last_rcvd_snum;
@@ -72,7 +71,15 @@ struct context {
 	GList *vcd_queue_list;
 	GList *vcd_queue_last;
 	gboolean immediate_write;
+	/* Logic state, sized to the largest unit size seen so far. */
+	size_t logic_size;
 	uint8_t *last_logic;
+	uint8_t *logic_mask;
+	uint8_t *logic_diff;
+	struct vcd_channel_desc **logic_by_bit;
+	size_t logic_bit_count;
+	/* Text of the current packet, reused across packets. */
+	GString *text;
 };
 
 /*
@@ -171,18 +178,40 @@ static GString *vcd_identifier(size_t idx)
  * - Put the mandatory whitespace between real (or vector) values and
  *   the following identifier. No whitespace for single bit values.
  * - For real values callers need not specify "precision" nor the number
- *   of significant digits. The Verilog VCD spec specifically picked the
- *   "%.16g" format such that all bits of the internal presentation of
- *   the IEEE754 floating point value get communicated between the
- *   writer and the reader.
+ *   of significant digits. The Verilog VCD spec picked the "%.16g"
+ *   format such that all bits of the internal presentation of the
+ *   IEEE754 floating point value get communicated between the writer
+ *   and the reader. Values originate from single precision data here,
+ *   the shortest text which reads back as the same float serves the
+ *   same purpose and is much cheaper to generate. Note that this text
+ *   differs from what earlier versions wrote: a value of 0.1 used to
+ *   read "r0.1000000014901161", and now reads "r0.1". Readers still
+ *   get the identical single precision value.
+ * - Timestamps are integer multiples of the sample period for all but
+ *   odd samplerates, and get printed without floating point math then.
  */
 
-static void append_vcd_timestamp(GString *s, double ts, gboolean lf)
+static double snum_to_ts(struct context *ctx, uint64_t snum)
+{
+	double ts;
+
+	ts = (double)snum;
+	ts /= ctx->samplerate;
+	ts *= ctx->period;
+
+	return ts;
+}
+
+static void append_vcd_timestamp(GString *s, struct context *ctx,
+	uint64_t snum, gboolean lf)
 {
 
 	g_string_append_c(s, '\n');
 	g_string_append_c(s, '#');
-	g_string_append_printf(s, "%.0f", ts);
+	if (ctx->samplerate && ctx->period % ctx->samplerate == 0)
+		sr_gstring_append_u64(s, snum * (ctx->period / ctx->samplerate));
+	else
+		sr_gstring_append_fixed(s, snum_to_ts(ctx, snum), 0);
 	g_string_append_c(s, lf ? '\n' : ' ');
 }
 
@@ -190,16 +219,16 @@ static void format_vcd_value_bit(GString *s, uint8_t bit_value, GString *id)
 {
 
 	g_string_append_c(s, bit_value ? '1' : '0');
-	g_string_append(s, id->str);
+	g_string_append_len(s, id->str, id->len);
 }
 
-static void format_vcd_value_real(GString *s, double real_value, GString *id)
+static void format_vcd_value_real(GString *s, float real_value, GString *id)
 {
 
 	g_string_append_c(s, 'r');
-	g_string_append_printf(s, "%.16g", real_value);
+	sr_gstring_append_float(s, real_value);
 	g_string_append_c(s, ' ');
-	g_string_append(s, id->str);
+	g_string_append_len(s, id->str, id->len);
 }
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -210,6 +239,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	GSList *l;
 	size_t num_enabled, num_logic, num_analog, desc_idx;
 	struct vcd_channel_desc *desc;
+	size_t bit;
 
 	(void)options;
 
@@ -260,10 +290,10 @@ static int init(struct sr_output *o, GHashTable *options)
 		/*
 		 * Make sure to _not_ match next time, to have initial
 		 * values dumped when the first sample gets received.
+		 * (Logic channels get dumped for sample number 0.)
 		 */
 		if (desc->type == SR_CHANNEL_LOGIC && num_logic) {
 			num_logic--;
-			desc->last.logic = ~0;
 		} else if (desc->type == SR_CHANNEL_ANALOG && num_analog) {
 			num_analog--;
 			/* "Construct" NaN, avoid a compile time error. */
@@ -288,15 +318,34 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->immediate_write = TRUE;
 
 	/*
-	 * Keep a copy of the last logic data bitmap around. To avoid
-	 * iterating over individual bits when nothing in the set has
-	 * changed. The overhead of two byte array compares should
-	 * outweight the tenfold bit count compared to byte counts.
+	 * Map sample bit positions to logic channel descriptions. Value
+	 * changes get determined by XOR of the previous and the current
+	 * sample, masked by the bits of enabled logic channels. Only the
+	 * set bits of the result need to be looked at.
 	 */
-	alloc_size = (ctx->logic_count + 7) / 8;
-	ctx->last_logic = g_malloc0(alloc_size);
-	if (ctx->logic_count && !ctx->last_logic)
-		return SR_ERR_MALLOC;
+	ctx->logic_bit_count = 0;
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (ctx->logic_bit_count <= desc->index)
+			ctx->logic_bit_count = desc->index + 1;
+	}
+	alloc_size = sizeof(ctx->logic_by_bit[0]) * ctx->logic_bit_count;
+	ctx->logic_by_bit = g_malloc0(alloc_size);
+	ctx->logic_size = (ctx->logic_bit_count + 7) / 8;
+	ctx->last_logic = g_malloc0(ctx->logic_size);
+	ctx->logic_mask = g_malloc0(ctx->logic_size);
+	ctx->logic_diff = g_malloc0(ctx->logic_size);
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		bit = desc->index;
+		ctx->logic_by_bit[bit] = desc;
+		ctx->logic_mask[bit / 8] |= 1 << (bit % 8);
+	}
+	ctx->text = g_string_sized_new(512);
 
 	return SR_OK;
 }
@@ -415,26 +464,27 @@ static GString *gen_header(const struct sr_output *o)
 }
 
 /*
- * Gets called when a session feed packet was received. Either creates
- * a VCD file header (once in the output module's lifetime), or an empty
- * GString. Callers will append the text representation of sample data
- * to that string as needed.
+ * Gets called when a session feed packet was received. Writes the VCD
+ * file header to the sink, once in the output module's lifetime. Callers
+ * then append the text representation of sample data to the context's
+ * text buffer.
  */
-static GString *chk_header(const struct sr_output *o)
+static int chk_header(const struct sr_output *o, struct sr_output_sink *sink)
 {
 	struct context *ctx;
-	GString *s;
+	GString *header;
+	int ret;
 
 	ctx = o->priv;
+	if (ctx->header_done)
+		return SR_OK;
 
-	if (!ctx->header_done) {
-		ctx->header_done = TRUE;
-		s = gen_header(o);
-	} else {
-		s = g_string_sized_new(512);
-	}
+	ctx->header_done = TRUE;
+	header = gen_header(o);
+	ret = sr_output_sink_write_gstring(sink, header);
+	g_string_free(header, TRUE);
 
-	return s;
+	return ret;
 }
 
 /*
@@ -784,17 +834,6 @@ static GString *queue_value_text_prep(struct context *ctx)
 	return buff;
 }
 
-static double snum_to_ts(struct context *ctx, uint64_t snum)
-{
-	double ts;
-
-	ts = (double)snum;
-	ts /= ctx->samplerate;
-	ts *= ctx->period;
-
-	return ts;
-}
-
 /*
  * Unqueue one item of the VCD values queue which corresponds to one
  * sample number. Append all of the text to the passed in GString.
@@ -802,7 +841,6 @@ static double snum_to_ts(struct context *ctx, uint64_t snum)
 static int unqueue_item(struct context *ctx,
 	struct vcd_queue_item *item, GString *s)
 {
-	double ts;
 	GString *buff;
 	gboolean is_empty;
 
@@ -812,10 +850,9 @@ static int unqueue_item(struct context *ctx,
 	 * timestamp but no value changes, assuming this is the last
 	 * entry which corresponds to SR_DF_END.
 	 */
-	ts = snum_to_ts(ctx, item->samplenum);
 	buff = item->values;
 	is_empty = !buff || !buff->len || !buff->str || !*buff->str;
-	append_vcd_timestamp(s, ts, is_empty);
+	append_vcd_timestamp(s, ctx, item->samplenum, is_empty);
 	if (!is_empty)
 		g_string_append(s, buff->str);
 
@@ -979,32 +1016,117 @@ static int write_completed_changes(struct context *ctx, GString *out)
 	return SR_OK;
 }
 
+/*
+ * Grow the logic state to the unit size of received data. Bits beyond
+ * the enabled channels' positions are masked out, and are not checked.
+ */
+static void prep_logic_state(struct context *ctx, size_t unit_size)
+{
+	size_t old_size;
+
+	if (unit_size <= ctx->logic_size)
+		return;
+
+	old_size = ctx->logic_size;
+	ctx->last_logic = g_realloc(ctx->last_logic, unit_size);
+	ctx->logic_mask = g_realloc(ctx->logic_mask, unit_size);
+	ctx->logic_diff = g_realloc(ctx->logic_diff, unit_size);
+	memset(&ctx->last_logic[old_size], 0, unit_size - old_size);
+	memset(&ctx->logic_mask[old_size], 0, unit_size - old_size);
+	ctx->logic_size = unit_size;
+}
+
+/*
+ * Check one set of logic samples for value changes. Queue the changes,
+ * or immediately emit their text.
+ */
+static void process_logic_sample(struct context *ctx, const uint8_t *sample,
+	size_t unit_size, uint64_t snum_curr, GString *out)
+{
+	struct vcd_channel_desc *desc;
+	size_t byte_idx, bit_idx;
+	uint8_t diff, any_diff, curbit;
+	GString *s_val;
+
+	/*
+	 * Determine the changed channels' bits. Dump all channels' values
+	 * for the first sample.
+	 */
+	any_diff = 0;
+	for (byte_idx = 0; byte_idx < unit_size; byte_idx++) {
+		diff = ctx->logic_mask[byte_idx];
+		if (snum_curr != 0)
+			diff &= ctx->last_logic[byte_idx] ^ sample[byte_idx];
+		ctx->logic_diff[byte_idx] = diff;
+		any_diff |= diff;
+	}
+	memcpy(ctx->last_logic, sample, unit_size);
+	if (!any_diff)
+		return;
+
+	/*
+	 * Start or continue tracking that sample number.
+	 * Avoid string copies for logic-only setups.
+	 */
+	if (ctx->immediate_write) {
+		append_vcd_timestamp(out, ctx, snum_curr, FALSE);
+	} else {
+		queue_samplenum(ctx, snum_curr);
+	}
+
+	/* Iterate over the changed logic channels only. */
+	for (byte_idx = 0; byte_idx < unit_size; byte_idx++) {
+		diff = ctx->logic_diff[byte_idx];
+		for (bit_idx = byte_idx * 8; diff; bit_idx++, diff >>= 1) {
+			if (!(diff & 1))
+				continue;
+			desc = ctx->logic_by_bit[bit_idx];
+			curbit = (sample[byte_idx] >> (bit_idx % 8)) & 1;
+
+			/*
+			 * Queue, or immediately emit the text for
+			 * the observed value change.
+			 */
+			if (ctx->immediate_write) {
+				g_string_append_c(out, ' ');
+				s_val = out;
+			} else {
+				s_val = queue_value_text_prep(ctx);
+				if (!s_val)
+					return;
+			}
+			format_vcd_value_bit(s_val, curbit, desc->name);
+		}
+	}
+}
+
 /* Get packets from the session feed, generate output text. */
 static int receive(const struct sr_output *o,
-	const struct sr_datafeed_packet *packet, GString **out)
+	const struct sr_datafeed_packet *packet, struct sr_output_sink *sink)
 {
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *logic_rle;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size, skip;
 	gboolean changed;
-	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	GString *out, *s_val;
+	uint8_t *sample;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
-	double ts;
 
-	*out = NULL;
 	if (!o || !o->priv)
 		return SR_ERR_BUG;
 	ctx = o->priv;
+	out = ctx->text;
+	g_string_truncate(out, 0);
 
 	switch (packet->type) {
 	case SR_DF_META:
@@ -1017,7 +1139,8 @@ static int receive(const struct sr_output *o,
 		}
 		break;
 	case SR_DF_LOGIC:
-		*out = chk_header(o);
+		if ((rc = chk_header(o, sink)) != SR_OK)
+			return rc;
 
 		logic = packet->payload;
 		sample = logic->data;
@@ -1025,74 +1148,56 @@ static int receive(const struct sr_output *o,
 		count = logic->length / unit_size;
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
+		prep_logic_state(ctx, unit_size);
 
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
+		/*
+		 * Skip runs of unchanged samples in bulk, only inspect
+		 * the samples which differ from their predecessor.
+		 */
+		while (count) {
+			if (snum_curr != 0) {
+				skip = sr_logic_find_change(sample, count,
+					unit_size, ctx->last_logic);
+				snum_curr += skip;
+				sample += skip * unit_size;
+				count -= skip;
+				if (!count)
+					break;
 			}
-
-			/* Advance to next set of logic samples. */
+			process_logic_sample(ctx, sample, unit_size,
+				snum_curr, out);
 			snum_curr++;
 			sample += unit_size;
+			count--;
+		}
+		write_completed_changes(ctx, out);
+		break;
+	case SR_DF_LOGIC_RLE:
+		if ((rc = chk_header(o, sink)) != SR_OK)
+			return rc;
+
+		/*
+		 * Value changes only can occur at the start of a run.
+		 * Check the first sample of each run, and skip over the
+		 * run's repetitions.
+		 */
+		logic_rle = packet->payload;
+		sample = logic_rle->values;
+		unit_size = logic_rle->unitsize;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, sr_logic_rle_sample_count(logic_rle));
+		prep_logic_state(ctx, unit_size);
+		for (run = 0; run < logic_rle->num_runs; run++) {
+			process_logic_sample(ctx, sample, unit_size,
+				snum_curr, out);
+			snum_curr += logic_rle->counts[run];
+			sample += unit_size;
 		}
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_ANALOG:
-		*out = chk_header(o);
+		if ((rc = chk_header(o, sink)) != SR_OK)
+			return rc;
 
 		/*
 		 * This implementation expects one analog packet per
@@ -1149,9 +1254,9 @@ static int receive(const struct sr_output *o,
 
 			/* Queue, or emit the timestamp and the new value. */
 			if (ctx->immediate_write) {
-				ts = snum_to_ts(ctx, snum_curr + index);
-				append_vcd_timestamp(*out, ts, FALSE);
-				s_val = *out;
+				append_vcd_timestamp(out, ctx,
+					snum_curr + index, FALSE);
+				s_val = out;
 			} else {
 				queue_samplenum(ctx, snum_curr + index);
 				s_val = queue_value_text_prep(ctx);
@@ -1160,19 +1265,20 @@ static int receive(const struct sr_output *o,
 		}
 
 		g_free(floats);
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_END:
-		*out = chk_header(o);
+		if ((rc = chk_header(o, sink)) != SR_OK)
+			return rc;
 		/* Push the final timestamp as length indicator. */
 		snum_curr = get_max_snum_flush(ctx);
 		queue_samplenum(ctx, snum_curr);
 		/* Flush previously queued value changes. */
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	}
 
-	return SR_OK;
+	return sr_output_sink_write_gstring(sink, out);
 }
 
 static int cleanup(struct sr_output *o)
@@ -1198,6 +1304,11 @@ static int cleanup(struct sr_output *o)
 		g_string_free(desc->name, TRUE);
 	}
 	g_free(ctx->channels);
+	g_free(ctx->logic_by_bit);
+	g_free(ctx->last_logic);
+	g_free(ctx->logic_mask);
+	g_free(ctx->logic_diff);
+	g_string_free(ctx->text, TRUE);
 	g_free(ctx);
 
 	return SR_OK;
@@ -1208,9 +1319,9 @@ struct sr_output_module output_vcd = {
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE,
 	.options = NULL,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive,
 	.cleanup = cleanup,
 };
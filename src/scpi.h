@@ -80,6 +80,19 @@ struct scpi_command {
 	const char *string;
 };
 
+/**
+ * Receives a slice of a block response's data.
+ *
+ * @param data The received data.
+ * @param len Number of bytes in the slice.
+ * @param total Number of data bytes in the whole block.
+ * @param cb_data Opaque data which was passed to sr_scpi_get_block_cb().
+ *
+ * @return SR_OK to continue the transfer, other values abort it.
+ */
+typedef int (*sr_scpi_block_callback)(const uint8_t *data, size_t len,
+		size_t total, void *cb_data);
+
 struct sr_scpi_hw_info {
 	char *manufacturer;
 	char *model;
@@ -111,11 +124,43 @@ struct sr_scpi_dev_inst {
 	void *priv;
 	/* Only used for quirk workarounds, notably the Rigol DS1000 series. */
 	uint64_t firmware_version;
-	GMutex scpi_mutex;
+	GRecMutex scpi_mutex;
 	char *actual_channel_name;
 	gboolean no_opc_command;
 };
 
+/**
+ * A batch of SCPI commands whose responses are read back in order.
+ *
+ * On transports which carry a plain byte stream, all queued commands
+ * go out in a single write and the responses are parsed back-to-back
+ * from the input stream. Other transports send each query only after
+ * the previous response was read, so drivers can use the same code
+ * for every connection type. While responses are outstanding, the
+ * batch keeps the device locked against other threads.
+ */
+struct sr_scpi_batch {
+	struct sr_scpi_dev_inst *scpi;
+	gboolean pipelined;
+	/* Commands which have not been sent yet. */
+	GQueue *commands;
+	/* Number of sent queries whose response was not read yet. */
+	unsigned int pending;
+	/* Reading a response was started, message based transports. */
+	gboolean reading;
+	/* Stale input from before a reset, to be dropped. */
+	unsigned int discard_responses;
+	size_t discard_bytes;
+	/* Received bytes which were not consumed yet. */
+	GByteArray *rx;
+	/* Drop a block's line termination before the next response. */
+	gboolean skip_eol;
+	gboolean in_block;
+	size_t block_remaining;
+	/* The batch holds the device's mutex while responses are due. */
+	gboolean locked;
+};
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi));
 SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
@@ -160,10 +205,34 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_cb(struct sr_scpi_dev_inst *scpi,
+			const char *command, size_t unitsize,
+			sr_scpi_block_callback cb, void *cb_data);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
 
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi);
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch);
+SR_PRIV void sr_scpi_batch_reset(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+			const char *format, ...);
+SR_PRIV int sr_scpi_batch_add_query(struct sr_scpi_batch *batch,
+			const char *format, ...);
+SR_PRIV int sr_scpi_batch_flush(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+			char **scpi_response);
+SR_PRIV int sr_scpi_batch_get_int(struct sr_scpi_batch *batch,
+			int *scpi_response);
+SR_PRIV int sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+			float *scpi_response);
+SR_PRIV int sr_scpi_batch_block_begin(struct sr_scpi_batch *batch,
+			size_t *length);
+SR_PRIV int sr_scpi_batch_read_block(struct sr_scpi_batch *batch,
+			uint8_t *buf, size_t maxlen);
+SR_PRIV int sr_scpi_batch_get_block(struct sr_scpi_batch *batch,
+			GByteArray **scpi_response);
+
 SR_PRIV const char *sr_scpi_unquote_string(char *s);
 
 SR_PRIV const char *sr_vendor_alias(const char *raw_vendor);
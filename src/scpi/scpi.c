@@ -29,6 +29,8 @@
 
 #define SCPI_READ_RETRIES 100
 #define SCPI_READ_RETRY_TIMEOUT_US (10 * 1000)
+#define SCPI_BATCH_READ_SIZE 4096
+#define SCPI_BLOCK_SLICE_SIZE (64 * 1024)
 
 static const char *scpi_vendors[][2] = {
 	{ "Agilent Technologies", "Agilent" },
@@ -402,7 +404,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
  */
 SR_PRIV int sr_scpi_open(struct sr_scpi_dev_inst *scpi)
 {
-	g_mutex_init(&scpi->scpi_mutex);
+	g_rec_mutex_init(&scpi->scpi_mutex);
 
 	return scpi->open(scpi);
 }
@@ -475,9 +477,9 @@ SR_PRIV int sr_scpi_send(struct sr_scpi_dev_inst *scpi,
 	int ret;
 
 	va_start(args, format);
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_send_variadic(scpi, format, args);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 	va_end(args);
 
 	return ret;
@@ -497,9 +499,9 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_send_variadic(scpi, format, args);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -530,9 +532,9 @@ SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_read_data(scpi, buf, maxlen);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -554,9 +556,9 @@ SR_PRIV int sr_scpi_write_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_write_data(scpi, buf, maxlen);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -584,10 +586,10 @@ SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi)
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi->close(scpi);
-	g_mutex_unlock(&scpi->scpi_mutex);
-	g_mutex_clear(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_clear(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -666,9 +668,9 @@ SR_PRIV int sr_scpi_read_response(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_read_response(scpi, response, abs_timeout_us);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -678,9 +680,9 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_get_data(scpi, command, scpi_response);
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -962,79 +964,55 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 }
 
 /**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
+ * Send a SCPI command and read the header of a "definite length block"
+ * response, without mutex.
  *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
+ * SCPI protocol data blocks are preceeded with a length spec.
+ * The length spec consists of a '#' marker, one digit which
+ * specifies the character count of the length spec, and the
+ * respective number of characters which specify the data block's
+ * length. Raw data bytes follow (thus one must no longer assume
+ * that the received input stream would be an ASCIIZ string).
  *
  * @param[in] scpi Previously initialised SCPI device structure.
  * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
+ * @param[out] response Receives the data bytes which were read along
+ *             with the header.
+ * @param[in,out] timeout Absolute timeout in microseconds.
+ * @param[out] datalen The number of data bytes in the block.
  *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+ * @return SR_OK on success, SR_ERR* on failure.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+static int scpi_get_block_header(struct sr_scpi_dev_inst *scpi,
+		const char *command, GString *response, gint64 *timeout,
+		long *datalen)
 {
 	int ret;
-	GString* response;
-	gsize oldlen;
 	char buf[10];
 	long llen;
-	long datalen;
-	gint64 timeout;
-
-	*scpi_response = NULL;
-
-	g_mutex_lock(&scpi->scpi_mutex);
 
 	if (command)
-		if (scpi_send(scpi, command) != SR_OK) {
-			g_mutex_unlock(&scpi->scpi_mutex);
+		if (scpi_send(scpi, command) != SR_OK)
 			return SR_ERR;
-		}
 
-	if (sr_scpi_read_begin(scpi) != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+	if (sr_scpi_read_begin(scpi) != SR_OK)
 		return SR_ERR;
-	}
-
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
 
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+	*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
 
 	/* Get (the first chunk of) the response. */
 	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
+		ret = scpi_read_response(scpi, response, *timeout);
+		if (ret < 0)
 			return ret;
-		}
 	} while (response->len < 2);
 
 	/*
-	 * SCPI protocol data blocks are preceeded with a length spec.
-	 * The length spec consists of a '#' marker, one digit which
-	 * specifies the character count of the length spec, and the
-	 * respective number of characters which specify the data block's
-	 * length. Raw data bytes follow (thus one must no longer assume
-	 * that the received input stream would be an ASCIIZ string).
-	 *
 	 * Get the data block length, and strip off the length spec from
 	 * the input buffer, leaving just the data bytes.
 	 */
-	if (response->str[0] != '#') {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	if (response->str[0] != '#')
 		return SR_ERR_DATA;
-	}
 	buf[0] = response->str[1];
 	buf[1] = '\0';
 	ret = sr_atol(buf, &llen);
@@ -1060,66 +1038,1088 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
 		ret = SR_ERR_NA;
 	}
-	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+	if (ret != SR_OK)
+		return ret;
+
+	while (response->len < (unsigned long)(2 + llen)) {
+		ret = scpi_read_response(scpi, response, *timeout);
+		if (ret < 0)
+			return ret;
+	}
+
+	memcpy(buf, &response->str[2], llen);
+	buf[llen] = '\0';
+	ret = sr_atol(buf, datalen);
+	if (ret != SR_OK)
+		return ret;
+	if (*datalen < 0)
+		return SR_ERR_DATA;
+	g_string_erase(response, 0, 2 + llen);
+
+	return SR_OK;
+}
+
+/**
+ * Read the next part of a block's data into a caller provided buffer,
+ * without mutex. Data which was received along with the header is
+ * returned first.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in,out] pending Data bytes which were received before.
+ * @param[out] buf Buffer to store the data.
+ * @param[in] len Maximum number of bytes to read.
+ * @param[in,out] timeout Absolute timeout in microseconds.
+ *
+ * @return Number of bytes read (can be 0), or SR_ERR* upon failure.
+ */
+static int scpi_read_block_data(struct sr_scpi_dev_inst *scpi,
+		GString *pending, uint8_t *buf, size_t len, gint64 *timeout)
+{
+	int ret;
+
+	if (pending->len) {
+		len = MIN(len, pending->len);
+		memcpy(buf, pending->str, len);
+		g_string_erase(pending, 0, len);
+		return len;
+	}
+
+	ret = scpi_read_data(scpi, (char *)buf, MIN(len, G_MAXINT));
+	if (ret < 0) {
+		sr_err("Incompletely read SCPI response.");
+		return SR_ERR;
+	}
+
+	if (ret > 0) {
+		*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		return ret;
+	}
+
+	if (g_get_monotonic_time() > *timeout) {
+		sr_err("Timed out waiting for SCPI response.");
+		return SR_ERR_TIMEOUT;
+	}
+
+	return 0;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	int ret;
+	GString *response;
+	GByteArray *block;
+	long datalen;
+	size_t pos;
+	gint64 timeout;
+
+	*scpi_response = NULL;
+
+	g_rec_mutex_lock(&scpi->scpi_mutex);
+
+	response = g_string_sized_new(1024);
+	ret = scpi_get_block_header(scpi, command, response, &timeout,
+		&datalen);
+	if (ret != SR_OK || datalen == 0) {
+		g_rec_mutex_unlock(&scpi->scpi_mutex);
 		g_string_free(response, TRUE);
 		return ret;
 	}
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
+	/* The length is known now, receive the data in place. */
+	block = g_byte_array_sized_new(datalen);
+	g_byte_array_set_size(block, datalen);
+	pos = 0;
+	while (pos < (size_t)datalen) {
+		ret = scpi_read_block_data(scpi, response, block->data + pos,
+			datalen - pos, &timeout);
+		/* On timeout truncate the buffer and send the partial response
+		 * instead of getting stuck on timeouts...
+		 */
+		if (ret == SR_ERR_TIMEOUT) {
+			g_byte_array_set_size(block, pos);
+			break;
+		}
 		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
+			g_rec_mutex_unlock(&scpi->scpi_mutex);
 			g_string_free(response, TRUE);
+			g_byte_array_free(block, TRUE);
 			return ret;
 		}
+		pos += ret;
 	}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
+
+	g_string_free(response, TRUE);
+	*scpi_response = block;
+
+	return SR_OK;
+}
+
+/**
+ * Send a SCPI command, read the reply as a "definite length block", and
+ * pass the data to a callback while it is being received.
+ *
+ * The callback gets invoked for every received slice of data. Slices
+ * are multiples of unitsize, so that samples are never split across
+ * invocations. A trailing partial sample is dropped with a warning.
+ * The device stays locked against other threads for the whole block.
+ * The callback runs in the calling thread and may e.g. send session
+ * packets, but it must not access this device, the block is not
+ * complete yet.
+ *
+ * When the callback does not return SR_OK, the remainder of the block
+ * is read and discarded, to keep the connection in sync. On timeout,
+ * the complete samples received so far are passed on, and the block is
+ * considered complete, like sr_scpi_get_block() does.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in] unitsize Size of a sample in bytes, 1 if not applicable.
+ * @param[in] cb Callback which receives the data slices.
+ * @param[in] cb_data Opaque data which gets passed to the callback.
+ *
+ * @return SR_OK on success, the callback's return code when it aborted
+ *         the transfer, or SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_get_block_cb(struct sr_scpi_dev_inst *scpi,
+		const char *command, size_t unitsize,
+		sr_scpi_block_callback cb, void *cb_data)
+{
+	int ret, cb_ret;
+	GString *response;
+	uint8_t *slice;
+	long datalen;
+	size_t pos, fill, count, bufsize;
+	gboolean timed_out;
+	gint64 timeout;
+
+	if (!unitsize || unitsize > SCPI_BLOCK_SLICE_SIZE)
+		return SR_ERR_ARG;
+
+	g_rec_mutex_lock(&scpi->scpi_mutex);
+
+	response = g_string_sized_new(1024);
+	ret = scpi_get_block_header(scpi, command, response, &timeout,
+		&datalen);
+	if (ret != SR_OK || datalen == 0) {
+		g_rec_mutex_unlock(&scpi->scpi_mutex);
 		g_string_free(response, TRUE);
 		return ret;
 	}
-	g_string_erase(response, 0, 2 + llen);
 
+	bufsize = MIN((size_t)datalen, SCPI_BLOCK_SLICE_SIZE);
+	slice = g_malloc(bufsize);
+
+	pos = 0;
+	fill = 0;
+	cb_ret = SR_OK;
+	timed_out = FALSE;
+	while (pos < (size_t)datalen) {
+		ret = scpi_read_block_data(scpi, response, slice + fill,
+			MIN(bufsize - fill, datalen - pos), &timeout);
+		/* Pass on the partial response instead of getting stuck. */
+		if (ret == SR_ERR_TIMEOUT) {
+			timed_out = TRUE;
+			ret = SR_OK;
+		}
+		if (ret < 0)
+			break;
+		pos += ret;
+
+		/* Discard the remainder after the callback failed. */
+		if (cb_ret != SR_OK) {
+			if (timed_out)
+				break;
+			continue;
+		}
+		fill += ret;
+
+		/* Pass on complete samples, keep the rest for later. */
+		count = fill - fill % unitsize;
+		if (count) {
+			cb_ret = cb(slice, count, datalen, cb_data);
+			memmove(slice, slice + count, fill - count);
+			fill -= count;
+		}
+		if (timed_out)
+			break;
+	}
+	if (ret >= 0 && cb_ret == SR_OK && fill)
+		sr_warn("Dropping %zu bytes of an incomplete sample.", fill);
+
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
+
+	g_free(slice);
+	g_string_free(response, TRUE);
+
+	if (ret < 0)
+		return ret;
+
+	return cb_ret;
+}
+
+/**
+ * Create a batch of SCPI commands for a device.
+ *
+ * Commands are queued by sr_scpi_batch_add() and sent by
+ * sr_scpi_batch_flush(). The responses to the queued queries are then
+ * read in queue order by the sr_scpi_batch_get_*() and block routines.
+ * While responses are outstanding, the batch holds the device's mutex,
+ * so other threads which access the device wait until all responses
+ * were read. A batch must therefore only be used from a single thread.
+ * Callers which give up on a response must call sr_scpi_batch_reset().
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return The new batch, to be freed by sr_scpi_batch_free().
+ */
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi)
+{
+	struct sr_scpi_batch *batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->scpi = scpi;
 	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
+	 * Only raw TCP is a plain byte stream which accepts several
+	 * program messages in one write. Message based transports and
+	 * the length prefixed Rigol TCP framing expect one query at a
+	 * time, and get the commands sent one after another.
 	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
-
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
-
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
-				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
+	batch->pipelined = scpi->transport == SCPI_TRANSPORT_RAW_TCP;
+	batch->commands = g_queue_new();
+	batch->rx = g_byte_array_new();
+
+	return batch;
+}
+
+/* A queued command, newline terminated. */
+struct batch_command {
+	char *text;
+	gboolean query;
+};
+
+static void batch_command_free(void *data)
+{
+	struct batch_command *cmd;
+
+	cmd = data;
+	g_free(cmd->text);
+	g_free(cmd);
+}
+
+/**
+ * Free a batch, discarding commands which were not sent yet.
+ *
+ * @param batch The batch to free, can be NULL.
+ */
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch)
+{
+	if (!batch)
+		return;
+
+	if (batch->locked)
+		sr_scpi_batch_reset(batch);
+
+	g_queue_free_full(batch->commands, batch_command_free);
+	g_byte_array_free(batch->rx, TRUE);
+	g_free(batch);
+}
+
+/*
+ * Release the device's mutex after a batch operation, but keep the
+ * device locked while responses are outstanding, such that other
+ * threads cannot interleave their commands.
+ */
+static void batch_unlock(struct sr_scpi_batch *batch)
+{
+	gboolean busy;
+
+	busy = batch->pending || batch->in_block;
+	if (busy && !batch->locked)
+		g_rec_mutex_lock(&batch->scpi->scpi_mutex);
+	else if (!busy && batch->locked)
+		g_rec_mutex_unlock(&batch->scpi->scpi_mutex);
+	batch->locked = busy;
+
+	g_rec_mutex_unlock(&batch->scpi->scpi_mutex);
+}
+
+static int batch_add_variadic(struct sr_scpi_batch *batch, gboolean query,
+			      const char *format, va_list args)
+{
+	struct batch_command *cmd;
+	va_list args_copy;
+	char *buf;
+	int len;
+
+	va_copy(args_copy, args);
+	len = sr_vsnprintf_ascii(NULL, 0, format, args_copy);
+	va_end(args_copy);
+	if (len <= 0)
+		return SR_ERR;
+
+	buf = g_malloc0(len + 2);
+	sr_vsprintf_ascii(buf, format, args);
+	if (buf[len - 1] != '\n')
+		buf[len] = '\n';
+
+	cmd = g_malloc(sizeof(*cmd));
+	cmd->text = buf;
+	cmd->query = query;
+	g_queue_push_tail(batch->commands, cmd);
+
+	return SR_OK;
+}
+
+/**
+ * Queue a SCPI command which has no response.
+ *
+ * @param batch The batch to add the command to.
+ * @param format Format string, to be followed by any necessary arguments.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+			      const char *format, ...)
+{
+	va_list args;
+	int ret;
+
+	va_start(args, format);
+	ret = batch_add_variadic(batch, FALSE, format, args);
+	va_end(args);
+
+	return ret;
+}
+
+/**
+ * Queue a SCPI query. The caller must read its response once the batch
+ * was flushed.
+ *
+ * @param batch The batch to add the query to.
+ * @param format Format string, to be followed by any necessary arguments.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_batch_add_query(struct sr_scpi_batch *batch,
+				    const char *format, ...)
+{
+	va_list args;
+	int ret;
+
+	va_start(args, format);
+	ret = batch_add_variadic(batch, TRUE, format, args);
+	va_end(args);
+
+	return ret;
+}
+
+/* Send queued commands, without mutex. */
+static int batch_send(struct sr_scpi_batch *batch)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct batch_command *cmd;
+	GString *msg;
+	int ret;
+
+	scpi = batch->scpi;
+
+	if (batch->pipelined) {
+		if (g_queue_is_empty(batch->commands))
+			return SR_OK;
+		msg = g_string_sized_new(256);
+		while ((cmd = g_queue_pop_head(batch->commands))) {
+			if (cmd->query)
+				batch->pending++;
+			g_string_append(msg, cmd->text);
+			batch_command_free(cmd);
+		}
+		ret = scpi->send(scpi->priv, msg->str);
+		g_string_free(msg, TRUE);
+		return ret;
+	}
+
+	/* Send commands up to and including the next query. */
+	while (!batch->pending && (cmd = g_queue_pop_head(batch->commands))) {
+		if (cmd->query)
+			batch->pending++;
+		ret = scpi->send(scpi->priv, cmd->text);
+		batch_command_free(cmd);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Append the next chunk of input to the receive buffer, without mutex.
+ * Returns the number of bytes read, 0 when nothing was available yet.
+ */
+static int batch_read(struct sr_scpi_batch *batch, gint64 *timeout)
+{
+	struct sr_scpi_dev_inst *scpi;
+	guint oldlen;
+	int len;
+
+	scpi = batch->scpi;
+
+	if (!batch->pipelined && sr_scpi_read_complete(scpi)) {
+		sr_err("Incomplete SCPI response.");
+		return SR_ERR_DATA;
 	}
 
-	g_mutex_unlock(&scpi->scpi_mutex);
+	oldlen = batch->rx->len;
+	g_byte_array_set_size(batch->rx, oldlen + SCPI_BATCH_READ_SIZE);
+	len = scpi_read_data(scpi, (char *)batch->rx->data + oldlen,
+		SCPI_BATCH_READ_SIZE);
+	g_byte_array_set_size(batch->rx, oldlen + MAX(len, 0));
+
+	if (len < 0) {
+		sr_err("Incompletely read SCPI response.");
+		return SR_ERR;
+	}
+
+	if (len > 0) {
+		*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		return len;
+	}
+
+	if (g_get_monotonic_time() > *timeout) {
+		sr_err("Timed out waiting for SCPI response.");
+		return SR_ERR_TIMEOUT;
+	}
+
+	return 0;
+}
+
+/* Drop line termination which follows a previous response. */
+static void batch_skip_eol(struct sr_scpi_batch *batch)
+{
+	GByteArray *rx;
+	guint skip;
+
+	rx = batch->rx;
+	if (!batch->skip_eol)
+		return;
+	for (skip = 0; skip < rx->len; skip++) {
+		if (rx->data[skip] != '\r' && rx->data[skip] != '\n')
+			break;
+	}
+	g_byte_array_remove_range(rx, 0, skip);
+	if (rx->len)
+		batch->skip_eol = FALSE;
+}
+
+/*
+ * Consume the line termination of a block which was the last
+ * outstanding response, without mutex. Other users of the device
+ * must not receive it once the batch is idle.
+ */
+static void batch_drop_eol(struct sr_scpi_batch *batch)
+{
+	GByteArray *rx;
+	gint64 timeout;
+	guint skip;
+
+	rx = batch->rx;
+	timeout = g_get_monotonic_time() + batch->scpi->read_timeout_us;
+	while (batch->skip_eol) {
+		for (skip = 0; skip < rx->len; skip++) {
+			if (rx->data[skip] != '\r')
+				break;
+		}
+		if (skip < rx->len) {
+			if (rx->data[skip] == '\n')
+				skip++;
+			batch->skip_eol = FALSE;
+		}
+		g_byte_array_remove_range(rx, 0, skip);
+		if (batch->skip_eol && batch_read(batch, &timeout) < 0)
+			break;
+	}
+}
+
+/*
+ * Drop responses which were outstanding when the batch was reset,
+ * without mutex. A response is either a line of text, or a definite
+ * length block which can come with a header.
+ */
+static int batch_discard_stale(struct sr_scpi_batch *batch)
+{
+	struct sr_scpi_dev_inst *scpi;
+	GByteArray *rx;
+	guint8 *eol, *hash;
+	gint64 timeout;
+	char buf[10];
+	guint lim, pos, llen;
+	long datalen;
+	size_t len;
+	int ret;
+
+	scpi = batch->scpi;
+	rx = batch->rx;
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	if (!batch->pipelined) {
+		if (!batch->discard_responses)
+			return SR_OK;
+		if (!batch->reading) {
+			ret = sr_scpi_read_begin(scpi);
+			if (ret != SR_OK)
+				return ret;
+		}
+		while (!sr_scpi_read_complete(scpi)) {
+			ret = batch_read(batch, &timeout);
+			if (ret < 0)
+				return ret;
+			g_byte_array_set_size(rx, 0);
+		}
+		g_byte_array_set_size(rx, 0);
+		batch->reading = FALSE;
+		batch->discard_responses = 0;
+		return SR_OK;
+	}
+
+	while (batch->discard_bytes || batch->discard_responses) {
+		if (batch->discard_bytes) {
+			len = MIN(rx->len, batch->discard_bytes);
+			g_byte_array_remove_range(rx, 0, len);
+			batch->discard_bytes -= len;
+			if (!batch->discard_bytes) {
+				batch->skip_eol = TRUE;
+				continue;
+			}
+		} else {
+			batch_skip_eol(batch);
+			eol = batch->skip_eol ? NULL :
+				memchr(rx->data, '\n', rx->len);
+			lim = eol ? (guint)(eol - rx->data) : rx->len;
+			hash = memchr(rx->data, '#', lim);
+			pos = hash ? (guint)(hash - rx->data) : 0;
+			if (hash && pos + 1 < rx->len &&
+					g_ascii_isdigit(rx->data[pos + 1])) {
+				llen = rx->data[pos + 1] - '0';
+				if (!llen) {
+					sr_err("Cannot skip indefinite length block.");
+					return SR_ERR_NA;
+				}
+				if (rx->len >= pos + 2 + llen) {
+					memcpy(buf, &rx->data[pos + 2], llen);
+					buf[llen] = '\0';
+					if (sr_atol(buf, &datalen) != SR_OK ||
+							datalen < 0) {
+						sr_err("Invalid stale block length.");
+						return SR_ERR_DATA;
+					}
+					g_byte_array_remove_range(rx, 0,
+						pos + 2 + llen);
+					batch->discard_bytes = datalen;
+					batch->discard_responses--;
+					if (!datalen)
+						batch->skip_eol = TRUE;
+					continue;
+				}
+			} else if (eol) {
+				g_byte_array_remove_range(rx, 0, lim + 1);
+				batch->discard_responses--;
+				continue;
+			}
+		}
+		ret = batch_read(batch, &timeout);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (!batch->pending)
+		batch_drop_eol(batch);
+
+	return SR_OK;
+}
+
+/* Prepare for reading the next response, without mutex. */
+static int batch_response_begin(struct sr_scpi_batch *batch)
+{
+	int ret;
+
+	if (!batch->pending) {
+		ret = batch_send(batch);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	if (!batch->pending) {
+		sr_err("No SCPI query pending in batch.");
+		return SR_ERR;
+	}
+
+	ret = batch_discard_stale(batch);
+	if (ret != SR_OK)
+		return ret;
+
+	if (batch->pipelined)
+		return SR_OK;
+
+	ret = sr_scpi_read_begin(batch->scpi);
+	if (ret == SR_OK)
+		batch->reading = TRUE;
+
+	return ret;
+}
+
+/* Finish reading a response, without mutex. */
+static int batch_response_end(struct sr_scpi_batch *batch)
+{
+	batch->pending--;
+	batch->reading = FALSE;
+
+	if (batch->pipelined)
+		return SR_OK;
+
+	/* Each response is a message of its own, drop its remainder. */
+	g_byte_array_set_size(batch->rx, 0);
+
+	return batch_send(batch);
+}
+
+/**
+ * Return a batch to its initial state after an error.
+ *
+ * Commands which were not sent yet are discarded. Responses which are
+ * outstanding, including the remainder of a partially read block, are
+ * read and dropped, and the device gets unlocked. Use this on every
+ * error path which leaves responses unread. Responses which cannot be
+ * dropped now, e.g. after a timeout, get dropped before the response
+ * to the next query which is read from the batch.
+ *
+ * @param batch The batch to reset, can be NULL.
+ */
+SR_PRIV void sr_scpi_batch_reset(struct sr_scpi_batch *batch)
+{
+	struct batch_command *cmd;
+
+	if (!batch)
+		return;
+
+	g_rec_mutex_lock(&batch->scpi->scpi_mutex);
+
+	while ((cmd = g_queue_pop_head(batch->commands)))
+		batch_command_free(cmd);
+
+	if (!batch->pipelined) {
+		/* At most one response is in flight, as a message of its own. */
+		if (batch->pending || batch->in_block)
+			batch->discard_responses = 1;
+	} else if (batch->in_block) {
+		/* The block's query still counts as pending. */
+		batch->discard_bytes += batch->block_remaining;
+		batch->discard_responses += batch->pending - 1;
+	} else {
+		batch->discard_responses += batch->pending;
+	}
+	batch->pending = 0;
+	batch->in_block = FALSE;
+	batch->block_remaining = 0;
+
+	if (batch_discard_stale(batch) != SR_OK)
+		sr_warn("Cannot drop outstanding SCPI responses yet.");
+	batch_unlock(batch);
+}
+
+/**
+ * Send the queued commands.
+ *
+ * For pipelined transports all commands go out in a single write. Else
+ * the commands up to the first query are sent, the following ones are
+ * sent as the responses get read.
+ *
+ * @param batch The batch to flush.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_flush(struct sr_scpi_batch *batch)
+{
+	int ret;
+
+	g_rec_mutex_lock(&batch->scpi->scpi_mutex);
+	ret = batch_send(batch);
+	batch_unlock(batch);
+
+	return ret;
+}
+
+/**
+ * Read the response to the next query of a batch as a string.
+ *
+ * Callers must free the allocated memory regardless of the routine's
+ * return code. See @ref g_free().
+ *
+ * @param[in] batch The batch to read from.
+ * @param[out] scpi_response Pointer where to store the SCPI response.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+				      char **scpi_response)
+{
+	struct sr_scpi_dev_inst *scpi;
+	GByteArray *rx;
+	guint8 *eol;
+	gint64 timeout;
+	guint len, skip;
+	int ret;
+
+	*scpi_response = NULL;
+
+	scpi = batch->scpi;
+	rx = batch->rx;
+
+	g_rec_mutex_lock(&scpi->scpi_mutex);
+
+	ret = batch_response_begin(batch);
+	if (ret != SR_OK) {
+		batch_unlock(batch);
+		return ret;
+	}
+
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	while (TRUE) {
+		batch_skip_eol(batch);
+		if (!batch->skip_eol) {
+			eol = memchr(rx->data, '\n', rx->len);
+			if (eol) {
+				len = eol - rx->data;
+				skip = len + 1;
+				break;
+			}
+			/* Message based transports may omit the termination. */
+			if (!batch->pipelined && rx->len &&
+					sr_scpi_read_complete(scpi)) {
+				len = skip = rx->len;
+				break;
+			}
+		}
+		ret = batch_read(batch, &timeout);
+		if (ret < 0) {
+			batch_unlock(batch);
+			return ret;
+		}
+	}
+
+	if (len && rx->data[len - 1] == '\r')
+		len--;
+	*scpi_response = g_strndup((const char *)rx->data, len);
+	g_byte_array_remove_range(rx, 0, skip);
+
+	sr_spew("Got batch response: '%.70s', length %u.", *scpi_response, len);
+
+	ret = batch_response_end(batch);
+
+	batch_unlock(batch);
+
+	return ret;
+}
+
+/**
+ * Read the response to the next query of a batch as an integer.
+ *
+ * @param batch The batch to read from.
+ * @param scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_int(struct sr_scpi_batch *batch,
+				   int *scpi_response)
+{
+	int ret;
+	struct sr_rational ret_rational;
+	char *response;
+
+	ret = sr_scpi_batch_get_string(batch, &response);
+	if (ret != SR_OK) {
+		g_free(response);
+		return ret;
+	}
+
+	ret = sr_parse_rational(response, &ret_rational);
+	if (ret == SR_OK && (ret_rational.p % ret_rational.q) == 0) {
+		*scpi_response = ret_rational.p / ret_rational.q;
+	} else {
+		sr_dbg("get_int: non-integer rational=%" PRId64 "/%" PRIu64,
+			ret_rational.p, ret_rational.q);
+		ret = SR_ERR_DATA;
+	}
+
+	g_free(response);
+
+	return ret;
+}
+
+/**
+ * Read the response to the next query of a batch as a float.
+ *
+ * @param batch The batch to read from.
+ * @param scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+				     float *scpi_response)
+{
+	int ret;
+	char *response;
+
+	ret = sr_scpi_batch_get_string(batch, &response);
+	if (ret != SR_OK) {
+		g_free(response);
+		return ret;
+	}
+
+	if (sr_atof_ascii(response, scpi_response) != SR_OK)
+		ret = SR_ERR_DATA;
+
+	g_free(response);
+
+	return ret;
+}
+
+/* Finish a block response, without mutex. */
+static int batch_block_end(struct sr_scpi_batch *batch)
+{
+	gint64 timeout;
+
+	batch->in_block = FALSE;
+	batch->skip_eol = TRUE;
+
+	/* Consume the termination which follows the block data. */
+	if (!batch->pipelined) {
+		timeout = g_get_monotonic_time() + batch->scpi->read_timeout_us;
+		while (!sr_scpi_read_complete(batch->scpi)) {
+			if (batch_read(batch, &timeout) < 0)
+				break;
+		}
+	} else if (batch->pending == 1) {
+		batch_drop_eol(batch);
+	}
+
+	return batch_response_end(batch);
+}
+
+/**
+ * Start reading the response to the next query of a batch as a
+ * "definite length block".
+ *
+ * A response header which precedes the block (e.g. "C1:WF ALL,") is
+ * skipped. The block data is then read by sr_scpi_batch_read_block().
+ *
+ * @param[in] batch The batch to read from.
+ * @param[out] length The number of data bytes in the block.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_block_begin(struct sr_scpi_batch *batch,
+				       size_t *length)
+{
+	struct sr_scpi_dev_inst *scpi;
+	GByteArray *rx;
+	guint8 *hash;
+	gint64 timeout;
+	char buf[10];
+	long llen, datalen;
+	guint pos;
+	int ret;
+
+	scpi = batch->scpi;
+	rx = batch->rx;
+
+	g_rec_mutex_lock(&scpi->scpi_mutex);
+
+	if (batch->in_block) {
+		batch_unlock(batch);
+		sr_err("Previous SCPI block was not completely read.");
+		return SR_ERR;
+	}
+
+	ret = batch_response_begin(batch);
+	if (ret != SR_OK) {
+		batch_unlock(batch);
+		return ret;
+	}
+
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	/* Skip up to the '#' marker, then get the length spec. */
+	while (TRUE) {
+		hash = memchr(rx->data, '#', rx->len);
+		if (!hash) {
+			g_byte_array_set_size(rx, 0);
+		} else {
+			pos = hash - rx->data;
+			g_byte_array_remove_range(rx, 0, pos);
+			if (rx->len >= 2 && g_ascii_isdigit(rx->data[1])) {
+				llen = rx->data[1] - '0';
+				if (!llen) {
+					sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
+					batch_unlock(batch);
+					return SR_ERR_NA;
+				}
+				if (rx->len >= (guint)(2 + llen))
+					break;
+			} else if (rx->len >= 2) {
+				sr_err("Received invalid data block header.");
+				batch_unlock(batch);
+				return SR_ERR_DATA;
+			}
+		}
+		ret = batch_read(batch, &timeout);
+		if (ret < 0) {
+			batch_unlock(batch);
+			return ret;
+		}
+	}
+
+	memcpy(buf, &rx->data[2], llen);
+	buf[llen] = '\0';
+	ret = sr_atol(buf, &datalen);
+	if (ret != SR_OK || datalen < 0) {
+		sr_err("Received invalid data block length '%s'.", buf);
+		batch_unlock(batch);
+		return SR_ERR_DATA;
+	}
+	g_byte_array_remove_range(rx, 0, 2 + llen);
+
+	*length = datalen;
+	batch->block_remaining = datalen;
+	batch->in_block = TRUE;
+	if (!datalen)
+		ret = batch_block_end(batch);
+
+	batch_unlock(batch);
+
+	return ret;
+}
+
+/**
+ * Read data of the current block response. Already received data is
+ * returned first, else this does a single read from the device.
+ *
+ * @param batch The batch to read from.
+ * @param buf Buffer to store the data.
+ * @param maxlen Maximum number of bytes to read.
+ *
+ * @return Number of bytes read (can be 0), or SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_batch_read_block(struct sr_scpi_batch *batch,
+				      uint8_t *buf, size_t maxlen)
+{
+	struct sr_scpi_dev_inst *scpi;
+	size_t len;
+	int ret;
+
+	scpi = batch->scpi;
+
+	g_rec_mutex_lock(&scpi->scpi_mutex);
+
+	if (!batch->in_block) {
+		batch_unlock(batch);
+		sr_err("No SCPI block is being read.");
+		return SR_ERR;
+	}
+
+	len = MIN(maxlen, batch->block_remaining);
+	len = MIN(len, G_MAXINT);
+	if (batch->rx->len) {
+		len = MIN(len, batch->rx->len);
+		memcpy(buf, batch->rx->data, len);
+		g_byte_array_remove_range(batch->rx, 0, len);
+		ret = len;
+	} else {
+		ret = scpi_read_data(scpi, (char *)buf, len);
+		if (ret < 0) {
+			batch_unlock(batch);
+			sr_err("Incompletely read SCPI block.");
+			return SR_ERR;
+		}
+	}
+
+	batch->block_remaining -= ret;
+	if (!batch->block_remaining) {
+		if (batch_block_end(batch) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	batch_unlock(batch);
+
+	return ret;
+}
+
+/**
+ * Read the response to the next query of a batch as a "definite length
+ * block" and store the data in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] batch The batch to read from.
+ * @param[out] scpi_response Pointer where to store the block data.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_block(struct sr_scpi_batch *batch,
+				     GByteArray **scpi_response)
+{
+	GByteArray *block;
+	gint64 timeout;
+	size_t length, pos;
+	int ret;
+
+	*scpi_response = NULL;
+
+	ret = sr_scpi_batch_block_begin(batch, &length);
+	if (ret != SR_OK)
+		return ret;
+
+	block = g_byte_array_sized_new(length);
+	g_byte_array_set_size(block, length);
+
+	timeout = g_get_monotonic_time() + batch->scpi->read_timeout_us;
+	pos = 0;
+	while (pos < length) {
+		ret = sr_scpi_batch_read_block(batch, block->data + pos,
+			length - pos);
+		if (ret < 0) {
+			g_byte_array_free(block, TRUE);
+			return ret;
+		}
+		if (ret > 0) {
+			pos += ret;
+			timeout = g_get_monotonic_time() +
+				batch->scpi->read_timeout_us;
+		} else if (g_get_monotonic_time() > timeout) {
+			sr_err("Timed out waiting for SCPI block.");
+			g_byte_array_free(block, TRUE);
+			return SR_ERR_TIMEOUT;
+		}
+	}
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	*scpi_response = block;
 
 	return SR_OK;
 }
@@ -1311,7 +2311,7 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 		return SR_OK;
 	}
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 
 	/* Select channel. */
 	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
@@ -1329,7 +2329,7 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 	ret = scpi_send_variadic(scpi, cmd, args);
 	va_end(args);
 
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -1356,7 +2356,7 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		return SR_ERR_NA;
 	}
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	g_rec_mutex_lock(&scpi->scpi_mutex);
 
 	/* Select channel. */
 	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
@@ -1374,20 +2374,20 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 	ret = scpi_send_variadic(scpi, cmd, args);
 	va_end(args);
 	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+		g_rec_mutex_unlock(&scpi->scpi_mutex);
 		return ret;
 	}
 
 	response = g_string_sized_new(1024);
 	ret = scpi_get_data(scpi, NULL, &response);
 	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+		g_rec_mutex_unlock(&scpi->scpi_mutex);
 		if (response)
 			g_string_free(response, TRUE);
 		return ret;
 	}
 
-	g_mutex_unlock(&scpi->scpi_mutex);
+	g_rec_mutex_unlock(&scpi->scpi_mutex);
 
 	/* Get rid of trailing linefeed if present */
 	if (response->len >= 1 && response->str[response->len - 1] == '\n')
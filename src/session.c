@@ -49,8 +49,43 @@
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	gboolean accepts_rle;
 };
 
+/*
+ * The session feed thread receives packets via a ring of slots. Usually
+ * the thread which runs the session's event sources is the only sender,
+ * but drivers may send from threads of their own as well. The ring is a
+ * bounded multi producer, single consumer queue: senders claim a slot by
+ * advancing the head index atomically, and publish the slot's packet by
+ * updating the slot's sequence number, the feed thread takes packets in
+ * order of the sequence numbers. No lock is held while a packet gets
+ * queued. The worker's mutex and condition only are used to sleep while
+ * the ring is empty (consumer) or full (producers).
+ */
+struct feed_ring_slot {
+	gint seq;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+struct feed_worker {
+	struct sr_session *session;
+	GThread *thread;
+	struct feed_ring_slot *slots;
+	guint mask;
+	gint head;
+	guint tail;
+	gint stop;
+	gint consumer_waiting;
+	gint producers_waiting;
+	GMutex mutex;
+	GCond cond;
+};
+
+/* The session which the current thread is the feed thread of. */
+static GPrivate feed_thread_session = G_PRIVATE_INIT(NULL);
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  */
@@ -199,6 +234,10 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	return source;
 }
 
+static void feed_worker_stop(struct sr_session *session);
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+
 /**
  * Create a new session.
  *
@@ -254,6 +293,8 @@ SR_API int sr_session_destroy(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
+	feed_worker_stop(session);
+
 	sr_session_dev_remove_all(session);
 	g_slist_free_full(session->owned_devs, (GDestroyNotify)sr_dev_inst_free);
 
@@ -467,21 +508,8 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 	return SR_OK;
 }
 
-/**
- * Add a datafeed callback to a session.
- *
- * @param session The session to use. Must not be NULL.
- * @param cb Function to call when a chunk of data is received.
- *           Must not be NULL.
- * @param cb_data Opaque pointer passed in by the caller.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR_BUG No session exists.
- *
- * @since 0.3.0
- */
-SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
-		sr_datafeed_callback cb, void *cb_data)
+static int datafeed_callback_add(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, gboolean accepts_rle)
 {
 	struct datafeed_callback *cb_struct;
 
@@ -498,6 +526,7 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
 	cb_struct->cb = cb;
 	cb_struct->cb_data = cb_data;
+	cb_struct->accepts_rle = accepts_rle;
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
@@ -505,6 +534,50 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	return SR_OK;
 }
 
+/**
+ * Add a datafeed callback to a session.
+ *
+ * Run-length encoded logic data (SR_DF_LOGIC_RLE) gets expanded to
+ * SR_DF_LOGIC packets before it is passed to the callback.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ *
+ * @since 0.3.0
+ */
+SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data)
+{
+	return datafeed_callback_add(session, cb, cb_data, FALSE);
+}
+
+/**
+ * Add a datafeed callback which accepts run-length encoded logic data.
+ *
+ * Other than with sr_session_datafeed_callback_add() the callback also
+ * receives SR_DF_LOGIC_RLE packets as they were sent by the device.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_rle_callback_add(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data)
+{
+	return datafeed_callback_add(session, cb, cb_data, TRUE);
+}
+
 /**
  * Get the trigger assigned to this session.
  *
@@ -692,6 +765,9 @@ static gboolean delayed_stop_check(void *data)
 	session->running = FALSE;
 	unset_main_context(session);
 
+	/* Have the session feed thread deliver all pending packets. */
+	feed_worker_stop(session);
+
 	sr_info("Stopped.");
 
 	/* This indicates a bug in user code, since it is not valid to
@@ -729,6 +805,324 @@ static int stop_check_later(struct sr_session *session)
 	return (source_id != 0) ? SR_OK : SR_ERR;
 }
 
+/**
+ * Configure the session feed thread.
+ *
+ * By default datafeed packets are passed to transform modules and
+ * datafeed callbacks in the context of the thread which runs the
+ * session, immediately when a device sends them. Slow receivers then
+ * delay the device's data processing, and can cause overruns at high
+ * samplerates.
+ *
+ * When the session feed thread is enabled, packets are queued in a ring
+ * of @a ring_size slots, and a separate thread delivers them. Transform
+ * modules and datafeed callbacks then run in that separate thread. A
+ * device's data gets held back when the ring is full. Devices may send
+ * packets from several threads, no lock is taken while packets get
+ * queued, and each thread's packets keep their order. The thread is
+ * created when the session starts, and it delivers all pending packets
+ * before the session's stopped callback runs.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param ring_size The number of ring slots, rounded up to a power of
+ *                  two. 0 disables the session feed thread.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_feed_thread_set(struct sr_session *session,
+		size_t ring_size)
+{
+	size_t size;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change the feed thread of a running session.");
+		return SR_ERR;
+	}
+	if (ring_size > G_MAXINT / 2)
+		return SR_ERR_ARG;
+
+	size = ring_size ? 2 : 0;
+	while (size && size < ring_size)
+		size *= 2;
+	session->feed_ring_size = size;
+
+	return SR_OK;
+}
+
+/**
+ * Get statistics of the session feed thread.
+ *
+ * The statistics cover the most recent session run. They are updated
+ * while the session is running, and are not reset when it stops.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Receives the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_feed_stats_get(struct sr_session *session,
+		struct sr_session_feed_stats *stats)
+{
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	stats->packets = (gsize)g_atomic_pointer_get(&session->feed_packets);
+	stats->stalls = (gsize)g_atomic_pointer_get(&session->feed_stalls);
+	stats->max_fill = (gsize)g_atomic_pointer_get(&session->feed_max_fill);
+
+	return SR_OK;
+}
+
+static void feed_worker_wake(struct feed_worker *worker)
+{
+	g_mutex_lock(&worker->mutex);
+	g_cond_broadcast(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+}
+
+/* Whether the slot at the head is still in use. Producer side. */
+static gboolean feed_ring_is_full(struct feed_worker *worker)
+{
+	guint pos;
+	gint seq;
+
+	pos = g_atomic_int_get(&worker->head);
+	seq = g_atomic_int_get(&worker->slots[pos & worker->mask].seq);
+
+	return (gint)((guint)seq - pos) < 0;
+}
+
+/* Whether the slot at the tail was not published yet. Consumer side. */
+static gboolean feed_ring_is_empty(struct feed_worker *worker)
+{
+	guint pos;
+	gint seq;
+
+	pos = worker->tail;
+	seq = g_atomic_int_get(&worker->slots[pos & worker->mask].seq);
+
+	return (gint)((guint)seq - (pos + 1)) < 0;
+}
+
+/* Claim the slot at the head, and publish a packet in it. */
+static gboolean feed_ring_try_push(struct feed_worker *worker,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	struct feed_ring_slot *slot;
+	guint pos;
+	gint diff;
+
+	pos = g_atomic_int_get(&worker->head);
+	for (;;) {
+		slot = &worker->slots[pos & worker->mask];
+		diff = (gint)((guint)g_atomic_int_get(&slot->seq) - pos);
+		if (diff < 0)
+			return FALSE;
+		if (diff == 0 && g_atomic_int_compare_and_exchange(&worker->head,
+				(gint)pos, (gint)(pos + 1)))
+			break;
+		pos = g_atomic_int_get(&worker->head);
+	}
+
+	slot->sdi = sdi;
+	slot->packet = packet;
+	g_atomic_int_set(&slot->seq, pos + 1);
+
+	return TRUE;
+}
+
+/* Hand a packet over to the session feed thread. Any sender thread. */
+static void feed_ring_push(struct feed_worker *worker,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	gboolean stalled;
+
+	stalled = FALSE;
+	while (!feed_ring_try_push(worker, sdi, packet)) {
+		if (!stalled)
+			g_atomic_pointer_add(&worker->session->feed_stalls, 1);
+		stalled = TRUE;
+		g_mutex_lock(&worker->mutex);
+		g_atomic_int_inc(&worker->producers_waiting);
+		while (feed_ring_is_full(worker))
+			g_cond_wait(&worker->cond, &worker->mutex);
+		g_atomic_int_add(&worker->producers_waiting, -1);
+		g_mutex_unlock(&worker->mutex);
+	}
+
+	if (g_atomic_int_get(&worker->consumer_waiting))
+		feed_worker_wake(worker);
+}
+
+/* Take the next packet from the ring. Consumer side only. */
+static gboolean feed_ring_pop(struct feed_worker *worker,
+		struct feed_ring_slot *slot)
+{
+	struct sr_session *session;
+	struct feed_ring_slot *s;
+	guint pos;
+	gsize fill;
+
+	if (feed_ring_is_empty(worker))
+		return FALSE;
+
+	pos = worker->tail;
+	s = &worker->slots[pos & worker->mask];
+	slot->sdi = s->sdi;
+	slot->packet = s->packet;
+
+	/* Only the feed thread updates these statistics. */
+	session = worker->session;
+	g_atomic_pointer_add(&session->feed_packets, 1);
+	fill = (guint)g_atomic_int_get(&worker->head) - pos;
+	if (fill > (gsize)g_atomic_pointer_get(&session->feed_max_fill))
+		g_atomic_pointer_set(&session->feed_max_fill, fill);
+
+	g_atomic_int_set(&s->seq, pos + worker->mask + 1);
+	worker->tail = pos + 1;
+
+	if (g_atomic_int_get(&worker->producers_waiting))
+		feed_worker_wake(worker);
+
+	return TRUE;
+}
+
+static gpointer feed_worker_thread(gpointer data)
+{
+	struct feed_worker *worker;
+	struct feed_ring_slot slot;
+	gboolean done;
+
+	worker = data;
+	g_private_set(&feed_thread_session, worker->session);
+
+	do {
+		while (feed_ring_pop(worker, &slot)) {
+			session_dispatch(slot.sdi, slot.packet);
+			sr_packet_free(slot.packet);
+		}
+
+		g_mutex_lock(&worker->mutex);
+		g_atomic_int_set(&worker->consumer_waiting, 1);
+		while (feed_ring_is_empty(worker) && !g_atomic_int_get(&worker->stop))
+			g_cond_wait(&worker->cond, &worker->mutex);
+		g_atomic_int_set(&worker->consumer_waiting, 0);
+		done = feed_ring_is_empty(worker) && g_atomic_int_get(&worker->stop);
+		g_mutex_unlock(&worker->mutex);
+	} while (!done);
+
+	g_private_set(&feed_thread_session, NULL);
+
+	return NULL;
+}
+
+/*
+ * Look up the feed thread which a sender hands packets to. Returns NULL
+ * when packets get dispatched directly: when the feed thread is not
+ * running, or when the feed thread itself sends (transform modules
+ * which expand packets do). Senders register themselves before they
+ * access the worker, feed_worker_stop() only releases the worker after
+ * all registered senders called feed_worker_release().
+ */
+static struct feed_worker *feed_worker_acquire(struct sr_session *session)
+{
+	struct feed_worker *worker;
+
+	if (g_private_get(&feed_thread_session) == session)
+		return NULL;
+
+	g_atomic_int_inc(&session->feed_senders);
+	worker = g_atomic_pointer_get(&session->feed_worker);
+	if (!worker)
+		g_atomic_int_add(&session->feed_senders, -1);
+
+	return worker;
+}
+
+static void feed_worker_release(struct sr_session *session)
+{
+	g_atomic_int_add(&session->feed_senders, -1);
+}
+
+static int feed_worker_start(struct sr_session *session)
+{
+	struct feed_worker *worker;
+	guint i;
+
+	g_atomic_pointer_set(&session->feed_packets, 0);
+	g_atomic_pointer_set(&session->feed_stalls, 0);
+	g_atomic_pointer_set(&session->feed_max_fill, 0);
+	if (!session->feed_ring_size)
+		return SR_OK;
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->session = session;
+	worker->slots = g_malloc0(session->feed_ring_size * sizeof(worker->slots[0]));
+	worker->mask = session->feed_ring_size - 1;
+	for (i = 0; i <= worker->mask; i++)
+		worker->slots[i].seq = i;
+	g_mutex_init(&worker->mutex);
+	g_cond_init(&worker->cond);
+
+	worker->thread = g_thread_try_new("sr-session-feed",
+		feed_worker_thread, worker, NULL);
+	if (!worker->thread) {
+		sr_err("Cannot create session feed thread.");
+		g_mutex_clear(&worker->mutex);
+		g_cond_clear(&worker->cond);
+		g_free(worker->slots);
+		g_free(worker);
+		return SR_ERR;
+	}
+	g_atomic_pointer_set(&session->feed_worker, worker);
+	sr_dbg("Started session feed thread, %zu slots.", session->feed_ring_size);
+
+	return SR_OK;
+}
+
+/*
+ * Stop the session feed thread after it delivered all queued packets.
+ * Senders which look up the worker afterwards dispatch directly. The
+ * worker gets released when no sender accesses it any longer.
+ */
+static void feed_worker_stop(struct sr_session *session)
+{
+	struct feed_worker *worker;
+
+	worker = g_atomic_pointer_get(&session->feed_worker);
+	if (!worker)
+		return;
+
+	g_atomic_pointer_set(&session->feed_worker, NULL);
+	while (g_atomic_int_get(&session->feed_senders))
+		g_thread_yield();
+
+	g_atomic_int_set(&worker->stop, 1);
+	feed_worker_wake(worker);
+	g_thread_join(worker->thread);
+
+	sr_dbg("Stopped session feed thread, %" G_GSIZE_FORMAT " packets, "
+		"%" G_GSIZE_FORMAT " stalls, max fill %" G_GSIZE_FORMAT ".",
+		session->feed_packets, session->feed_stalls,
+		session->feed_max_fill);
+
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker->slots);
+	g_free(worker);
+}
+
 /**
  * Start a session.
  *
@@ -806,6 +1200,12 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
+	ret = feed_worker_start(session);
+	if (ret != SR_OK) {
+		unset_main_context(session);
+		return ret;
+	}
+
 	sr_info("Starting.");
 
 	session->running = TRUE;
@@ -837,6 +1237,7 @@ SR_API int sr_session_start(struct sr_session *session)
 		 * sources... */
 		session->running = FALSE;
 
+		feed_worker_stop(session);
 		unset_main_context(session);
 		return ret;
 	}
@@ -1035,6 +1436,7 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *logic_rle;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1066,6 +1468,11 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		logic_rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", logic_rle->num_runs, logic_rle->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
@@ -1108,6 +1515,34 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
+/* Pass an expanded SR_DF_LOGIC_RLE chunk through the whole session feed. */
+static int send_expanded_rle(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	return sr_session_send(cb_data, packet);
+}
+
+/* Pass an expanded SR_DF_LOGIC_RLE chunk to the callbacks without RLE support. */
+static int dispatch_expanded_rle(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	sdi = cb_data;
+	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->accepts_rle)
+			continue;
+		if (sr_log_loglevel_get() >= SR_LOG_DBG)
+			datafeed_dump(packet);
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	}
+
+	return SR_OK;
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -1124,10 +1559,8 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
+	struct feed_worker *worker;
+	struct sr_datafeed_packet *copy;
 	int ret;
 
 	if (!sdi) {
@@ -1145,6 +1578,97 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	/* The caller keeps ownership, queue a copy for the feed thread. */
+	worker = feed_worker_acquire(sdi->session);
+	if (worker) {
+		ret = sr_packet_copy(packet, &copy);
+		if (ret == SR_OK)
+			feed_ring_push(worker, sdi, copy);
+		feed_worker_release(sdi->session);
+		return ret;
+	}
+
+	return session_dispatch(sdi, packet);
+}
+
+/**
+ * Send a packet, and pass its ownership to the session.
+ *
+ * The packet and its payload must have been allocated like
+ * sr_packet_copy() does, the session releases them by means of
+ * sr_packet_free(). The session feed thread receives the packet
+ * without another copy. Callers can check whether this saves a copy
+ * by means of sr_session_feed_is_threaded().
+ *
+ * @param sdi The device instance to send the packet from. Must not be NULL.
+ * @param packet The datafeed packet to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_owned(const struct sr_dev_inst *sdi,
+		struct sr_datafeed_packet *packet)
+{
+	struct feed_worker *worker;
+	int ret;
+
+	if (!sdi || !sdi->session || !packet) {
+		if (packet)
+			sr_packet_free(packet);
+		return SR_ERR_ARG;
+	}
+
+	worker = feed_worker_acquire(sdi->session);
+	if (worker) {
+		feed_ring_push(worker, sdi, packet);
+		feed_worker_release(sdi->session);
+		return SR_OK;
+	}
+
+	ret = session_dispatch(sdi, packet);
+	sr_packet_free(packet);
+
+	return ret;
+}
+
+/**
+ * Check whether packets get delivered by the session feed thread.
+ *
+ * @param session The session to check.
+ *
+ * @return TRUE when the session feed thread is running.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_feed_is_threaded(const struct sr_session *session)
+{
+	return session && g_atomic_pointer_get(&session->feed_worker);
+}
+
+/*
+ * Pass a packet through the transform modules, and to the datafeed
+ * callbacks. Runs in the session feed thread when that is enabled.
+ */
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	gboolean need_expand;
+	int ret;
+
+	/*
+	 * Transform modules only handle plain logic data. Expand RLE
+	 * packets early when transforms are in use.
+	 */
+	if (packet->type == SR_DF_LOGIC_RLE && sdi->session->transforms)
+		return sr_logic_rle_expand_packets(packet->payload,
+			send_expanded_rle, (void *)sdi);
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
@@ -1153,7 +1677,6 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	packet_in = (struct sr_datafeed_packet *)packet;
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
-		sr_spew("Running transform module '%s'.", t->module->id);
 		ret = t->module->receive(t, packet_in, &packet_out);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
@@ -1176,6 +1699,28 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	}
 	packet = packet_in;
 
+	/*
+	 * Callbacks which don't accept run-length encoded data receive
+	 * the expanded samples, the expansion is shared among them.
+	 */
+	if (packet->type == SR_DF_LOGIC_RLE) {
+		need_expand = FALSE;
+		for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			if (!cb_struct->accepts_rle) {
+				need_expand = TRUE;
+				continue;
+			}
+			if (sr_log_loglevel_get() >= SR_LOG_DBG)
+				datafeed_dump(packet);
+			cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		}
+		if (!need_expand)
+			return SR_OK;
+		return sr_logic_rle_expand_packets(packet->payload,
+			dispatch_expanded_rle, (void *)sdi);
+	}
+
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
 	 * callbacks.
@@ -1506,6 +2051,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
+	const struct sr_datafeed_logic_rle *logic_rle;
+	struct sr_datafeed_logic_rle *logic_rle_copy;
 	uint8_t *payload;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
@@ -1514,6 +2061,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +2073,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,12 +2083,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
-			g_free(logic_copy);
-			return SR_ERR;
-		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
+		logic_copy->data = g_malloc(logic->length);
+		memcpy(logic_copy->data, logic->data, logic->length);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
@@ -1566,6 +2111,21 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		logic_rle = packet->payload;
+		logic_rle_copy = g_malloc(sizeof(*logic_rle_copy));
+		logic_rle_copy->num_runs = logic_rle->num_runs;
+		logic_rle_copy->unitsize = logic_rle->unitsize;
+		logic_rle_copy->values = g_malloc(
+				logic_rle->num_runs * logic_rle->unitsize);
+		memcpy(logic_rle_copy->values, logic_rle->values,
+				logic_rle->num_runs * logic_rle->unitsize);
+		logic_rle_copy->counts = g_malloc(
+				logic_rle->num_runs * sizeof(uint64_t));
+		memcpy(logic_rle_copy->counts, logic_rle->counts,
+				logic_rle->num_runs * sizeof(uint64_t));
+		(*copy)->payload = logic_rle_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1579,12 +2139,15 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *logic_rle;
 	struct sr_config *src;
 	GSList *l;
 
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1615,6 +2178,12 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		logic_rle = packet->payload;
+		g_free(logic_rle->values);
+		g_free(logic_rle->counts);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
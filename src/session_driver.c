@@ -32,10 +32,27 @@
 /* size of payloads sent across the session bus */
 /** @cond PRIVATE */
 #define CHUNKSIZE (4 * 1024 * 1024)
+/* number of chunks which the reader thread can fill in advance */
+#define PREFETCH_CHUNKS 4
 /** @endcond */
 
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+/*
+ * Capture data gets decompressed by a reader thread into a pool of
+ * recycled chunk buffers. The main loop only sends filled chunks to
+ * the session, and returns them to the pool afterwards. The reader
+ * owns the archive and the capture file state while the acquisition
+ * runs. An event source becomes ready when filled chunks are pending,
+ * the reader wakes up the session's main loop after filling a chunk.
+ * The main loop never blocks on the reader.
+ */
+struct session_chunk {
+	uint8_t *data;
+	size_t len;
+	int analog_channel;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
@@ -50,6 +67,20 @@ struct session_vdev {
 	GArray *analog_channels;
 	int cur_chunk;
 	gboolean finished;
+	GThread *reader;
+	gint reader_stop;
+	GAsyncQueue *free_chunks;
+	GAsyncQueue *full_chunks;
+	GMainContext *main_context;
+	struct session_chunk chunks[PREFETCH_CHUNKS];
+	struct session_chunk end_chunk;
+};
+
+/** Custom GLib event source, ready when chunks are pending. */
+struct chunk_source {
+	GSource base;
+	struct sr_session *session;
+	struct session_vdev *vdev;
 };
 
 static const uint32_t devopts[] = {
@@ -61,22 +92,21 @@ static const uint32_t devopts[] = {
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+/*
+ * Read the next chunk of capture data, advancing through the archive's
+ * capture files as needed. Runs in the reader thread. Returns FALSE
+ * when there is no more data. A chunk may remain empty when the reader
+ * advanced to another capture file.
+ */
+static gboolean read_session_chunk(struct session_vdev *vdev,
+		struct session_chunk *chunk)
 {
-	struct session_vdev *vdev;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	struct zip_stat zs;
 	int ret, got_data;
 	char capturefile[128];
-	void *buf;
 
 	got_data = FALSE;
-	vdev = sdi->priv;
+	chunk->len = 0;
 
 	if (!vdev->capfile) {
 		/* No capture file opened yet, or finished with the last
@@ -126,7 +156,7 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 				g_free(vdev->capturefile);
 
 				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
+				 * capturefile is set by read_session_chunk() - however only
 				 * once. In order to not mess this mechanism up, we simulate
 				 * this here if needed. For purely analog files, capturefile
 				 * is not set.
@@ -140,40 +170,18 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 		}
 	}
 
-	buf = g_malloc(CHUNKSIZE);
-
 	/* unitsize is not defined for purely analog session files. */
 	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
+		ret = zip_fread(vdev->capfile, chunk->data,
 				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
 	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
+		ret = zip_fread(vdev->capfile, chunk->data, CHUNKSIZE);
 
 	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
+		if (vdev->cur_analog_channel != 0 || vdev->unitsize) {
 			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
+			chunk->len = ret;
+			chunk->analog_channel = vdev->cur_analog_channel;
 		} else {
 			/*
 			 * Neither analog data, nor logic which has
@@ -181,10 +189,6 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 			 */
 			sr_warn("Neither analog nor logic data. Ignoring.");
 		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
 	} else {
 		/* done with this capture file */
 		zip_fclose(vdev->capfile);
@@ -195,15 +199,205 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 			got_data = TRUE;
 		}
 	}
-	g_free(buf);
 
 	return got_data;
 }
 
+static gpointer session_reader_thread(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct session_chunk *chunk;
+	gboolean more;
+
+	vdev = data;
+	more = TRUE;
+	while (more && !g_atomic_int_get(&vdev->reader_stop)) {
+		chunk = g_async_queue_pop(vdev->free_chunks);
+		do {
+			more = read_session_chunk(vdev, chunk);
+		} while (more && !chunk->len &&
+			!g_atomic_int_get(&vdev->reader_stop));
+		if (chunk->len) {
+			g_async_queue_push(vdev->full_chunks, chunk);
+			g_main_context_wakeup(vdev->main_context);
+		} else {
+			g_async_queue_push(vdev->free_chunks, chunk);
+		}
+	}
+	g_async_queue_push(vdev->full_chunks, &vdev->end_chunk);
+	g_main_context_wakeup(vdev->main_context);
+
+	return NULL;
+}
+
+static int session_reader_start(struct session_vdev *vdev)
+{
+	size_t i;
+
+	vdev->free_chunks = g_async_queue_new();
+	vdev->full_chunks = g_async_queue_new();
+	for (i = 0; i < PREFETCH_CHUNKS; i++) {
+		vdev->chunks[i].data = g_try_malloc(CHUNKSIZE);
+		if (!vdev->chunks[i].data)
+			return SR_ERR_MALLOC;
+		g_async_queue_push(vdev->free_chunks, &vdev->chunks[i]);
+	}
+	vdev->reader_stop = 0;
+	vdev->reader = g_thread_new("session-reader",
+		session_reader_thread, vdev);
+
+	return SR_OK;
+}
+
+static gboolean chunk_source_ready(struct chunk_source *csource)
+{
+	return csource->vdev->finished ||
+		g_async_queue_length(csource->vdev->full_chunks) > 0;
+}
+
+static gboolean chunk_source_prepare(GSource *source, int *timeout)
+{
+	*timeout = -1;
+
+	return chunk_source_ready((struct chunk_source *)source);
+}
+
+static gboolean chunk_source_check(GSource *source)
+{
+	return chunk_source_ready((struct chunk_source *)source);
+}
+
+static gboolean chunk_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	(void)source;
+
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+
+	return (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, 0, user_data);
+}
+
+static void chunk_source_finalize(GSource *source)
+{
+	struct chunk_source *csource;
+
+	csource = (struct chunk_source *)source;
+	sr_session_source_destroyed(csource->session, csource->vdev, source);
+}
+
+static int chunk_source_add(struct sr_session *session,
+		struct session_vdev *vdev, sr_receive_data_callback cb,
+		void *cb_data)
+{
+	static GSourceFuncs chunk_source_funcs = {
+		.prepare  = &chunk_source_prepare,
+		.check    = &chunk_source_check,
+		.dispatch = &chunk_source_dispatch,
+		.finalize = &chunk_source_finalize
+	};
+	GSource *source;
+	struct chunk_source *csource;
+	int ret;
+
+	source = g_source_new(&chunk_source_funcs, sizeof(struct chunk_source));
+	csource = (struct chunk_source *)source;
+	g_source_set_name(source, "session-chunks");
+	csource->session = session;
+	csource->vdev = vdev;
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+
+	ret = sr_session_source_add_internal(session, vdev, source);
+	g_source_unref(source);
+
+	return ret;
+}
+
+static void session_reader_stop(struct session_vdev *vdev)
+{
+	struct session_chunk *chunk;
+	size_t i;
+
+	if (vdev->reader) {
+		/*
+		 * Return pending chunks to the pool, so that a reader
+		 * which waits for a free chunk can notice the request.
+		 */
+		g_atomic_int_set(&vdev->reader_stop, 1);
+		while ((chunk = g_async_queue_try_pop(vdev->full_chunks))) {
+			if (chunk != &vdev->end_chunk)
+				g_async_queue_push(vdev->free_chunks, chunk);
+		}
+		g_thread_join(vdev->reader);
+		vdev->reader = NULL;
+	}
+	if (vdev->full_chunks) {
+		g_async_queue_unref(vdev->full_chunks);
+		vdev->full_chunks = NULL;
+	}
+	if (vdev->free_chunks) {
+		g_async_queue_unref(vdev->free_chunks);
+		vdev->free_chunks = NULL;
+	}
+	if (vdev->main_context) {
+		g_main_context_unref(vdev->main_context);
+		vdev->main_context = NULL;
+	}
+	for (i = 0; i < PREFETCH_CHUNKS; i++) {
+		g_free(vdev->chunks[i].data);
+		vdev->chunks[i].data = NULL;
+	}
+}
+
+static void send_session_chunk(struct sr_dev_inst *sdi,
+		struct session_chunk *chunk)
+{
+	struct session_vdev *vdev;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	vdev = sdi->priv;
+
+	if (chunk->analog_channel != 0) {
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, chunk->analog_channel - 1));
+		analog.num_samples = chunk->len / sizeof(float);
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = (float *)chunk->data;
+		sr_session_send(sdi, &packet);
+		g_slist_free(analog.meaning->channels);
+	} else {
+		if (chunk->len % vdev->unitsize != 0)
+			sr_warn("Read size %zu not a multiple of the"
+				" unit size %d.", chunk->len, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = chunk->len;
+		logic.unitsize = vdev->unitsize;
+		logic.data = chunk->data;
+		sr_session_send(sdi, &packet);
+	}
+	vdev->bytes_read += chunk->len;
+}
+
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct session_vdev *vdev;
+	struct session_chunk *chunk;
 
 	(void)fd;
 	(void)revents;
@@ -211,11 +405,21 @@ static int receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	vdev = sdi->priv;
 
-	if (!vdev->finished && !stream_session_data(sdi))
-		vdev->finished = TRUE;
+	if (!vdev->finished) {
+		chunk = g_async_queue_try_pop(vdev->full_chunks);
+		if (!chunk)
+			return G_SOURCE_CONTINUE;
+		if (chunk == &vdev->end_chunk) {
+			vdev->finished = TRUE;
+		} else {
+			send_session_chunk(sdi, chunk);
+			g_async_queue_push(vdev->free_chunks, chunk);
+		}
+	}
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
+	session_reader_stop(vdev);
 	if (vdev->capfile) {
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
@@ -224,6 +428,10 @@ static int receive_data(int fd, int revents, void *cb_data)
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
 	}
+	if (vdev->analog_channels) {
+		g_array_free(vdev->analog_channels, TRUE);
+		vdev->analog_channels = NULL;
+	}
 
 	std_session_send_df_end(sdi);
 
@@ -360,10 +568,26 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	std_session_send_df_header(sdi);
+	vdev->main_context = g_main_context_ref(sdi->session->main_context);
+	ret = session_reader_start(vdev);
+	if (ret != SR_OK) {
+		sr_err("Cannot allocate session read buffers.");
+		session_reader_stop(vdev);
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return ret;
+	}
+
+	/* Sends chunks as the reader thread provides them. */
+	ret = chunk_source_add(sdi->session, vdev, receive_data, (void *)sdi);
+	if (ret != SR_OK) {
+		session_reader_stop(vdev);
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return ret;
+	}
 
-	/* freewheeling source */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	std_session_send_df_header(sdi);
 
 	return SR_OK;
 }
@@ -375,6 +599,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	vdev = sdi->priv;
 
 	vdev->finished = TRUE;
+	if (vdev->main_context)
+		g_main_context_wakeup(vdev->main_context);
 
 	return SR_OK;
 }
@@ -393,4 +393,751 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+/** @cond PRIVATE */
+/* Size of the scratch buffer for skipping data within a chunk. */
+#define SKIP_BUFSIZE (64 * 1024)
+
+/*
+ * A sequence of archive members which hold the data of one stream,
+ * either logic data, or the data of one analog channel. Sample data
+ * can be stored in a single member, or in numbered chunk members.
+ */
+struct session_file_stream {
+	char *name;
+	size_t unitsize;
+	guint num_chunks;
+	zip_int64_t *members;
+	uint64_t *starts;
+	uint8_t *changes;
+	uint8_t *first;
+	uint8_t *last;
+	double *min;
+	double *max;
+};
+
+struct sr_session_file {
+	struct zip *archive;
+	struct session_file_stream logic;
+	guint num_analog;
+	struct session_file_stream *analog;
+};
+/** @endcond */
+
+static uint8_t *stream_parse_hex_list(GKeyFile *index, const char *group,
+		const char *key, size_t unitsize, guint count)
+{
+	char **list;
+	gsize len, i, b;
+	uint8_t *data;
+	int hi, lo;
+
+	list = g_key_file_get_string_list(index, group, key, &len, NULL);
+	if (!list)
+		return NULL;
+	data = NULL;
+	if (len == count) {
+		data = g_malloc(count * unitsize);
+		for (i = 0; i < len && data; i++) {
+			if (strlen(list[i]) != 2 * unitsize) {
+				g_free(data);
+				data = NULL;
+				break;
+			}
+			for (b = 0; b < unitsize; b++) {
+				hi = g_ascii_xdigit_value(list[i][2 * b]);
+				lo = g_ascii_xdigit_value(list[i][2 * b + 1]);
+				if (hi < 0 || lo < 0) {
+					g_free(data);
+					data = NULL;
+					break;
+				}
+				data[i * unitsize + b] = (hi << 4) | lo;
+			}
+		}
+	}
+	g_strfreev(list);
+
+	return data;
+}
+
+static double *stream_parse_double_list(GKeyFile *index, const char *group,
+		const char *key, guint count)
+{
+	double *list;
+	gsize len;
+
+	list = g_key_file_get_double_list(index, group, key, &len, NULL);
+	if (list && len != count) {
+		g_free(list);
+		list = NULL;
+	}
+
+	return list;
+}
+
+/*
+ * Locate the members of a stream in the archive, and determine the
+ * sample numbers which each member covers. Sample counts and summaries
+ * are taken from the archive's index when it matches the archive's
+ * members. Otherwise the sample counts of all members get derived from
+ * their uncompressed sizes, which the archive's directory provides
+ * without decompression.
+ */
+static int stream_init(struct zip *archive, GKeyFile *index,
+		struct session_file_stream *stream, char *name, size_t unitsize)
+{
+	struct zip_stat zs;
+	GArray *members;
+	zip_int64_t single, member;
+	uint64_t total, count;
+	char **samples, *chunkname;
+	gsize num_samples;
+	guint nr;
+
+	stream->name = name;
+	stream->unitsize = unitsize;
+
+	members = g_array_new(FALSE, FALSE, sizeof(zip_int64_t));
+	single = zip_name_locate(archive, name, 0);
+	if (single >= 0) {
+		/* Unchunked data, a single member. */
+		g_array_append_val(members, single);
+	} else {
+		for (nr = 1; ; nr++) {
+			chunkname = g_strdup_printf("%s-%u", name, nr);
+			member = zip_name_locate(archive, chunkname, 0);
+			g_free(chunkname);
+			if (member < 0)
+				break;
+			g_array_append_val(members, member);
+		}
+	}
+	stream->num_chunks = members->len;
+	stream->members = (zip_int64_t *)g_array_free(members, FALSE);
+	stream->starts = g_malloc((stream->num_chunks + 1) *
+		sizeof(stream->starts[0]));
+
+	samples = NULL;
+	num_samples = 0;
+	if (index && g_key_file_has_group(index, name))
+		samples = g_key_file_get_string_list(index, name, "samples",
+			&num_samples, NULL);
+	if (samples && num_samples != stream->num_chunks) {
+		sr_warn("Ignoring index of stream %s, chunk count mismatch.",
+			name);
+		g_strfreev(samples);
+		samples = NULL;
+	}
+
+	total = 0;
+	for (nr = 0; nr < stream->num_chunks; nr++) {
+		if (samples) {
+			count = g_ascii_strtoull(samples[nr], NULL, 10);
+		} else {
+			member = stream->members[nr];
+			if (zip_stat_index(archive, member, 0, &zs) < 0 ||
+					!(zs.valid & ZIP_STAT_SIZE)) {
+				sr_err("Cannot stat member %" PRId64 " of stream %s.",
+					(int64_t)member, name);
+				return SR_ERR_DATA;
+			}
+			count = zs.size / unitsize;
+		}
+		stream->starts[nr] = total;
+		total += count;
+	}
+	stream->starts[stream->num_chunks] = total;
+
+	/* Only use summaries of an index which matches the archive. */
+	if (samples) {
+		stream->changes = stream_parse_hex_list(index, name, "changes",
+			unitsize, stream->num_chunks);
+		stream->first = stream_parse_hex_list(index, name, "first",
+			unitsize, stream->num_chunks);
+		stream->last = stream_parse_hex_list(index, name, "last",
+			unitsize, stream->num_chunks);
+		stream->min = stream_parse_double_list(index, name, "min",
+			stream->num_chunks);
+		stream->max = stream_parse_double_list(index, name, "max",
+			stream->num_chunks);
+	}
+	g_strfreev(samples);
+
+	return SR_OK;
+}
+
+static void stream_free(struct session_file_stream *stream)
+{
+	g_free(stream->name);
+	g_free(stream->members);
+	g_free(stream->starts);
+	g_free(stream->changes);
+	g_free(stream->first);
+	g_free(stream->last);
+	g_free(stream->min);
+	g_free(stream->max);
+}
+
+static uint64_t stream_samples(const struct session_file_stream *stream)
+{
+	return stream->starts ? stream->starts[stream->num_chunks] : 0;
+}
+
+/* Find the chunk which contains the given sample number. */
+static guint stream_find_chunk(const struct session_file_stream *stream,
+		uint64_t sample)
+{
+	guint lo, hi, mid;
+
+	lo = 0;
+	hi = stream->num_chunks;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (stream->starts[mid] <= sample)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Read a range of samples of a stream. Only the chunks which cover
+ * the range get decompressed, data preceding the range within the
+ * first chunk gets skipped.
+ */
+static int stream_read(struct zip *archive,
+		const struct session_file_stream *stream,
+		uint64_t start, uint64_t count, uint8_t *buf,
+		uint64_t *read_count)
+{
+	struct zip_file *zf;
+	uint64_t total, skip, want, avail;
+	zip_int64_t len;
+	uint8_t *scratch;
+	guint chunk;
+	int ret;
+
+	*read_count = 0;
+	total = stream_samples(stream);
+	if (start >= total)
+		return SR_OK;
+	count = MIN(count, total - start);
+
+	scratch = NULL;
+	ret = SR_OK;
+	chunk = stream_find_chunk(stream, start);
+	while (count && chunk < stream->num_chunks) {
+		zf = zip_fopen_index(archive, stream->members[chunk], 0);
+		if (!zf) {
+			sr_err("Failed to open chunk of %s: %s", stream->name,
+				zip_strerror(archive));
+			ret = SR_ERR_IO;
+			break;
+		}
+		skip = (start - stream->starts[chunk]) * stream->unitsize;
+		while (skip) {
+			if (!scratch)
+				scratch = g_malloc(SKIP_BUFSIZE);
+			len = zip_fread(zf, scratch, MIN(skip, SKIP_BUFSIZE));
+			if (len <= 0)
+				break;
+			skip -= len;
+		}
+		avail = stream->starts[chunk + 1] - start;
+		want = MIN(count, avail) * stream->unitsize;
+		len = skip ? -1 : zip_fread(zf, buf, want);
+		zip_fclose(zf);
+		if (len < 0 || (uint64_t)len != want) {
+			sr_err("Short read from chunk of %s.", stream->name);
+			ret = SR_ERR_DATA;
+			break;
+		}
+		want /= stream->unitsize;
+		buf += want * stream->unitsize;
+		start += want;
+		count -= want;
+		*read_count += want;
+		chunk++;
+	}
+	g_free(scratch);
+
+	return ret;
+}
+
+/*
+ * Iterate over the chunks which cover a range of samples. Chunks which
+ * are completely covered and have an index summary get passed to the
+ * callback without data. Otherwise the covered part of the chunk gets
+ * read and passed to the callback.
+ */
+typedef void (*stream_summary_cb)(const struct session_file_stream *stream,
+		guint chunk, const uint8_t *data, uint64_t count, void *cb_data);
+
+static int stream_summarize(struct zip *archive,
+		const struct session_file_stream *stream, gboolean have_summary,
+		uint64_t start, uint64_t count,
+		stream_summary_cb cb, void *cb_data)
+{
+	uint64_t end, first, last, got;
+	uint8_t *data;
+	guint chunk;
+	int ret;
+
+	end = MIN(start + count, stream_samples(stream));
+	if (start >= end)
+		return SR_OK;
+
+	for (chunk = stream_find_chunk(stream, start);
+			chunk < stream->num_chunks; chunk++) {
+		first = MAX(start, stream->starts[chunk]);
+		last = MIN(end, stream->starts[chunk + 1]);
+		if (first >= end)
+			break;
+		if (first >= last)
+			continue;
+		if (have_summary && first == stream->starts[chunk] &&
+				last == stream->starts[chunk + 1]) {
+			cb(stream, chunk, NULL, last - first, cb_data);
+			continue;
+		}
+		data = g_try_malloc((last - first) * stream->unitsize);
+		if (!data)
+			return SR_ERR_MALLOC;
+		ret = stream_read(archive, stream, first, last - first,
+			data, &got);
+		if (ret == SR_OK && got != last - first)
+			ret = SR_ERR_DATA;
+		if (ret != SR_OK) {
+			g_free(data);
+			return ret;
+		}
+		cb(stream, chunk, data, got, cb_data);
+		g_free(data);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Open a session file for random access to its sample data.
+ *
+ * Other than sr_session_load() this does not create a session. The
+ * caller can read arbitrary ranges of samples, only the archive
+ * members which cover the range get decompressed. Session files which
+ * were written before the "index" member got introduced are supported
+ * as well, at the cost of reading data where summaries are requested.
+ *
+ * @param[in] filename The name of the session file to open.
+ * @param[out] file The opened session file. Release it with
+ *                  sr_session_file_close() after use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ * @retval SR_ERR This is not a session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file)
+{
+	struct sr_session_file *sf;
+	struct zip_stat zs;
+	GKeyFile *kf, *index;
+	const char *devgroup;
+	char *capturefile;
+	int unitsize, total_probes, total_analog, first_analog;
+	guint i;
+	int ret;
+
+	if (!filename || !file)
+		return SR_ERR_ARG;
+	*file = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+	sf = g_malloc0(sizeof(*sf));
+	if (!(sf->archive = zip_open(filename, 0, NULL))) {
+		g_free(sf);
+		return SR_ERR;
+	}
+	if (zip_stat(sf->archive, "metadata", 0, &zs) < 0 ||
+			!(kf = sr_sessionfile_read_metadata(sf->archive, &zs))) {
+		sr_session_file_close(sf);
+		return SR_ERR_DATA;
+	}
+	index = NULL;
+	if (zip_stat(sf->archive, "index", 0, &zs) >= 0)
+		index = sr_sessionfile_read_metadata(sf->archive, &zs);
+	else
+		sr_dbg("No index in session file, using archive directory.");
+
+	devgroup = "device 1";
+	capturefile = g_key_file_get_string(kf, devgroup, "capturefile", NULL);
+	unitsize = g_key_file_get_integer(kf, devgroup, "unitsize", NULL);
+	total_probes = g_key_file_get_integer(kf, devgroup, "total probes", NULL);
+	total_analog = g_key_file_get_integer(kf, devgroup, "total analog", NULL);
+	g_key_file_free(kf);
+
+	ret = SR_OK;
+	if (capturefile && unitsize > 0) {
+		ret = stream_init(sf->archive, index, &sf->logic,
+			capturefile, unitsize);
+	} else {
+		g_free(capturefile);
+		capturefile = NULL;
+	}
+
+	/* Analog channel numbers follow the logic channels, see srzip. */
+	first_analog = capturefile ? total_probes + 1 : 1;
+	if (total_analog > 0) {
+		sf->num_analog = total_analog;
+		sf->analog = g_malloc0(sf->num_analog * sizeof(sf->analog[0]));
+	}
+	for (i = 0; i < sf->num_analog && ret == SR_OK; i++) {
+		ret = stream_init(sf->archive, index, &sf->analog[i],
+			g_strdup_printf("analog-1-%u", first_analog + i),
+			sizeof(float));
+	}
+	if (index)
+		g_key_file_free(index);
+
+	if (ret != SR_OK) {
+		sr_session_file_close(sf);
+		return ret;
+	}
+	*file = sf;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file which was opened for random access.
+ *
+ * @param[in] file The session file. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_close(struct sr_session_file *file)
+{
+	guint i;
+
+	if (!file)
+		return SR_OK;
+
+	stream_free(&file->logic);
+	for (i = 0; i < file->num_analog; i++)
+		stream_free(&file->analog[i]);
+	g_free(file->analog);
+	if (file->archive)
+		zip_discard(file->archive);
+	g_free(file);
+
+	return SR_OK;
+}
+
+/**
+ * Get properties of a session file's logic data.
+ *
+ * @param[in] file The session file.
+ * @param[out] unitsize The number of bytes per sample. Can be NULL.
+ * @param[out] num_samples The number of samples. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no logic data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_info(struct sr_session_file *file,
+		unsigned int *unitsize, uint64_t *num_samples)
+{
+	if (!file)
+		return SR_ERR_ARG;
+	if (!file->logic.name)
+		return SR_ERR_NA;
+
+	if (unitsize)
+		*unitsize = file->logic.unitsize;
+	if (num_samples)
+		*num_samples = stream_samples(&file->logic);
+
+	return SR_OK;
+}
+
+/**
+ * Get properties of a session file's analog data.
+ *
+ * @param[in] file The session file.
+ * @param[out] num_channels The number of analog channels. Can be NULL.
+ * @param[out] num_samples The number of samples of the channel with the
+ *                         least samples. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no analog data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_info(struct sr_session_file *file,
+		unsigned int *num_channels, uint64_t *num_samples)
+{
+	uint64_t count;
+	guint i;
+
+	if (!file)
+		return SR_ERR_ARG;
+	if (!file->num_analog)
+		return SR_ERR_NA;
+
+	if (num_channels)
+		*num_channels = file->num_analog;
+	if (num_samples) {
+		*num_samples = stream_samples(&file->analog[0]);
+		for (i = 1; i < file->num_analog; i++) {
+			count = stream_samples(&file->analog[i]);
+			*num_samples = MIN(*num_samples, count);
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of logic samples from a session file.
+ *
+ * @param[in] file The session file.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Space for count samples of the logic data's unit size.
+ * @param[out] read_count The number of samples which were read. Less
+ *                        than count when the range exceeds the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no logic data.
+ * @retval SR_ERR_IO Failed to access the archive.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_read(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *buf,
+		uint64_t *read_count)
+{
+	if (!file || !buf || !read_count)
+		return SR_ERR_ARG;
+	if (!file->logic.name)
+		return SR_ERR_NA;
+
+	return stream_read(file->archive, &file->logic,
+		start, count, buf, read_count);
+}
+
+/**
+ * Read a range of an analog channel's samples from a session file.
+ *
+ * @param[in] file The session file.
+ * @param[in] channel The analog channel, counting from 0.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Space for count values.
+ * @param[out] read_count The number of samples which were read. Less
+ *                        than count when the range exceeds the data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Failed to access the archive.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_read(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *read_count)
+{
+	if (!file || !buf || !read_count || channel >= file->num_analog)
+		return SR_ERR_ARG;
+
+	return stream_read(file->archive, &file->analog[channel],
+		start, count, (uint8_t *)buf, read_count);
+}
+
+/** @cond PRIVATE */
+struct logic_changes_state {
+	uint8_t *changes;
+	uint8_t *prev;
+	gboolean have_prev;
+};
+/** @endcond */
+
+static void logic_changes_cb(const struct session_file_stream *stream,
+		guint chunk, const uint8_t *data, uint64_t count, void *cb_data)
+{
+	struct logic_changes_state *state;
+	const uint8_t *first, *last, *prev, *curr;
+	size_t unitsize, b;
+	uint64_t i;
+
+	state = cb_data;
+	unitsize = stream->unitsize;
+	if (data) {
+		first = data;
+		last = &data[(count - 1) * unitsize];
+		prev = first;
+		for (i = 1; i < count; i++) {
+			curr = prev + unitsize;
+			for (b = 0; b < unitsize; b++)
+				state->changes[b] |= prev[b] ^ curr[b];
+			prev = curr;
+		}
+	} else {
+		first = &stream->first[chunk * unitsize];
+		last = &stream->last[chunk * unitsize];
+		for (b = 0; b < unitsize; b++)
+			state->changes[b] |= stream->changes[chunk * unitsize + b];
+	}
+	if (state->have_prev) {
+		for (b = 0; b < unitsize; b++)
+			state->changes[b] |= state->prev[b] ^ first[b];
+	}
+	memcpy(state->prev, last, unitsize);
+	state->have_prev = TRUE;
+}
+
+/**
+ * Determine which logic channels change within a range of samples.
+ *
+ * Uses the session file's index for chunks which the range completely
+ * covers, only the range's partially covered chunks get read.
+ *
+ * @param[in] file The session file.
+ * @param[in] start The number of the first sample of the range.
+ * @param[in] count The number of samples in the range.
+ * @param[out] changes Space for one sample of the logic data's unit
+ *                     size. Receives a bit mask of the channels which
+ *                     change their value within the range.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The session file has no logic data.
+ * @retval SR_ERR_IO Failed to access the archive.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_changes(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint8_t *changes)
+{
+	struct logic_changes_state state;
+	gboolean have_summary;
+	int ret;
+
+	if (!file || !changes)
+		return SR_ERR_ARG;
+	if (!file->logic.name)
+		return SR_ERR_NA;
+
+	memset(changes, 0, file->logic.unitsize);
+	state.changes = changes;
+	state.prev = g_malloc0(file->logic.unitsize);
+	state.have_prev = FALSE;
+	have_summary = file->logic.changes && file->logic.first &&
+		file->logic.last;
+	ret = stream_summarize(file->archive, &file->logic, have_summary,
+		start, count, logic_changes_cb, &state);
+	g_free(state.prev);
+
+	return ret;
+}
+
+/** @cond PRIVATE */
+struct analog_range_state {
+	double min, max;
+	gboolean have_value;
+};
+/** @endcond */
+
+static void analog_range_cb(const struct session_file_stream *stream,
+		guint chunk, const uint8_t *data, uint64_t count, void *cb_data)
+{
+	struct analog_range_state *state;
+	double min, max, value;
+	uint64_t i;
+
+	state = cb_data;
+	if (data) {
+		if (!count)
+			return;
+		min = max = read_fltle(data);
+		for (i = 1; i < count; i++) {
+			value = read_fltle(&data[i * sizeof(float)]);
+			if (value < min)
+				min = value;
+			if (value > max)
+				max = value;
+		}
+	} else {
+		min = stream->min[chunk];
+		max = stream->max[chunk];
+	}
+	if (!state->have_value || min < state->min)
+		state->min = min;
+	if (!state->have_value || max > state->max)
+		state->max = max;
+	state->have_value = TRUE;
+}
+
+/**
+ * Determine the minimum and maximum value of an analog channel within
+ * a range of samples.
+ *
+ * Uses the session file's index for chunks which the range completely
+ * covers, only the range's partially covered chunks get read.
+ *
+ * @param[in] file The session file.
+ * @param[in] channel The analog channel, counting from 0.
+ * @param[in] start The number of the first sample of the range.
+ * @param[in] count The number of samples in the range.
+ * @param[out] min The minimum value.
+ * @param[out] max The maximum value.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The range contains no samples.
+ * @retval SR_ERR_IO Failed to access the archive.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_range(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *min, float *max)
+{
+	struct session_file_stream *stream;
+	struct analog_range_state state;
+	int ret;
+
+	if (!file || !min || !max || channel >= file->num_analog)
+		return SR_ERR_ARG;
+
+	stream = &file->analog[channel];
+	memset(&state, 0, sizeof(state));
+	ret = stream_summarize(file->archive, stream,
+		stream->min && stream->max, start, count,
+		analog_range_cb, &state);
+	if (ret != SR_OK)
+		return ret;
+	if (!state.have_value)
+		return SR_ERR_NA;
+	*min = state.min;
+	*max = state.max;
+
+	return SR_OK;
+}
+
 /** @} */
@@ -41,6 +41,96 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/*
+ * The trigger specification gets compiled into bit masks per stage when
+ * the acquisition starts. This allows to check all of a stage's matches
+ * on a sample at once, with a few word-wide logic operations, instead
+ * of walking lists and testing individual bits.
+ *
+ * Masks are kept in 64bit words which hold the sample's bytes in memory
+ * order. The byte order of the words does not matter, sample data gets
+ * loaded the same way.
+ */
+struct soft_trigger_stage {
+	gboolean has_matches;
+	gboolean has_edges;
+	uint64_t *ones;
+	uint64_t *zeros;
+	uint64_t *rising;
+	uint64_t *falling;
+	uint64_t *edge;
+};
+
+static void mask_set_bit(uint64_t *mask, int index)
+{
+	uint8_t *bytes;
+
+	bytes = (uint8_t *)mask;
+	bytes[index / 8] |= 1 << (index % 8);
+}
+
+static void soft_trigger_compile(struct soft_trigger_logic *stl)
+{
+	struct soft_trigger_stage *cs;
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	GSList *l, *m;
+	int idx;
+	size_t words;
+
+	stl->words = (stl->unitsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0(stl->num_stages * sizeof(stl->stages[0]));
+	stl->masks = g_malloc0(stl->num_stages * 5 * stl->words * sizeof(uint64_t));
+	stl->cur_word = g_malloc0(stl->words * sizeof(uint64_t));
+	stl->prev_word = g_malloc0(stl->words * sizeof(uint64_t));
+
+	words = stl->words;
+	for (l = stl->trigger->stages, idx = 0; l; l = l->next, idx++) {
+		stage = l->data;
+		cs = &stl->stages[idx];
+		cs->ones = &stl->masks[(idx * 5 + 0) * words];
+		cs->zeros = &stl->masks[(idx * 5 + 1) * words];
+		cs->rising = &stl->masks[(idx * 5 + 2) * words];
+		cs->falling = &stl->masks[(idx * 5 + 3) * words];
+		cs->edge = &stl->masks[(idx * 5 + 4) * words];
+		cs->has_matches = stage->matches != NULL;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			if (match->channel->index / 8 >= stl->unitsize) {
+				sr_warn("Ignoring trigger on channel %s.",
+					match->channel->name);
+				continue;
+			}
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				mask_set_bit(cs->zeros, match->channel->index);
+				break;
+			case SR_TRIGGER_ONE:
+				mask_set_bit(cs->ones, match->channel->index);
+				break;
+			case SR_TRIGGER_RISING:
+				mask_set_bit(cs->rising, match->channel->index);
+				cs->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_FALLING:
+				mask_set_bit(cs->falling, match->channel->index);
+				cs->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_EDGE:
+				mask_set_bit(cs->edge, match->channel->index);
+				cs->has_edges = TRUE;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -51,7 +141,7 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
-	stl->prev_sample = g_malloc0(stl->unitsize);
+	soft_trigger_compile(stl);
 	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
 	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
 	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
@@ -76,7 +166,10 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
 	g_free(stl->pre_trigger_buffer);
-	g_free(stl->prev_sample);
+	g_free(stl->stages);
+	g_free(stl->masks);
+	g_free(stl->cur_word);
+	g_free(stl->prev_word);
 	g_free(stl);
 }
 
@@ -138,36 +231,108 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	}
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+/*
+ * Load a sample into words, in memory order like the stage masks. The
+ * common unit sizes use fixed size copies, which compile to plain loads.
+ */
+static void load_sample(struct soft_trigger_logic *stl,
+		const uint8_t *sample, uint64_t *words)
 {
-	int bit, prev_bit;
-	gboolean result;
-
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
-			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
+	switch (stl->unitsize) {
+	case 1:
+		words[0] = 0;
+		memcpy(words, sample, 1);
+		break;
+	case 2:
+		words[0] = 0;
+		memcpy(words, sample, 2);
+		break;
+	case 4:
+		words[0] = 0;
+		memcpy(words, sample, 4);
+		break;
+	case 8:
+		memcpy(words, sample, 8);
+		break;
+	default:
+		if (stl->unitsize % sizeof(uint64_t))
+			words[stl->words - 1] = 0;
+		memcpy(words, sample, stl->unitsize);
+		break;
 	}
+}
+
+static gboolean sample_repeated(const struct soft_trigger_logic *stl)
+{
+	if (stl->words == 1)
+		return stl->cur_word[0] == stl->prev_word[0];
 
-	return result;
+	return !memcmp(stl->cur_word, stl->prev_word,
+		stl->words * sizeof(uint64_t));
+}
+
+/*
+ * Check a sample against all matches of a stage. Level matches need the
+ * channel's bit to have the expected value. Edge matches need a change
+ * of the channel's bit, and the current bit's value for its direction.
+ * A stage's edge matches never fire on the very first sample, since
+ * there is no previous sample to compare against.
+ */
+static gboolean logic_check_stage(struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage *cs,
+		const uint64_t *cur, const uint64_t *prev)
+{
+	uint64_t changed, fail;
+	int w;
+
+	if (cs->has_edges && !stl->have_prev)
+		return FALSE;
+
+	fail = 0;
+	for (w = 0; w < stl->words; w++) {
+		changed = cur[w] ^ prev[w];
+		fail |= cs->ones[w] & ~cur[w];
+		fail |= cs->zeros[w] & cur[w];
+		fail |= cs->rising[w] & ~(changed & cur[w]);
+		fail |= cs->falling[w] & ~(changed & ~cur[w]);
+		fail |= cs->edge[w] & ~changed;
+	}
+
+	return fail == 0;
+}
+
+/*
+ * Skip samples which repeat the previous sample. Returns the offset of
+ * the first sample which differs from the one at the start position,
+ * or len when the remainder of the buffer repeats it. Common unit sizes
+ * get compared a word at a time.
+ */
+static int skip_repeated(const uint8_t *buf, int pos, int len, int unitsize)
+{
+	uint64_t pattern, word;
+	int i;
+
+	if (unitsize == 1 || unitsize == 2 || unitsize == 4 || unitsize == 8) {
+		for (i = 0; i < (int)sizeof(pattern); i += unitsize)
+			memcpy((uint8_t *)&pattern + i, buf + pos, unitsize);
+		pos += unitsize;
+		while (pos + (int)sizeof(word) <= len) {
+			memcpy(&word, buf + pos, sizeof(word));
+			if (word != pattern)
+				break;
+			pos += sizeof(word);
+		}
+		while (pos < len && !memcmp(buf + pos, &pattern, unitsize))
+			pos += unitsize;
+		return pos;
+	}
+
+	for (i = pos + unitsize; i < len; i += unitsize) {
+		if (memcmp(buf + i, buf + pos, unitsize))
+			break;
+	}
+
+	return i;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,36 +340,47 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
+	const struct soft_trigger_stage *cs;
+	uint64_t *tmp;
 	int offset;
-	int i;
-	gboolean match_found;
+	int i, next;
+	gboolean match_found, idle;
+
+	if (!stl->num_stages)
+		return SR_ERR_ARG;
 
 	offset = -1;
+	idle = FALSE;
 	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+		if (stl->cur_stage >= stl->num_stages)
+			stl->cur_stage = 0;
+		cs = &stl->stages[stl->cur_stage];
+		if (!cs->has_matches)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
-			}
+		/*
+		 * When the first stage did not match on the previous
+		 * sample, it won't match on repetitions of that sample
+		 * either: levels are unchanged, and edges are absent.
+		 */
+		load_sample(stl, buf + i, stl->cur_word);
+		if (idle && sample_repeated(stl)) {
+			next = skip_repeated(buf, i, len, stl->unitsize);
+			i = next - stl->unitsize;
+			continue;
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
+
+		match_found = logic_check_stage(stl, cs,
+			stl->cur_word, stl->prev_word);
+		tmp = stl->prev_word;
+		stl->prev_word = stl->cur_word;
+		stl->cur_word = tmp;
+		stl->have_prev = TRUE;
+		idle = FALSE;
 		if (match_found) {
 			/* Matched on the current stage. */
-			if (l_stage->next) {
+			if (stl->cur_stage + 1 < stl->num_stages) {
 				/* Advance to next stage. */
 				stl->cur_stage++;
 			} else {
@@ -229,10 +405,12 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 			 * takes care of.
 			 */
 			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
+			if (i < -stl->unitsize)
+				i = -stl->unitsize; /* Oops, went back past this buffer. */
 			/* Reset trigger stage. */
 			stl->cur_stage = 0;
+		} else {
+			idle = TRUE;
 		}
 	}
 
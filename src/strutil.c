@@ -35,6 +35,9 @@
 #include <string.h>
 #include <strings.h>
 #include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -811,6 +814,268 @@ SR_PRIV void sr_hexdump_free(GString *s)
 		g_string_free(s, TRUE);
 }
 
+/*
+ * Fast number formatting for text output modules.
+ *
+ * Exporting long captures as text is dominated by printf() style calls,
+ * which parse their format string, and go through locale handling for
+ * every single value. The routines below directly append the digits of
+ * a value to a GString. Floating point values are converted with exact
+ * integer arithmetic where the result is certain, and fall back to
+ * g_ascii_formatd() otherwise. In either case the output does not depend
+ * on the locale, and uses '.' as the decimal separator.
+ */
+
+/** @cond PRIVATE */
+#define FMT_BUF_SIZE	384
+#define FMT_MAX_FRAC	15
+/** @endcond */
+
+static const char digit_pairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const double pow10_tab[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+	1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+};
+
+/* Write the decimal digits of a value, ending at (excluding) end. */
+static char *format_u64(char *end, uint64_t value)
+{
+	size_t idx;
+
+	while (value >= 100) {
+		idx = (value % 100) * 2;
+		value /= 100;
+		*--end = digit_pairs[idx + 1];
+		*--end = digit_pairs[idx];
+	}
+	if (value >= 10) {
+		idx = value * 2;
+		*--end = digit_pairs[idx + 1];
+		*--end = digit_pairs[idx];
+	} else {
+		*--end = '0' + value;
+	}
+
+	return end;
+}
+
+/*
+ * Round a non-negative value to a number of fractional digits, as an
+ * integer. Returns FALSE when the result might differ from the correct
+ * rounding of the exact binary value, like printf() does it.
+ */
+static gboolean round_scaled(double mag, int frac, uint64_t *result)
+{
+	double scaled, dist;
+
+	if (frac < 0 || frac > FMT_MAX_FRAC)
+		return FALSE;
+	scaled = mag * pow10_tab[frac];
+	if (!(scaled < 9007199254740992.0))
+		return FALSE;
+
+	/*
+	 * The product carries a rounding error of up to one ulp. Don't
+	 * decide the direction for values that close to a tie.
+	 */
+	dist = fabs(scaled - floor(scaled) - 0.5);
+	if (dist <= scaled * DBL_EPSILON)
+		return FALSE;
+	*result = (uint64_t)nearbyint(scaled);
+
+	return TRUE;
+}
+
+/* Append a rounded integer with a number of fractional digits. */
+static void append_scaled(GString *s, gboolean neg, uint64_t value,
+		int frac, gboolean strip)
+{
+	char buf[48], *end, *p;
+	uint64_t ip, fp;
+	int i;
+
+	ip = value / (uint64_t)pow10_tab[frac];
+	fp = value % (uint64_t)pow10_tab[frac];
+	end = &buf[sizeof(buf)];
+	if (frac) {
+		for (i = 0; i < frac; i++) {
+			*--end = '0' + fp % 10;
+			fp /= 10;
+		}
+		*--end = '.';
+	}
+	p = format_u64(end, ip);
+	if (neg)
+		*--p = '-';
+	end = &buf[sizeof(buf)];
+	if (strip && frac) {
+		while (end[-1] == '0')
+			end--;
+		if (end[-1] == '.')
+			end--;
+	}
+	g_string_append_len(s, p, end - p);
+}
+
+static void append_formatd(GString *s, const char *conv, int prec,
+		double value)
+{
+	char fmt[16], buf[FMT_BUF_SIZE];
+
+	snprintf(fmt, sizeof(fmt), "%%.%d%s", CLAMP(prec, 0, 64), conv);
+	g_string_append(s, g_ascii_formatd(buf, sizeof(buf), fmt, value));
+}
+
+/**
+ * Append the decimal text of an unsigned integer to a GString.
+ *
+ * @param[in] s The GString to append to.
+ * @param[in] value The value to print.
+ *
+ * @private
+ */
+SR_PRIV void sr_gstring_append_u64(GString *s, uint64_t value)
+{
+	char buf[24], *p;
+
+	p = format_u64(&buf[sizeof(buf)], value);
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+/**
+ * Append the decimal text of a signed integer to a GString.
+ *
+ * @param[in] s The GString to append to.
+ * @param[in] value The value to print.
+ *
+ * @private
+ */
+SR_PRIV void sr_gstring_append_i64(GString *s, int64_t value)
+{
+	char buf[24], *p;
+
+	if (value >= 0) {
+		p = format_u64(&buf[sizeof(buf)], value);
+	} else {
+		p = format_u64(&buf[sizeof(buf)], -(uint64_t)value);
+		*--p = '-';
+	}
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+/**
+ * Append a floating point value in fixed point notation to a GString.
+ *
+ * The text matches printf("%.*f", decimals, value) in the C locale.
+ *
+ * @param[in] s The GString to append to.
+ * @param[in] value The value to print.
+ * @param[in] decimals The number of fractional digits.
+ *
+ * @private
+ */
+SR_PRIV void sr_gstring_append_fixed(GString *s, double value, int decimals)
+{
+	uint64_t r;
+
+	if (decimals < 0)
+		decimals = 0;
+	if (isfinite(value) && round_scaled(fabs(value), decimals, &r)) {
+		append_scaled(s, signbit(value), r, decimals, FALSE);
+		return;
+	}
+	append_formatd(s, "f", decimals, value);
+}
+
+/**
+ * Append a floating point value in "general" notation to a GString.
+ *
+ * The text matches printf("%.*g", precision, value) in the C locale.
+ *
+ * @param[in] s The GString to append to.
+ * @param[in] value The value to print.
+ * @param[in] precision The number of significant digits.
+ *
+ * @private
+ */
+SR_PRIV void sr_gstring_append_g(GString *s, double value, int precision)
+{
+	double mag;
+	uint64_t r;
+	int exp10, frac;
+
+	if (precision < 1)
+		precision = 1;
+	mag = fabs(value);
+	if (mag == 0.0) {
+		g_string_append(s, signbit(value) ? "-0" : "0");
+		return;
+	}
+	if (isfinite(value) && precision <= FMT_MAX_FRAC) {
+		/*
+		 * Fixed point notation is used for exponents from -4 up to
+		 * the precision. The rounded value must still have the
+		 * estimated number of digits, else the exponent was off.
+		 */
+		exp10 = (int)floor(log10(mag));
+		frac = precision - 1 - exp10;
+		if (exp10 >= -4 && exp10 < precision
+				&& round_scaled(mag, frac, &r)
+				&& r >= (uint64_t)pow10_tab[precision - 1]
+				&& r < (uint64_t)pow10_tab[precision]) {
+			append_scaled(s, signbit(value), r, frac, TRUE);
+			return;
+		}
+	}
+	append_formatd(s, "g", precision, value);
+}
+
+/**
+ * Append the shortest text which reads back as the same float value.
+ *
+ * Values from 1e-5 to below 1e10 use fixed point notation, with as few
+ * fractional digits as are needed. Other values use exponent notation.
+ *
+ * @param[in] s The GString to append to.
+ * @param[in] value The value to print.
+ *
+ * @private
+ */
+SR_PRIV void sr_gstring_append_float(GString *s, float value)
+{
+	double mag;
+	uint64_t r;
+	int exp10, frac, max_frac;
+
+	mag = fabs(value);
+	if (mag == 0.0) {
+		g_string_append(s, signbit(value) ? "-0" : "0");
+		return;
+	}
+	if (isfinite(value)) {
+		exp10 = (int)floor(log10(mag));
+		if (exp10 >= -5 && exp10 < 10) {
+			/* Nine significant digits always round trip. */
+			max_frac = MAX(9 - 1 - exp10, 0);
+			for (frac = 0; frac <= max_frac; frac++) {
+				if (!round_scaled(mag, frac, &r))
+					continue;
+				if ((float)(r / pow10_tab[frac]) != (float)mag)
+					continue;
+				append_scaled(s, signbit(value), r, frac, FALSE);
+				return;
+			}
+		}
+	}
+	append_formatd(s, "g", 9, value);
+}
+
 /**
  * Convert a string representation of a numeric value to a sr_rational.
  *
@@ -0,0 +1,598 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reduce the sample rate by a configurable factor, for consumers which
+ * only need an overview of long captures. Input samples are grouped in
+ * buckets of 'factor' samples, and each bucket is represented by one or
+ * two output samples depending on the mode:
+ *
+ * - "envelope" (default): two samples per bucket. Analog data gets the
+ *   bucket's minimum and maximum, in the order of their occurrence.
+ *   Logic data gets the bucket's last value, preceded by that value
+ *   with all channels inverted which had any edge within the bucket.
+ *   Channels with activity thus show a transition in the output, even
+ *   when they toggle back and forth within the bucket.
+ * - "mean": one sample per bucket. Analog data gets the mean value of
+ *   the bucket, logic data gets the bucket's last value.
+ *
+ * Buckets can span packets, samples of an incomplete bucket get held
+ * back until more data arrives. Each analog channel has its own bucket
+ * state, channels which share a packet also share the bucket phase.
+ * Packets which start at a bucket boundary get decimated in place,
+ * output samples overwrite input samples which were already consumed.
+ * Other packets' output goes to a buffer which is kept for reuse.
+ * Samplerate meta packets are replaced by a copy with the output rate,
+ * the sender's packet is not modified.
+ *
+ * An incomplete bucket at the end of the acquisition gets dropped: a
+ * transform passes on at most one packet per received packet, and the
+ * SR_DF_END packet must be passed on. At most factor - 1 samples per
+ * channel are lost this way.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+#define DEFAULT_FACTOR		1000
+/* Logic samples get processed in lanes of 64 bits. */
+#define LANE_BYTES		sizeof(uint64_t)
+
+enum decimate_mode {
+	MODE_ENVELOPE,
+	MODE_MEAN,
+};
+
+/* Bucket state of one analog channel. */
+struct analog_state {
+	uint64_t count;
+	float min, max;
+	uint64_t min_pos, max_pos;
+	double sum;
+};
+
+struct context {
+	uint64_t factor;
+	enum decimate_mode mode;
+	/* Output samples per bucket. */
+	size_t per_bucket;
+
+	/* Logic bucket state, one element per lane. */
+	uint16_t unitsize;
+	size_t lanes;
+	uint64_t logic_count;
+	gboolean have_prev;
+	uint64_t *prev;
+	uint64_t *edges;
+	struct sr_datafeed_logic logic;
+
+	/* Analog bucket state, per channel. */
+	GHashTable *analog_states;
+	struct analog_state **states;
+	size_t states_len;
+	float *fbuf;
+	size_t fbuf_len;
+
+	/* Copy of the most recent meta packet, with the output rate. */
+	struct sr_datafeed_meta meta;
+
+	/* Output of packets which cannot get decimated in place. */
+	uint8_t *obuf;
+	size_t obuf_size;
+
+	/* Output packet, pointing to in place or buffered data. */
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	mode = g_variant_get_string(g_hash_table_lookup(options, "mode"), NULL);
+	if (!strcmp(mode, "envelope")) {
+		ctx->mode = MODE_ENVELOPE;
+		ctx->per_bucket = 2;
+	} else if (!strcmp(mode, "mean")) {
+		ctx->mode = MODE_MEAN;
+		ctx->per_bucket = 1;
+	} else {
+		sr_err("Unknown decimation mode '%s'.", mode);
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	if (ctx->factor < 2)
+		sr_info("Decimation factor %" PRIu64 ", passing data through.",
+			ctx->factor);
+
+	ctx->analog_states = g_hash_table_new_full(g_direct_hash,
+		g_direct_equal, NULL, g_free);
+
+	return SR_OK;
+}
+
+static inline uint64_t lane_load(const uint8_t *p, size_t len)
+{
+	uint8_t b;
+	uint16_t h;
+	uint32_t w;
+	uint64_t v;
+
+	switch (len) {
+	case 1:
+		b = *p;
+		return b;
+	case 2:
+		memcpy(&h, p, sizeof(h));
+		return h;
+	case 4:
+		memcpy(&w, p, sizeof(w));
+		return w;
+	case 8:
+		memcpy(&v, p, sizeof(v));
+		return v;
+	default:
+		v = 0;
+		memcpy(&v, p, len);
+		return v;
+	}
+}
+
+static inline void lane_store(uint8_t *p, size_t len, uint64_t v)
+{
+	uint8_t b;
+	uint16_t h;
+	uint32_t w;
+
+	switch (len) {
+	case 1:
+		b = v;
+		*p = b;
+		break;
+	case 2:
+		h = v;
+		memcpy(p, &h, sizeof(h));
+		break;
+	case 4:
+		w = v;
+		memcpy(p, &w, sizeof(w));
+		break;
+	default:
+		memcpy(p, &v, len);
+		break;
+	}
+}
+
+static void logic_reset(struct context *ctx, uint16_t unitsize)
+{
+	ctx->unitsize = unitsize;
+	ctx->lanes = (unitsize + LANE_BYTES - 1) / LANE_BYTES;
+	ctx->prev = g_realloc(ctx->prev, ctx->lanes * sizeof(ctx->prev[0]));
+	ctx->edges = g_realloc(ctx->edges, ctx->lanes * sizeof(ctx->edges[0]));
+	memset(ctx->edges, 0, ctx->lanes * sizeof(ctx->edges[0]));
+	ctx->logic_count = 0;
+	ctx->have_prev = FALSE;
+}
+
+/*
+ * Get the buffer which receives a packet's output. Decimation works in
+ * place when the packet starts at a bucket boundary, the output never
+ * overtakes the input then: at most 'per_bucket' samples get written
+ * per 'factor' (>= per_bucket) samples consumed.
+ */
+static void *get_outbuf(struct context *ctx, void *data, gboolean aligned,
+	uint64_t num_samples, size_t unitsize)
+{
+	size_t size;
+
+	if (aligned)
+		return data;
+
+	size = (num_samples / ctx->factor + 1) * ctx->per_bucket * unitsize;
+	if (ctx->obuf_size < size) {
+		g_free(ctx->obuf);
+		ctx->obuf = g_malloc(size);
+		ctx->obuf_size = size;
+	}
+
+	return ctx->obuf;
+}
+
+/* Decimate logic data. Returns the number of samples written to 'out'. */
+static uint64_t decimate_logic(struct context *ctx, const uint8_t *data,
+	uint8_t *out_data, uint64_t num_samples)
+{
+	const uint8_t *rdp;
+	uint8_t *wrp, *out;
+	size_t unitsize, lane, lane_len;
+	uint64_t i, v, written;
+
+	unitsize = ctx->unitsize;
+	rdp = data;
+	wrp = out_data;
+	written = 0;
+	if (!ctx->have_prev && num_samples) {
+		for (lane = 0; lane < ctx->lanes; lane++) {
+			lane_len = MIN(LANE_BYTES, unitsize - lane * LANE_BYTES);
+			ctx->prev[lane] = lane_load(rdp + lane * LANE_BYTES, lane_len);
+		}
+		ctx->have_prev = TRUE;
+	}
+	for (i = 0; i < num_samples; i++) {
+		for (lane = 0; lane < ctx->lanes; lane++) {
+			lane_len = MIN(LANE_BYTES, unitsize - lane * LANE_BYTES);
+			v = lane_load(rdp + lane * LANE_BYTES, lane_len);
+			ctx->edges[lane] |= v ^ ctx->prev[lane];
+			ctx->prev[lane] = v;
+		}
+		rdp += unitsize;
+		if (++ctx->logic_count < ctx->factor)
+			continue;
+
+		/* Bucket complete. */
+		for (lane = 0; lane < ctx->lanes; lane++) {
+			lane_len = MIN(LANE_BYTES, unitsize - lane * LANE_BYTES);
+			out = wrp + lane * LANE_BYTES;
+			if (ctx->mode == MODE_ENVELOPE) {
+				lane_store(out, lane_len,
+					ctx->prev[lane] ^ ctx->edges[lane]);
+				out += unitsize;
+			}
+			lane_store(out, lane_len, ctx->prev[lane]);
+			ctx->edges[lane] = 0;
+		}
+		wrp += ctx->per_bucket * unitsize;
+		written += ctx->per_bucket;
+		ctx->logic_count = 0;
+	}
+
+	return written;
+}
+
+/*
+ * Decimate one channel's data, which is interleaved with 'stride' - 1
+ * other channels' values. Returns the number of values written.
+ */
+static uint64_t decimate_analog(struct context *ctx, struct analog_state *st,
+	const float *data, float *out, uint64_t num_samples, size_t stride)
+{
+	float *wrp, v;
+	uint64_t i, written;
+
+	wrp = out;
+	written = 0;
+	for (i = 0; i < num_samples; i++) {
+		v = data[i * stride];
+		if (!st->count || v < st->min) {
+			st->min = v;
+			st->min_pos = st->count;
+		}
+		if (!st->count || v > st->max) {
+			st->max = v;
+			st->max_pos = st->count;
+		}
+		st->sum += v;
+		if (++st->count < ctx->factor)
+			continue;
+
+		if (ctx->mode == MODE_MEAN) {
+			wrp[0] = st->sum / st->count;
+		} else if (st->min_pos <= st->max_pos) {
+			wrp[0] = st->min;
+			wrp[stride] = st->max;
+		} else {
+			wrp[0] = st->max;
+			wrp[stride] = st->min;
+		}
+		wrp += ctx->per_bucket * stride;
+		written += ctx->per_bucket;
+		st->count = 0;
+		st->sum = 0;
+	}
+
+	return written;
+}
+
+/* Can the analog payload get decimated without conversion? */
+static gboolean analog_is_native_float(const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+
+	enc = analog->encoding;
+	if (!enc->is_float || enc->unitsize != sizeof(float))
+		return FALSE;
+#ifdef WORDS_BIGENDIAN
+	if (!enc->is_bigendian)
+		return FALSE;
+#else
+	if (enc->is_bigendian)
+		return FALSE;
+#endif
+	if (enc->scale.p != (int64_t)enc->scale.q || enc->scale.q == 0)
+		return FALSE;
+	if (enc->offset.p != 0)
+		return FALSE;
+
+	return TRUE;
+}
+
+static int receive_analog(struct context *ctx,
+	struct sr_datafeed_packet *packet_in,
+	struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_state *st;
+	GSList *l;
+	void *key;
+	float *data, *out;
+	size_t num_channels, ch, values;
+	uint64_t count;
+	gboolean in_step;
+	int ret;
+
+	analog = packet_in->payload;
+	num_channels = MAX(g_slist_length(analog->meaning->channels), 1);
+	values = analog->num_samples * num_channels;
+	if (analog_is_native_float(analog)) {
+		data = analog->data;
+	} else {
+		if (ctx->fbuf_len < values) {
+			g_free(ctx->fbuf);
+			ctx->fbuf = g_malloc(values * sizeof(float));
+			ctx->fbuf_len = values;
+		}
+		data = ctx->fbuf;
+		ret = sr_analog_to_float(analog, data);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	/* Lookup the bucket state of each of the packet's channels. */
+	if (ctx->states_len < num_channels) {
+		ctx->states = g_realloc(ctx->states,
+			num_channels * sizeof(ctx->states[0]));
+		ctx->states_len = num_channels;
+	}
+	in_step = TRUE;
+	l = analog->meaning->channels;
+	for (ch = 0; ch < num_channels; ch++) {
+		key = l ? l->data : NULL;
+		l = l ? l->next : NULL;
+		st = g_hash_table_lookup(ctx->analog_states, key);
+		if (!st) {
+			st = g_malloc0(sizeof(*st));
+			g_hash_table_insert(ctx->analog_states, key, st);
+		}
+		ctx->states[ch] = st;
+		if (st->count != ctx->states[0]->count)
+			in_step = FALSE;
+	}
+
+	/*
+	 * Channels of a packet must emit the same number of values. When
+	 * earlier packets left them at different bucket positions, drop
+	 * their partial buckets and start over.
+	 */
+	if (!in_step) {
+		sr_dbg("Channels' buckets out of step, restarting them.");
+		for (ch = 0; ch < num_channels; ch++)
+			memset(ctx->states[ch], 0, sizeof(*ctx->states[ch]));
+	}
+
+	out = get_outbuf(ctx, data, ctx->states[0]->count == 0,
+		analog->num_samples, num_channels * sizeof(float));
+	count = 0;
+	for (ch = 0; ch < num_channels; ch++) {
+		count = decimate_analog(ctx, ctx->states[ch], &data[ch],
+			&out[ch], analog->num_samples, num_channels);
+	}
+	if (!count) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+
+	ctx->analog = *analog;
+	ctx->analog.data = out;
+	ctx->analog.num_samples = count;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_logic(struct context *ctx,
+	struct sr_datafeed_packet *packet_in,
+	struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	uint64_t num_samples, count;
+	uint8_t *out;
+
+	logic = packet_in->payload;
+	if (!logic->unitsize)
+		return SR_ERR_ARG;
+	if (logic->unitsize != ctx->unitsize)
+		logic_reset(ctx, logic->unitsize);
+
+	num_samples = logic->length / logic->unitsize;
+	out = get_outbuf(ctx, logic->data, ctx->logic_count == 0,
+		num_samples, logic->unitsize);
+	count = decimate_logic(ctx, logic->data, out, num_samples);
+	if (!count) {
+		*packet_out = NULL;
+		return SR_OK;
+	}
+
+	ctx->logic.length = count * logic->unitsize;
+	ctx->logic.unitsize = logic->unitsize;
+	ctx->logic.data = out;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Pass on a copy of the meta packet, with the output samplerate. */
+static void receive_meta(struct context *ctx,
+	struct sr_datafeed_packet *packet_in,
+	struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	GVariant *data;
+	uint64_t rate;
+
+	g_slist_free_full(ctx->meta.config, (GDestroyNotify)sr_config_free);
+	ctx->meta.config = NULL;
+
+	meta = packet_in->payload;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		data = src->data;
+		if (src->key == SR_CONF_SAMPLERATE) {
+			rate = g_variant_get_uint64(src->data);
+			rate = rate / ctx->factor * ctx->per_bucket;
+			data = g_variant_new_uint64(MAX(rate, 1));
+		}
+		ctx->meta.config = g_slist_append(ctx->meta.config,
+			sr_config_new(src->key, data));
+	}
+
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+	*packet_out = &ctx->packet;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	if (ctx->factor < 2)
+		return SR_OK;
+
+	switch (packet_in->type) {
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in, packet_out);
+	case SR_DF_META:
+		receive_meta(ctx, packet_in, packet_out);
+		break;
+	case SR_DF_HEADER:
+	case SR_DF_END:
+		/* Partial buckets don't carry over to the next acquisition. */
+		ctx->unitsize = 0;
+		g_hash_table_remove_all(ctx->analog_states);
+		break;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->analog_states);
+	g_slist_free_full(ctx->meta.config, (GDestroyNotify)sr_config_free);
+	g_free(ctx->states);
+	g_free(ctx->prev);
+	g_free(ctx->edges);
+	g_free(ctx->fbuf);
+	g_free(ctx->obuf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per output bucket (an incomplete last bucket is dropped)", NULL, NULL },
+	{ "mode", "Mode", "Bucket representation (envelope: min/max and edges, mean: average and last value)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_FACTOR));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("envelope"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("envelope")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("mean")));
+		options[1].values = l;
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the sample rate, keeping an envelope or the mean",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
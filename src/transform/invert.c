@@ -24,32 +24,113 @@
 
 #define LOG_PREFIX "transform/invert"
 
+struct context {
+	/* Selected channels, NULL selects all of them. */
+	GSList *channels;
+	/* Logic mask for the current unit size. */
+	struct sr_logic_mask *mask;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *spec;
+	char **names, *name;
+	GSList *l;
+	size_t i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	spec = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	names = g_strsplit(spec, ",", 0);
+	for (i = 0; names[i]; i++) {
+		name = g_strstrip(names[i]);
+		if (!*name)
+			continue;
+		for (l = t->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (strcmp(ch->name, name) == 0)
+				break;
+		}
+		if (!l) {
+			sr_err("Unknown channel '%s'.", name);
+			g_strfreev(names);
+			g_slist_free(ctx->channels);
+			g_free(ctx);
+			t->priv = NULL;
+			return SR_ERR_ARG;
+		}
+		ctx->channels = g_slist_append(ctx->channels, ch);
+	}
+	g_strfreev(names);
+
+	return SR_OK;
+}
+
+/* Build the mask which inverts the selected channels' bits. */
+static struct sr_logic_mask *create_mask(struct context *ctx, size_t unitsize)
+{
+	struct sr_logic_mask *mask;
+	struct sr_channel *ch;
+	uint8_t *bits;
+	GSList *l;
+
+	bits = g_malloc0(unitsize);
+	if (!ctx->channels)
+		memset(bits, 0xff, unitsize);
+	for (l = ctx->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if ((size_t)ch->index >= unitsize * 8)
+			continue;
+		bits[ch->index / 8] |= 1 << (ch->index % 8);
+	}
+	mask = sr_logic_mask_new(unitsize, NULL, bits);
+	g_free(bits);
+
+	return mask;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
+	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
+	struct sr_channel *ch;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
+	ctx = t->priv;
 
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
+		if (!logic->unitsize)
+			break;
+		if (!ctx->mask || ctx->mask->unitsize != logic->unitsize) {
+			sr_logic_mask_free(ctx->mask);
+			ctx->mask = create_mask(ctx, logic->unitsize);
 		}
+		sr_logic_mask_apply(ctx->mask, logic->data,
+			logic->length - logic->length % logic->unitsize);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
+		if (ctx->channels) {
+			ch = analog->meaning->channels ?
+				analog->meaning->channels->data : NULL;
+			if (!g_slist_find(ctx->channels, ch))
+				break;
+		}
 		p = analog->encoding->scale.p;
 		q = analog->encoding->scale.q;
 		if (q > INT64_MAX)
@@ -68,12 +149,41 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	sr_logic_mask_free(ctx->mask);
+	g_slist_free(ctx->channels);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to invert, all channels when empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
 SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
-	.options = NULL,
-	.init = NULL,
+	.options = get_options,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.cleanup = cleanup,
 };
@@ -43,6 +43,23 @@ static int init(struct sr_transform *t, GHashTable *options)
 	return SR_OK;
 }
 
+/*
+ * Multiply an encoding's scale or offset by the factor. When the exact
+ * product does not fit, fall back to a close approximation.
+ */
+static void scale_rational(struct sr_rational *r,
+		const struct sr_rational *factor)
+{
+	double value;
+
+	if (sr_rational_mult(r, r, factor) == SR_OK)
+		return;
+
+	value = (double)r->p / r->q * factor->p / factor->q;
+	sr_dbg("Rational overflow, approximating %g.", value);
+	sr_rational_from_double(r, value);
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
@@ -57,8 +74,9 @@ static int receive(const struct sr_transform *t,
 	switch (packet_in->type) {
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
-		analog->encoding->scale.p *= ctx->factor.p;
-		analog->encoding->scale.q *= ctx->factor.q;
+		scale_rational(&analog->encoding->scale, &ctx->factor);
+		/* Raw integer data can come with an offset, scale it too. */
+		scale_rational(&analog->encoding->offset, &ctx->factor);
 		break;
 	default:
 		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
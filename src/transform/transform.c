@@ -45,12 +45,14 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_decimate;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_decimate,
 	NULL,
 };
 
@@ -259,7 +261,10 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 		g_hash_table_destroy(new_opts);
 
 	/* Add the transform to the session's list of transforms. */
-	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	if (t) {
+		sr_dbg("Adding transform module '%s' to the session.", tmod->id);
+		sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	}
 
 	return t;
 }
@@ -52,6 +52,37 @@ struct usb_source {
 	GPtrArray *pollfds;
 };
 
+/** Snapshot of the USB device list, shared by all driver scans of a
+ * libsigrok context.
+ *
+ * Each driver used to walk the bus and read string descriptors on its
+ * own. With many drivers compiled in, a single scan enumerated the bus
+ * dozens of times and opened the same devices over and over. The cache
+ * holds one device list plus the string descriptors read so far, until
+ * a hotplug event, a firmware upload or the lifetime expires.
+ */
+struct sr_usb_cache {
+	GMutex mutex;
+	libusb_device **devlist;
+	ssize_t count;
+	int64_t expires_us;
+	/* Number of bus enumerations so far. */
+	uint64_t enumerations;
+	/* Key "bus.address.index", value the ASCII string descriptor. */
+	GHashTable *strings;
+	/* Set from the libusb hotplug callback, read with atomics. */
+	gint stale;
+	gboolean have_hotplug;
+	libusb_hotplug_callback_handle hotplug;
+};
+
+/*
+ * Upper bound on the age of a snapshot. Hotplug notifications are only
+ * delivered while libusb events get handled (i.e. during acquisition),
+ * so the lifetime catches bus changes between scans on an idle context.
+ */
+#define USB_CACHE_TTL_US (2 * 1000 * 1000)
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -379,10 +410,291 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
 	return valid ? SR_OK : SR_ERR_ARG;
 }
 
+static int LIBUSB_CALL usb_cache_hotplug_cb(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	struct sr_usb_cache *cache;
+
+	(void)usb_ctx;
+	(void)dev;
+	(void)event;
+
+	/*
+	 * This may run on whichever thread handles libusb events, so only
+	 * flag the snapshot. It gets rebuilt on the next lookup.
+	 */
+	cache = user_data;
+	g_atomic_int_set(&cache->stale, 1);
+
+	return 0;
+}
+
+static struct sr_usb_cache *usb_cache_get(struct sr_context *ctx)
+{
+	struct sr_usb_cache *cache;
+	int ret;
+
+	if (ctx->usb_cache)
+		return ctx->usb_cache;
+
+	cache = g_malloc0(sizeof(*cache));
+	g_mutex_init(&cache->mutex);
+	cache->strings = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		ret = libusb_hotplug_register_callback(ctx->libusb_ctx,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+			LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+			LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			usb_cache_hotplug_cb, cache, &cache->hotplug);
+		if (ret == LIBUSB_SUCCESS)
+			cache->have_hotplug = TRUE;
+		else
+			sr_dbg("Failed to register hotplug callback: %s.",
+			       libusb_error_name(ret));
+	}
+
+	ctx->usb_cache = cache;
+
+	return cache;
+}
+
+/* Must be called with the cache mutex held. */
+static void usb_cache_drop(struct sr_usb_cache *cache)
+{
+	if (cache->devlist)
+		libusb_free_device_list(cache->devlist, 1);
+	cache->devlist = NULL;
+	cache->count = 0;
+	g_hash_table_remove_all(cache->strings);
+}
+
+/* Must be called with the cache mutex held. */
+static ssize_t usb_cache_refresh(struct sr_context *ctx,
+		struct sr_usb_cache *cache)
+{
+	ssize_t cnt;
+	int64_t now;
+
+	now = g_get_monotonic_time();
+	if (cache->devlist && !g_atomic_int_get(&cache->stale)
+			&& now < cache->expires_us)
+		return cache->count;
+
+	usb_cache_drop(cache);
+	g_atomic_int_set(&cache->stale, 0);
+
+	cnt = libusb_get_device_list(ctx->libusb_ctx, &cache->devlist);
+	if (cnt < 0) {
+		cache->devlist = NULL;
+		return cnt;
+	}
+	cache->count = cnt;
+	cache->expires_us = now + USB_CACHE_TTL_US;
+	cache->enumerations++;
+	sr_spew("Enumerated %zd USB devices.", cnt);
+
+	return cnt;
+}
+
+/**
+ * Get the list of USB devices from the context's enumeration snapshot.
+ *
+ * Drop-in replacement for libusb_get_device_list() during scans. The
+ * bus is only enumerated again when the snapshot is stale.
+ *
+ * @param ctx The libsigrok context.
+ * @param[out] list The NULL terminated device list. Every device in it
+ *             holds a reference. Release with libusb_free_device_list()
+ *             and unref_devices set, just like a libusb list.
+ *
+ * @return The number of devices in the list, or a negative libusb
+ *         error code.
+ *
+ * @private
+ */
+SR_PRIV ssize_t sr_usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list)
+{
+	struct sr_usb_cache *cache;
+	libusb_device **copy;
+	ssize_t cnt, i;
+
+	cache = usb_cache_get(ctx);
+	g_mutex_lock(&cache->mutex);
+
+	cnt = usb_cache_refresh(ctx, cache);
+	if (cnt < 0) {
+		g_mutex_unlock(&cache->mutex);
+		return cnt;
+	}
+
+	/*
+	 * libusb_free_device_list() releases the array with free(), so the
+	 * copy must come from malloc() rather than from g_malloc().
+	 */
+	copy = malloc((cnt + 1) * sizeof(*copy));
+	if (!copy) {
+		g_mutex_unlock(&cache->mutex);
+		return LIBUSB_ERROR_NO_MEM;
+	}
+	for (i = 0; i < cnt; i++)
+		copy[i] = libusb_ref_device(cache->devlist[i]);
+	copy[cnt] = NULL;
+
+	g_mutex_unlock(&cache->mutex);
+
+	*list = copy;
+
+	return cnt;
+}
+
+/**
+ * Read an ASCII string descriptor, using the context's string cache.
+ *
+ * The device is only opened on a cache miss. Callers pass in a handle
+ * pointer set to NULL, and close the handle if it was set on return.
+ * This allows several strings of a device to be read with a single
+ * libusb_open().
+ *
+ * @param ctx The libsigrok context.
+ * @param dev The device to read from.
+ * @param[in,out] hdl Handle to use, opened here if it points to NULL.
+ * @param index The string descriptor index.
+ * @param[out] data Buffer receiving the NUL terminated string.
+ * @param length Size of the buffer.
+ *
+ * @return The string length, or a negative libusb error code.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_get_string(struct sr_context *ctx, libusb_device *dev,
+		libusb_device_handle **hdl, uint8_t index,
+		char *data, int length)
+{
+	struct sr_usb_cache *cache;
+	unsigned char strdesc[256];
+	const char *str;
+	char *key;
+	int ret;
+
+	if (index == 0 || length < 1)
+		return LIBUSB_ERROR_INVALID_PARAM;
+
+	cache = usb_cache_get(ctx);
+	key = g_strdup_printf("%d.%d.%d", libusb_get_bus_number(dev),
+		libusb_get_device_address(dev), index);
+
+	g_mutex_lock(&cache->mutex);
+	str = g_hash_table_lookup(cache->strings, key);
+	if (str) {
+		g_strlcpy(data, str, length);
+		g_mutex_unlock(&cache->mutex);
+		g_free(key);
+		return strlen(data);
+	}
+	g_mutex_unlock(&cache->mutex);
+
+	if (!*hdl && (ret = libusb_open(dev, hdl)) != LIBUSB_SUCCESS) {
+		*hdl = NULL;
+		g_free(key);
+		return ret;
+	}
+
+	/* Read the complete string, so the cache does not depend on length. */
+	ret = libusb_get_string_descriptor_ascii(*hdl, index,
+		strdesc, sizeof(strdesc));
+	if (ret < 0) {
+		g_free(key);
+		return ret;
+	}
+
+	g_mutex_lock(&cache->mutex);
+	g_hash_table_replace(cache->strings, key, g_strdup((char *)strdesc));
+	g_mutex_unlock(&cache->mutex);
+
+	g_strlcpy(data, (const char *)strdesc, length);
+
+	return strlen(data);
+}
+
+/**
+ * Mark the context's USB enumeration snapshot as outdated.
+ *
+ * Drivers call this after actions which change the bus without a
+ * hotplug notification being processed, like a firmware upload which
+ * makes the device renumerate.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_cache_invalidate(struct sr_context *ctx)
+{
+	if (ctx->usb_cache)
+		g_atomic_int_set(&ctx->usb_cache->stale, 1);
+}
+
+/**
+ * Get the number of bus enumerations of the context's USB snapshot.
+ *
+ * Tells whether lookups were served from the snapshot.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @return The number of enumerations since the context was created.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_usb_cache_enumerations(struct sr_context *ctx)
+{
+	struct sr_usb_cache *cache;
+	uint64_t count;
+
+	cache = ctx->usb_cache;
+	if (!cache)
+		return 0;
+
+	g_mutex_lock(&cache->mutex);
+	count = cache->enumerations;
+	g_mutex_unlock(&cache->mutex);
+
+	return count;
+}
+
+/**
+ * Release the context's USB enumeration snapshot.
+ *
+ * Must be called before the libusb context is destroyed.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_cache_free(struct sr_context *ctx)
+{
+	struct sr_usb_cache *cache;
+
+	cache = ctx->usb_cache;
+	if (!cache)
+		return;
+
+	if (cache->have_hotplug)
+		libusb_hotplug_deregister_callback(ctx->libusb_ctx,
+			cache->hotplug);
+	usb_cache_drop(cache);
+	g_hash_table_destroy(cache->strings);
+	g_mutex_clear(&cache->mutex);
+	g_free(cache);
+	ctx->usb_cache = NULL;
+}
+
 /**
  * Find USB devices according to a connection string.
  *
- * @param usb_ctx libusb context to use while scanning.
+ * @param ctx libsigrok context to use while scanning.
  * @param conn Connection string specifying the device(s) to match. This
  * can be of the form "<bus>.<address>", or "<vendorid>.<productid>".
  *
@@ -390,7 +702,7 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
  * matching the device that matched the connection string. The GSList and
  * its contents must be freed by the caller.
  */
-SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
+SR_PRIV GSList *sr_usb_find(struct sr_context *ctx, const char *conn)
 {
 	struct sr_usb_dev_inst *usb;
 	struct libusb_device **devlist;
@@ -412,7 +724,11 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 
 	/* Looks like a valid USB device specification, but is it connected? */
 	devices = NULL;
-	libusb_get_device_list(usb_ctx, &devlist);
+	if ((ret = sr_usb_get_device_list(ctx, &devlist)) < 0) {
+		sr_err("Failed to retrieve device list: %s.",
+		       libusb_error_name(ret));
+		return NULL;
+	}
 	for (i = 0; devlist[i]; i++) {
 		if ((ret = libusb_get_device_descriptor(devlist[i], &des))) {
 			sr_err("Failed to get device descriptor: %s.",
@@ -441,48 +757,65 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 	return devices;
 }
 
-SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
+SR_PRIV int sr_usb_open(struct sr_context *ctx, struct sr_usb_dev_inst *usb)
 {
 	struct libusb_device **devlist;
 	struct libusb_device_descriptor des;
-	int ret, r, cnt, i, a, b;
+	gboolean retry;
+	int ret, r, cnt, i, a, b, attempt;
 
 	sr_dbg("Trying to open USB device %d.%d.", usb->bus, usb->address);
 
-	if ((cnt = libusb_get_device_list(usb_ctx, &devlist)) < 0) {
-		sr_err("Failed to retrieve device list: %s.",
-		       libusb_error_name(cnt));
-		return SR_ERR;
-	}
-
 	ret = SR_ERR;
-	for (i = 0; i < cnt; i++) {
-		if ((r = libusb_get_device_descriptor(devlist[i], &des)) < 0) {
-			sr_err("Failed to get device descriptor: %s.",
-			       libusb_error_name(r));
-			continue;
+	for (attempt = 0; attempt < 2; attempt++) {
+		/*
+		 * The snapshot may predate a renumeration. When the device
+		 * is missing or gone, enumerate once more before giving up.
+		 */
+		if (attempt > 0)
+			sr_usb_cache_invalidate(ctx);
+
+		if ((cnt = sr_usb_get_device_list(ctx, &devlist)) < 0) {
+			sr_err("Failed to retrieve device list: %s.",
+			       libusb_error_name(cnt));
+			return SR_ERR;
 		}
 
-		b = libusb_get_bus_number(devlist[i]);
-		a = libusb_get_device_address(devlist[i]);
-		if (b != usb->bus || a != usb->address)
-			continue;
+		retry = TRUE;
+		for (i = 0; i < cnt; i++) {
+			if ((r = libusb_get_device_descriptor(devlist[i], &des)) < 0) {
+				sr_err("Failed to get device descriptor: %s.",
+				       libusb_error_name(r));
+				continue;
+			}
+
+			b = libusb_get_bus_number(devlist[i]);
+			a = libusb_get_device_address(devlist[i]);
+			if (b != usb->bus || a != usb->address)
+				continue;
+
+			if ((r = libusb_open(devlist[i], &usb->devhdl)) < 0) {
+				retry = (r == LIBUSB_ERROR_NO_DEVICE);
+				if (!retry || attempt > 0)
+					sr_err("Failed to open device: %s.",
+					       libusb_error_name(r));
+				break;
+			}
+
+			sr_dbg("Opened USB device (VID:PID = %04x:%04x, bus.address = "
+			       "%d.%d).", des.idVendor, des.idProduct, b, a);
 
-		if ((r = libusb_open(devlist[i], &usb->devhdl)) < 0) {
-			sr_err("Failed to open device: %s.",
-			       libusb_error_name(r));
+			ret = SR_OK;
+			retry = FALSE;
 			break;
 		}
 
-		sr_dbg("Opened USB device (VID:PID = %04x:%04x, bus.address = "
-		       "%d.%d).", des.idVendor, des.idProduct, b, a);
+		libusb_free_device_list(devlist, 1);
 
-		ret = SR_OK;
-		break;
+		if (!retry)
+			break;
 	}
 
-	libusb_free_device_list(devlist, 1);
-
 	return ret;
 }
 
@@ -562,13 +895,13 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
  * @return TRUE if the device's configuration profile strings
  *         configuration, FALSE otherwise.
  */
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product)
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product)
 {
 	struct libusb_device_descriptor des;
 	struct libusb_device_handle *hdl;
 	gboolean ret;
-	unsigned char strdesc[64];
+	char strdesc[64];
 
 	hdl = NULL;
 	ret = FALSE;
@@ -576,19 +909,16 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		/* Assume the FW has not been loaded, unless proven wrong. */
 		libusb_get_device_descriptor(dev, &des);
 
-		if (libusb_open(dev, &hdl) != 0)
-			break;
-
-		if (libusb_get_string_descriptor_ascii(hdl,
+		if (sr_usb_get_string(ctx, dev, &hdl,
 				des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
 			break;
-		if (strcmp((const char *)strdesc, manufacturer))
+		if (strcmp(strdesc, manufacturer))
 			break;
 
-		if (libusb_get_string_descriptor_ascii(hdl,
+		if (sr_usb_get_string(ctx, dev, &hdl,
 				des.iProduct, strdesc, sizeof(strdesc)) < 0)
 			break;
-		if (strcmp((const char *)strdesc, product))
+		if (strcmp(strdesc, product))
 			break;
 
 		ret = TRUE;
@@ -428,6 +428,282 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+START_TEST(test_analog_to_double_strided)
+{
+	int ret;
+	size_t i;
+	int16_t raw;
+	double want;
+	uint8_t data[2 * 37];
+	float fout[37], sout[3 * 37];
+	double dout[37];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	/*
+	 * Use enough values to involve vectorized conversion and its
+	 * remainder, and scale/offset factors which are exactly
+	 * representable, so that all variants yield identical results.
+	 */
+	for (i = 0; i < ARRAY_SIZE(dout); i++) {
+		raw = (int16_t)(i * 1789 - 32000);
+		data[2 * i + 0] = raw & 0xff;
+		data[2 * i + 1] = (raw >> 8) & 0xff;
+	}
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = ARRAY_SIZE(dout);
+	analog.data = data;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.unitsize = sizeof(raw);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = FALSE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 4;
+	encoding.offset.p = -3;
+	encoding.offset.q = 1;
+
+	for (i = 0; i < ARRAY_SIZE(sout); i++)
+		sout[i] = -1;
+	ret = sr_analog_to_float(&analog, fout);
+	fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+	ret = sr_analog_to_double(&analog, dout);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	ret = sr_analog_to_float_strided(&analog, sout, 3);
+	fail_unless(ret == SR_OK, "sr_analog_to_float_strided() failed: %d.", ret);
+
+	for (i = 0; i < ARRAY_SIZE(dout); i++) {
+		raw = (int16_t)(i * 1789 - 32000);
+		want = raw / 4.0 - 3;
+		fail_unless(dout[i] == want, "double %zu: %f != %f", i, dout[i], want);
+		fail_unless(fout[i] == (float)want, "float %zu: %f != %f", i, fout[i], want);
+		fail_unless(sout[3 * i] == (float)want, "strided %zu: %f != %f", i, sout[3 * i], want);
+		fail_unless(sout[3 * i + 1] == -1 && sout[3 * i + 2] == -1,
+			"strided %zu: gap was written to", i);
+	}
+
+	ret = sr_analog_to_double(&analog, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_to_float_strided(&analog, sout, 0);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* All integer and floating point encodings which the conversion supports. */
+static const struct conv_encoding {
+	const char *name;
+	gboolean is_float, is_signed, is_bigendian;
+	uint8_t unitsize;
+} conv_encodings[] = {
+	{ "u8", FALSE, FALSE, FALSE, 1, },
+	{ "i8", FALSE, TRUE, FALSE, 1, },
+	{ "u16le", FALSE, FALSE, FALSE, 2, },
+	{ "u16be", FALSE, FALSE, TRUE, 2, },
+	{ "i16le", FALSE, TRUE, FALSE, 2, },
+	{ "i16be", FALSE, TRUE, TRUE, 2, },
+	{ "u32le", FALSE, FALSE, FALSE, 4, },
+	{ "u32be", FALSE, FALSE, TRUE, 4, },
+	{ "i32le", FALSE, TRUE, FALSE, 4, },
+	{ "i32be", FALSE, TRUE, TRUE, 4, },
+	{ "fltle", TRUE, TRUE, FALSE, 4, },
+	{ "fltbe", TRUE, TRUE, TRUE, 4, },
+	{ "dblle", TRUE, TRUE, FALSE, 8, },
+	{ "dblbe", TRUE, TRUE, TRUE, 8, },
+};
+
+/* Decode one input value without help of the library. */
+static double conv_reference(const struct conv_encoding *e, const uint8_t *p)
+{
+	uint64_t raw;
+	size_t i;
+	union { uint32_t u; float f; } u32;
+	union { uint64_t u; double d; } u64;
+
+	raw = 0;
+	for (i = 0; i < e->unitsize; i++) {
+		raw <<= 8;
+		raw |= p[e->is_bigendian ? i : e->unitsize - 1 - i];
+	}
+	if (e->is_float && e->unitsize == 4) {
+		u32.u = raw;
+		return u32.f;
+	}
+	if (e->is_float) {
+		u64.u = raw;
+		return u64.d;
+	}
+	if (e->is_signed && e->unitsize < 8 && (raw >> (8 * e->unitsize - 1)))
+		raw |= ~UINT64_C(0) << (8 * e->unitsize);
+
+	return e->is_signed ? (double)(int64_t)raw : (double)raw;
+}
+
+/* Fill in test data which includes the extremes of integer types. */
+static void conv_fill(const struct conv_encoding *e, uint8_t *data, size_t count)
+{
+	size_t i, b;
+	uint32_t seed;
+	union { uint32_t u; float f; } u32;
+	union { uint64_t u; double d; } u64;
+	uint64_t raw;
+
+	seed = 1;
+	for (i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		raw = seed ^ ((uint64_t)seed << 29);
+		if (i % 8 == 1)
+			raw = 0;
+		else if (i % 8 == 3)
+			raw = ~UINT64_C(0);
+		else if (i % 8 == 5)
+			raw = UINT64_C(1) << (8 * e->unitsize - 1);
+		if (e->is_float && e->unitsize == 4) {
+			u32.f = (int16_t)seed / 64.0f;
+			raw = u32.u;
+		} else if (e->is_float) {
+			u64.d = (int64_t)raw / 65536.0;
+			raw = u64.u;
+		}
+		for (b = 0; b < e->unitsize; b++) {
+			data[i * e->unitsize + (e->is_bigendian ? e->unitsize - 1 - b : b)] = raw & 0xff;
+			raw >>= 8;
+		}
+	}
+}
+
+/*
+ * Cross check the vectorized and the scalar conversion of all supported
+ * encodings against a reference. Contiguous output involves the SIMD
+ * kernels where the host supports them, strided output always uses the
+ * scalar kernels. The value count leaves a remainder for the scalar
+ * kernels. Floating point test data is exactly representable after
+ * scale and offset got applied, which keeps the native single precision
+ * path comparable.
+ */
+START_TEST(test_analog_conv_kernels)
+{
+	const struct conv_encoding *e;
+	int ret;
+	size_t idx, i;
+	double want;
+	uint8_t data[8 * 37];
+	float fout[37], sout[2 * 37];
+	double dout[37];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = ARRAY_SIZE(fout);
+	analog.data = data;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.scale.p = 3;
+	encoding.scale.q = 8;
+	encoding.offset.p = -5;
+	encoding.offset.q = 2;
+
+	for (idx = 0; idx < ARRAY_SIZE(conv_encodings); idx++) {
+		e = &conv_encodings[idx];
+		conv_fill(e, data, ARRAY_SIZE(fout));
+		encoding.unitsize = e->unitsize;
+		encoding.is_float = e->is_float;
+		encoding.is_signed = e->is_signed;
+		encoding.is_bigendian = e->is_bigendian;
+
+		ret = sr_analog_to_float(&analog, fout);
+		fail_unless(ret == SR_OK, "%s: to_float failed: %d.", e->name, ret);
+		ret = sr_analog_to_double(&analog, dout);
+		fail_unless(ret == SR_OK, "%s: to_double failed: %d.", e->name, ret);
+		ret = sr_analog_to_float_strided(&analog, sout, 2);
+		fail_unless(ret == SR_OK, "%s: to_float_strided failed: %d.", e->name, ret);
+
+		for (i = 0; i < ARRAY_SIZE(fout); i++) {
+			want = conv_reference(e, &data[i * e->unitsize]);
+			want *= 3 / 8.0;
+			want += -5 / 2.0;
+			fail_unless(dout[i] == want, "%s: double %zu: %g != %g",
+				e->name, i, dout[i], want);
+			fail_unless(fout[i] == (float)want, "%s: float %zu: %g != %g",
+				e->name, i, fout[i], want);
+			fail_unless(sout[2 * i] == (float)want, "%s: strided float %zu: %g != %g",
+				e->name, i, sout[2 * i], want);
+		}
+	}
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/*
+ * Benchmark the conversion of all supported encodings to single and
+ * double precision. Run the test suite with CK_VERBOSE and G_MESSAGES_DEBUG
+ * set to see the rates.
+ */
+#define BENCH_SAMPLES (4 * 1024 * 1024)
+
+START_TEST(test_analog_conv_bench)
+{
+	const struct conv_encoding *e;
+	int ret;
+	size_t idx;
+	uint8_t *data;
+	float *fout;
+	double *dout;
+	gint64 start, usecs;
+	char what[32];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	data = g_malloc(8 * BENCH_SAMPLES);
+	fout = g_malloc(BENCH_SAMPLES * sizeof(fout[0]));
+	dout = g_malloc(BENCH_SAMPLES * sizeof(dout[0]));
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = BENCH_SAMPLES;
+	analog.data = data;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.scale.p = 1;
+	encoding.scale.q = 1000;
+
+	for (idx = 0; idx < ARRAY_SIZE(conv_encodings); idx++) {
+		e = &conv_encodings[idx];
+		conv_fill(e, data, BENCH_SAMPLES);
+		encoding.unitsize = e->unitsize;
+		encoding.is_float = e->is_float;
+		encoding.is_signed = e->is_signed;
+		encoding.is_bigendian = e->is_bigendian;
+
+		start = g_get_monotonic_time();
+		ret = sr_analog_to_float(&analog, fout);
+		usecs = g_get_monotonic_time() - start;
+		fail_unless(ret == SR_OK, "%s: to_float failed: %d.", e->name, ret);
+		snprintf(what, sizeof(what), "%s to float", e->name);
+		srtest_bench_report(what, BENCH_SAMPLES, "S", usecs);
+
+		start = g_get_monotonic_time();
+		ret = sr_analog_to_double(&analog, dout);
+		usecs = g_get_monotonic_time() - start;
+		fail_unless(ret == SR_OK, "%s: to_double failed: %d.", e->name, ret);
+		snprintf(what, sizeof(what), "%s to double", e->name);
+		srtest_bench_report(what, BENCH_SAMPLES, "S", usecs);
+	}
+
+	g_slist_free(meaning.channels);
+	g_free(dout);
+	g_free(fout);
+	g_free(data);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -697,6 +973,13 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_double_strided);
+	tcase_add_test(tc, test_analog_conv_kernels);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("analog_conv_bench");
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_analog_conv_bench);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
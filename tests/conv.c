@@ -238,6 +238,434 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+/*
+ * Reference implementation of the planar to logic conversion, which
+ * tests one bit at a time (like drivers used to do before the common
+ * helper was introduced).
+ */
+static void planar_to_logic_ref(uint8_t *dst, size_t unitsize,
+	const uint8_t *src, size_t batch_count, size_t word_bits,
+	gboolean msb_first, const uint8_t *channel_map, size_t channel_count)
+{
+	size_t word_bytes, batch, ch, idx, sample, bitpos;
+	const uint8_t *word;
+	uint64_t value;
+
+	word_bytes = word_bits / 8;
+	memset(dst, 0, batch_count * word_bits * unitsize);
+	for (batch = 0; batch < batch_count; batch++) {
+		for (ch = 0; ch < channel_count; ch++) {
+			word = &src[(batch * channel_count + ch) * word_bytes];
+			value = 0;
+			for (idx = 0; idx < word_bytes; idx++)
+				value |= (uint64_t)word[idx] << (8 * idx);
+			bitpos = channel_map ? channel_map[ch] : ch;
+			for (sample = 0; sample < word_bits; sample++) {
+				idx = msb_first ? word_bits - 1 - sample : sample;
+				if (!(value & (UINT64_C(1) << idx)))
+					continue;
+				idx = (batch * word_bits + sample) * unitsize;
+				dst[idx + bitpos / 8] |= 1 << (bitpos % 8);
+			}
+		}
+	}
+}
+
+static void check_planar_to_logic(size_t unitsize, size_t word_bits,
+	gboolean msb_first, const uint8_t *channel_map, size_t channel_count)
+{
+	const size_t batch_count = 100;
+	uint8_t *src, *dst, *ref;
+	size_t src_len, dst_len, idx;
+	int ret;
+
+	src_len = batch_count * channel_count * word_bits / 8;
+	dst_len = batch_count * word_bits * unitsize;
+	src = g_malloc(src_len);
+	dst = g_malloc(dst_len);
+	ref = g_malloc(dst_len);
+	for (idx = 0; idx < src_len; idx++)
+		src[idx] = g_random_int();
+	memset(dst, 0xa5, dst_len);
+
+	planar_to_logic_ref(ref, unitsize, src, batch_count, word_bits,
+		msb_first, channel_map, channel_count);
+	ret = sr_planar_to_logic(dst, unitsize, src, batch_count, word_bits,
+		msb_first, channel_map, channel_count);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(dst, ref, dst_len) == 0,
+		"Mismatch, unitsize %zu, word %zu bits, %zu channels.",
+		unitsize, word_bits, channel_count);
+
+	g_free(src);
+	g_free(dst);
+	g_free(ref);
+}
+
+START_TEST(test_planar_to_logic_dense)
+{
+	size_t unitsize, word_bits, count;
+
+	for (unitsize = 1; unitsize <= 8; unitsize++) {
+		for (word_bits = 8; word_bits <= 64; word_bits *= 2) {
+			for (count = 1; count <= 8 * unitsize; count++) {
+				check_planar_to_logic(unitsize, word_bits,
+					FALSE, NULL, count);
+				check_planar_to_logic(unitsize, word_bits,
+					TRUE, NULL, count);
+			}
+		}
+	}
+}
+END_TEST
+
+START_TEST(test_planar_to_logic_sparse)
+{
+	/* Channel layouts similar to what the USB drivers see. */
+	static const uint8_t map_odd[] = { 1, 3, 5, 7, 9, 11, 13, 15, };
+	static const uint8_t map_some[] = { 0, 2, 3, 12, };
+	static const uint8_t map_wide[] = { 31, 0, 17, 8, 24, 5, };
+
+	check_planar_to_logic(2, 64, FALSE, map_odd, ARRAY_SIZE(map_odd));
+	check_planar_to_logic(2, 16, TRUE, map_odd, ARRAY_SIZE(map_odd));
+	check_planar_to_logic(2, 32, TRUE, map_some, ARRAY_SIZE(map_some));
+	check_planar_to_logic(2, 16, FALSE, map_some, ARRAY_SIZE(map_some));
+	check_planar_to_logic(4, 16, FALSE, map_wide, ARRAY_SIZE(map_wide));
+}
+END_TEST
+
+/*
+ * Convert a DSLogic like capture (16 channels, 64bit words) and report
+ * the throughput of the transpose and of the bitwise reference (debug
+ * log). Both must produce the same output.
+ */
+START_TEST(test_planar_to_logic_bench)
+{
+	const size_t batch_count = 32 * 1024;
+	const size_t channel_count = 16, word_bits = 64, unitsize = 2;
+	uint8_t *src, *dst, *ref;
+	size_t src_len, dst_len, idx;
+	gint64 start, usecs, ref_usecs;
+	int ret;
+
+	src_len = batch_count * channel_count * word_bits / 8;
+	dst_len = batch_count * word_bits * unitsize;
+	src = g_malloc(src_len);
+	dst = g_malloc(dst_len);
+	ref = g_malloc(dst_len);
+	for (idx = 0; idx < src_len; idx++)
+		src[idx] = g_random_int();
+
+	start = g_get_monotonic_time();
+	planar_to_logic_ref(ref, unitsize, src, batch_count, word_bits,
+		FALSE, NULL, channel_count);
+	ref_usecs = g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	ret = sr_planar_to_logic(dst, unitsize, src, batch_count, word_bits,
+		FALSE, NULL, channel_count);
+	usecs = g_get_monotonic_time() - start;
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(dst, ref, dst_len) == 0, "Output mismatch.");
+
+	g_debug("Planar to logic: %zu bytes in %" PRIi64 " us, %.1f MB/s "
+		"(reference %" PRIi64 " us).", src_len, usecs,
+		usecs ? (double)src_len / usecs : 0.0, ref_usecs);
+
+	g_free(src);
+	g_free(dst);
+	g_free(ref);
+}
+END_TEST
+
+START_TEST(test_planar_to_logic_args)
+{
+	static const uint8_t map_bad[] = { 0, 16, };
+	uint8_t src[16], dst[64 * 2];
+
+	memset(src, 0, sizeof(src));
+	fail_unless(sr_planar_to_logic(NULL, 2, src, 1, 64, FALSE, NULL, 2) == SR_ERR_ARG);
+	fail_unless(sr_planar_to_logic(dst, 0, src, 1, 64, FALSE, NULL, 2) == SR_ERR_ARG);
+	fail_unless(sr_planar_to_logic(dst, 2, src, 1, 12, FALSE, NULL, 2) == SR_ERR_ARG);
+	fail_unless(sr_planar_to_logic(dst, 2, src, 1, 64, FALSE, NULL, 17) == SR_ERR_ARG);
+	fail_unless(sr_planar_to_logic(dst, 2, src, 1, 64, FALSE, map_bad, 2) == SR_ERR_ARG);
+}
+END_TEST
+
+/* Bytewise reference for the change detection. */
+static size_t find_change_ref(const uint8_t *data, size_t count,
+	size_t unitsize, const uint8_t *ref)
+{
+	size_t idx;
+
+	for (idx = 0; idx < count; idx++) {
+		if (memcmp(&data[idx * unitsize], ref, unitsize) != 0)
+			break;
+	}
+
+	return idx;
+}
+
+static void fill_run(uint8_t *dst, const uint8_t *value, size_t unitsize,
+	size_t count)
+{
+	while (count--) {
+		memcpy(dst, value, unitsize);
+		dst += unitsize;
+	}
+}
+
+/*
+ * Place a single change at every position of runs which cover several
+ * vector widths, at every buffer alignment. The kernels must agree with
+ * the bytewise reference, also for a difference in the last byte of a
+ * unit, and when no change is present at all.
+ */
+START_TEST(test_logic_find_change)
+{
+	static const size_t unitsizes[] = { 1, 2, 3, 4, 5, 8, 16, 17, };
+	const size_t count = 96;
+	uint8_t *buf, *data, ref[17];
+	size_t us_idx, unitsize, offset, pos, byte, got, expect;
+
+	buf = g_malloc(count * 17 + 64);
+	for (us_idx = 0; us_idx < ARRAY_SIZE(unitsizes); us_idx++) {
+		unitsize = unitsizes[us_idx];
+		for (byte = 0; byte < unitsize; byte++)
+			ref[byte] = 0x5a + byte;
+		for (offset = 0; offset < 32; offset += 7) {
+			data = &buf[offset];
+			for (pos = 0; pos <= count; pos++) {
+				fill_run(data, ref, unitsize, count);
+				byte = pos % unitsize;
+				if (pos < count)
+					data[pos * unitsize + byte] ^= 1 << (pos % 8);
+				expect = find_change_ref(data, count, unitsize, ref);
+				got = sr_logic_find_change(data, count,
+					unitsize, ref);
+				fail_unless(got == expect && expect == pos,
+					"Mismatch, unitsize %zu, offset %zu, "
+					"change at %zu, got %zu.",
+					unitsize, offset, pos, got);
+				/* A shorter buffer ends before the change. */
+				got = sr_logic_find_change(data, pos / 2,
+					unitsize, ref);
+				fail_unless(got == pos / 2,
+					"Mismatch, unitsize %zu, count %zu.",
+					unitsize, pos / 2);
+			}
+		}
+		/* The first sample is compared against the reference. */
+		memset(buf, 0, count * unitsize);
+		fail_unless(sr_logic_find_change(buf, count, unitsize, ref) == 0,
+			"Missed a change at the start, unitsize %zu.", unitsize);
+	}
+	fail_unless(sr_logic_find_change(buf, 0, 1, ref) == 0);
+	g_free(buf);
+}
+END_TEST
+
+/*
+ * Scan a buffer with a few long runs of unchanged samples, like VCD
+ * output sees for slow signals, and report the throughput of the
+ * kernel and of the bytewise reference (debug log).
+ */
+START_TEST(test_logic_find_change_bench)
+{
+	const size_t count = 8 * 1024 * 1024, unitsize = 2, runs = 16;
+	uint8_t *data, value[2];
+	size_t idx, pos, got, changes;
+	gint64 start, usecs, ref_usecs;
+
+	data = g_malloc(count * unitsize);
+	for (idx = 0; idx < runs; idx++) {
+		value[0] = idx;
+		value[1] = ~idx;
+		fill_run(&data[idx * count / runs * unitsize],
+			value, unitsize, count / runs);
+	}
+
+	start = g_get_monotonic_time();
+	changes = 0;
+	for (pos = 0; pos < count; pos += got, changes++) {
+		got = find_change_ref(&data[pos * unitsize], count - pos,
+			unitsize, &data[pos * unitsize]);
+		got = MAX(got, 1);
+	}
+	ref_usecs = g_get_monotonic_time() - start;
+	fail_unless(changes == runs, "Reference found %zu runs.", changes);
+
+	start = g_get_monotonic_time();
+	changes = 0;
+	for (pos = 0; pos < count; pos += got, changes++) {
+		got = sr_logic_find_change(&data[pos * unitsize], count - pos,
+			unitsize, &data[pos * unitsize]);
+		got = MAX(got, 1);
+	}
+	usecs = g_get_monotonic_time() - start;
+	fail_unless(changes == runs, "Kernel found %zu runs.", changes);
+
+	g_debug("Change detection: %zu bytes in %" PRIi64 " us, %.1f MB/s "
+		"(reference %" PRIi64 " us).", count * unitsize, usecs,
+		usecs ? (double)count * unitsize / usecs : 0.0, ref_usecs);
+
+	g_free(data);
+}
+END_TEST
+
+/* Bytewise reference for the logic mask. */
+static void logic_mask_ref(uint8_t *data, size_t count, size_t unitsize,
+	const uint8_t *and_mask, const uint8_t *xor_mask)
+{
+	size_t idx, byte;
+
+	for (idx = 0; idx < count; idx++) {
+		for (byte = 0; byte < unitsize; byte++) {
+			data[idx * unitsize + byte] &= and_mask[byte];
+			data[idx * unitsize + byte] ^= xor_mask[byte];
+		}
+	}
+}
+
+/*
+ * Apply random masks to random data, for unit sizes which do and do not
+ * divide the vector width, at every buffer alignment, and for lengths
+ * which end within a vector. The kernels must agree with the reference.
+ */
+START_TEST(test_logic_mask)
+{
+	static const size_t unitsizes[] = { 1, 2, 3, 4, 5, 7, 8, 12, 16, 31, 33, };
+	static const size_t counts[] = { 0, 1, 5, 17, 100, 1001, };
+	struct sr_logic_mask *mask;
+	uint8_t *buf, *data, *ref, and_mask[33], xor_mask[33];
+	size_t us_idx, c_idx, unitsize, count, offset, idx, len;
+
+	buf = g_malloc(1001 * 33 + 32);
+	ref = g_malloc(1001 * 33);
+	for (us_idx = 0; us_idx < ARRAY_SIZE(unitsizes); us_idx++) {
+		unitsize = unitsizes[us_idx];
+		for (idx = 0; idx < unitsize; idx++) {
+			and_mask[idx] = g_random_int();
+			xor_mask[idx] = g_random_int();
+		}
+		mask = sr_logic_mask_new(unitsize, and_mask, xor_mask);
+		fail_unless(mask != NULL);
+		for (c_idx = 0; c_idx < ARRAY_SIZE(counts); c_idx++) {
+			count = counts[c_idx];
+			len = count * unitsize;
+			for (offset = 0; offset < 32; offset += 5) {
+				data = &buf[offset];
+				for (idx = 0; idx < len; idx++)
+					data[idx] = ref[idx] = g_random_int();
+				logic_mask_ref(ref, count, unitsize,
+					and_mask, xor_mask);
+				sr_logic_mask_apply(mask, data, len);
+				fail_unless(memcmp(data, ref, len) == 0,
+					"Mismatch, unitsize %zu, %zu samples, "
+					"offset %zu.", unitsize, count, offset);
+			}
+		}
+		sr_logic_mask_free(mask);
+	}
+
+	/* Omitted masks keep all bits, and invert none. */
+	mask = sr_logic_mask_new(3, NULL, NULL);
+	for (idx = 0; idx < 300; idx++)
+		buf[idx] = ref[idx] = idx;
+	sr_logic_mask_apply(mask, buf, 300);
+	fail_unless(memcmp(buf, ref, 300) == 0, "Default mask changed data.");
+	sr_logic_mask_free(mask);
+	fail_unless(sr_logic_mask_new(0, NULL, NULL) == NULL);
+
+	g_free(buf);
+	g_free(ref);
+}
+END_TEST
+
+/*
+ * Invert a few channels of a 16 channel capture, as the invert
+ * transform does, and report the throughput of the kernel and of the
+ * bytewise reference (debug log).
+ */
+START_TEST(test_logic_mask_bench)
+{
+	const size_t count = 8 * 1024 * 1024, unitsize = 2;
+	static const uint8_t and_mask[] = { 0xff, 0xff, };
+	static const uint8_t xor_mask[] = { 0x05, 0x80, };
+	struct sr_logic_mask *mask;
+	uint8_t *data, *ref;
+	size_t idx;
+	gint64 start, usecs, ref_usecs;
+
+	data = g_malloc(count * unitsize);
+	ref = g_malloc(count * unitsize);
+	for (idx = 0; idx < count * unitsize; idx++)
+		data[idx] = ref[idx] = g_random_int();
+	mask = sr_logic_mask_new(unitsize, and_mask, xor_mask);
+
+	start = g_get_monotonic_time();
+	logic_mask_ref(ref, count, unitsize, and_mask, xor_mask);
+	ref_usecs = g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	sr_logic_mask_apply(mask, data, count * unitsize);
+	usecs = g_get_monotonic_time() - start;
+	fail_unless(memcmp(data, ref, count * unitsize) == 0,
+		"Output mismatch.");
+
+	g_debug("Logic mask: %zu bytes in %" PRIi64 " us, %.1f MB/s "
+		"(reference %" PRIi64 " us).", count * unitsize, usecs,
+		usecs ? (double)count * unitsize / usecs : 0.0, ref_usecs);
+
+	sr_logic_mask_free(mask);
+	g_free(data);
+	g_free(ref);
+}
+END_TEST
+
+START_TEST(test_logic_rle_expand)
+{
+	static const uint16_t values[] = { 0x1234, 0xabcd, 0x0000, 0xffff, };
+	static const uint64_t counts[] = { 1, 5, 300, 2, };
+	struct sr_datafeed_logic_rle rle;
+	uint8_t dst[400 * sizeof(uint16_t)], *wrptr;
+	uint64_t run_idx, run_pos, total, count, chunk;
+	size_t run, idx, pos;
+
+	rle.num_runs = ARRAY_SIZE(values);
+	rle.unitsize = sizeof(values[0]);
+	rle.values = (void *)values;
+	rle.counts = (uint64_t *)counts;
+	total = sr_logic_rle_sample_count(&rle);
+	fail_unless(total == 308, "Unexpected sample count %" PRIu64, total);
+
+	/* Expand in chunks of differing size, which split runs. */
+	for (chunk = 1; chunk <= total; chunk += 7) {
+		memset(dst, 0x55, sizeof(dst));
+		run_idx = 0;
+		run_pos = 0;
+		wrptr = dst;
+		count = 0;
+		while ((idx = sr_logic_rle_expand(&rle, &run_idx, &run_pos,
+				wrptr, chunk))) {
+			fail_unless(idx <= chunk);
+			wrptr += idx * rle.unitsize;
+			count += idx;
+		}
+		fail_unless(count == total);
+		idx = 0;
+		for (run = 0; run < rle.num_runs; run++) {
+			for (pos = 0; pos < counts[run]; pos++, idx++) {
+				fail_unless(!memcmp(&dst[idx * rle.unitsize],
+					&values[run], rle.unitsize),
+					"Mismatch at sample %zu, chunk %" PRIu64,
+					idx, chunk);
+			}
+		}
+	}
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -253,5 +681,28 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("planar");
+	tcase_add_test(tc, test_planar_to_logic_dense);
+	tcase_add_test(tc, test_planar_to_logic_sparse);
+	tcase_add_test(tc, test_planar_to_logic_args);
+	tcase_add_test(tc, test_planar_to_logic_bench);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("rle");
+	tcase_add_test(tc, test_logic_rle_expand);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("change");
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_logic_find_change);
+	tcase_add_test(tc, test_logic_find_change_bench);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("mask");
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_logic_mask);
+	tcase_add_test(tc, test_logic_mask_bench);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,384 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#ifdef HAVE_HW_DEMO
+
+/* Number of samples to acquire, and the packet size to request. */
+#define BENCH_SAMPLES		(16 * 1024 * 1024)
+#define BENCH_PACKET_SAMPLES	(64 * 1024)
+#define BENCH_LOGIC_CHANNELS	16
+
+static struct sr_dev_inst *demo_scan(int num_logic, int num_analog)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config src_logic, src_analog;
+	GSList *options, *devices;
+	struct sr_dev_inst *sdi;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+
+	src_logic.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	src_logic.data = g_variant_ref_sink(g_variant_new_int32(num_logic));
+	src_analog.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	src_analog.data = g_variant_ref_sink(g_variant_new_int32(num_analog));
+	options = g_slist_append(NULL, &src_logic);
+	options = g_slist_append(options, &src_analog);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(src_logic.data);
+	g_variant_unref(src_analog.data);
+	fail_unless(devices != NULL, "No demo device found.");
+
+	sdi = devices->data;
+	g_slist_free(devices);
+	ret = sr_dev_open(sdi);
+	fail_unless(ret == SR_OK, "sr_dev_open() error: %d", ret);
+
+	return sdi;
+}
+
+/*
+ * Run the demo device's benchmark mode through a session. All samples
+ * must arrive in packets of the requested size. The achieved rate gets
+ * reported by the driver (info log), and here (debug log).
+ */
+START_TEST(test_demo_benchmark)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	struct srtest_feed feed;
+	gint64 usecs;
+	int ret;
+
+	sdi = demo_scan(BENCH_LOGIC_CHANNELS, 0);
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+		g_variant_new_string("benchmark"));
+	fail_unless(ret == SR_OK, "Cannot select benchmark mode: %d", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE,
+		g_variant_new_uint64(BENCH_PACKET_SAMPLES));
+	fail_unless(ret == SR_OK, "Cannot set packet size: %d", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(BENCH_SAMPLES));
+	fail_unless(ret == SR_OK, "Cannot set sample limit: %d", ret);
+
+	memset(&feed, 0, sizeof(feed));
+	sr_session_new(srtest_ctx, &session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, srtest_feed_in, &feed);
+
+	usecs = srtest_session_run(session);
+
+	fail_unless(feed.seen_header, "No SR_DF_HEADER seen.");
+	fail_unless(feed.seen_end, "No SR_DF_END seen.");
+	fail_unless(feed.logic_unitsize == BENCH_LOGIC_CHANNELS / 8,
+		"Unexpected unit size %u.", feed.logic_unitsize);
+	fail_unless(feed.logic_bytes == BENCH_SAMPLES * feed.logic_unitsize,
+		"Unexpected data amount: %" PRIu64 ".", feed.logic_bytes);
+	fail_unless(feed.logic_max_packet ==
+		BENCH_PACKET_SAMPLES * feed.logic_unitsize,
+		"Unexpected packet size: %" PRIu64 ".", feed.logic_max_packet);
+
+	srtest_bench_report("Demo benchmark", BENCH_SAMPLES, "S", usecs);
+
+	sr_session_destroy(session);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Packet size and sample count for the checks of the sent data. */
+#define CHECK_PACKET_SAMPLES	300
+#define CHECK_PACKETS		50
+#define CHECK_FRAMES		5
+/* Samples per frame, as the driver's SAMPLES_PER_FRAME. */
+#define CHECK_FRAME_SAMPLES	1000
+
+struct packet_check {
+	GByteArray *first;
+	GByteArray *data;
+	uint64_t packets;
+	uint64_t frames;
+	uint64_t frame_samples;
+	gboolean in_frame;
+	gboolean seen_end;
+};
+
+static void check_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct packet_check *chk;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	chk = cb_data;
+	switch (packet->type) {
+	case SR_DF_FRAME_BEGIN:
+		fail_unless(!chk->in_frame, "Nested frame.");
+		chk->in_frame = TRUE;
+		chk->frame_samples = 0;
+		break;
+	case SR_DF_FRAME_END:
+		fail_unless(chk->in_frame, "Frame end without a begin.");
+		fail_unless(chk->frame_samples == CHECK_FRAME_SAMPLES,
+			"Frame %" PRIu64 " holds %" PRIu64 " samples.",
+			chk->frames, chk->frame_samples);
+		chk->in_frame = FALSE;
+		chk->frames++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!chk->first) {
+			chk->first = g_byte_array_new();
+			g_byte_array_append(chk->first, logic->data,
+				logic->length);
+		}
+		g_byte_array_append(chk->data, logic->data, logic->length);
+		chk->frame_samples += logic->length / logic->unitsize;
+		chk->packets++;
+		break;
+	case SR_DF_END:
+		chk->seen_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+static void demo_run_check(struct sr_dev_inst *sdi, gboolean invert,
+	struct packet_check *chk)
+{
+	struct sr_session *session;
+	const struct sr_transform *t;
+	int ret;
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_TEST_MODE,
+		g_variant_new_string("benchmark"));
+	fail_unless(ret == SR_OK, "Cannot select benchmark mode: %d", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE,
+		g_variant_new_uint64(CHECK_PACKET_SAMPLES));
+	fail_unless(ret == SR_OK, "Cannot set packet size: %d", ret);
+
+	memset(chk, 0, sizeof(*chk));
+	chk->data = g_byte_array_new();
+	sr_session_new(srtest_ctx, &session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, check_in, chk);
+	t = NULL;
+	if (invert) {
+		t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+		fail_unless(t != NULL, "Cannot create transform.");
+	}
+
+	ret = sr_session_start(session);
+	fail_unless(ret == SR_OK, "sr_session_start() error: %d", ret);
+	ret = sr_session_run(session);
+	fail_unless(ret == SR_OK, "sr_session_run() error: %d", ret);
+	fail_unless(chk->seen_end, "No SR_DF_END seen.");
+
+	sr_session_destroy(session);
+	if (t)
+		sr_transform_free(t);
+	sr_dev_close(sdi);
+}
+
+static void packet_check_free(struct packet_check *chk)
+{
+	if (chk->first)
+		g_byte_array_free(chk->first, TRUE);
+	g_byte_array_free(chk->data, TRUE);
+}
+
+/*
+ * Benchmark mode sends the same block over and over again. An in place
+ * transform must not change what later packets carry: all packets must
+ * be identical, the last one may be shorter.
+ */
+START_TEST(test_demo_benchmark_invert)
+{
+	struct sr_dev_inst *sdi;
+	struct packet_check chk;
+	size_t len, pos, unitsize;
+	int ret;
+
+	sdi = demo_scan(BENCH_LOGIC_CHANNELS, 0);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(CHECK_PACKETS * CHECK_PACKET_SAMPLES + 100));
+	fail_unless(ret == SR_OK, "Cannot set sample limit: %d", ret);
+	demo_run_check(sdi, TRUE, &chk);
+
+	unitsize = BENCH_LOGIC_CHANNELS / 8;
+	fail_unless(chk.packets == CHECK_PACKETS + 1,
+		"Unexpected packet count: %" PRIu64 ".", chk.packets);
+	fail_unless(chk.first->len == CHECK_PACKET_SAMPLES * unitsize,
+		"Unexpected packet size: %u.", chk.first->len);
+	for (pos = 0; pos < chk.data->len; pos += len) {
+		len = MIN(chk.data->len - pos, chk.first->len);
+		fail_unless(!memcmp(&chk.data->data[pos], chk.first->data, len),
+			"Packet at offset %zu differs.", pos);
+	}
+
+	packet_check_free(&chk);
+}
+END_TEST
+
+/*
+ * Frames hold a fixed number of samples also in benchmark mode, when
+ * it is not a multiple of the packet size. The data must continue the
+ * repeated block across frame boundaries.
+ */
+START_TEST(test_demo_benchmark_frames)
+{
+	struct sr_dev_inst *sdi;
+	struct packet_check chk;
+	size_t period, pos;
+	int ret;
+
+	sdi = demo_scan(BENCH_LOGIC_CHANNELS, 0);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_FRAMES,
+		g_variant_new_uint64(CHECK_FRAMES));
+	fail_unless(ret == SR_OK, "Cannot set frame limit: %d", ret);
+	demo_run_check(sdi, FALSE, &chk);
+
+	fail_unless(chk.frames == CHECK_FRAMES,
+		"Unexpected frame count: %" PRIu64 ".", chk.frames);
+	fail_unless(!chk.in_frame, "Last frame was not ended.");
+	fail_unless(chk.data->len == CHECK_FRAMES * CHECK_FRAME_SAMPLES *
+		BENCH_LOGIC_CHANNELS / 8,
+		"Unexpected data amount: %u.", chk.data->len);
+	period = CHECK_PACKET_SAMPLES * BENCH_LOGIC_CHANNELS / 8;
+	for (pos = period; pos < chk.data->len; pos++) {
+		fail_unless(chk.data->data[pos] == chk.data->data[pos - period],
+			"Data does not repeat the block at offset %zu.", pos);
+	}
+
+	packet_check_free(&chk);
+}
+END_TEST
+
+/* Acquisition parameters for the feed thread comparison. */
+#define FEED_SAMPLERATE		SR_MHZ(1)
+#define FEED_SAMPLES		(200 * 1000)
+#define FEED_LOGIC_CHANNELS	8
+#define FEED_ANALOG_CHANNELS	4
+
+/* Query the feed statistics from within a datafeed callback. */
+static void stats_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_session_feed_stats stats;
+	int ret;
+
+	(void)sdi;
+	(void)packet;
+
+	ret = sr_session_feed_stats_get(cb_data, &stats);
+	fail_unless(ret == SR_OK, "sr_session_feed_stats_get() error: %d", ret);
+}
+
+static void demo_run_digest(size_t ring_size, struct srtest_feed *feed,
+	struct sr_session_feed_stats *stats)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	int ret;
+
+	sdi = demo_scan(FEED_LOGIC_CHANNELS, FEED_ANALOG_CHANNELS);
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(FEED_SAMPLERATE));
+	fail_unless(ret == SR_OK, "Cannot set samplerate: %d", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(FEED_SAMPLES));
+	fail_unless(ret == SR_OK, "Cannot set sample limit: %d", ret);
+
+	memset(feed, 0, sizeof(*feed));
+	sr_session_new(srtest_ctx, &session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, srtest_feed_in, feed);
+	sr_session_datafeed_callback_add(session, stats_in, session);
+	ret = sr_session_feed_thread_set(session, ring_size);
+	fail_unless(ret == SR_OK, "Cannot configure feed thread: %d", ret);
+
+	srtest_session_run(session);
+	sr_session_feed_stats_get(session, stats);
+
+	sr_session_destroy(session);
+	sr_dev_close(sdi);
+}
+
+/*
+ * Acquire the same logic and analog data with and without the session
+ * feed thread. Datafeed callbacks must see identical data, and can
+ * query the feed statistics while the device waits for ring slots.
+ */
+START_TEST(test_demo_feed_thread)
+{
+	struct srtest_feed direct, threaded;
+	struct sr_session_feed_stats stats;
+	size_t idx;
+
+	demo_run_digest(0, &direct, &stats);
+	fail_unless(stats.packets == 0, "Direct path used the feed thread.");
+	demo_run_digest(4, &threaded, &stats);
+	fail_unless(stats.packets > 0, "Feed thread did not run.");
+
+	fail_unless(direct.logic_bytes == FEED_SAMPLES,
+		"Unexpected logic data amount: %" PRIu64 ".", direct.logic_bytes);
+	for (idx = 0; idx < FEED_ANALOG_CHANNELS; idx++) {
+		fail_unless(direct.analog_samples[FEED_LOGIC_CHANNELS + idx] ==
+			FEED_SAMPLES,
+			"Unexpected analog sample count, channel %zu.", idx);
+	}
+	srtest_feed_check_equal(&threaded, &direct);
+}
+END_TEST
+
+#endif
+
+Suite *suite_driver_demo(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("driver-demo");
+
+	tc = tcase_create("benchmark");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+#ifdef HAVE_HW_DEMO
+	tcase_add_test(tc, test_demo_benchmark);
+	tcase_add_test(tc, test_demo_benchmark_invert);
+	tcase_add_test(tc, test_demo_benchmark_frames);
+#endif
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("feed_thread");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+#ifdef HAVE_HW_DEMO
+	tcase_add_test(tc, test_demo_feed_thread);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}
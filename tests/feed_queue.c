@@ -0,0 +1,192 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define QUEUE_UNITSIZE	2
+#define QUEUE_SAMPLES	1000
+/* Block sizes which exceed the queue's size, or fit into it. */
+#define BLOCK_LARGE	(3 * QUEUE_SAMPLES + 17)
+#define BLOCK_SMALL	(QUEUE_SAMPLES / 3)
+
+struct feed_result {
+	GByteArray *logic;
+};
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct feed_result *res;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	res = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	fail_unless(logic->unitsize == QUEUE_UNITSIZE,
+		"Unexpected unit size %u.", logic->unitsize);
+	g_byte_array_append(res->logic, logic->data, logic->length);
+}
+
+static void fill_pattern(uint8_t *buf, size_t count, size_t first)
+{
+	size_t idx;
+
+	for (idx = 0; idx < count; idx++) {
+		buf[idx * QUEUE_UNITSIZE + 0] = (first + idx) & 0xff;
+		buf[idx * QUEUE_UNITSIZE + 1] = ((first + idx) >> 8) ^ 0x5a;
+	}
+}
+
+static struct sr_session *create_session(struct sr_dev_inst **sdi,
+	struct feed_result *res)
+{
+	struct sr_session *session;
+
+	*sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(*sdi != NULL, "sr_dev_inst_user_new() failed.");
+	sr_dev_inst_channel_add(*sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(*sdi, 1, SR_CHANNEL_LOGIC, "D1");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_dev_add(session, *sdi);
+	res->logic = g_byte_array_new();
+	sr_session_datafeed_callback_add(session, datafeed_in, res);
+
+	return session;
+}
+
+/*
+ * Submit a mix of large blocks, small blocks, and repeated values. The
+ * session feed must see the samples in submission order, and the
+ * caller's data must not change.
+ */
+static void check_submit_mix(gboolean rle, gboolean transform)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	const struct sr_transform *t;
+	struct feed_queue_logic *q;
+	struct feed_result res;
+	GByteArray *expect;
+	uint8_t *block, *orig;
+	size_t block_len, i;
+	int ret;
+
+	session = create_session(&sdi, &res);
+	t = NULL;
+	if (transform) {
+		t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+		fail_unless(t != NULL, "Cannot create transform.");
+	}
+	if (rle)
+		q = feed_queue_logic_alloc_rle(sdi, QUEUE_SAMPLES, QUEUE_UNITSIZE);
+	else
+		q = feed_queue_logic_alloc(sdi, QUEUE_SAMPLES, QUEUE_UNITSIZE);
+	fail_unless(q != NULL, "Cannot create feed queue.");
+
+	block_len = BLOCK_LARGE * QUEUE_UNITSIZE;
+	block = g_malloc(block_len);
+	fill_pattern(block, BLOCK_LARGE, 0);
+	orig = g_malloc(block_len);
+	memcpy(orig, block, block_len);
+	expect = g_byte_array_new();
+
+	/* Large block with an empty queue, passes through. */
+	ret = feed_queue_logic_submit_many(q, block, BLOCK_LARGE);
+	fail_unless(ret == SR_OK);
+	g_byte_array_append(expect, block, block_len);
+	/* Small block, then a large block with pending data. */
+	ret = feed_queue_logic_submit_many(q, block, BLOCK_SMALL);
+	fail_unless(ret == SR_OK);
+	g_byte_array_append(expect, block, BLOCK_SMALL * QUEUE_UNITSIZE);
+	ret = feed_queue_logic_submit_many(q, block, BLOCK_LARGE);
+	fail_unless(ret == SR_OK);
+	g_byte_array_append(expect, block, block_len);
+	/* Repeated value, then a flush. */
+	ret = feed_queue_logic_submit(q, &block[QUEUE_UNITSIZE], 2345);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < 2345; i++)
+		g_byte_array_append(expect, &block[QUEUE_UNITSIZE], QUEUE_UNITSIZE);
+	ret = feed_queue_logic_flush(q);
+	fail_unless(ret == SR_OK);
+
+	fail_unless(memcmp(block, orig, block_len) == 0,
+		"Submitted data was modified.");
+	/* Without a channel selection, invert flips all bits of a unit. */
+	if (transform) {
+		for (i = 0; i < expect->len; i++)
+			expect->data[i] ^= 0xff;
+	}
+	fail_unless(res.logic->len == expect->len,
+		"Unexpected amount of data: %u.", res.logic->len);
+	fail_unless(memcmp(res.logic->data, expect->data, expect->len) == 0,
+		"Unexpected data content.");
+
+	feed_queue_logic_free(q);
+	sr_session_destroy(session);
+	if (t)
+		sr_transform_free(t);
+	g_byte_array_free(res.logic, TRUE);
+	g_byte_array_free(expect, TRUE);
+	g_free(block);
+	g_free(orig);
+}
+
+START_TEST(test_feed_queue_logic)
+{
+	check_submit_mix(FALSE, FALSE);
+}
+END_TEST
+
+START_TEST(test_feed_queue_logic_rle)
+{
+	check_submit_mix(TRUE, FALSE);
+}
+END_TEST
+
+/* In place transforms must not modify the caller's data. */
+START_TEST(test_feed_queue_logic_transform)
+{
+	check_submit_mix(FALSE, TRUE);
+	check_submit_mix(TRUE, TRUE);
+}
+END_TEST
+
+Suite *suite_feed_queue(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("feed-queue");
+
+	tc = tcase_create("logic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_feed_queue_logic);
+	tcase_add_test(tc, test_feed_queue_logic_rle);
+	tcase_add_test(tc, test_feed_queue_logic_transform);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -33,6 +34,142 @@ START_TEST(test_input_available)
 }
 END_TEST
 
+/* Number of text lines in the generated input. */
+#define CHUNK_LINES	(200 * 1000)
+
+/* Timestamps, three bit columns, a hex column. */
+static GString *create_csv(void)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_sized_new(CHUNK_LINES * 32);
+	g_string_append(s, "time,a,b,c,x\n");
+	for (i = 0; i < CHUNK_LINES; i++) {
+		g_string_append_printf(s, "%.6f,%d,%d,%d,%04x\n",
+			(i + 1) * 1e-3, (int)(i & 1), (int)((i >> 1) & 1),
+			(int)((i >> 2) & 1), (unsigned)((i * 2654435761u) & 0xffff));
+	}
+
+	return s;
+}
+
+/* Four signals, one of them changes at every timestamp. */
+static GString *create_vcd(void)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_sized_new(CHUNK_LINES * 16);
+	g_string_append(s, "$timescale 1 us $end\n"
+		"$scope module top $end\n"
+		"$var wire 1 ! a $end\n"
+		"$var wire 1 \" b $end\n"
+		"$var wire 1 # c $end\n"
+		"$var wire 1 $ d $end\n"
+		"$upscope $end\n"
+		"$enddefinitions $end\n");
+	for (i = 0; i < CHUNK_LINES; i++) {
+		g_string_append_printf(s, "#%zu\n%d!\n", i * 3, (int)(i & 1));
+		if (i % 3 == 0)
+			g_string_append_printf(s, "%d\"\n", (int)((i >> 2) & 1));
+		if (i % 7 == 0)
+			g_string_append_printf(s, "%d#\n%d$\n",
+				(int)((i >> 3) & 1), (int)((i >> 4) & 1));
+	}
+
+	return s;
+}
+
+static void import_chunks(const char *id, GHashTable *options,
+	const GString *text, size_t send_size, struct srtest_feed *feed)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GString *buf;
+	size_t pos, len;
+	gint64 start, usecs;
+	char what[48];
+	int ret;
+
+	memset(feed, 0, sizeof(*feed));
+
+	imod = sr_input_find(id);
+	fail_unless(imod != NULL, "Failed to find input module '%s'.", id);
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Failed to create '%s' input instance.", id);
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, srtest_feed_in, feed);
+
+	start = g_get_monotonic_time();
+	buf = g_string_sized_new(send_size);
+	sdi = NULL;
+	for (pos = 0; pos < text->len; pos += len) {
+		len = MIN(text->len - pos, send_size);
+		g_string_assign(buf, "");
+		g_string_append_len(buf, text->str + pos, len);
+		ret = sr_input_send(in, buf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	usecs = g_get_monotonic_time() - start;
+
+	snprintf(what, sizeof(what), "%s import, %zu byte chunks", id, send_size);
+	srtest_bench_report(what, text->len, "B", usecs);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(session);
+}
+
+/*
+ * Send text input in large and in small chunks. Small chunks split lines
+ * at arbitrary positions and leave unprocessed text in the module's
+ * receive buffer on every call, which must not cost a move of the
+ * buffered data. The sample data must not depend on the chunk size.
+ * Run the test suite with CK_VERBOSE and G_MESSAGES_DEBUG set to see
+ * the rates.
+ */
+START_TEST(test_input_chunks_bench)
+{
+	static const size_t send_sizes[] = { 4 * 1024 * 1024, 64 * 1024, 1024, 333, };
+	struct srtest_feed first, feed;
+	GHashTable *options;
+	GString *csv, *vcd;
+	size_t i;
+
+	csv = create_csv();
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("column_formats"),
+		g_variant_ref_sink(g_variant_new_string("t,3b,x16")));
+	for (i = 0; i < G_N_ELEMENTS(send_sizes); i++) {
+		import_chunks("csv", options, csv, send_sizes[i], i ? &feed : &first);
+		if (i)
+			srtest_feed_check_equal(&feed, &first);
+	}
+	fail_unless(first.logic_bytes == CHUNK_LINES * 3,
+		"Unexpected CSV logic data amount: %" PRIu64 ".", first.logic_bytes);
+	g_hash_table_destroy(options);
+	g_string_free(csv, TRUE);
+
+	vcd = create_vcd();
+	for (i = 0; i < G_N_ELEMENTS(send_sizes); i++) {
+		import_chunks("vcd", NULL, vcd, send_sizes[i], i ? &feed : &first);
+		if (i)
+			srtest_feed_check_equal(&feed, &first);
+	}
+	fail_unless(first.logic_bytes != 0, "No VCD logic data.");
+	g_string_free(vcd, TRUE);
+}
+END_TEST
+
 Suite *suite_input_all(void)
 {
 	Suite *s;
@@ -44,5 +181,11 @@ Suite *suite_input_all(void)
 	tcase_add_test(tc, test_input_available);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("chunks");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_input_chunks_bench);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,16 +19,30 @@
 
 #include <config.h>
 #include <check.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
 #define BUFSIZE (1000 * 1000)
 
+/*
+ * Channel count for the mapped input test, which results in three byte
+ * samples. The sample count makes the input exceed the module's packet
+ * size, and not be a multiple of it.
+ */
+#define PATTERN_CHANNELS	20
+#define PATTERN_UNITSIZE	3
+#define PATTERN_SAMPLES		1500001
+
 enum {
 	CHECK_ALL_LOW,
 	CHECK_ALL_HIGH,
 	CHECK_HELLO_WORLD,
+	CHECK_PATTERN,
 };
 
 static uint64_t df_packet_counter = 0, sample_counter = 0;
@@ -37,6 +51,11 @@ static GArray *logic_channellist = NULL;
 static int check_to_perform;
 static uint64_t expected_samples;
 static uint64_t *expected_samplerate;
+static const uint8_t *expected_data;
+/* Caller memory of sr_input_send_mapped(), and packets pointing into it. */
+static const uint8_t *mapped_data;
+static size_t mapped_len;
+static uint64_t mapped_packets;
 
 static void check_all_low(const struct sr_datafeed_logic *logic)
 {
@@ -76,6 +95,25 @@ static void check_hello_world(const struct sr_datafeed_logic *logic)
 	}
 }
 
+static void check_pattern(const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *data;
+
+	fail_unless(logic->unitsize == PATTERN_UNITSIZE,
+		"Unexpected unit size %u.", logic->unitsize);
+	fail_unless(logic->length % logic->unitsize == 0,
+		"Incomplete sample in packet.");
+	fail_unless(!memcmp(logic->data,
+		&expected_data[sample_counter * logic->unitsize], logic->length),
+		"Unexpected logic data after sample %" PRIu64 ".",
+		sample_counter);
+
+	data = logic->data;
+	if (mapped_data && data >= mapped_data &&
+			data + logic->length <= mapped_data + mapped_len)
+		mapped_packets++;
+}
+
 static void datafeed_in(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *packet, void *cb_data)
 {
@@ -158,6 +196,8 @@ static void datafeed_in(const struct sr_dev_inst *sdi,
 			check_all_high(logic);
 		else if (check_to_perform == CHECK_HELLO_WORLD)
 			check_hello_world(logic);
+		else if (check_to_perform == CHECK_PATTERN)
+			check_pattern(logic);
 
 		sample_counter += logic->length / logic->unitsize;
 
@@ -308,6 +348,223 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+/* Send mapped data, check for SR_OK, and count in place packets. */
+static void send_mapped(const struct sr_input *in, uint8_t *data, size_t len)
+{
+	int ret;
+
+	mapped_data = data;
+	mapped_len = len;
+	ret = sr_input_send_mapped(in, data, len);
+	fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+	mapped_data = NULL;
+}
+
+/*
+ * Send multi-byte samples in pieces which split samples: by copy, in
+ * place, and from a file. Incomplete samples must be completed with
+ * the next piece, no matter how the next piece gets sent.
+ */
+START_TEST(test_input_binary_mapped)
+{
+	int ret, fd;
+	struct sr_input *in;
+	const struct sr_input_module *imod;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *gbuf;
+	GError *error;
+	uint8_t *buf;
+	size_t len, pos, i;
+	char *filename;
+
+	len = PATTERN_SAMPLES * PATTERN_UNITSIZE;
+	buf = g_malloc(len);
+	for (i = 0; i < len; i++)
+		buf[i] = (i * 2654435761u) >> 24;
+
+	df_packet_counter = sample_counter = 0;
+	have_seen_df_end = FALSE;
+	logic_channellist = NULL;
+	check_to_perform = CHECK_PATTERN;
+	expected_samples = PATTERN_SAMPLES;
+	expected_samplerate = NULL;
+	expected_data = buf;
+	mapped_packets = 0;
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+		g_variant_ref_sink(g_variant_new_int32(PATTERN_CHANNELS)));
+	in = sr_input_new(imod, options);
+	g_hash_table_destroy(options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	/* Start via copy, ending within a sample. */
+	pos = 100;
+	gbuf = g_string_new_len((gchar *)buf, pos);
+	ret = sr_input_send(in, gbuf);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	g_string_free(gbuf, TRUE);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "Device instance not ready.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sdi);
+
+	/*
+	 * In place, each piece starts with leftover from the previous
+	 * one. The single byte completes a sample without more data.
+	 */
+	send_mapped(in, buf + pos, 333334);
+	pos += 333334;
+	fail_unless(mapped_packets > 0, "Mapped data was not used in place.");
+	send_mapped(in, buf + pos, 1);
+	pos += 1;
+	send_mapped(in, buf + pos, 131075);
+	pos += 131075;
+	fail_unless(pos % PATTERN_UNITSIZE != 0);
+
+	/* The remainder from a file, again starting within a sample. */
+	error = NULL;
+	fd = g_file_open_tmp("sr-input-binary-XXXXXX", &filename, &error);
+	fail_unless(fd >= 0, "Cannot create file: %s",
+		error ? error->message : "");
+	close(fd);
+	fail_unless(g_file_set_contents(filename, (gchar *)buf, len, NULL),
+		"Cannot write file.");
+	ret = sr_input_send_file(in, filename, pos);
+	fail_unless(ret == SR_OK, "sr_input_send_file() error: %d", ret);
+	g_unlink(filename);
+	g_free(filename);
+
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	fail_unless(have_seen_df_end, "No SR_DF_END seen.");
+	sr_input_free(in);
+
+	sr_session_destroy(session);
+
+	expected_data = NULL;
+	g_free(buf);
+}
+END_TEST
+
+#ifdef G_OS_UNIX
+struct pipe_writer {
+	const char *filename;
+	const uint8_t *data;
+	size_t len;
+};
+
+static gpointer pipe_writer_thread(gpointer data)
+{
+	struct pipe_writer *w;
+	ssize_t n;
+	size_t pos;
+	int fd;
+
+	w = data;
+	fd = open(w->filename, O_WRONLY);
+	if (fd < 0)
+		return NULL;
+	for (pos = 0; pos < w->len; pos += n) {
+		n = write(fd, w->data + pos, w->len - pos);
+		if (n <= 0)
+			break;
+	}
+	close(fd);
+
+	return NULL;
+}
+
+/*
+ * Send from a pipe, which cannot be mapped, nor seek to the offset of
+ * the data which was sent by copy before.
+ */
+START_TEST(test_input_binary_pipe)
+{
+	int ret;
+	struct sr_input *in;
+	const struct sr_input_module *imod;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct pipe_writer writer;
+	GHashTable *options;
+	GThread *thread;
+	GString *gbuf;
+	uint8_t *buf;
+	size_t len, pos, i;
+	char *dir, *filename;
+
+	len = PATTERN_SAMPLES * PATTERN_UNITSIZE;
+	buf = g_malloc(len);
+	for (i = 0; i < len; i++)
+		buf[i] = (i * 2654435761u) >> 24;
+
+	df_packet_counter = sample_counter = 0;
+	have_seen_df_end = FALSE;
+	logic_channellist = NULL;
+	check_to_perform = CHECK_PATTERN;
+	expected_samples = PATTERN_SAMPLES;
+	expected_samplerate = NULL;
+	expected_data = buf;
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+		g_variant_ref_sink(g_variant_new_int32(PATTERN_CHANNELS)));
+	in = sr_input_new(imod, options);
+	g_hash_table_destroy(options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	pos = 100;
+	gbuf = g_string_new_len((gchar *)buf, pos);
+	ret = sr_input_send(in, gbuf);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	g_string_free(gbuf, TRUE);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "Device instance not ready.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sdi);
+
+	dir = g_dir_make_tmp("sr-input-binary-XXXXXX", NULL);
+	fail_unless(dir != NULL, "Cannot create directory.");
+	filename = g_build_filename(dir, "fifo", NULL);
+	fail_unless(mkfifo(filename, 0600) == 0, "Cannot create FIFO.");
+	writer.filename = filename;
+	writer.data = buf;
+	writer.len = len;
+	thread = g_thread_new("pipe-writer", pipe_writer_thread, &writer);
+	ret = sr_input_send_file(in, filename, pos);
+	fail_unless(ret == SR_OK, "sr_input_send_file() error: %d", ret);
+	g_thread_join(thread);
+	g_unlink(filename);
+	g_rmdir(dir);
+	g_free(filename);
+	g_free(dir);
+
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	fail_unless(have_seen_df_end, "No SR_DF_END seen.");
+	sr_input_free(in);
+
+	sr_session_destroy(session);
+
+	expected_data = NULL;
+	g_free(buf);
+}
+END_TEST
+#endif
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +578,10 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_mapped);
+#ifdef G_OS_UNIX
+	tcase_add_test(tc, test_input_binary_pipe);
+#endif
 	suite_add_tcase(s, tc);
 
 	return s;
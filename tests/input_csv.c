@@ -0,0 +1,173 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Number of text lines in the generated input. */
+#define CSV_LINES	(200 * 1000)
+/* Chunk size which the input data gets sent in. */
+#define SEND_SIZE	(4 * 1024 * 1024)
+
+static const char *csv_formats = "t,3b,x16,a";
+
+/* Timestamps, three bit columns, a hex column, an analog column. */
+static GString *create_csv(size_t lines)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_sized_new(lines * 48);
+	g_string_append(s, "time,a,b,c,x,y\r\n");
+	for (i = 0; i < lines; i++) {
+		g_string_append_printf(s, "%.6f, %d ,%d,%d,%04x,%.4f%s\r\n",
+			i * 1e-3, (int)(i & 1), (int)((i >> 1) & 1),
+			(int)((i >> 2) & 1), (unsigned)((i * 2654435761u) & 0xffff),
+			(i % 1000) / 7.0, (i % 997) ? "" : " ; comment");
+		if (i % 5000 == 0)
+			g_string_append(s, "\r\n");
+	}
+
+	return s;
+}
+
+static void import_csv(const GString *csv, uint32_t threads,
+	struct srtest_feed *feed)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *buf;
+	size_t pos, len;
+	gint64 start, usecs;
+	char what[32];
+	int ret;
+
+	memset(feed, 0, sizeof(*feed));
+
+	imod = sr_input_find("csv");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("column_formats"),
+		g_variant_ref_sink(g_variant_new_string(csv_formats)));
+	g_hash_table_insert(options, g_strdup("threads"),
+		g_variant_ref_sink(g_variant_new_uint32(threads)));
+	in = sr_input_new(imod, options);
+	g_hash_table_destroy(options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, srtest_feed_in, feed);
+
+	start = g_get_monotonic_time();
+	buf = g_string_sized_new(SEND_SIZE);
+	sdi = NULL;
+	for (pos = 0; pos < csv->len; pos += len) {
+		len = MIN(csv->len - pos, SEND_SIZE);
+		g_string_assign(buf, "");
+		g_string_append_len(buf, csv->str + pos, len);
+		ret = sr_input_send(in, buf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	usecs = g_get_monotonic_time() - start;
+
+	snprintf(what, sizeof(what), "CSV import, %u threads", threads);
+	srtest_bench_report(what, csv->len, "B", usecs);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(session);
+}
+
+/*
+ * Parallel parsing must result in the same sample data as parsing in
+ * the calling thread. Also reports the import throughput (debug log).
+ */
+START_TEST(test_input_csv_threads)
+{
+	static const uint32_t thread_counts[] = { 2, 4, 0, };
+	struct srtest_feed serial, parallel;
+	GString *csv;
+	uint64_t analog_samples;
+	size_t i;
+
+	csv = create_csv(CSV_LINES);
+
+	import_csv(csv, 1, &serial);
+	fail_unless(serial.seen_end, "No SR_DF_END seen.");
+	fail_unless(serial.logic_bytes == CSV_LINES * 3,
+		"Unexpected logic data amount: %" PRIu64 ".", serial.logic_bytes);
+	analog_samples = 0;
+	for (i = 0; i < SRTEST_FEED_CHANNELS; i++)
+		analog_samples += serial.analog_samples[i];
+	fail_unless(analog_samples == CSV_LINES,
+		"Unexpected analog data amount: %" PRIu64 ".", analog_samples);
+
+	for (i = 0; i < G_N_ELEMENTS(thread_counts); i++) {
+		import_csv(csv, thread_counts[i], &parallel);
+		srtest_feed_check_equal(&parallel, &serial);
+	}
+
+	g_string_free(csv, TRUE);
+}
+END_TEST
+
+/* Parallel parsing is opt-in, the default parses in the calling thread. */
+START_TEST(test_input_csv_threads_default)
+{
+	const struct sr_option **opts;
+	size_t i;
+
+	opts = sr_input_options_get(sr_input_find("csv"));
+	fail_unless(opts != NULL, "No csv options.");
+	for (i = 0; opts[i]; i++) {
+		if (strcmp(opts[i]->id, "threads"))
+			continue;
+		fail_unless(g_variant_get_uint32(opts[i]->def) == 1,
+			"Unexpected default thread count.");
+		break;
+	}
+	fail_unless(opts[i] != NULL, "No threads option.");
+	sr_input_options_free(opts);
+}
+END_TEST
+
+Suite *suite_input_csv(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-csv");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_csv_threads);
+	tcase_add_test(tc, test_input_csv_threads_default);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,184 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/*
+ * Number of single-bit signals in the generated input. Enough to use
+ * one, two, and three character identifiers.
+ */
+#define VCD_SIGNALS	9000
+/* Number of timestamps, and value changes per timestamp. */
+#define VCD_TIMESTAMPS	1000
+#define VCD_CHANGES	40
+/* Chunk size which the input data gets sent in. */
+#define SEND_SIZE	(1024 * 1024)
+
+/* Shortest printable identifier first, like simulators assign them. */
+static void append_id(GString *s, size_t idx)
+{
+	do {
+		g_string_append_c(s, '!' + idx % 94);
+		idx /= 94;
+	} while (idx--);
+}
+
+static void set_bit(uint8_t *image, size_t idx, gboolean value)
+{
+	if (value)
+		image[idx / 8] |= 1 << (idx % 8);
+	else
+		image[idx / 8] &= ~(1 << (idx % 8));
+}
+
+/*
+ * Declare many single-bit signals, an alias for the first signal, and
+ * an (ignored) string variable. Emit random value changes for each
+ * timestamp. Keep the sample data image which the import is expected
+ * to result in.
+ */
+static GString *create_vcd(struct srtest_feed *expect)
+{
+	GString *s;
+	uint8_t *image;
+	size_t unit_size, i, t, idx;
+	uint32_t rnd;
+	gboolean value;
+
+	s = g_string_sized_new(VCD_SIGNALS * 32 +
+		VCD_TIMESTAMPS * VCD_CHANGES * 6);
+	g_string_append(s, "$timescale 1 us $end\n$scope module top $end\n");
+	for (i = 0; i < VCD_SIGNALS; i++) {
+		g_string_append(s, "$var wire 1 ");
+		append_id(s, i);
+		g_string_append_printf(s, " sig%zu $end\n", i);
+	}
+	g_string_append(s, "$var wire 1 ! alias $end\n");
+	g_string_append(s, "$var string 1 ~~~~ text $end\n");
+	g_string_append(s, "$upscope $end\n$enddefinitions $end\n");
+
+	unit_size = (VCD_SIGNALS + 1 + 7) / 8;
+	image = g_malloc0(unit_size);
+	memset(expect, 0, sizeof(*expect));
+	rnd = 1;
+	for (t = 0; t < VCD_TIMESTAMPS; t++) {
+		g_string_append_printf(s, "#%zu\n", t);
+		for (i = 0; i < VCD_CHANGES; i++) {
+			rnd = rnd * 1103515245 + 12345;
+			idx = (rnd >> 8) % VCD_SIGNALS;
+			value = (rnd >> 4) & 1;
+			g_string_append_c(s, value ? '1' : '0');
+			append_id(s, idx);
+			g_string_append_c(s, '\n');
+			set_bit(image, idx, value);
+			if (idx == 0)
+				set_bit(image, VCD_SIGNALS, value);
+		}
+		if (t % 100 == 0)
+			g_string_append(s, "sdone ~~~~\n");
+		expect->logic_hash = srtest_hash(expect->logic_hash,
+			image, unit_size);
+		expect->logic_bytes += unit_size;
+	}
+	g_free(image);
+	expect->seen_end = TRUE;
+
+	return s;
+}
+
+static void import_vcd(const GString *vcd, struct srtest_feed *feed)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GString *buf;
+	size_t pos, len;
+	gint64 start, usecs;
+	char what[32];
+	int ret;
+
+	memset(feed, 0, sizeof(*feed));
+
+	imod = sr_input_find("vcd");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, srtest_feed_in, feed);
+
+	start = g_get_monotonic_time();
+	buf = g_string_sized_new(SEND_SIZE);
+	sdi = NULL;
+	for (pos = 0; pos < vcd->len; pos += len) {
+		len = MIN(vcd->len - pos, SEND_SIZE);
+		g_string_assign(buf, "");
+		g_string_append_len(buf, vcd->str + pos, len);
+		ret = sr_input_send(in, buf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+	usecs = g_get_monotonic_time() - start;
+
+	snprintf(what, sizeof(what), "VCD import, %d signals", VCD_SIGNALS);
+	srtest_bench_report(what, vcd->len, "B", usecs);
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(session);
+}
+
+/*
+ * Value changes of many signals must end up at their channels' bit
+ * positions. Also reports the import throughput (debug log).
+ */
+START_TEST(test_input_vcd_wide)
+{
+	struct srtest_feed expect, feed;
+	GString *vcd;
+
+	vcd = create_vcd(&expect);
+
+	import_vcd(vcd, &feed);
+	srtest_feed_check_equal(&feed, &expect);
+
+	g_string_free(vcd, TRUE);
+}
+END_TEST
+
+Suite *suite_input_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-vcd");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_vcd_wide);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
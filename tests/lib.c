@@ -160,3 +160,116 @@ GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi)
 
 	return channels;
 }
+
+/* Update a hash of data, to compare data streams without keeping them. */
+uint32_t srtest_hash(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p;
+
+	p = data;
+	while (len--)
+		hash = hash * 31 + *p++;
+
+	return hash;
+}
+
+/*
+ * Datafeed callback which summarizes the session feed in the
+ * struct srtest_feed passed as cb_data. Analog data is hashed in its
+ * float representation, separately for each channel.
+ */
+void srtest_feed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct srtest_feed *feed;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_channel *ch;
+	float *values;
+	int ret;
+
+	(void)sdi;
+
+	feed = cb_data;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		feed->seen_header = TRUE;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		fail_unless(!feed->logic_unitsize ||
+			logic->unitsize == feed->logic_unitsize,
+			"Unit size changed to %u.", logic->unitsize);
+		feed->logic_unitsize = logic->unitsize;
+		feed->logic_hash = srtest_hash(feed->logic_hash,
+			logic->data, logic->length);
+		feed->logic_bytes += logic->length;
+		feed->logic_packets++;
+		feed->logic_max_packet = MAX(feed->logic_max_packet,
+			logic->length);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		ch = analog->meaning->channels->data;
+		fail_unless(ch->index < SRTEST_FEED_CHANNELS,
+			"Unexpected channel %s.", ch->name);
+		values = g_malloc(analog->num_samples * sizeof(values[0]) + 1);
+		ret = sr_analog_to_float(analog, values);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() error: %d", ret);
+		feed->analog_hash[ch->index] = srtest_hash(
+			feed->analog_hash[ch->index], values,
+			analog->num_samples * sizeof(values[0]));
+		feed->analog_samples[ch->index] += analog->num_samples;
+		g_free(values);
+		break;
+	case SR_DF_END:
+		feed->seen_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Check that two session feeds carried the same data. */
+void srtest_feed_check_equal(const struct srtest_feed *feed,
+		const struct srtest_feed *expect)
+{
+	int i;
+
+	fail_unless(feed->seen_end && expect->seen_end, "No SR_DF_END seen.");
+	fail_unless(feed->logic_bytes == expect->logic_bytes,
+		"Logic data amount differs: %" PRIu64 " instead of %" PRIu64 ".",
+		feed->logic_bytes, expect->logic_bytes);
+	fail_unless(feed->logic_hash == expect->logic_hash,
+		"Logic data content differs.");
+	for (i = 0; i < SRTEST_FEED_CHANNELS; i++) {
+		fail_unless(feed->analog_samples[i] == expect->analog_samples[i],
+			"Analog sample count differs, channel index %d.", i);
+		fail_unless(feed->analog_hash[i] == expect->analog_hash[i],
+			"Analog data differs, channel index %d.", i);
+	}
+}
+
+/* Start and run a session, return the time it took. */
+gint64 srtest_session_run(struct sr_session *session)
+{
+	gint64 start;
+	int ret;
+
+	start = g_get_monotonic_time();
+	ret = sr_session_start(session);
+	fail_unless(ret == SR_OK, "sr_session_start() error: %d", ret);
+	ret = sr_session_run(session);
+	fail_unless(ret == SR_OK, "sr_session_run() error: %d", ret);
+
+	return g_get_monotonic_time() - start;
+}
+
+/* Report a benchmark's throughput (debug log). */
+void srtest_bench_report(const char *what, uint64_t amount,
+		const char *unit, gint64 usecs)
+{
+	g_debug("%s: %" PRIu64 " %s in %" PRIi64 " us, %.1f M%s/s.",
+		what, amount, unit, usecs,
+		usecs ? (double)amount / usecs : 0.0, unit);
+}
@@ -41,18 +41,54 @@ void srtest_check_samplerate(struct sr_context *sr_ctx, const char *drivername,
 
 GArray *srtest_get_enabled_logic_channels(const struct sr_dev_inst *sdi);
 
+/* Number of channel indices which srtest_feed_in() keeps analog digests for. */
+#define SRTEST_FEED_CHANNELS 64
+
+/* Summary of a session feed's content, as seen by srtest_feed_in(). */
+struct srtest_feed {
+	gboolean seen_header;
+	gboolean seen_end;
+	unsigned int logic_unitsize;
+	uint64_t logic_packets;
+	uint64_t logic_bytes;
+	uint64_t logic_max_packet;
+	uint32_t logic_hash;
+	uint64_t analog_samples[SRTEST_FEED_CHANNELS];
+	uint32_t analog_hash[SRTEST_FEED_CHANNELS];
+};
+
+uint32_t srtest_hash(uint32_t hash, const void *data, size_t len);
+void srtest_feed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data);
+void srtest_feed_check_equal(const struct srtest_feed *feed,
+		const struct srtest_feed *expect);
+
+gint64 srtest_session_run(struct sr_session *session);
+void srtest_bench_report(const char *what, uint64_t amount,
+		const char *unit, gint64 usecs);
+
 Suite *suite_core(void);
 Suite *suite_driver_all(void);
+Suite *suite_driver_demo(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_csv(void);
+Suite *suite_input_vcd(void);
 Suite *suite_output_all(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
-Suite *suite_strutil(void);
+Suite *suite_srzip(void);
 Suite *suite_version(void);
 Suite *suite_device(void);
-Suite *suite_trigger(void);
+Suite *suite_feed_queue(void);
 Suite *suite_analog(void);
+
+/* Suites of the tests for private library functions. */
 Suite *suite_conv(void);
+Suite *suite_log(void);
+Suite *suite_scpi(void);
+Suite *suite_strutil(void);
+Suite *suite_trigger(void);
+Suite *suite_usb(void);
 
 #endif
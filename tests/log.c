@@ -0,0 +1,173 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define LOG_PREFIX "test"
+
+static int log_collect(void *cb_data, int loglevel, const char *format,
+		va_list args)
+{
+	GPtrArray *messages;
+
+	(void)loglevel;
+
+	messages = cb_data;
+	g_ptr_array_add(messages, g_strdup_vprintf(format, args));
+
+	return SR_OK;
+}
+
+static GPtrArray *log_collect_start(int *loglevel)
+{
+	GPtrArray *messages;
+
+	*loglevel = sr_log_loglevel_get();
+	sr_log_loglevel_set(SR_LOG_DBG);
+	messages = g_ptr_array_new_with_free_func(g_free);
+	sr_log_callback_set(log_collect, messages);
+
+	return messages;
+}
+
+static void log_collect_stop(GPtrArray *messages, int loglevel)
+{
+	sr_log_callback_set_default();
+	sr_log_loglevel_set(loglevel);
+	g_ptr_array_free(messages, TRUE);
+}
+
+/*
+ * Check deferred logging. Messages must only reach the log callback
+ * when the ring is flushed or deferred logging is disabled. Text of a
+ * string argument with a precision need not be terminated, the ring
+ * must not read past the precision.
+ */
+#ifndef _WIN32
+START_TEST(test_log_deferred)
+{
+	GPtrArray *messages;
+	uint8_t *pages;
+	const char *text;
+	long pagesize;
+	int ret, loglevel;
+
+	/*
+	 * Put the text at the very end of a page which is followed by
+	 * an inaccessible one, reading past it crashes the test.
+	 */
+	pagesize = sysconf(_SC_PAGESIZE);
+	pages = mmap(NULL, 2 * pagesize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	fail_unless(pages != MAP_FAILED, "Cannot map memory.");
+	mprotect(pages + pagesize, pagesize, PROT_NONE);
+	memcpy(pages + pagesize - 4, "abcd", 4);
+	text = (const char *)pages + pagesize - 4;
+
+	messages = log_collect_start(&loglevel);
+
+	ret = sr_log_deferred_enable(16, FALSE);
+	fail_unless(ret == SR_OK, "sr_log_deferred_enable() failed: %d.", ret);
+	sr_dbg("first \"%.4s\" %d", text, 1);
+	sr_dbg("second \"%-6.2s\"", text);
+	fail_unless(messages->len == 0, "Deferred message was not held back.");
+
+	ret = sr_log_deferred_flush();
+	fail_unless(ret == SR_OK, "sr_log_deferred_flush() failed: %d.", ret);
+	fail_unless(messages->len == 2, "Unexpected message count %u.",
+		messages->len);
+	fail_unless(!strcmp(messages->pdata[0], "test: first \"abcd\" 1"),
+		"Unexpected message: %s", (char *)messages->pdata[0]);
+	fail_unless(!strcmp(messages->pdata[1], "test: second \"ab    \""),
+		"Unexpected message: %s", (char *)messages->pdata[1]);
+
+	sr_dbg("third \"%.4s\"", text);
+	fail_unless(messages->len == 2, "Deferred message was not held back.");
+	ret = sr_log_deferred_disable();
+	fail_unless(ret == SR_OK, "sr_log_deferred_disable() failed: %d.", ret);
+	fail_unless(messages->len == 3, "Disabling did not drain the ring.");
+	fail_unless(!strcmp(messages->pdata[2], "test: third \"abcd\""),
+		"Unexpected message: %s", (char *)messages->pdata[2]);
+
+	sr_dbg("fourth");
+	fail_unless(messages->len == 4, "Message was not logged right away.");
+
+	log_collect_stop(messages, loglevel);
+	munmap(pages, 2 * pagesize);
+}
+END_TEST
+#endif
+
+/*
+ * Warnings and errors are not held back, and take the debug messages
+ * before them along, in order.
+ */
+START_TEST(test_log_deferred_urgent)
+{
+	GPtrArray *messages;
+	int ret, loglevel;
+
+	messages = log_collect_start(&loglevel);
+
+	ret = sr_log_deferred_enable(16, FALSE);
+	fail_unless(ret == SR_OK, "sr_log_deferred_enable() failed: %d.", ret);
+	sr_dbg("debug %d", 1);
+	fail_unless(messages->len == 0, "Deferred message was not held back.");
+	sr_warn("warning %d", 2);
+	fail_unless(messages->len == 2, "Warning was held back.");
+	sr_err("error %s", "3");
+	fail_unless(messages->len == 3, "Error was held back.");
+	ret = sr_log_deferred_disable();
+	fail_unless(ret == SR_OK, "sr_log_deferred_disable() failed: %d.", ret);
+
+	fail_unless(!strcmp(messages->pdata[0], "test: debug 1"),
+		"Unexpected message: %s", (char *)messages->pdata[0]);
+	fail_unless(!strcmp(messages->pdata[1], "test: warning 2"),
+		"Unexpected message: %s", (char *)messages->pdata[1]);
+	fail_unless(!strcmp(messages->pdata[2], "test: error 3"),
+		"Unexpected message: %s", (char *)messages->pdata[2]);
+
+	log_collect_stop(messages, loglevel);
+}
+END_TEST
+
+Suite *suite_log(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("log");
+
+	tc = tcase_create("deferred");
+#ifndef _WIN32
+	tcase_add_test(tc, test_log_deferred);
+#endif
+	tcase_add_test(tc, test_log_deferred_urgent);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,8 +19,16 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /* Check whether at least one output module is available. */
@@ -96,6 +104,417 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Check binary output through sr_output_send() and a memory sink. */
+START_TEST(test_output_sink_memory)
+{
+	const struct sr_output *o;
+	struct sr_output_sink *sink;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[16], mem[40];
+	GString *out;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, NULL, NULL);
+	fail_unless(o != NULL, "Cannot create 'binary' output.");
+
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "sr_output_send() failed: %d.", ret);
+	fail_unless(out && out->len == sizeof(data) &&
+		!memcmp(out->str, data, sizeof(data)), "Wrong GString output.");
+	g_string_free(out, TRUE);
+
+	sink = sr_output_sink_memory_new(mem, sizeof(mem));
+	fail_unless(sink != NULL, "Cannot create memory sink.");
+	ret = sr_output_send_sink(o, &packet, sink);
+	fail_unless(ret == SR_OK, "First send failed: %d.", ret);
+	ret = sr_output_send_sink(o, &packet, sink);
+	fail_unless(ret == SR_OK, "Second send failed: %d.", ret);
+	fail_unless(sr_output_sink_bytes(sink) == 2 * sizeof(data),
+		"Wrong sink byte count.");
+	fail_unless(!memcmp(mem, data, sizeof(data)) &&
+		!memcmp(mem + sizeof(data), data, sizeof(data)),
+		"Wrong sink content.");
+
+	/* The region cannot take a third packet. */
+	ret = sr_output_send_sink(o, &packet, sink);
+	fail_unless(ret == SR_ERR_IO, "Sink overflow not detected.");
+	fail_unless(sr_output_sink_bytes(sink) == 2 * sizeof(data),
+		"Failed write changed the byte count.");
+
+	sr_output_sink_reset(sink);
+	ret = sr_output_send_sink(o, &packet, sink);
+	fail_unless(ret == SR_OK && sr_output_sink_bytes(sink) == sizeof(data),
+		"Sink reset failed.");
+
+	sr_output_sink_free(sink);
+	sr_output_free(o);
+}
+END_TEST
+
+/* Send a packet, the output must be an empty string. */
+static void check_send_empty(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+	int ret;
+
+	out = NULL;
+	ret = sr_output_send(o, packet, &out);
+	fail_unless(ret == SR_OK, "sr_output_send() failed: %d.", ret);
+	fail_unless(out != NULL && out->len == 0,
+		"No empty string from '%s' output.", o->module->id);
+	g_string_free(out, TRUE);
+}
+
+/*
+ * Modules which write to sinks return an empty string when a packet
+ * causes no output, like GString based modules always did.
+ */
+START_TEST(test_output_send_empty)
+{
+	static char *line_ids[] = { "bits", "hex", };
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet, trigger;
+	struct sr_datafeed_logic logic;
+	struct sr_dev_inst *sdi;
+	uint8_t data;
+	GString *out;
+	size_t i;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	data = 1;
+	logic.length = 1;
+	logic.unitsize = 1;
+	logic.data = &data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	trigger.type = SR_DF_TRIGGER;
+	trigger.payload = NULL;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create 'binary' output.");
+	check_send_empty(o, &trigger);
+	sr_output_free(o);
+
+	/* The first sample gets the header, later ones are buffered. */
+	for (i = 0; i < ARRAY_SIZE(line_ids); i++) {
+		o = sr_output_new(sr_output_find(line_ids[i]), NULL, sdi, NULL);
+		fail_unless(o != NULL, "Cannot create '%s' output.",
+			line_ids[i]);
+		out = NULL;
+		ret = sr_output_send(o, &packet, &out);
+		fail_unless(ret == SR_OK && out && out->len,
+			"No header from '%s' output.", line_ids[i]);
+		g_string_free(out, TRUE);
+		check_send_empty(o, &packet);
+		sr_output_free(o);
+	}
+}
+END_TEST
+
+#ifndef _WIN32
+
+/* Lines of the "bits" output, each larger than a pipe's buffer. */
+#define SINK_LINES		3
+#define SINK_LINE_SAMPLES	(96 * 1024)
+#define SINK_READ_CHUNK		1000
+#define SINK_ALARM_USECS	200
+
+struct pipe_reader {
+	int fd;
+	GByteArray *data;
+};
+
+static volatile sig_atomic_t sink_alarms;
+
+static void sink_alarm(int sig)
+{
+	(void)sig;
+
+	sink_alarms++;
+}
+
+/* Read slowly in small chunks, such that the writer blocks. */
+static gpointer pipe_reader_run(gpointer data)
+{
+	struct pipe_reader *rd;
+	uint8_t buf[SINK_READ_CHUNK];
+	ssize_t ret;
+
+	rd = data;
+	while ((ret = read(rd->fd, buf, sizeof(buf))) != 0) {
+		if (ret < 0)
+			continue;
+		g_byte_array_append(rd->data, buf, ret);
+		g_usleep(20);
+	}
+
+	return NULL;
+}
+
+/* Set up a "bits" output with long lines, one region per line. */
+static const struct sr_output *sink_bits_output(struct sr_dev_inst *sdi)
+{
+	const struct sr_output *o;
+	GHashTable *opts;
+
+	opts = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(opts, "width", g_variant_ref_sink(
+		g_variant_new_uint32(SINK_LINE_SAMPLES)));
+	o = sr_output_new(sr_output_find("bits"), opts, sdi, NULL);
+	g_hash_table_destroy(opts);
+	fail_unless(o != NULL, "Cannot create 'bits' output.");
+
+	return o;
+}
+
+/*
+ * Write long gather lists to a pipe, while signals interrupt the
+ * blocked writer. The "bits" output writes each channel's line (larger
+ * than the pipe's buffer) and its newline as separate regions.
+ * Interrupted writes return after part of the data, the sink must
+ * resume at the correct offset within its regions.
+ */
+START_TEST(test_output_sink_fd_partial)
+{
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_output_sink *sink;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct pipe_reader rd;
+	struct sigaction sa, old_sa;
+	struct itimerval timer;
+	sigset_t set, old_set;
+	GString *expect, *out;
+	GThread *thread;
+	uint8_t *data;
+	char name[8];
+	size_t i;
+	int fds[2], ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(sdi != NULL, "sr_dev_inst_user_new() failed.");
+	for (i = 0; i < 8; i++) {
+		snprintf(name, sizeof(name), "D%zu", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	data = g_malloc(SINK_LINES * SINK_LINE_SAMPLES);
+	for (i = 0; i < SINK_LINES * SINK_LINE_SAMPLES; i++)
+		data[i] = (i * 7) ^ (i >> 9);
+	logic.length = SINK_LINES * SINK_LINE_SAMPLES;
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	o = sink_bits_output(sdi);
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out, "sr_output_send() failed: %d.", ret);
+	expect = out;
+	sr_output_free(o);
+
+	fail_unless(pipe(fds) == 0, "Cannot create pipe.");
+	rd.fd = fds[0];
+	rd.data = g_byte_array_new();
+	/* Only the writer (this thread) must receive the signals. */
+	sigemptyset(&set);
+	sigaddset(&set, SIGALRM);
+	pthread_sigmask(SIG_BLOCK, &set, &old_set);
+	thread = g_thread_new("pipe-reader", pipe_reader_run, &rd);
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sink_alarm;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGALRM, &sa, &old_sa);
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = SINK_ALARM_USECS;
+	timer.it_value = timer.it_interval;
+	sink_alarms = 0;
+	setitimer(ITIMER_REAL, &timer, NULL);
+
+	o = sink_bits_output(sdi);
+	sink = sr_output_sink_fd_new(fds[1], 0);
+	fail_unless(sink != NULL, "Cannot create fd sink.");
+	ret = sr_output_send_sink(o, &packet, sink);
+
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_REAL, &timer, NULL);
+	sigaction(SIGALRM, &old_sa, NULL);
+	fail_unless(ret == SR_OK, "Sink write failed: %d.", ret);
+	fail_unless(sr_output_sink_bytes(sink) == expect->len,
+		"Wrong sink byte count.");
+	sr_output_sink_free(sink);
+	sr_output_free(o);
+	close(fds[1]);
+	g_thread_join(thread);
+	close(fds[0]);
+
+	fail_unless(sink_alarms > 0, "Writer was not interrupted.");
+	fail_unless(rd.data->len == expect->len,
+		"Unexpected amount of data: %u of %zu bytes.",
+		rd.data->len, expect->len);
+	fail_unless(!memcmp(rd.data->data, expect->str, expect->len),
+		"Data corrupted by partial writes.");
+
+	g_byte_array_free(rd.data, TRUE);
+	g_string_free(expect, TRUE);
+	g_free(data);
+}
+END_TEST
+
+#endif
+
+#define VCD_CHANNELS	12
+#define VCD_DISABLED	10
+#define VCD_SAMPLES	20000
+#define VCD_SAMPLERATE	SR_MHZ(1)
+
+/* Run packets through an output, collect the text after the header. */
+static GString *vcd_collect(const struct sr_output *o,
+	const struct sr_datafeed_packet *packets, size_t count)
+{
+	GString *text, *out;
+	const char *body;
+	size_t idx;
+	int ret;
+
+	text = g_string_new(NULL);
+	for (idx = 0; idx < count; idx++) {
+		out = NULL;
+		ret = sr_output_send(o, &packets[idx], &out);
+		fail_unless(ret == SR_OK, "sr_output_send() failed: %d.", ret);
+		if (out) {
+			g_string_append_len(text, out->str, out->len);
+			g_string_free(out, TRUE);
+		}
+	}
+	body = strstr(text->str, "$enddefinitions $end\n");
+	fail_unless(body != NULL, "No VCD header.");
+	g_string_erase(text, 0, body - text->str);
+
+	return text;
+}
+
+/*
+ * Logic packets get scanned for runs of unchanged samples in bulk, with
+ * changes of disabled channels and unused bits masked out. Compare the
+ * VCD text against the output for RLE packets of single sample runs,
+ * which check every sample's value individually. User devices have no
+ * samplerate, a meta packet provides it for the VCD timescale.
+ */
+START_TEST(test_output_vcd_changes)
+{
+	static const size_t splits[] = { 1, 2, 31, 4096, 7, VCD_SAMPLES, };
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packets[ARRAY_SIZE(splits) + 2];
+	struct sr_datafeed_logic logic[ARRAY_SIZE(splits)];
+	struct sr_datafeed_logic_rle rle;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+	uint8_t *data;
+	uint64_t *counts;
+	GString *bulk, *each;
+	GRand *rand;
+	char name[8];
+	size_t idx, pos, len, num;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(sdi != NULL, "sr_dev_inst_user_new() failed.");
+	for (idx = 0; idx < VCD_CHANNELS; idx++) {
+		snprintf(name, sizeof(name), "D%zu", idx);
+		sr_dev_inst_channel_add(sdi, idx, SR_CHANNEL_LOGIC, name);
+	}
+	ch = g_slist_nth_data(sr_dev_inst_channels_get(sdi), VCD_DISABLED);
+	sr_dev_channel_enable(ch, FALSE);
+
+	/* Long runs, with changes of random channels, also unused bits. */
+	rand = g_rand_new_with_seed(42);
+	data = g_malloc(VCD_SAMPLES * 2);
+	counts = g_malloc(VCD_SAMPLES * sizeof(counts[0]));
+	data[0] = data[1] = 0;
+	for (idx = 0; idx < VCD_SAMPLES; idx++) {
+		if (idx) {
+			data[idx * 2 + 0] = data[idx * 2 - 2];
+			data[idx * 2 + 1] = data[idx * 2 - 1];
+		}
+		if (g_rand_int_range(rand, 0, 200) == 0) {
+			pos = g_rand_int_range(rand, 0, 16);
+			data[idx * 2 + pos / 8] ^= 1 << (pos % 8);
+		}
+		counts[idx] = 1;
+	}
+	g_rand_free(rand);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(VCD_SAMPLERATE));
+	meta.config = g_slist_append(NULL, &src);
+	packets[0].type = SR_DF_META;
+	packets[0].payload = &meta;
+
+	num = 1;
+	pos = 0;
+	for (idx = 0; idx < ARRAY_SIZE(splits) && pos < VCD_SAMPLES; idx++) {
+		len = MIN(splits[idx], VCD_SAMPLES - pos);
+		logic[idx].length = len * 2;
+		logic[idx].unitsize = 2;
+		logic[idx].data = &data[pos * 2];
+		packets[num].type = SR_DF_LOGIC;
+		packets[num++].payload = &logic[idx];
+		pos += len;
+	}
+	fail_unless(pos == VCD_SAMPLES);
+	packets[num].type = SR_DF_END;
+	packets[num++].payload = NULL;
+	o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create 'vcd' output.");
+	bulk = vcd_collect(o, packets, num);
+	sr_output_free(o);
+
+	rle.num_runs = VCD_SAMPLES;
+	rle.unitsize = 2;
+	rle.values = data;
+	rle.counts = counts;
+	packets[1].type = SR_DF_LOGIC_RLE;
+	packets[1].payload = &rle;
+	packets[2].type = SR_DF_END;
+	packets[2].payload = NULL;
+	o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create 'vcd' output.");
+	each = vcd_collect(o, packets, 3);
+	sr_output_free(o);
+
+	fail_unless(strchr(bulk->str, '#') != NULL, "No value changes.");
+	fail_unless(bulk->len == each->len && !strcmp(bulk->str, each->str),
+		"VCD text differs for bulk change detection.");
+
+	g_string_free(bulk, TRUE);
+	g_string_free(each, TRUE);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+	g_free(data);
+	g_free(counts);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +529,12 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_sink_memory);
+	tcase_add_test(tc, test_output_send_empty);
+#ifndef _WIN32
+	tcase_add_test(tc, test_output_sink_fd_partial);
+#endif
+	tcase_add_test(tc, test_output_vcd_changes);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -0,0 +1,417 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+#include "lib.h"
+
+#ifndef _WIN32
+
+/* Responses of the fake device, commands without an entry get none. */
+static const struct {
+	const char *command;
+	const char *response;
+} fake_responses[] = {
+	{ "*OPC?", "1\n" },
+	{ "A?", "1.5\n" },
+	{ "B?", "42\n" },
+	{ "BLK?", "#15hello\n" },
+	{ "HDR:BLK?", "HDR:BLK ALL,#210abcdefghij\n" },
+	{ "EMPTY?", "#10\n" },
+};
+
+struct fake_device {
+	int listen_fd;
+	int port;
+	GThread *thread;
+	/* Received commands, one per line. */
+	GString *log;
+};
+
+/* Answer commands line by line, until the client disconnects. */
+static gpointer fake_device_run(gpointer data)
+{
+	struct fake_device *dev;
+	GString *line;
+	char c;
+	size_t i;
+	int fd;
+
+	dev = data;
+	fd = accept(dev->listen_fd, NULL, NULL);
+	if (fd < 0)
+		return NULL;
+
+	line = g_string_new(NULL);
+	while (recv(fd, &c, 1, 0) == 1) {
+		if (c != '\n') {
+			g_string_append_c(line, c);
+			continue;
+		}
+		g_string_append_printf(dev->log, "%s\n", line->str);
+		for (i = 0; i < G_N_ELEMENTS(fake_responses); i++) {
+			if (strcmp(line->str, fake_responses[i].command))
+				continue;
+			send(fd, fake_responses[i].response,
+				strlen(fake_responses[i].response), 0);
+			break;
+		}
+		g_string_truncate(line, 0);
+	}
+	g_string_free(line, TRUE);
+	close(fd);
+
+	return NULL;
+}
+
+static struct sr_scpi_dev_inst *fake_device_open(struct fake_device *dev)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct sockaddr_in addr;
+	socklen_t addrlen;
+	char *resource;
+
+	dev->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(dev->listen_fd >= 0, "Cannot create socket.");
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	fail_unless(bind(dev->listen_fd, (struct sockaddr *)&addr,
+		sizeof(addr)) == 0, "Cannot bind socket.");
+	fail_unless(listen(dev->listen_fd, 1) == 0, "Cannot listen.");
+	addrlen = sizeof(addr);
+	getsockname(dev->listen_fd, (struct sockaddr *)&addr, &addrlen);
+	dev->port = ntohs(addr.sin_port);
+	dev->log = g_string_new(NULL);
+	dev->thread = g_thread_new("fake-scpi", fake_device_run, dev);
+
+	resource = g_strdup_printf("tcp-raw/127.0.0.1/%d", dev->port);
+	scpi = scpi_dev_inst_new(NULL, resource, NULL);
+	g_free(resource);
+	fail_unless(scpi != NULL, "Cannot create SCPI device.");
+	fail_unless(sr_scpi_open(scpi) == SR_OK, "Cannot open SCPI device.");
+
+	return scpi;
+}
+
+static void fake_device_close(struct fake_device *dev,
+	struct sr_scpi_dev_inst *scpi)
+{
+	sr_scpi_close(scpi);
+	sr_scpi_free(scpi);
+	g_thread_join(dev->thread);
+	close(dev->listen_fd);
+}
+
+/*
+ * Pipeline commands and queries, and read the responses of several
+ * kinds back-to-back. A command which contains a '?' but has no
+ * response must not be taken for a query.
+ */
+START_TEST(test_scpi_batch_pipelined)
+{
+	struct fake_device dev;
+	struct sr_scpi_dev_inst *scpi;
+	struct sr_scpi_batch *batch;
+	GByteArray *block;
+	float fvalue;
+	int ivalue, ret;
+	char *str;
+
+	scpi = fake_device_open(&dev);
+	batch = sr_scpi_batch_new(scpi);
+	fail_unless(batch->pipelined, "Raw TCP batches should be pipelined.");
+
+	sr_scpi_batch_add(batch, "DISP:TEXT 'why?'");
+	sr_scpi_batch_add_query(batch, "A?");
+	sr_scpi_batch_add_query(batch, "BLK?");
+	sr_scpi_batch_add_query(batch, "HDR:BLK?");
+	sr_scpi_batch_add_query(batch, "EMPTY?");
+	sr_scpi_batch_add_query(batch, "B?");
+	sr_scpi_batch_add_query(batch, "*OPC?");
+	ret = sr_scpi_batch_flush(batch);
+	fail_unless(ret == SR_OK, "Flush error %d.", ret);
+	fail_unless(batch->pending == 6, "Unexpected query count %u.",
+		batch->pending);
+
+	ret = sr_scpi_batch_get_float(batch, &fvalue);
+	fail_unless(ret == SR_OK && fvalue == 1.5f, "Unexpected float.");
+	ret = sr_scpi_batch_get_block(batch, &block);
+	fail_unless(ret == SR_OK && block->len == 5 &&
+		!memcmp(block->data, "hello", 5), "Unexpected block.");
+	g_byte_array_free(block, TRUE);
+	ret = sr_scpi_batch_get_block(batch, &block);
+	fail_unless(ret == SR_OK && block->len == 10 &&
+		!memcmp(block->data, "abcdefghij", 10),
+		"Unexpected block with header.");
+	g_byte_array_free(block, TRUE);
+	ret = sr_scpi_batch_get_block(batch, &block);
+	fail_unless(ret == SR_OK && block->len == 0, "Unexpected empty block.");
+	g_byte_array_free(block, TRUE);
+	ret = sr_scpi_batch_get_int(batch, &ivalue);
+	fail_unless(ret == SR_OK && ivalue == 42, "Unexpected integer.");
+	ret = sr_scpi_batch_get_string(batch, &str);
+	fail_unless(ret == SR_OK && !strcmp(str, "1"), "Unexpected string.");
+	g_free(str);
+	fail_unless(batch->pending == 0, "Responses left unread.");
+
+	sr_scpi_batch_free(batch);
+	fake_device_close(&dev, scpi);
+	fail_unless(!strcmp(dev.log->str, "DISP:TEXT 'why?'\nA?\nBLK?\n"
+		"HDR:BLK?\nEMPTY?\nB?\n*OPC?\n"),
+		"Unexpected commands: %s", dev.log->str);
+	g_string_free(dev.log, TRUE);
+}
+END_TEST
+
+/*
+ * Give up on a partially read block while more responses are in
+ * flight. After a reset, the next query's response must be read, and
+ * no stale data.
+ */
+START_TEST(test_scpi_batch_reset)
+{
+	struct fake_device dev;
+	struct sr_scpi_dev_inst *scpi;
+	struct sr_scpi_batch *batch;
+	uint8_t buf[3];
+	size_t length;
+	float fvalue;
+	int ret;
+	char *str;
+
+	scpi = fake_device_open(&dev);
+	batch = sr_scpi_batch_new(scpi);
+
+	sr_scpi_batch_add_query(batch, "HDR:BLK?");
+	sr_scpi_batch_add_query(batch, "BLK?");
+	sr_scpi_batch_add_query(batch, "B?");
+	ret = sr_scpi_batch_flush(batch);
+	fail_unless(ret == SR_OK, "Flush error %d.", ret);
+	ret = sr_scpi_batch_block_begin(batch, &length);
+	fail_unless(ret == SR_OK && length == 10, "Unexpected block header.");
+	ret = sr_scpi_batch_read_block(batch, buf, sizeof(buf));
+	fail_unless(ret > 0, "Block read error %d.", ret);
+
+	sr_scpi_batch_reset(batch);
+	fail_unless(batch->pending == 0 && !batch->in_block,
+		"Reset left the batch busy.");
+	/* Commands which were not sent yet are dropped as well. */
+	sr_scpi_batch_add_query(batch, "B?");
+	sr_scpi_batch_reset(batch);
+
+	sr_scpi_batch_add_query(batch, "A?");
+	sr_scpi_batch_add_query(batch, "*OPC?");
+	ret = sr_scpi_batch_flush(batch);
+	fail_unless(ret == SR_OK, "Flush error %d.", ret);
+	ret = sr_scpi_batch_get_float(batch, &fvalue);
+	fail_unless(ret == SR_OK && fvalue == 1.5f,
+		"Stale data after reset.");
+	ret = sr_scpi_batch_get_string(batch, &str);
+	fail_unless(ret == SR_OK && !strcmp(str, "1"), "Unexpected string.");
+	g_free(str);
+
+	sr_scpi_batch_free(batch);
+	fake_device_close(&dev, scpi);
+	g_string_free(dev.log, TRUE);
+}
+END_TEST
+
+struct other_query {
+	struct sr_scpi_dev_inst *scpi;
+	char *response;
+	int ret;
+	gint done;
+};
+
+static gpointer other_query_run(gpointer data)
+{
+	struct other_query *q;
+
+	q = data;
+	q->ret = sr_scpi_get_string(q->scpi, "B?", &q->response);
+	g_atomic_int_set(&q->done, 1);
+
+	return NULL;
+}
+
+/*
+ * Another thread which queries the device while batch responses are
+ * outstanding must wait for them, and must not get their data. After
+ * a reset, the device is available again.
+ */
+START_TEST(test_scpi_batch_lock)
+{
+	struct fake_device dev;
+	struct sr_scpi_dev_inst *scpi;
+	struct sr_scpi_batch *batch;
+	struct other_query q;
+	GByteArray *block;
+	GThread *thread;
+	float fvalue;
+	int ivalue, ret;
+
+	scpi = fake_device_open(&dev);
+	batch = sr_scpi_batch_new(scpi);
+
+	sr_scpi_batch_add_query(batch, "A?");
+	sr_scpi_batch_add_query(batch, "BLK?");
+	ret = sr_scpi_batch_flush(batch);
+	fail_unless(ret == SR_OK, "Flush error %d.", ret);
+
+	memset(&q, 0, sizeof(q));
+	q.scpi = scpi;
+	thread = g_thread_new("scpi-other", other_query_run, &q);
+	g_usleep(100 * 1000);
+	fail_unless(!g_atomic_int_get(&q.done),
+		"Query interleaved with outstanding batch responses.");
+
+	ret = sr_scpi_batch_get_float(batch, &fvalue);
+	fail_unless(ret == SR_OK && fvalue == 1.5f, "Unexpected float.");
+	fail_unless(!g_atomic_int_get(&q.done),
+		"Query interleaved with an outstanding block.");
+	/* Give up on the block, the reset drops it. */
+	sr_scpi_batch_reset(batch);
+	g_thread_join(thread);
+	fail_unless(q.ret == SR_OK && !strcmp(q.response, "42"),
+		"Other thread got an unexpected response.");
+	g_free(q.response);
+
+	/* Without outstanding responses, the device is not locked. */
+	sr_scpi_batch_add(batch, "DISP:TEXT 'idle'");
+	sr_scpi_batch_flush(batch);
+	ret = sr_scpi_get_int(scpi, "B?", &ivalue);
+	fail_unless(ret == SR_OK && ivalue == 42, "Unexpected integer.");
+
+	/* Nor does the termination of the last block reach other users. */
+	sr_scpi_batch_add_query(batch, "BLK?");
+	sr_scpi_batch_flush(batch);
+	ret = sr_scpi_batch_get_block(batch, &block);
+	fail_unless(ret == SR_OK && block->len == 5, "Unexpected block.");
+	g_byte_array_free(block, TRUE);
+	ret = sr_scpi_get_int(scpi, "B?", &ivalue);
+	fail_unless(ret == SR_OK && ivalue == 42, "Block termination left over.");
+
+	sr_scpi_batch_free(batch);
+	fake_device_close(&dev, scpi);
+	fail_unless(!strcmp(dev.log->str, "A?\nBLK?\nB?\n"
+		"DISP:TEXT 'idle'\nB?\nBLK?\nB?\n"),
+		"Unexpected commands: %s", dev.log->str);
+	g_string_free(dev.log, TRUE);
+}
+END_TEST
+
+struct block_slices {
+	struct other_query *query;
+	GThread *thread;
+	GString *data;
+	gboolean split;
+};
+
+static int block_slice_cb(const uint8_t *data, size_t len, size_t total,
+		void *cb_data)
+{
+	struct block_slices *b;
+
+	(void)total;
+
+	b = cb_data;
+	if (len % sizeof(uint16_t))
+		b->split = TRUE;
+	g_string_append_len(b->data, (const char *)data, len);
+
+	/* Another thread's query must wait for the end of the block. */
+	if (!b->thread) {
+		b->thread = g_thread_new("scpi-other", other_query_run,
+			b->query);
+		g_usleep(100 * 1000);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * The block callback only gets complete samples, a trailing partial
+ * sample is dropped. The device stays locked while the callback runs.
+ */
+START_TEST(test_scpi_get_block_cb)
+{
+	struct fake_device dev;
+	struct sr_scpi_dev_inst *scpi;
+	struct other_query q;
+	struct block_slices b;
+	int ret;
+
+	scpi = fake_device_open(&dev);
+
+	memset(&q, 0, sizeof(q));
+	q.scpi = scpi;
+	memset(&b, 0, sizeof(b));
+	b.query = &q;
+	b.data = g_string_new(NULL);
+	ret = sr_scpi_get_block_cb(scpi, "BLK?", sizeof(uint16_t),
+		block_slice_cb, &b);
+	fail_unless(ret == SR_OK, "Block error %d.", ret);
+	fail_unless(!b.split, "Sample split across slices.");
+	fail_unless(!strcmp(b.data->str, "hell"),
+		"Unexpected block data: %s", b.data->str);
+	fail_unless(b.thread != NULL, "Callback not invoked.");
+	g_thread_join(b.thread);
+	fail_unless(q.ret == SR_OK && !strcmp(q.response, "42"),
+		"Query interleaved with the block.");
+	g_free(q.response);
+	g_string_free(b.data, TRUE);
+
+	fake_device_close(&dev, scpi);
+	fail_unless(!strcmp(dev.log->str, "BLK?\nB?\n"),
+		"Unexpected commands: %s", dev.log->str);
+	g_string_free(dev.log, TRUE);
+}
+END_TEST
+
+#endif
+
+Suite *suite_scpi(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("scpi");
+
+	tc = tcase_create("batch");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+#ifndef _WIN32
+	tcase_add_test(tc, test_scpi_batch_pipelined);
+	tcase_add_test(tc, test_scpi_batch_reset);
+	tcase_add_test(tc, test_scpi_batch_lock);
+	tcase_add_test(tc, test_scpi_get_block_cb);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -185,6 +185,36 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether the session feed thread can get configured, and whether
+ * its statistics can get retrieved.
+ */
+START_TEST(test_session_feed_thread_set)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_feed_stats stats;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_feed_thread_set(sess, 100);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_feed_thread_set(sess, 0);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_feed_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats.packets == 0 && stats.stalls == 0);
+
+	sr_session_destroy(sess);
+
+	/* NULL session or stats, must not segfault. */
+	ret = sr_session_feed_thread_set(NULL, 100);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_feed_stats_get(NULL, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +239,10 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("feed_thread");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_feed_thread_set);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
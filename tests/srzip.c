@@ -0,0 +1,529 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <zip.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define SRZIP_LOGIC_CHANNELS	16
+#define SRZIP_UNITSIZE		(SRZIP_LOGIC_CHANNELS / 8)
+#define SRZIP_SAMPLERATE	SR_MHZ(1)
+/*
+ * Amount of logic data to write for the benchmark (a multi-GB capture,
+ * SRZIP_BENCH_MB overrides it), and to replay. Size of feed packets.
+ */
+#define BENCH_BYTES		(UINT64_C(2) * 1024 * 1024 * 1024)
+#define REPLAY_BYTES		(256 * 1024 * 1024)
+#define METHOD_BENCH_BYTES	(256 * 1024 * 1024)
+#define BENCH_PACKET_BYTES	(64 * 1024)
+/* The srzip output writes chunks of 4 MiB. */
+#define ARCHIVE_CHUNK_BYTES	(4 * 1024 * 1024)
+/* Amount of logic data for random access, spans several archive chunks. */
+#define ACCESS_SAMPLES		(5 * 1024 * 1024 + 321)
+
+/* Logic data pattern: slow counter, compresses like typical captures. */
+static void fill_pattern(uint8_t *buf, size_t length, uint64_t sample)
+{
+	size_t pos;
+	uint16_t value;
+
+	for (pos = 0; pos + SRZIP_UNITSIZE <= length; pos += SRZIP_UNITSIZE) {
+		value = (sample++ >> 6) & 0xffff;
+		buf[pos + 0] = value & 0xff;
+		buf[pos + 1] = value >> 8;
+	}
+}
+
+static struct sr_dev_inst *create_device(void)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(sdi != NULL, "sr_dev_inst_user_new() failed.");
+	for (i = 0; i < SRZIP_LOGIC_CHANNELS; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+
+	return sdi;
+}
+
+static void send_packet(const struct sr_output *o,
+	uint16_t type, const void *payload)
+{
+	struct sr_datafeed_packet packet;
+	GString *out;
+	int ret;
+
+	packet.type = type;
+	packet.payload = payload;
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "sr_output_send() error: %d", ret);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+static void send_samplerate(const struct sr_output *o)
+{
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SRZIP_SAMPLERATE));
+	meta.config = g_slist_append(NULL, &src);
+	send_packet(o, SR_DF_META, &meta);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+}
+
+/*
+ * Write an amount of patterned logic data to an srzip file, using the
+ * output module's options (may be NULL). Returns the time spent,
+ * optionally the time spent at the end of the feed, and the data's
+ * hash. Archive members must reach the file while the data is being
+ * sent, not only at the end of the feed. Up to two chunks per processor
+ * may be waiting for the compression threads, check after that.
+ */
+static gint64 write_srzip(const char *filename, GHashTable *options,
+	uint64_t length, gint64 *end_usecs, uint32_t *hash)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_logic logic;
+	uint8_t *buf;
+	uint64_t pos;
+	uint64_t check_pos;
+	gint64 start, end_start, usecs;
+	gboolean checked;
+	GStatBuf st;
+
+	sdi = create_device();
+	o = sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+	fail_unless(o != NULL, "Cannot create srzip output.");
+
+	buf = g_malloc(BENCH_PACKET_BYTES);
+	logic.unitsize = SRZIP_UNITSIZE;
+	logic.length = BENCH_PACKET_BYTES;
+	logic.data = buf;
+
+	*hash = 0;
+	checked = FALSE;
+	check_pos = (2 * g_get_num_processors() + 2) * ARCHIVE_CHUNK_BYTES;
+	start = g_get_monotonic_time();
+	send_packet(o, SR_DF_HEADER, NULL);
+	send_samplerate(o);
+	for (pos = 0; pos < length; pos += logic.length) {
+		logic.length = MIN(length - pos, BENCH_PACKET_BYTES);
+		fill_pattern(buf, logic.length, pos / SRZIP_UNITSIZE);
+		*hash = srtest_hash(*hash, buf, logic.length);
+		send_packet(o, SR_DF_LOGIC, &logic);
+		if (!checked && pos >= check_pos) {
+			fail_unless(g_stat(filename, &st) == 0,
+				"No output file during the capture.");
+			fail_unless(st.st_size > ARCHIVE_CHUNK_BYTES / 1024,
+				"Chunks not written during the capture.");
+			checked = TRUE;
+		}
+	}
+	end_start = g_get_monotonic_time();
+	send_packet(o, SR_DF_END, NULL);
+	usecs = g_get_monotonic_time() - start;
+	if (end_usecs)
+		*end_usecs = g_get_monotonic_time() - end_start;
+	sr_output_free(o);
+	g_free(buf);
+
+	return usecs;
+}
+
+/* Number of directory entries besides "." and "..". */
+static guint dir_entry_count(const char *dirname)
+{
+	GDir *dir;
+	guint count;
+
+	dir = g_dir_open(dirname, 0, NULL);
+	fail_unless(dir != NULL, "Cannot open directory %s.", dirname);
+	count = 0;
+	while (g_dir_read_name(dir))
+		count++;
+	g_dir_close(dir);
+
+	return count;
+}
+
+static uint64_t bench_bytes(void)
+{
+	const char *s;
+
+	s = g_getenv("SRZIP_BENCH_MB");
+	if (!s || !*s)
+		return BENCH_BYTES;
+
+	return g_ascii_strtoull(s, NULL, 10) * 1024 * 1024;
+}
+
+/*
+ * Write a multi-GB capture to an srzip file, and report the throughput,
+ * the time spent at the end of the feed, and the archive size (debug
+ * log). No other files may be written next to the archive.
+ */
+START_TEST(test_srzip_write_bench)
+{
+	char *dirname, *filename;
+	gint64 usecs, end_usecs;
+	uint64_t length;
+	uint32_t hash;
+	GStatBuf st;
+
+	dirname = g_dir_make_tmp("srzip-XXXXXX", NULL);
+	fail_unless(dirname != NULL, "Cannot create temporary directory.");
+	filename = g_build_filename(dirname, "bench.sr", NULL);
+
+	length = bench_bytes();
+	usecs = write_srzip(filename, NULL, length, &end_usecs, &hash);
+
+	fail_unless(g_stat(filename, &st) == 0, "No output file written.");
+	fail_unless(st.st_size > 0, "Empty output file.");
+	fail_unless(dir_entry_count(dirname) == 1, "Extra files written.");
+
+	srtest_bench_report("srzip write", length, "B", usecs);
+	g_debug("srzip write: %" PRIi64 " us at the end of the feed, %"
+		PRIi64 " bytes archive.", end_usecs, (int64_t)st.st_size);
+
+	g_unlink(filename);
+	g_rmdir(dirname);
+	g_free(filename);
+	g_free(dirname);
+}
+END_TEST
+
+/* Compression settings to compare. Level 0 is the method's default. */
+static const struct {
+	const char *method;
+	uint32_t level;
+	uint32_t threads;
+} method_bench[] = {
+	{ "store", 0, 0 },
+	{ "deflate", 1, 0 },
+	{ "deflate", 0, 1 },
+	{ "deflate", 0, 0 },
+	{ "deflate", 9, 0 },
+	{ "zstd", 1, 0 },
+	{ "zstd", 0, 0 },
+	{ "zstd", 19, 0 },
+};
+
+/* Whether the srzip output offers a compression method in this build. */
+static gboolean method_supported(const char *method)
+{
+	const struct sr_option **opts;
+	const GSList *l;
+	gboolean found;
+	int i;
+
+	opts = sr_output_options_get(sr_output_find("srzip"));
+	found = FALSE;
+	for (i = 0; opts && opts[i]; i++) {
+		if (strcmp(opts[i]->id, "compression"))
+			continue;
+		for (l = opts[i]->values; l; l = l->next) {
+			if (!strcmp(g_variant_get_string(l->data, NULL), method))
+				found = TRUE;
+		}
+	}
+	sr_output_options_free(opts);
+
+	return found;
+}
+
+/*
+ * Write a capture with each compression method, level and number of
+ * threads, and report the throughput and the archive size (debug log).
+ */
+START_TEST(test_srzip_method_bench)
+{
+	GHashTable *options;
+	char *dirname, *filename, *name;
+	gint64 usecs;
+	uint32_t hash;
+	GStatBuf st;
+	size_t i;
+
+	dirname = g_dir_make_tmp("srzip-XXXXXX", NULL);
+	fail_unless(dirname != NULL, "Cannot create temporary directory.");
+	filename = g_build_filename(dirname, "method.sr", NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(method_bench); i++) {
+		if (!method_supported(method_bench[i].method))
+			continue;
+		options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+		g_hash_table_insert(options, "compression", g_variant_ref_sink(
+			g_variant_new_string(method_bench[i].method)));
+		g_hash_table_insert(options, "level", g_variant_ref_sink(
+			g_variant_new_uint32(method_bench[i].level)));
+		g_hash_table_insert(options, "threads", g_variant_ref_sink(
+			g_variant_new_uint32(method_bench[i].threads)));
+		usecs = write_srzip(filename, options, METHOD_BENCH_BYTES,
+			NULL, &hash);
+		g_hash_table_destroy(options);
+
+		fail_unless(g_stat(filename, &st) == 0, "No output file written.");
+		fail_unless(st.st_size > 0, "Empty output file.");
+
+		name = g_strdup_printf("srzip %s level %" PRIu32 " threads %"
+			PRIu32, method_bench[i].method, method_bench[i].level,
+			method_bench[i].threads);
+		srtest_bench_report(name, METHOD_BENCH_BYTES, "B", usecs);
+		g_debug("%s: %" PRIi64 " bytes archive.", name, (int64_t)st.st_size);
+		g_free(name);
+		g_unlink(filename);
+	}
+
+	g_rmdir(dirname);
+	g_free(filename);
+	g_free(dirname);
+}
+END_TEST
+
+/*
+ * Replay an srzip file through the session file driver, and report the
+ * throughput (debug log). The data must arrive unmodified.
+ */
+START_TEST(test_srzip_replay_bench)
+{
+	struct sr_session *session;
+	struct srtest_feed feed;
+	char *dirname, *filename;
+	gint64 usecs;
+	uint32_t hash;
+	int ret;
+
+	dirname = g_dir_make_tmp("srzip-XXXXXX", NULL);
+	fail_unless(dirname != NULL, "Cannot create temporary directory.");
+	filename = g_build_filename(dirname, "replay.sr", NULL);
+	write_srzip(filename, NULL, REPLAY_BYTES, NULL, &hash);
+
+	ret = sr_session_load(srtest_ctx, filename, &session);
+	fail_unless(ret == SR_OK, "sr_session_load() error: %d", ret);
+	memset(&feed, 0, sizeof(feed));
+	sr_session_datafeed_callback_add(session, srtest_feed_in, &feed);
+	usecs = srtest_session_run(session);
+
+	fail_unless(feed.seen_end, "No SR_DF_END seen.");
+	fail_unless(feed.logic_bytes == REPLAY_BYTES,
+		"Unexpected logic data amount: %" PRIu64 ".", feed.logic_bytes);
+	fail_unless(feed.logic_hash == hash, "Unexpected logic data content.");
+
+	srtest_bench_report("srzip replay", REPLAY_BYTES, "B", usecs);
+
+	sr_session_destroy(session);
+	g_unlink(filename);
+	g_rmdir(dirname);
+	g_free(filename);
+	g_free(dirname);
+}
+END_TEST
+
+/*
+ * Replace the archive's index, or remove it when text is NULL. Models
+ * files which older versions wrote, or which were modified later.
+ */
+static void replace_index(const char *filename, const char *text)
+{
+	struct zip *archive;
+	struct zip_source *src;
+	zip_int64_t idx;
+
+	archive = zip_open(filename, 0, NULL);
+	fail_unless(archive != NULL, "Cannot open archive.");
+	idx = zip_name_locate(archive, "index", 0);
+	fail_unless(idx >= 0, "No index in archive.");
+	if (text) {
+		src = zip_source_buffer(archive, text, strlen(text), FALSE);
+		fail_unless(zip_replace(archive, idx, src) >= 0,
+			"Cannot replace index.");
+	} else {
+		fail_unless(zip_delete(archive, idx) == 0,
+			"Cannot remove index.");
+	}
+	fail_unless(zip_close(archive) == 0, "Cannot write archive.");
+}
+
+/* Read a range of samples, compare against the written pattern. */
+static void check_read(struct sr_session_file *sf, uint64_t start,
+	uint64_t count)
+{
+	uint8_t *buf, *expect;
+	uint64_t got, want;
+	int ret;
+
+	want = start < ACCESS_SAMPLES ? MIN(count, ACCESS_SAMPLES - start) : 0;
+	buf = g_malloc0(count * SRZIP_UNITSIZE + 1);
+	expect = g_malloc0(count * SRZIP_UNITSIZE + 1);
+	fill_pattern(expect, want * SRZIP_UNITSIZE, start);
+
+	ret = sr_session_file_logic_read(sf, start, count, buf, &got);
+	fail_unless(ret == SR_OK, "Read error %d at %" PRIu64 ".", ret, start);
+	fail_unless(got == want, "Read %" PRIu64 " instead of %" PRIu64
+		" samples at %" PRIu64 ".", got, want, start);
+	fail_unless(memcmp(buf, expect, want * SRZIP_UNITSIZE) == 0,
+		"Data mismatch at %" PRIu64 ".", start);
+
+	g_free(buf);
+	g_free(expect);
+}
+
+/* Check the channel change mask of a range against the pattern. */
+static void check_changes(struct sr_session_file *sf, uint64_t start,
+	uint64_t count)
+{
+	uint8_t *data, changes[SRZIP_UNITSIZE], expect[SRZIP_UNITSIZE];
+	uint64_t i;
+	size_t b;
+	int ret;
+
+	data = g_malloc(count * SRZIP_UNITSIZE);
+	fill_pattern(data, count * SRZIP_UNITSIZE, start);
+	memset(expect, 0, sizeof(expect));
+	for (i = 1; i < count; i++) {
+		for (b = 0; b < SRZIP_UNITSIZE; b++)
+			expect[b] |= data[(i - 1) * SRZIP_UNITSIZE + b] ^
+				data[i * SRZIP_UNITSIZE + b];
+	}
+	g_free(data);
+
+	ret = sr_session_file_logic_changes(sf, start, count, changes);
+	fail_unless(ret == SR_OK, "Changes error %d at %" PRIu64 ".",
+		ret, start);
+	fail_unless(memcmp(changes, expect, sizeof(expect)) == 0,
+		"Changes mismatch at %" PRIu64 ".", start);
+}
+
+/*
+ * Open an srzip file for random access, and read ranges at the start,
+ * across chunk boundaries, and beyond the end of the data.
+ */
+static void check_random_access(const char *index_text, gboolean replace)
+{
+	struct sr_session_file *sf;
+	char *dirname, *filename;
+	unsigned int unitsize;
+	uint64_t num_samples, chunk_samples;
+	uint32_t hash;
+	int ret;
+
+	dirname = g_dir_make_tmp("srzip-XXXXXX", NULL);
+	fail_unless(dirname != NULL, "Cannot create temporary directory.");
+	filename = g_build_filename(dirname, "access.sr", NULL);
+	write_srzip(filename, NULL, ACCESS_SAMPLES * SRZIP_UNITSIZE, NULL,
+		&hash);
+	if (replace)
+		replace_index(filename, index_text);
+
+	ret = sr_session_file_open(filename, &sf);
+	fail_unless(ret == SR_OK, "sr_session_file_open() error: %d", ret);
+	ret = sr_session_file_logic_info(sf, &unitsize, &num_samples);
+	fail_unless(ret == SR_OK, "sr_session_file_logic_info() error: %d", ret);
+	fail_unless(unitsize == SRZIP_UNITSIZE, "Unexpected unit size %u.",
+		unitsize);
+	fail_unless(num_samples == ACCESS_SAMPLES,
+		"Unexpected sample count %" PRIu64 ".", num_samples);
+
+	chunk_samples = ARCHIVE_CHUNK_BYTES / SRZIP_UNITSIZE;
+	check_read(sf, 0, 1000);
+	check_read(sf, 12345, 1);
+	check_read(sf, chunk_samples - 10, 20);
+	check_read(sf, chunk_samples, 1000);
+	check_read(sf, 2 * chunk_samples - 5000, 100000);
+	check_read(sf, ACCESS_SAMPLES - 100, 1000);
+	check_read(sf, ACCESS_SAMPLES + 10, 10);
+	check_changes(sf, 0, 3 * chunk_samples / 2);
+	check_changes(sf, 100, 64);
+	check_changes(sf, chunk_samples - 1, chunk_samples + 2);
+
+	sr_session_file_close(sf);
+	g_unlink(filename);
+	g_rmdir(dirname);
+	g_free(filename);
+	g_free(dirname);
+}
+
+START_TEST(test_srzip_file_access)
+{
+	check_random_access(NULL, FALSE);
+}
+END_TEST
+
+/* Archives without an index, sizes come from the archive directory. */
+START_TEST(test_srzip_file_access_no_index)
+{
+	check_random_access(NULL, TRUE);
+}
+END_TEST
+
+/* An index which lists fewer chunks than the archive holds is ignored. */
+START_TEST(test_srzip_file_access_index_mismatch)
+{
+	check_random_access("[logic-1]\nunitsize=2\n"
+		"samples=5;1000;\nchanges=ffff;0000;\n", TRUE);
+}
+END_TEST
+
+Suite *suite_srzip(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("srzip");
+
+	tc = tcase_create("write");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_srzip_write_bench);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("compression");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_srzip_method_bench);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("replay");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_srzip_replay_bench);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("random_access");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_srzip_file_access);
+	tcase_add_test(tc, test_srzip_file_access_no_index);
+	tcase_add_test(tc, test_srzip_file_access_index_mismatch);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -21,7 +21,10 @@
 #include <check.h>
 #include <errno.h>
 #include <locale.h>
+#include <math.h>
+#include <stdlib.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 #if 0
@@ -430,6 +433,301 @@ START_TEST(test_exponent)
 }
 END_TEST
 
+static const struct {
+	uint64_t value;
+	const char *text;
+} append_u64_tests[] = {
+	{ 0, "0" },
+	{ 9, "9" },
+	{ 10, "10" },
+	{ 99, "99" },
+	{ 100, "100" },
+	{ 1000000, "1000000" },
+	{ 1234567890123ULL, "1234567890123" },
+	{ UINT64_MAX, "18446744073709551615" },
+};
+
+static const struct {
+	int64_t value;
+	const char *text;
+} append_i64_tests[] = {
+	{ 0, "0" },
+	{ -1, "-1" },
+	{ 42, "42" },
+	{ -4200, "-4200" },
+	{ INT64_MAX, "9223372036854775807" },
+	{ INT64_MIN, "-9223372036854775808" },
+};
+
+/* Expected texts are those of printf() with the "%.*f" format. */
+static const struct {
+	double value;
+	int decimals;
+	const char *text;
+} append_fixed_tests[] = {
+	{ 0.0, 0, "0" },
+	{ -0.0, 2, "-0.00" },
+	{ 1.0, 3, "1.000" },
+	{ 1.5, 0, "2" },
+	/* Exact ties round to even, like printf(). */
+	{ 2.5, 0, "2" },
+	{ 0.125, 2, "0.12" },
+	{ 0.375, 2, "0.38" },
+	/* The binary value of 0.145 is below the tie. */
+	{ 0.145, 2, "0.14" },
+	{ 1234.5678, 2, "1234.57" },
+	{ -3.14159, 3, "-3.142" },
+	{ 1e-7, 3, "0.000" },
+	{ 9.9999, 3, "10.000" },
+	{ 1e20, 1, "100000000000000000000.0" },
+	{ 123.456, 20, "123.45600000000000306954" },
+	{ 5.0, -1, "5" },
+	{ INFINITY, 2, "inf" },
+	{ -INFINITY, 0, "-inf" },
+};
+
+/* Expected texts are those of printf() with the "%.*g" format. */
+static const struct {
+	double value;
+	int precision;
+	const char *text;
+} append_g_tests[] = {
+	{ 0.0, 6, "0" },
+	{ -0.0, 6, "-0" },
+	{ 1.0, 6, "1" },
+	{ -2.5, 6, "-2.5" },
+	{ 0.1, 6, "0.1" },
+	{ 0.0001, 6, "0.0001" },
+	{ 0.00001, 6, "1e-05" },
+	{ 123456.0, 6, "123456" },
+	{ 1234567.0, 6, "1.23457e+06" },
+	{ 999999.5, 6, "1e+06" },
+	{ 3.0, 0, "3" },
+	{ 0.5, 1, "0.5" },
+	{ 3.14159265358979, 15, "3.14159265358979" },
+	{ 1e300, 6, "1e+300" },
+	{ -INFINITY, 6, "-inf" },
+};
+
+/* Shortest text which reads back as the same float. */
+static const struct {
+	float value;
+	const char *text;
+} append_float_tests[] = {
+	{ 0.0f, "0" },
+	{ -0.0f, "-0" },
+	{ 1.0f, "1" },
+	{ -2.5f, "-2.5" },
+	{ 0.1f, "0.1" },
+	{ 3.3f, "3.3" },
+	{ 0.0001f, "0.0001" },
+	{ 1e9f, "1000000000" },
+	{ 16777217.0f, "16777216" },
+	{ 1e10f, "1e+10" },
+	{ 1.17549435e-38f, "1.17549435e-38" },
+};
+
+START_TEST(test_gstring_append_int)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_new("x");
+	for (i = 0; i < G_N_ELEMENTS(append_u64_tests); i++) {
+		g_string_truncate(s, 1);
+		sr_gstring_append_u64(s, append_u64_tests[i].value);
+		fail_unless(!strcmp(s->str + 1, append_u64_tests[i].text),
+			"Expected '%s', got '%s'.",
+			append_u64_tests[i].text, s->str + 1);
+	}
+	for (i = 0; i < G_N_ELEMENTS(append_i64_tests); i++) {
+		g_string_truncate(s, 1);
+		sr_gstring_append_i64(s, append_i64_tests[i].value);
+		fail_unless(!strcmp(s->str + 1, append_i64_tests[i].text),
+			"Expected '%s', got '%s'.",
+			append_i64_tests[i].text, s->str + 1);
+	}
+	g_string_free(s, TRUE);
+}
+END_TEST
+
+START_TEST(test_gstring_append_fixed)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_new(NULL);
+	for (i = 0; i < G_N_ELEMENTS(append_fixed_tests); i++) {
+		g_string_truncate(s, 0);
+		sr_gstring_append_fixed(s, append_fixed_tests[i].value,
+			append_fixed_tests[i].decimals);
+		fail_unless(!strcmp(s->str, append_fixed_tests[i].text),
+			"Expected '%s', got '%s'.",
+			append_fixed_tests[i].text, s->str);
+	}
+	g_string_free(s, TRUE);
+}
+END_TEST
+
+START_TEST(test_gstring_append_g)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_new(NULL);
+	for (i = 0; i < G_N_ELEMENTS(append_g_tests); i++) {
+		g_string_truncate(s, 0);
+		sr_gstring_append_g(s, append_g_tests[i].value,
+			append_g_tests[i].precision);
+		fail_unless(!strcmp(s->str, append_g_tests[i].text),
+			"Expected '%s', got '%s'.",
+			append_g_tests[i].text, s->str);
+	}
+	g_string_free(s, TRUE);
+}
+END_TEST
+
+START_TEST(test_gstring_append_float)
+{
+	GString *s;
+	size_t i;
+
+	s = g_string_new(NULL);
+	for (i = 0; i < G_N_ELEMENTS(append_float_tests); i++) {
+		g_string_truncate(s, 0);
+		sr_gstring_append_float(s, append_float_tests[i].value);
+		fail_unless(!strcmp(s->str, append_float_tests[i].text),
+			"Expected '%s', got '%s'.",
+			append_float_tests[i].text, s->str);
+	}
+	g_string_free(s, TRUE);
+}
+END_TEST
+
+/*
+ * Compare random values' text against g_ascii_formatd(), which follows
+ * printf() in the C locale. Float text must read back as the same value.
+ */
+START_TEST(test_gstring_append_random)
+{
+	char fmt[16], ref[G_ASCII_DTOSTR_BUF_SIZE + 64];
+	GString *s;
+	GRand *rand;
+	double value;
+	float fvalue;
+	int i, digits;
+
+	s = g_string_new(NULL);
+	rand = g_rand_new_with_seed(17);
+	for (i = 0; i < 100000; i++) {
+		value = ldexp(g_rand_double_range(rand, -1.0, 1.0),
+			g_rand_int_range(rand, -30, 40));
+		digits = g_rand_int_range(rand, 0, 10);
+
+		g_string_truncate(s, 0);
+		sr_gstring_append_fixed(s, value, digits);
+		snprintf(fmt, sizeof(fmt), "%%.%df", digits);
+		g_ascii_formatd(ref, sizeof(ref), fmt, value);
+		fail_unless(!strcmp(s->str, ref),
+			"Fixed: expected '%s', got '%s'.", ref, s->str);
+
+		g_string_truncate(s, 0);
+		sr_gstring_append_g(s, value, digits + 1);
+		snprintf(fmt, sizeof(fmt), "%%.%dg", digits + 1);
+		g_ascii_formatd(ref, sizeof(ref), fmt, value);
+		fail_unless(!strcmp(s->str, ref),
+			"General: expected '%s', got '%s'.", ref, s->str);
+
+		fvalue = value;
+		g_string_truncate(s, 0);
+		sr_gstring_append_float(s, fvalue);
+		fail_unless((float)g_ascii_strtod(s->str, NULL) == fvalue,
+			"Float: '%s' does not read back as %.9g.",
+			s->str, fvalue);
+	}
+	g_rand_free(rand);
+	g_string_free(s, TRUE);
+}
+END_TEST
+
+/*
+ * Format analog values like the CSV output does, and report the
+ * throughput of the append routines and of printf() (debug log).
+ */
+START_TEST(test_gstring_append_bench)
+{
+	const int count = 1000 * 1000;
+	GString *s;
+	GRand *rand;
+	float *values;
+	gint64 start, usecs, ref_usecs;
+	int i;
+
+	rand = g_rand_new_with_seed(23);
+	values = g_malloc(count * sizeof(values[0]));
+	for (i = 0; i < count; i++)
+		values[i] = g_rand_double_range(rand, -5.0, 5.0);
+	g_rand_free(rand);
+	s = g_string_sized_new(16 * count);
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		g_string_append_printf(s, "%g,", values[i]);
+	}
+	ref_usecs = g_get_monotonic_time() - start;
+
+	g_string_truncate(s, 0);
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		sr_gstring_append_g(s, values[i], 6);
+		g_string_append_c(s, ',');
+	}
+	usecs = g_get_monotonic_time() - start;
+	g_debug("Append %%g: %d values in %" PRIi64 " us, %.1f M/s "
+		"(printf %" PRIi64 " us).", count, usecs,
+		usecs ? (double)count / usecs : 0.0, ref_usecs);
+
+	g_string_truncate(s, 0);
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		g_string_append_printf(s, "%.16g ", values[i]);
+	}
+	ref_usecs = g_get_monotonic_time() - start;
+
+	g_string_truncate(s, 0);
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		sr_gstring_append_float(s, values[i]);
+		g_string_append_c(s, ' ');
+	}
+	usecs = g_get_monotonic_time() - start;
+	g_debug("Append float: %d values in %" PRIi64 " us, %.1f M/s "
+		"(printf %" PRIi64 " us).", count, usecs,
+		usecs ? (double)count / usecs : 0.0, ref_usecs);
+
+	g_string_truncate(s, 0);
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		g_string_append_printf(s, "%" PRIu64 ",", (uint64_t)i * 1000);
+	}
+	ref_usecs = g_get_monotonic_time() - start;
+
+	g_string_truncate(s, 0);
+	start = g_get_monotonic_time();
+	for (i = 0; i < count; i++) {
+		sr_gstring_append_u64(s, (uint64_t)i * 1000);
+		g_string_append_c(s, ',');
+	}
+	usecs = g_get_monotonic_time() - start;
+	g_debug("Append u64: %d values in %" PRIi64 " us, %.1f M/s "
+		"(printf %" PRIi64 " us).", count, usecs,
+		usecs ? (double)count / usecs : 0.0, ref_usecs);
+
+	g_string_free(s, TRUE);
+	g_free(values);
+}
+END_TEST
+
 Suite *suite_strutil(void)
 {
 	Suite *s;
@@ -452,5 +750,15 @@ Suite *suite_strutil(void)
 	tcase_add_test(tc, test_exponent);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("sr_gstring_append");
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_gstring_append_int);
+	tcase_add_test(tc, test_gstring_append_fixed);
+	tcase_add_test(tc, test_gstring_append_g);
+	tcase_add_test(tc, test_gstring_append_float);
+	tcase_add_test(tc, test_gstring_append_random);
+	tcase_add_test(tc, test_gstring_append_bench);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,8 +19,10 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /* Check whether at least one transform module is available. */
@@ -96,6 +98,654 @@ START_TEST(test_transform_options)
 }
 END_TEST
 
+/* Check the options of the 'decimate' transform module. */
+START_TEST(test_transform_decimate_options)
+{
+	const struct sr_option **opt;
+
+	opt = sr_transform_options_get(sr_transform_find("decimate"));
+	fail_unless(opt != NULL, "Couldn't find 'decimate' options.");
+	fail_unless(!strcmp(opt[0]->id, "factor"), "Wrong 'decimate' option found!");
+	fail_unless(!strcmp(opt[1]->id, "mode"), "Wrong 'decimate' option found!");
+	fail_unless(g_slist_length(opt[1]->values) == 2, "Wrong number of modes.");
+	sr_transform_options_free(opt);
+}
+END_TEST
+
+/* Input length for the decimation tests, not a multiple of factors. */
+#define DEC_SAMPLES		4999
+#define DEC_ANALOG_CHANNELS	2
+
+struct dec_fixture {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	/* All analog channels, and each analog channel on its own. */
+	GSList *analog_channels;
+	GSList *analog_channel[DEC_ANALOG_CHANNELS];
+	GRand *rand;
+};
+
+static void dec_setup(struct dec_fixture *f)
+{
+	struct sr_channel *ch;
+	int i;
+
+	f->sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(f->sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(f->sdi, 1, SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(f->sdi, 2, SR_CHANNEL_ANALOG, "A1");
+	sr_session_new(srtest_ctx, &f->session);
+	sr_session_dev_add(f->session, f->sdi);
+	f->analog_channels = NULL;
+	for (i = 0; i < DEC_ANALOG_CHANNELS; i++) {
+		ch = g_slist_nth_data(sr_dev_inst_channels_get(f->sdi), 1 + i);
+		f->analog_channels = g_slist_append(f->analog_channels, ch);
+		f->analog_channel[i] = g_slist_append(NULL, ch);
+	}
+	f->rand = g_rand_new_with_seed(1234);
+}
+
+static void dec_teardown(struct dec_fixture *f)
+{
+	int i;
+
+	g_rand_free(f->rand);
+	g_slist_free(f->analog_channels);
+	for (i = 0; i < DEC_ANALOG_CHANNELS; i++)
+		g_slist_free(f->analog_channel[i]);
+	sr_session_destroy(f->session);
+}
+
+static const struct sr_transform *dec_new(struct dec_fixture *f,
+	uint64_t factor, const char *mode)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "factor",
+		g_variant_ref_sink(g_variant_new_uint64(factor)));
+	g_hash_table_insert(options, "mode",
+		g_variant_ref_sink(g_variant_new_string(mode)));
+	t = sr_transform_new(sr_transform_find("decimate"), options, f->sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Cannot create 'decimate' transform.");
+
+	return t;
+}
+
+/* Packet sizes which start at and between bucket boundaries. */
+static size_t dec_next_len(struct dec_fixture *f, uint64_t factor,
+	size_t left)
+{
+	size_t len;
+
+	if (g_rand_boolean(f->rand))
+		len = factor * g_rand_int_range(f->rand, 1, 5);
+	else
+		len = g_rand_int_range(f->rand, 1, 3 * factor + 2);
+
+	return MIN(len, left);
+}
+
+/* Naive logic decimation, one sample and one byte at a time. */
+static size_t dec_logic_ref(const uint8_t *in, size_t count, size_t unitsize,
+	uint64_t factor, gboolean envelope, uint8_t *out)
+{
+	const uint8_t *prev, *smpl, *last;
+	size_t bucket, idx, byte, written;
+	uint8_t edges;
+
+	written = 0;
+	for (bucket = 0; (bucket + 1) * factor <= count; bucket++) {
+		last = &in[((bucket + 1) * factor - 1) * unitsize];
+		for (byte = 0; byte < unitsize && envelope; byte++) {
+			edges = 0;
+			for (idx = bucket * factor; idx < (bucket + 1) * factor; idx++) {
+				smpl = &in[idx * unitsize];
+				prev = idx ? smpl - unitsize : smpl;
+				edges |= smpl[byte] ^ prev[byte];
+			}
+			out[written * unitsize + byte] = last[byte] ^ edges;
+		}
+		if (envelope)
+			written++;
+		memcpy(&out[written * unitsize], last, unitsize);
+		written++;
+	}
+
+	return written;
+}
+
+/* Naive analog decimation of one channel. */
+static size_t dec_analog_ref(const float *in, size_t count, size_t stride,
+	uint64_t factor, gboolean envelope, float *out)
+{
+	size_t bucket, idx, min_idx, max_idx, written;
+	double sum;
+	float v;
+
+	written = 0;
+	for (bucket = 0; (bucket + 1) * factor <= count; bucket++) {
+		min_idx = max_idx = bucket * factor;
+		sum = 0;
+		for (idx = bucket * factor; idx < (bucket + 1) * factor; idx++) {
+			v = in[idx * stride];
+			if (v < in[min_idx * stride])
+				min_idx = idx;
+			if (v > in[max_idx * stride])
+				max_idx = idx;
+			sum += v;
+		}
+		if (!envelope) {
+			out[written++] = sum / factor;
+		} else {
+			out[written++] = in[MIN(min_idx, max_idx) * stride];
+			out[written++] = in[MAX(min_idx, max_idx) * stride];
+		}
+	}
+
+	return written;
+}
+
+/*
+ * Pass random logic data in packets of random size through the
+ * transform. Output must match the naive reference for all complete
+ * buckets, the incomplete last bucket gets dropped.
+ */
+static void check_decimate_logic(struct dec_fixture *f, uint64_t factor,
+	const char *mode, size_t unitsize)
+{
+	const struct sr_transform *t;
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_logic logic;
+	const struct sr_datafeed_logic *logic_out;
+	uint8_t *in, *ref, *pkt;
+	GByteArray *got;
+	size_t idx, pos, len, ref_count;
+	int ret;
+
+	in = g_malloc(DEC_SAMPLES * unitsize);
+	for (idx = 0; idx < DEC_SAMPLES * unitsize; idx++) {
+		in[idx] = idx < unitsize ? g_rand_int(f->rand) : in[idx - unitsize];
+		if (g_rand_int_range(f->rand, 0, 4 * factor) == 0)
+			in[idx] ^= 1 << g_rand_int_range(f->rand, 0, 8);
+	}
+	ref = g_malloc(2 * DEC_SAMPLES * unitsize);
+	ref_count = dec_logic_ref(in, DEC_SAMPLES, unitsize, factor,
+		!strcmp(mode, "envelope"), ref);
+
+	t = dec_new(f, factor, mode);
+	got = g_byte_array_new();
+	pkt = g_malloc(DEC_SAMPLES * unitsize);
+	for (pos = 0; pos < DEC_SAMPLES; pos += len) {
+		len = dec_next_len(f, factor, DEC_SAMPLES - pos);
+		/* Decimation works in place, pass a copy. */
+		memcpy(pkt, &in[pos * unitsize], len * unitsize);
+		logic.length = len * unitsize;
+		logic.unitsize = unitsize;
+		logic.data = pkt;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		ret = t->module->receive(t, &packet, &out);
+		fail_unless(ret == SR_OK, "Transform error %d.", ret);
+		if (!out)
+			continue;
+		fail_unless(out->type == SR_DF_LOGIC);
+		logic_out = out->payload;
+		fail_unless(logic_out->unitsize == unitsize);
+		g_byte_array_append(got, logic_out->data, logic_out->length);
+	}
+
+	fail_unless(got->len == ref_count * unitsize,
+		"Logic, factor %" PRIu64 ", %s, unitsize %zu: "
+		"%u bytes, expected %zu.", factor, mode, unitsize,
+		got->len, ref_count * unitsize);
+	fail_unless(!memcmp(got->data, ref, got->len),
+		"Logic, factor %" PRIu64 ", %s, unitsize %zu: data differs.",
+		factor, mode, unitsize);
+
+	sr_transform_free(t);
+	g_byte_array_free(got, TRUE);
+	g_free(in);
+	g_free(ref);
+	g_free(pkt);
+}
+
+/*
+ * Pass random analog data of two channels through the transform. Some
+ * packets hold both channels interleaved, others a single channel. Each
+ * channel's output must match the naive reference.
+ */
+static void check_decimate_analog(struct dec_fixture *f, uint64_t factor,
+	const char *mode)
+{
+	const struct sr_transform *t;
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_analog analog;
+	const struct sr_datafeed_analog *analog_out;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float *in, *ref[DEC_ANALOG_CHANNELS], *pkt, *values;
+	GArray *got[DEC_ANALOG_CHANNELS];
+	size_t idx, ch, pos, len, ref_count;
+	gboolean envelope, both;
+	int ret;
+
+	envelope = !strcmp(mode, "envelope");
+	in = g_malloc(DEC_SAMPLES * DEC_ANALOG_CHANNELS * sizeof(float));
+	for (idx = 0; idx < DEC_SAMPLES * DEC_ANALOG_CHANNELS; idx++)
+		in[idx] = g_rand_double_range(f->rand, -10.0, 10.0);
+	for (ch = 0; ch < DEC_ANALOG_CHANNELS; ch++) {
+		ref[ch] = g_malloc(2 * DEC_SAMPLES * sizeof(float));
+		ref_count = dec_analog_ref(&in[ch], DEC_SAMPLES,
+			DEC_ANALOG_CHANNELS, factor, envelope, ref[ch]);
+		got[ch] = g_array_new(FALSE, FALSE, sizeof(float));
+	}
+
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	t = dec_new(f, factor, mode);
+	pkt = g_malloc(DEC_SAMPLES * DEC_ANALOG_CHANNELS * sizeof(float));
+	values = g_malloc(DEC_SAMPLES * DEC_ANALOG_CHANNELS * sizeof(float));
+	both = TRUE;
+	for (pos = 0; pos < DEC_SAMPLES; pos += len) {
+		len = dec_next_len(f, factor, DEC_SAMPLES - pos);
+		/* Switch between joint and separate packets at boundaries. */
+		if (pos % factor == 0)
+			both = g_rand_boolean(f->rand);
+		for (ch = 0; ch < DEC_ANALOG_CHANNELS; ch++) {
+			if (both && ch)
+				break;
+			for (idx = 0; idx < len; idx++) {
+				if (both) {
+					memcpy(&pkt[idx * DEC_ANALOG_CHANNELS],
+						&in[(pos + idx) * DEC_ANALOG_CHANNELS],
+						DEC_ANALOG_CHANNELS * sizeof(float));
+				} else {
+					pkt[idx] = in[(pos + idx) *
+						DEC_ANALOG_CHANNELS + ch];
+				}
+			}
+			if (both)
+				meaning.channels = f->analog_channels;
+			else
+				meaning.channels = f->analog_channel[ch];
+			analog.data = pkt;
+			analog.num_samples = len;
+			ret = t->module->receive(t, &packet, &out);
+			fail_unless(ret == SR_OK, "Transform error %d.", ret);
+			if (!out)
+				continue;
+			fail_unless(out->type == SR_DF_ANALOG);
+			analog_out = out->payload;
+			sr_analog_to_float(analog_out, values);
+			for (idx = 0; idx < analog_out->num_samples; idx++) {
+				if (both) {
+					g_array_append_val(got[0],
+						values[idx * 2]);
+					g_array_append_val(got[1],
+						values[idx * 2 + 1]);
+				} else {
+					g_array_append_val(got[ch],
+						values[idx]);
+				}
+			}
+		}
+	}
+
+	for (ch = 0; ch < DEC_ANALOG_CHANNELS; ch++) {
+		fail_unless(got[ch]->len == ref_count,
+			"Analog, factor %" PRIu64 ", %s, channel %zu: "
+			"%u values, expected %zu.", factor, mode, ch,
+			got[ch]->len, ref_count);
+		fail_unless(!memcmp(got[ch]->data, ref[ch],
+			ref_count * sizeof(float)),
+			"Analog, factor %" PRIu64 ", %s, channel %zu: "
+			"data differs.", factor, mode, ch);
+		g_array_free(got[ch], TRUE);
+		g_free(ref[ch]);
+	}
+
+	sr_transform_free(t);
+	g_free(in);
+	g_free(pkt);
+	g_free(values);
+}
+
+START_TEST(test_transform_decimate_logic)
+{
+	static const uint64_t factors[] = { 2, 3, 7, 64, 1000, };
+	static const size_t unitsizes[] = { 1, 2, 3, 8, 9, 17, };
+	struct dec_fixture f;
+	size_t i, j;
+
+	dec_setup(&f);
+	for (i = 0; i < ARRAY_SIZE(factors); i++) {
+		for (j = 0; j < ARRAY_SIZE(unitsizes); j++) {
+			check_decimate_logic(&f, factors[i], "envelope",
+				unitsizes[j]);
+			check_decimate_logic(&f, factors[i], "mean",
+				unitsizes[j]);
+		}
+	}
+	dec_teardown(&f);
+}
+END_TEST
+
+START_TEST(test_transform_decimate_analog)
+{
+	static const uint64_t factors[] = { 2, 3, 7, 64, 1000, };
+	struct dec_fixture f;
+	size_t i;
+
+	dec_setup(&f);
+	for (i = 0; i < ARRAY_SIZE(factors); i++) {
+		check_decimate_analog(&f, factors[i], "envelope");
+		check_decimate_analog(&f, factors[i], "mean");
+	}
+	dec_teardown(&f);
+}
+END_TEST
+
+/* The samplerate is adjusted in a copy, the sender's packet is kept. */
+START_TEST(test_transform_decimate_meta)
+{
+	const struct sr_transform *t;
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_meta meta;
+	const struct sr_datafeed_meta *meta_out;
+	const struct sr_config *src;
+	struct sr_config rate, other;
+	struct dec_fixture f;
+	int ret;
+
+	dec_setup(&f);
+	t = dec_new(&f, 1000, "envelope");
+
+	rate.key = SR_CONF_SAMPLERATE;
+	rate.data = g_variant_ref_sink(g_variant_new_uint64(SR_MHZ(10)));
+	other.key = SR_CONF_LIMIT_SAMPLES;
+	other.data = g_variant_ref_sink(g_variant_new_uint64(12345));
+	meta.config = g_slist_append(NULL, &rate);
+	meta.config = g_slist_append(meta.config, &other);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+
+	ret = t->module->receive(t, &packet, &out);
+	fail_unless(ret == SR_OK, "Transform error %d.", ret);
+	fail_unless(out != NULL && out != &packet && out->type == SR_DF_META,
+		"No copy of the meta packet.");
+	fail_unless(g_variant_get_uint64(rate.data) == SR_MHZ(10),
+		"Sender's samplerate was modified.");
+	meta_out = out->payload;
+	fail_unless(g_slist_length(meta_out->config) == 2);
+	src = meta_out->config->data;
+	fail_unless(src->key == SR_CONF_SAMPLERATE &&
+		g_variant_get_uint64(src->data) == SR_KHZ(20),
+		"Unexpected output samplerate.");
+	src = meta_out->config->next->data;
+	fail_unless(src->key == SR_CONF_LIMIT_SAMPLES &&
+		g_variant_get_uint64(src->data) == 12345,
+		"Other config items were not passed on.");
+
+	g_slist_free(meta.config);
+	g_variant_unref(rate.data);
+	g_variant_unref(other.data);
+	sr_transform_free(t);
+	dec_teardown(&f);
+}
+END_TEST
+
+/* Logic channels of the invert tests' device, and the data's size. */
+#define INV_LOGIC_CHANNELS	12
+#define INV_UNITSIZE		2
+#define INV_SAMPLES		1001
+
+struct inv_fixture {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	/* Each analog channel on its own, as in analog packets. */
+	GSList *analog_channel[2];
+};
+
+static void inv_setup(struct inv_fixture *f)
+{
+	char name[8];
+	int i;
+
+	f->sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < INV_LOGIC_CHANNELS; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(f->sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_dev_inst_channel_add(f->sdi, INV_LOGIC_CHANNELS,
+		SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(f->sdi, INV_LOGIC_CHANNELS + 1,
+		SR_CHANNEL_ANALOG, "A1");
+	sr_session_new(srtest_ctx, &f->session);
+	sr_session_dev_add(f->session, f->sdi);
+	for (i = 0; i < 2; i++) {
+		f->analog_channel[i] = g_slist_append(NULL, g_slist_nth_data(
+			sr_dev_inst_channels_get(f->sdi), INV_LOGIC_CHANNELS + i));
+	}
+}
+
+static void inv_teardown(struct inv_fixture *f)
+{
+	g_slist_free(f->analog_channel[0]);
+	g_slist_free(f->analog_channel[1]);
+	sr_session_destroy(f->session);
+}
+
+static const struct sr_transform *inv_new(struct inv_fixture *f,
+	const char *channels)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "channels",
+		g_variant_ref_sink(g_variant_new_string(channels)));
+	t = sr_transform_new(sr_transform_find("invert"), options, f->sdi);
+	g_hash_table_destroy(options);
+
+	return t;
+}
+
+/*
+ * Invert random logic data, which ends in an incomplete sample. Only
+ * the bits in @a xor_mask may flip, the incomplete sample must be kept.
+ */
+static void check_invert_logic(const struct sr_transform *t,
+	const uint8_t *xor_mask)
+{
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_logic logic;
+	uint8_t *data, *ref;
+	size_t len, idx;
+	int ret;
+
+	len = INV_SAMPLES * INV_UNITSIZE + 1;
+	data = g_malloc(len);
+	ref = g_malloc(len);
+	for (idx = 0; idx < len; idx++) {
+		data[idx] = g_random_int();
+		ref[idx] = data[idx];
+		if (idx < len - 1)
+			ref[idx] ^= xor_mask[idx % INV_UNITSIZE];
+	}
+
+	logic.length = len;
+	logic.unitsize = INV_UNITSIZE;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = t->module->receive(t, &packet, &out);
+	fail_unless(ret == SR_OK, "Transform error %d.", ret);
+	fail_unless(out == &packet, "Logic data was not inverted in place.");
+	fail_unless(!memcmp(data, ref, len), "Unexpected logic data.");
+
+	g_free(data);
+	g_free(ref);
+}
+
+/* Pass an analog packet of one channel, and check the resulting scale. */
+static void check_invert_analog(const struct sr_transform *t,
+	GSList *channel, int64_t p, uint64_t q, int64_t p_exp, uint64_t q_exp)
+{
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float value;
+	int ret;
+
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	value = 1.0;
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+	encoding.scale.p = p;
+	encoding.scale.q = q;
+	encoding.offset.q = 1;
+	meaning.channels = channel;
+	analog.data = &value;
+	analog.num_samples = 1;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	ret = t->module->receive(t, &packet, &out);
+	fail_unless(ret == SR_OK, "Transform error %d.", ret);
+	fail_unless(out == &packet);
+	fail_unless(encoding.scale.p == p_exp && encoding.scale.q == q_exp,
+		"Scale %" PRIi64 "/%" PRIu64 " became %" PRIi64 "/%" PRIu64
+		", expected %" PRIi64 "/%" PRIu64 ".", p, q,
+		encoding.scale.p, encoding.scale.q, p_exp, q_exp);
+}
+
+/* Without a channel selection, all logic bits and analog scales invert. */
+START_TEST(test_transform_invert_all)
+{
+	static const uint8_t all[INV_UNITSIZE] = { 0xff, 0xff, };
+	const struct sr_transform *t;
+	struct inv_fixture f;
+
+	inv_setup(&f);
+	t = inv_new(&f, "");
+	fail_unless(t != NULL, "Cannot create 'invert' transform.");
+	check_invert_logic(t, all);
+	check_invert_analog(t, f.analog_channel[0], 2, 5, 5, 2);
+	check_invert_analog(t, f.analog_channel[1], -3, 4, -4, 3);
+	check_invert_analog(t, NULL, 1, 10, 10, 1);
+	sr_transform_free(t);
+	inv_teardown(&f);
+}
+END_TEST
+
+/*
+ * Select channels by name, with surrounding whitespace. Only their bits
+ * and scales may change, unknown names must be rejected.
+ */
+START_TEST(test_transform_invert_channels)
+{
+	static const uint8_t d1_d10[INV_UNITSIZE] = { 0x02, 0x04, };
+	static const uint8_t d0_d7_d8[INV_UNITSIZE] = { 0x81, 0x01, };
+	const struct sr_transform *t;
+	struct inv_fixture f;
+
+	inv_setup(&f);
+
+	t = inv_new(&f, "D1, D10");
+	fail_unless(t != NULL, "Cannot create 'invert' transform.");
+	check_invert_logic(t, d1_d10);
+	check_invert_analog(t, f.analog_channel[0], 2, 5, 2, 5);
+	check_invert_analog(t, f.analog_channel[1], 2, 5, 2, 5);
+	sr_transform_free(t);
+
+	t = inv_new(&f, " D8,D0 , D7,A1 ");
+	fail_unless(t != NULL, "Cannot create 'invert' transform.");
+	check_invert_logic(t, d0_d7_d8);
+	check_invert_analog(t, f.analog_channel[0], 2, 5, 2, 5);
+	check_invert_analog(t, f.analog_channel[1], 2, 5, 5, 2);
+	check_invert_analog(t, f.analog_channel[1], -3, 4, -4, 3);
+	sr_transform_free(t);
+
+	fail_unless(inv_new(&f, "D1, D12") == NULL,
+		"Unknown channel was accepted.");
+
+	inv_teardown(&f);
+}
+END_TEST
+
+/*
+ * Invert a few channels of a large capture, and all of them, through
+ * the transform. Reports the throughput (debug log).
+ */
+START_TEST(test_transform_invert_bench)
+{
+	static const char *specs[] = { "D1, D10", "", };
+	const size_t len = 32 * 1024 * 1024, runs = 8;
+	const struct sr_transform *t;
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_logic logic;
+	struct inv_fixture f;
+	uint8_t *data;
+	size_t idx, run;
+	gint64 start, usecs;
+
+	inv_setup(&f);
+	data = g_malloc(len);
+	for (idx = 0; idx < len; idx++)
+		data[idx] = g_random_int();
+
+	for (idx = 0; idx < ARRAY_SIZE(specs); idx++) {
+		t = inv_new(&f, specs[idx]);
+		fail_unless(t != NULL, "Cannot create 'invert' transform.");
+		logic.length = len;
+		logic.unitsize = INV_UNITSIZE;
+		logic.data = data;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		start = g_get_monotonic_time();
+		for (run = 0; run < runs; run++)
+			t->module->receive(t, &packet, &out);
+		usecs = g_get_monotonic_time() - start;
+		g_debug("Invert '%s': %zu x %zu bytes in %" PRIi64 " us, "
+			"%.1f MB/s.", specs[idx], runs, len, usecs,
+			usecs ? (double)runs * len / usecs : 0.0);
+		sr_transform_free(t);
+	}
+
+	g_free(data);
+	inv_teardown(&f);
+}
+END_TEST
+
 Suite *suite_transform_all(void)
 {
 	Suite *s;
@@ -110,6 +760,23 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_desc);
 	tcase_add_test(tc, test_transform_find);
 	tcase_add_test(tc, test_transform_options);
+	tcase_add_test(tc, test_transform_decimate_options);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("decimate");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_transform_decimate_logic);
+	tcase_add_test(tc, test_transform_decimate_analog);
+	tcase_add_test(tc, test_transform_decimate_meta);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("invert");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_set_timeout(tc, 0);
+	tcase_add_test(tc, test_transform_invert_all);
+	tcase_add_test(tc, test_transform_invert_channels);
+	tcase_add_test(tc, test_transform_invert_bench);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -20,9 +20,11 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /* Test lots of triggers/stages/matches/channels */
 #define NUM_TRIGGERS 70
@@ -249,6 +251,500 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/*
+ * Soft trigger checks. A device instance with logic channels gets
+ * created per test, its session receives pre-trigger data and the
+ * trigger marker.
+ */
+struct soft_trigger_env {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	uint64_t logic_bytes;
+	int triggers;
+	gboolean logic_after_trigger;
+};
+
+static void soft_trigger_feed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct soft_trigger_env *env;
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	env = cb_data;
+	if (packet->type == SR_DF_TRIGGER) {
+		env->triggers++;
+	} else if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		env->logic_bytes += logic->length;
+		if (env->triggers)
+			env->logic_after_trigger = TRUE;
+	}
+}
+
+static void soft_trigger_env_init(struct soft_trigger_env *env, int channels)
+{
+	char name[8];
+	int i, ret;
+
+	memset(env, 0, sizeof(*env));
+	ret = sr_session_new(srtest_ctx, &env->session);
+	fail_unless(ret == SR_OK, "sr_session_new() failed: %d.", ret);
+	env->sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(env->sdi != NULL);
+	for (i = 0; i < channels; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		ret = sr_dev_inst_channel_add(env->sdi, i, SR_CHANNEL_LOGIC, name);
+		fail_unless(ret == SR_OK);
+	}
+	ret = sr_session_dev_add(env->session, env->sdi);
+	fail_unless(ret == SR_OK, "sr_session_dev_add() failed: %d.", ret);
+	ret = sr_session_datafeed_callback_add(env->session,
+		soft_trigger_feed_in, env);
+	fail_unless(ret == SR_OK);
+	env->trigger = sr_trigger_new(NULL);
+}
+
+static void soft_trigger_env_free(struct soft_trigger_env *env)
+{
+	sr_trigger_free(env->trigger);
+	sr_session_destroy(env->session);
+	sr_dev_inst_free(env->sdi);
+}
+
+static struct sr_channel *soft_trigger_channel(struct soft_trigger_env *env,
+		int index)
+{
+	return g_slist_nth_data(env->sdi->channels, index);
+}
+
+static void soft_trigger_match_add(struct soft_trigger_env *env,
+		struct sr_trigger_stage *stage, int index, int match)
+{
+	int ret;
+
+	ret = sr_trigger_match_add(stage, soft_trigger_channel(env, index),
+		match, 0);
+	fail_unless(ret == SR_OK, "sr_trigger_match_add() failed: %d.", ret);
+}
+
+/* Run the soft trigger over a buffer, return the trigger's offset. */
+static int soft_trigger_run(struct soft_trigger_env *env,
+		const uint8_t *data, int len, int pre_trigger, int *pre_count)
+{
+	struct soft_trigger_logic *stl;
+	uint8_t *buf;
+	int offset;
+
+	stl = soft_trigger_logic_new(env->sdi, env->trigger, pre_trigger);
+	fail_unless(stl != NULL);
+	buf = g_malloc(len);
+	memcpy(buf, data, len);
+	offset = soft_trigger_logic_check(stl, buf, len, pre_count);
+	g_free(buf);
+	soft_trigger_logic_free(stl);
+
+	return offset;
+}
+
+/*
+ * Reference for the trigger's semantics, as the original per match
+ * implementation checked them. Stages need to match on consecutive
+ * samples. After a partial match the check resumes at the sample which
+ * follows the one where the first stage matched. Matches on disabled
+ * channels are ignored. Edges compare against the previously checked
+ * sample, and never match on the very first sample.
+ */
+struct soft_trigger_ref {
+	const struct sr_trigger *trigger;
+	int unitsize;
+	int cur_stage;
+	gboolean have_prev;
+	uint8_t prev[16];
+};
+
+static gboolean soft_trigger_ref_match(struct soft_trigger_ref *ref,
+		const uint8_t *sample, const struct sr_trigger_match *match)
+{
+	int index, bit, prev_bit;
+
+	index = match->channel->index;
+	bit = (sample[index / 8] >> (index % 8)) & 1;
+	prev_bit = (ref->prev[index / 8] >> (index % 8)) & 1;
+	switch (match->match) {
+	case SR_TRIGGER_ZERO:
+		return !bit;
+	case SR_TRIGGER_ONE:
+		return bit;
+	case SR_TRIGGER_RISING:
+		return ref->have_prev && !prev_bit && bit;
+	case SR_TRIGGER_FALLING:
+		return ref->have_prev && prev_bit && !bit;
+	case SR_TRIGGER_EDGE:
+		return ref->have_prev && prev_bit != bit;
+	default:
+		return FALSE;
+	}
+}
+
+static int soft_trigger_ref_check(struct soft_trigger_ref *ref,
+		const uint8_t *buf, int len)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	GSList *l;
+	gboolean match_found;
+	int i;
+
+	for (i = 0; i < len; i += ref->unitsize) {
+		stage = g_slist_nth_data(ref->trigger->stages, ref->cur_stage);
+		match_found = TRUE;
+		for (l = stage->matches; l; l = l->next) {
+			match = l->data;
+			if (!match->channel->enabled)
+				continue;
+			if (!soft_trigger_ref_match(ref, buf + i, match)) {
+				match_found = FALSE;
+				break;
+			}
+		}
+		memcpy(ref->prev, buf + i, ref->unitsize);
+		ref->have_prev = TRUE;
+		if (match_found) {
+			if (ref->cur_stage + 1 == (int)g_slist_length(ref->trigger->stages))
+				return i / ref->unitsize;
+			ref->cur_stage++;
+		} else if (ref->cur_stage > 0) {
+			i -= ref->cur_stage * ref->unitsize;
+			if (i < -ref->unitsize)
+				i = -ref->unitsize;
+			ref->cur_stage = 0;
+		}
+	}
+
+	return -1;
+}
+
+/* Check whether level matches need all channels to have their levels. */
+START_TEST(test_soft_trigger_levels)
+{
+	static const uint8_t data[] = { 0x00, 0x01, 0x08, 0x0b, 0x09, 0x08, 0x09, };
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+
+	soft_trigger_env_init(&env, 8);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 0, SR_TRIGGER_ONE);
+	soft_trigger_match_add(&env, stage, 1, SR_TRIGGER_ZERO);
+	soft_trigger_match_add(&env, stage, 3, SR_TRIGGER_ONE);
+	fail_unless(soft_trigger_run(&env, data, sizeof(data), 0, NULL) == 4);
+	fail_unless(env.triggers == 1);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/* Check rising, falling, and any edge matches. */
+START_TEST(test_soft_trigger_edges)
+{
+	static const uint8_t data[] = { 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, };
+	static const struct {
+		int match;
+		int offset;
+	} items[] = {
+		{ SR_TRIGGER_RISING, 4, },
+		{ SR_TRIGGER_FALLING, 2, },
+		{ SR_TRIGGER_EDGE, 2, },
+	};
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	size_t i;
+	int offset;
+
+	for (i = 0; i < ARRAY_SIZE(items); i++) {
+		soft_trigger_env_init(&env, 8);
+		stage = sr_trigger_stage_add(env.trigger);
+		soft_trigger_match_add(&env, stage, 0, items[i].match);
+		offset = soft_trigger_run(&env, data, sizeof(data), 0, NULL);
+		fail_unless(offset == items[i].offset,
+			"Match %d: offset %d, expected %d.",
+			items[i].match, offset, items[i].offset);
+		soft_trigger_env_free(&env);
+	}
+}
+END_TEST
+
+/*
+ * Check that a partial match of several stages resumes at the sample
+ * after the first stage's match. A "0001" sequence must be found in
+ * "00001", and "101" in "1100101".
+ */
+START_TEST(test_soft_trigger_stages)
+{
+	static const uint8_t data1[] = { 0x00, 0x00, 0x00, 0x00, 0x01, };
+	static const uint8_t data2[] = { 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, };
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	int i, offset;
+
+	soft_trigger_env_init(&env, 8);
+	for (i = 0; i < 4; i++) {
+		stage = sr_trigger_stage_add(env.trigger);
+		soft_trigger_match_add(&env, stage, 0,
+			i < 3 ? SR_TRIGGER_ZERO : SR_TRIGGER_ONE);
+	}
+	offset = soft_trigger_run(&env, data1, sizeof(data1), 0, NULL);
+	fail_unless(offset == 4, "Offset %d, expected 4.", offset);
+	soft_trigger_env_free(&env);
+
+	soft_trigger_env_init(&env, 8);
+	for (i = 0; i < 3; i++) {
+		stage = sr_trigger_stage_add(env.trigger);
+		soft_trigger_match_add(&env, stage, 0,
+			i == 1 ? SR_TRIGGER_ZERO : SR_TRIGGER_ONE);
+	}
+	offset = soft_trigger_run(&env, data2, sizeof(data2), 0, NULL);
+	fail_unless(offset == 6, "Offset %d, expected 6.", offset);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/* Check that matches on disabled channels are ignored. */
+START_TEST(test_soft_trigger_disabled)
+{
+	static const uint8_t data[] = { 0x00, 0x00, 0x02, };
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	int offset;
+
+	soft_trigger_env_init(&env, 8);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 0, SR_TRIGGER_ONE);
+	soft_trigger_match_add(&env, stage, 1, SR_TRIGGER_ONE);
+	soft_trigger_channel(&env, 0)->enabled = FALSE;
+	offset = soft_trigger_run(&env, data, sizeof(data), 0, NULL);
+	fail_unless(offset == 2, "Offset %d, expected 2.", offset);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/* Check channels beyond the first 64bit word of a sample. */
+START_TEST(test_soft_trigger_wide)
+{
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	uint8_t data[10 * 4];
+	int offset;
+
+	memset(data, 0, sizeof(data));
+	data[1 * 10 + 9] = 0x80;
+	data[3 * 10 + 9] = 0x80;
+	data[3 * 10 + 0] = 0x08;
+
+	soft_trigger_env_init(&env, 80);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 79, SR_TRIGGER_RISING);
+	soft_trigger_match_add(&env, stage, 3, SR_TRIGGER_ONE);
+	offset = soft_trigger_run(&env, data, sizeof(data), 0, NULL);
+	fail_unless(offset == 3, "Offset %d, expected 3.", offset);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/*
+ * Check that edges never match on the very first sample, even when
+ * a level match of the same stage gets checked before.
+ */
+START_TEST(test_soft_trigger_first_sample)
+{
+	static const uint8_t data[] = { 0x03, 0x02, 0x03, };
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	int offset;
+
+	soft_trigger_env_init(&env, 8);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 1, SR_TRIGGER_ONE);
+	soft_trigger_match_add(&env, stage, 0, SR_TRIGGER_RISING);
+	offset = soft_trigger_run(&env, data, sizeof(data), 0, NULL);
+	fail_unless(offset == 2, "Offset %d, expected 2.", offset);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/* Check that pre-trigger data of earlier buffers gets sent. */
+START_TEST(test_soft_trigger_pre_trigger)
+{
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_logic *stl;
+	uint8_t buf[10];
+	int offset, pre_count;
+
+	soft_trigger_env_init(&env, 8);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 0, SR_TRIGGER_ONE);
+	stl = soft_trigger_logic_new(env.sdi, env.trigger, 4);
+	memset(buf, 0, sizeof(buf));
+	offset = soft_trigger_logic_check(stl, buf, sizeof(buf), &pre_count);
+	fail_unless(offset == -1);
+	fail_unless(env.logic_bytes == 0);
+	buf[2] = 0x01;
+	offset = soft_trigger_logic_check(stl, buf, 3, &pre_count);
+	fail_unless(offset == 2, "Offset %d, expected 2.", offset);
+	fail_unless(pre_count == 4, "Pre-trigger count %d.", pre_count);
+	fail_unless(env.logic_bytes == 4);
+	fail_unless(env.triggers == 1 && !env.logic_after_trigger);
+	soft_trigger_logic_free(stl);
+	soft_trigger_env_free(&env);
+}
+END_TEST
+
+/*
+ * Generate sample data with runs of repeated samples and few changing
+ * bits, which lets random triggers match now and then.
+ */
+static void soft_trigger_random_data(uint8_t *data, int samples, int unitsize)
+{
+	int i, b;
+
+	for (b = 0; b < unitsize; b++)
+		data[b] = g_random_int();
+	for (i = 1; i < samples; i++) {
+		memcpy(&data[i * unitsize], &data[(i - 1) * unitsize], unitsize);
+		if (g_random_int_range(0, 4) == 0)
+			continue;
+		for (b = 0; b < unitsize; b++)
+			data[i * unitsize + b] ^= g_random_int() &
+				g_random_int() & g_random_int();
+	}
+}
+
+/*
+ * Check randomized triggers against the reference. Data gets presented
+ * in chunks of random size, which exercises the rewind after partial
+ * matches across buffer boundaries.
+ */
+START_TEST(test_soft_trigger_random)
+{
+	static const int unitsizes[] = { 1, 2, 3, 8, 10, };
+	const int samples = 512;
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_logic *stl;
+	struct soft_trigger_ref ref;
+	uint8_t *data;
+	int u, round, unitsize, channels, s, m, pos, len, offset, want;
+
+	g_random_set_seed(7);
+	for (u = 0; u < (int)ARRAY_SIZE(unitsizes); u++) {
+		unitsize = unitsizes[u];
+		channels = unitsize * 8;
+		data = g_malloc(samples * unitsize);
+		for (round = 0; round < 200; round++) {
+			soft_trigger_env_init(&env, channels);
+			for (s = g_random_int_range(1, 5); s; s--) {
+				stage = sr_trigger_stage_add(env.trigger);
+				for (m = g_random_int_range(1, 4); m; m--)
+					soft_trigger_match_add(&env, stage,
+						g_random_int_range(0, channels),
+						g_random_int_range(SR_TRIGGER_ZERO,
+							SR_TRIGGER_EDGE + 1));
+			}
+			soft_trigger_channel(&env, g_random_int_range(0,
+				channels))->enabled = FALSE;
+			soft_trigger_random_data(data, samples, unitsize);
+
+			memset(&ref, 0, sizeof(ref));
+			ref.trigger = env.trigger;
+			ref.unitsize = unitsize;
+			stl = soft_trigger_logic_new(env.sdi, env.trigger, 0);
+			for (pos = 0; pos < samples; pos += len) {
+				len = g_random_int_range(1, 40);
+				len = MIN(len, samples - pos);
+				want = soft_trigger_ref_check(&ref,
+					&data[pos * unitsize], len * unitsize);
+				offset = soft_trigger_logic_check(stl,
+					&data[pos * unitsize], len * unitsize, NULL);
+				fail_unless(offset == want, "Unit size %d, round %d, "
+					"sample %d: offset %d, expected %d.",
+					unitsize, round, pos, offset, want);
+				if (offset >= 0)
+					break;
+			}
+			soft_trigger_logic_free(stl);
+			soft_trigger_env_free(&env);
+		}
+		g_free(data);
+	}
+}
+END_TEST
+
+/*
+ * Benchmark the soft trigger on data which does not match, for random
+ * and mostly idle data, and compare with the reference. Run the test
+ * suite with CK_VERBOSE and G_MESSAGES_DEBUG set to see the rates.
+ */
+#define BENCH_BYTES (64 * 1024 * 1024)
+
+START_TEST(test_soft_trigger_bench)
+{
+	struct soft_trigger_env env;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_logic *stl;
+	struct soft_trigger_ref ref;
+	uint16_t *data;
+	size_t i, count;
+	gint64 start, usecs;
+	int idle, offset;
+	char what[48];
+
+	count = BENCH_BYTES / sizeof(data[0]);
+	data = g_malloc(BENCH_BYTES);
+	soft_trigger_env_init(&env, 16);
+	stage = sr_trigger_stage_add(env.trigger);
+	soft_trigger_match_add(&env, stage, 0, SR_TRIGGER_ONE);
+	soft_trigger_match_add(&env, stage, 15, SR_TRIGGER_RISING);
+
+	for (idle = 0; idle < 2; idle++) {
+		/* Channel 15 never rises, the trigger never matches. */
+		for (i = 0; i < count; i++) {
+			if (!idle || i % 256 == 0)
+				data[i] = g_random_int() & 0x7fff;
+			else
+				data[i] = data[i - 1];
+		}
+
+		stl = soft_trigger_logic_new(env.sdi, env.trigger, 0);
+		start = g_get_monotonic_time();
+		offset = soft_trigger_logic_check(stl, (uint8_t *)data,
+			BENCH_BYTES, NULL);
+		usecs = g_get_monotonic_time() - start;
+		soft_trigger_logic_free(stl);
+		fail_unless(offset == -1);
+		snprintf(what, sizeof(what), "Soft trigger, %s data",
+			idle ? "idle" : "random");
+		srtest_bench_report(what, BENCH_BYTES, "B", usecs);
+
+		memset(&ref, 0, sizeof(ref));
+		ref.trigger = env.trigger;
+		ref.unitsize = sizeof(data[0]);
+		start = g_get_monotonic_time();
+		offset = soft_trigger_ref_check(&ref, (uint8_t *)data,
+			BENCH_BYTES);
+		usecs = g_get_monotonic_time() - start;
+		fail_unless(offset == -1);
+		snprintf(what, sizeof(what), "Reference, %s data",
+			idle ? "idle" : "random");
+		srtest_bench_report(what, BENCH_BYTES, "B", usecs);
+	}
+
+	soft_trigger_env_free(&env);
+	g_free(data);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -276,5 +772,19 @@ Suite *suite_trigger(void)
 	tcase_add_test(tc, test_trigger_match_add_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("soft_trigger");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_soft_trigger_levels);
+	tcase_add_test(tc, test_soft_trigger_edges);
+	tcase_add_test(tc, test_soft_trigger_stages);
+	tcase_add_test(tc, test_soft_trigger_disabled);
+	tcase_add_test(tc, test_soft_trigger_wide);
+	tcase_add_test(tc, test_soft_trigger_first_sample);
+	tcase_add_test(tc, test_soft_trigger_pre_trigger);
+	tcase_add_test(tc, test_soft_trigger_random);
+	tcase_add_test(tc, test_soft_trigger_bench);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,194 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#ifdef HAVE_LIBUSB_1_0
+
+/* Snapshot lifetime as used by the library, plus some slack. */
+#define CACHE_TTL_US		(2 * 1000 * 1000)
+#define CACHE_TTL_SLACK_US	(200 * 1000)
+/* Number of device list lookups per benchmark pass. */
+#define BENCH_LOOKUPS		200
+/* Number of scans over all drivers per benchmark pass. */
+#define BENCH_SCANS		5
+
+/* Get a device list, returns FALSE when the host cannot enumerate. */
+static gboolean get_list(ssize_t *count)
+{
+	libusb_device **list;
+	ssize_t cnt;
+
+	cnt = sr_usb_get_device_list(srtest_ctx, &list);
+	if (cnt < 0)
+		return FALSE;
+	fail_unless(list[cnt] == NULL, "Device list not terminated.");
+	libusb_free_device_list(list, 1);
+	if (count)
+		*count = cnt;
+
+	return TRUE;
+}
+
+/*
+ * Lookups are served from the snapshot until it gets invalidated (as
+ * on hotplug events and firmware uploads), or its lifetime expires.
+ */
+START_TEST(test_usb_cache)
+{
+	uint64_t gen;
+	ssize_t first, cnt;
+
+	if (!get_list(&first)) {
+		g_debug("USB enumeration not available, skipping.");
+		return;
+	}
+	gen = sr_usb_cache_enumerations(srtest_ctx);
+	fail_unless(gen == 1, "Unexpected enumeration count %" PRIu64 ".",
+		gen);
+
+	fail_unless(get_list(&cnt), "Cached lookup failed.");
+	fail_unless(cnt == first, "Cached list differs.");
+	fail_unless(sr_usb_cache_enumerations(srtest_ctx) == gen,
+		"Lookup did not use the snapshot.");
+
+	sr_usb_cache_invalidate(srtest_ctx);
+	fail_unless(get_list(NULL), "Lookup after invalidation failed.");
+	fail_unless(sr_usb_cache_enumerations(srtest_ctx) == gen + 1,
+		"Invalidation did not cause an enumeration.");
+	fail_unless(get_list(NULL), "Cached lookup failed.");
+	fail_unless(sr_usb_cache_enumerations(srtest_ctx) == gen + 1,
+		"Lookup after enumeration did not use the snapshot.");
+
+	g_usleep(CACHE_TTL_US + CACHE_TTL_SLACK_US);
+	fail_unless(get_list(NULL), "Lookup after expiry failed.");
+	fail_unless(sr_usb_cache_enumerations(srtest_ctx) == gen + 2,
+		"Expired snapshot was used.");
+}
+END_TEST
+
+/*
+ * Compare device list lookups which enumerate the bus every time, as
+ * each driver's scan used to do, with lookups from the snapshot.
+ */
+START_TEST(test_usb_cache_bench)
+{
+	gint64 start, usecs_uncached, usecs_cached;
+	int i;
+
+	if (!get_list(NULL)) {
+		g_debug("USB enumeration not available, skipping.");
+		return;
+	}
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		sr_usb_cache_invalidate(srtest_ctx);
+		fail_unless(get_list(NULL), "Lookup failed.");
+	}
+	usecs_uncached = g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < BENCH_LOOKUPS; i++)
+		fail_unless(get_list(NULL), "Lookup failed.");
+	usecs_cached = g_get_monotonic_time() - start;
+
+	g_debug("USB device list: %d lookups, %" PRIi64 " us enumerating, "
+		"%" PRIi64 " us from snapshot.", BENCH_LOOKUPS,
+		usecs_uncached, usecs_cached);
+}
+END_TEST
+
+/*
+ * Scan with every driver, BENCH_SCANS times. Either each driver's scan
+ * enumerates the bus and reads the string descriptors again, as they
+ * used to do, or all scans of a pass share the snapshot.
+ */
+static gint64 scan_all(gboolean snapshot_per_driver, unsigned int *found)
+{
+	struct sr_dev_driver **drivers;
+	GSList *devices;
+	gint64 start;
+	int i, j;
+
+	drivers = sr_driver_list(srtest_ctx);
+	*found = 0;
+	start = g_get_monotonic_time();
+	for (i = 0; i < BENCH_SCANS; i++) {
+		sr_usb_cache_invalidate(srtest_ctx);
+		for (j = 0; drivers[j]; j++) {
+			if (snapshot_per_driver)
+				sr_usb_cache_invalidate(srtest_ctx);
+			devices = sr_driver_scan(drivers[j], NULL);
+			*found += g_slist_length(devices);
+			g_slist_free(devices);
+			sr_dev_clear(drivers[j]);
+		}
+	}
+
+	return g_get_monotonic_time() - start;
+}
+
+/* Compare scans over the full driver list with and without the snapshot. */
+START_TEST(test_usb_scan_bench)
+{
+	gint64 usecs_per_driver, usecs_shared;
+	unsigned int found_per_driver, found_shared;
+
+	if (!get_list(NULL)) {
+		g_debug("USB enumeration not available, skipping.");
+		return;
+	}
+	srtest_driver_init_all(srtest_ctx);
+
+	usecs_per_driver = scan_all(TRUE, &found_per_driver);
+	usecs_shared = scan_all(FALSE, &found_shared);
+	fail_unless(found_shared == found_per_driver,
+		"Scans found %u devices with the snapshot, %u without.",
+		found_shared, found_per_driver);
+
+	g_debug("Driver scans: %d passes, %u devices, %" PRIi64 " us "
+		"enumerating per driver, %" PRIi64 " us with the snapshot.",
+		BENCH_SCANS, found_shared, usecs_per_driver, usecs_shared);
+}
+END_TEST
+
+#endif
+
+Suite *suite_usb(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("usb");
+
+	tc = tcase_create("cache");
+	tcase_set_timeout(tc, 0);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+#ifdef HAVE_LIBUSB_1_0
+	tcase_add_test(tc, test_usb_cache);
+	tcase_add_test(tc, test_usb_cache_bench);
+	tcase_add_test(tc, test_usb_scan_bench);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}